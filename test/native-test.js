@@ -0,0 +1,54 @@
+'use strict';
+
+// Builds the host tests in test/native (test_*.cpp) with g++ and runs them, a test passes if it exits with 0
+
+const assert = require('node:assert');
+const { describe, it, before, after } = require('node:test');
+const fs = require('fs');
+const os = require('os');
+const path = require('path');
+const child_process = require('child_process');
+const util = require('util');
+const execFilePromise = util.promisify(child_process.execFile);
+
+const cxx = process.env.CXX || 'g++';
+const nativePath = path.join(__dirname, 'native');
+const tests = fs.readdirSync(nativePath).filter(f => /^test_.*\.cpp$/.test(f)).sort();
+
+function hasCompiler() {
+  try {
+    child_process.execFileSync(cxx, ['--version'], { stdio: 'ignore' });
+    return true;
+  } catch (e) {
+    return false;
+  }
+}
+
+describe('Native', { skip: !hasCompiler() && `${cxx} not found` }, () => {
+  let buildPath;
+
+  before(() => {
+    buildPath = fs.mkdtempSync(path.join(os.tmpdir(), 'wled-native-'));
+  });
+
+  after(() => {
+    fs.rmSync(buildPath, { recursive: true, force: true });
+  });
+
+  for (const test of tests) {
+    it(test, async () => {
+      const exe = path.join(buildPath, path.basename(test, '.cpp'));
+      try {
+        await execFilePromise(cxx, ['-std=gnu++17', '-O2', '-Wall', '-I', nativePath, '-o', exe, path.join(nativePath, test), '-lm']);
+      } catch (e) {
+        assert.fail(`${test} does not build:\n${e.stderr}`);
+      }
+      try {
+        const { stdout } = await execFilePromise(exe, [], { cwd: nativePath, timeout: 120000 });
+        console.log(stdout.trim());
+      } catch (e) {
+        assert.fail(`${test} failed:\n${e.stdout}${e.stderr}`);
+      }
+    });
+  }
+});
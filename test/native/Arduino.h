@@ -0,0 +1,3 @@
+#pragma once
+// Arduino core (stand-in for <Arduino.h>, included by modules after native_test.h)
+// native_test.h and the test provide what a module uses (pins, timing), nothing is declared here
@@ -0,0 +1,71 @@
+#pragma once
+// GIF decoder with the interface of Aircoookie/GifDecoder (stand-in for "GifDecoder.h", included after native_test.h)
+//
+// Instead of LZW compressed GIF data it reads uncompressed test files: "TGIF", width and height (16 bit little endian),
+// then per frame the delay in ms (16 bit) and width*height RGB triplets. Like the library it reads through the file
+// callbacks, draws every pixel of a frame through the pixel callback and starts over at the first frame after the last.
+
+template <int maxGifWidth, int maxGifHeight, int lzwMaxBits, bool useMalloc>
+class GifDecoder {
+  public:
+    typedef void (*callback)(void);
+    typedef void (*pixel_callback)(int16_t x, int16_t y, uint8_t red, uint8_t green, uint8_t blue);
+    typedef bool (*file_seek_callback)(unsigned long position);
+    typedef unsigned long (*file_position_callback)(void);
+    typedef int (*file_read_callback)(void);
+    typedef int (*file_read_block_callback)(void *buffer, int numberOfBytes);
+    typedef int (*file_size_callback)(void);
+
+    static const unsigned headerSize = 8;
+    unsigned allocs = 0, deallocs = 0, frameDecodes = 0;
+
+    void setScreenClearCallback(callback f)                   { screenClear = f; }
+    void setUpdateScreenCallback(callback f)                  { updateScreen = f; }
+    void setDrawPixelCallback(pixel_callback f)               { drawPixel = f; }
+    void setFileSeekCallback(file_seek_callback f)            { fileSeek = f; }
+    void setFilePositionCallback(file_position_callback f)    { filePosition = f; }
+    void setFileReadCallback(file_read_callback f)            { fileRead = f; }
+    void setFileReadBlockCallback(file_read_block_callback f) { fileReadBlock = f; }
+    void setFileSizeCallback(file_size_callback f)            { fileSize = f; }
+
+    void alloc()   { allocs++; }
+    void dealloc() { deallocs++; buf.clear(); buf.shrink_to_fit(); }
+
+    int startDecoding() {
+      uint8_t h[headerSize];
+      width = height = 0;
+      if (!fileSeek(0) || fileReadBlock(h, headerSize) != (int)headerSize || memcmp(h, "TGIF", 4)) return -1;
+      width  = h[4] | h[5] << 8;
+      height = h[6] | h[7] << 8;
+      if (!width || !height || width > maxGifWidth || height > maxGifHeight) return -1;
+      buf.resize(2 + width * height * 3);
+      return 0;
+    }
+
+    void getSize(uint16_t *w, uint16_t *h) { *w = width; *h = height; }
+
+    int decodeFrame(bool delayAfterDecode) {
+      if ((int)filePosition() >= fileSize()) fileSeek(headerSize); // trailer: loop
+      if (filePosition() == headerSize && screenClear) screenClear();
+      if (fileReadBlock(buf.data(), buf.size()) != (int)buf.size()) return -1;
+      delay = buf[0] | buf[1] << 8;
+      const uint8_t *p = buf.data() + 2;
+      for (int y = 0; y < height; y++) for (int x = 0; x < width; x++, p += 3) drawPixel(x, y, p[0], p[1], p[2]);
+      if (updateScreen) updateScreen();
+      frameDecodes++;
+      return 0;
+    }
+
+    uint16_t getFrameDelay_ms() { return delay; }
+
+  private:
+    callback screenClear = nullptr, updateScreen = nullptr;
+    pixel_callback drawPixel = nullptr;
+    file_seek_callback fileSeek = nullptr;
+    file_position_callback filePosition = nullptr;
+    file_read_callback fileRead = nullptr;
+    file_read_block_callback fileReadBlock = nullptr;
+    file_size_callback fileSize = nullptr;
+    std::vector<uint8_t> buf;
+    uint16_t width = 0, height = 0, delay = 0;
+};
@@ -0,0 +1,23 @@
+#pragma once
+// IPv4 address as in the Arduino core (stand-in for <IPAddress.h>, included by native_test.h after String)
+
+class IPAddress {
+  public:
+    IPAddress() : _ip{0,0,0,0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _ip{a,b,c,d} {}
+    IPAddress(uint32_t addr) { memcpy(_ip, &addr, 4); } // network byte order, first octet in lowest byte
+    operator uint32_t() const { uint32_t a; memcpy(&a, _ip, 4); return a; }
+    uint8_t operator[](int i) const { return _ip[i]; }
+    uint8_t &operator[](int i) { return _ip[i]; }
+    bool operator==(const IPAddress &o) const { return !memcmp(_ip, o._ip, 4); }
+    bool operator!=(const IPAddress &o) const { return !(*this == o); }
+    bool fromString(const char *s) {
+      unsigned a, b, c, d; char end;
+      if (sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &end) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false;
+      _ip[0] = a; _ip[1] = b; _ip[2] = c; _ip[3] = d;
+      return true;
+    }
+    String toString() const { char b[16]; snprintf(b, sizeof(b), "%u.%u.%u.%u", _ip[0], _ip[1], _ip[2], _ip[3]); return String(b); }
+  private:
+    uint8_t _ip[4];
+};
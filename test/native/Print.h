@@ -0,0 +1,19 @@
+#pragma once
+// Arduino Print (stand-in for <Print.h>, included after native_test.h)
+
+class Print {
+  public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) { size_t n = 0; while (size--) n += write(*buffer++); return n; }
+    size_t write(const char *s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const char *s) { return write(s); }
+    size_t print(const String &s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return print(std::to_string(v).c_str()); }
+    size_t print(unsigned v) { return print(std::to_string(v).c_str()); }
+    size_t print(long v) { return print(std::to_string(v).c_str()); }
+    size_t print(unsigned long v) { return print(std::to_string(v).c_str()); }
+    size_t println() { return write("\r\n"); }
+    template <typename T> size_t println(T v) { return print(v) + println(); }
+};
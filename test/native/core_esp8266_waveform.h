@@ -0,0 +1,5 @@
+#pragma once
+// ESP8266 waveform generator (stand-in for "core_esp8266_waveform.h", used by BusPwm)
+
+static inline int startWaveformClockCycles(uint8_t pin, uint32_t highCcys, uint32_t lowCcys, uint32_t runTimeCcys,
+                                           int8_t alignPhase = -1, uint32_t phaseOffsetCcys = 0, bool autoPwm = false) { return 0; }
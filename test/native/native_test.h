@@ -0,0 +1,153 @@
+#pragma once
+/*
+ * Host test support for wled00 modules (built with g++ by test/native-test.js)
+ *
+ * A test defines the Arduino and WLED symbols a module needs and includes the module .cpp directly,
+ * wled.h is skipped by predefining its include guard. Only what is common to several tests lives here.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <chrono>
+
+// Arduino String, also accepted by ArduinoJson (no iterators, otherwise ArduinoJson would treat it as a container)
+class String {
+  public:
+    String() {}
+    String(const char *s) : _s(s ? s : "") {}
+    String(const std::string &s) : _s(s) {}
+    String(int v) : _s(std::to_string(v)) {}
+    String(unsigned v) : _s(std::to_string(v)) {}
+    String(long v) : _s(std::to_string(v)) {}
+    String(unsigned long v) : _s(std::to_string(v)) {}
+    const char *c_str() const { return _s.c_str(); }
+    size_t length() const { return _s.size(); }
+    bool isEmpty() const { return _s.empty(); }
+    char operator[](size_t i) const { return _s[i]; }
+    bool operator==(const String &o) const { return _s == o._s; }
+    bool operator==(const char *o) const { return _s == o; }
+    bool operator!=(const char *o) const { return _s != o; }
+    String &operator+=(const String &o) { _s += o._s; return *this; }
+    String &operator+=(const char *o) { _s += o; return *this; }
+    String &operator+=(char c) { _s += c; return *this; }
+    String operator+(const String &o) const { return String(_s + o._s); }
+    int indexOf(const char *s) const { size_t p = _s.find(s); return p == std::string::npos ? -1 : (int)p; }
+    int indexOf(char c) const { size_t p = _s.find(c); return p == std::string::npos ? -1 : (int)p; }
+    String substring(size_t from, size_t to = std::string::npos) const { return from >= _s.size() ? String() : String(_s.substr(from, to == std::string::npos ? to : to - from)); }
+    bool startsWith(const char *s) const { return _s.rfind(s, 0) == 0; }
+    bool equals(const char *s) const { return _s == s; }
+    long toInt() const { return strtol(c_str(), nullptr, 10); }
+    bool concat(const char *s) { _s += s; return true; }
+    void setCharAt(size_t i, char c) { if (i < _s.size()) _s[i] = c; }
+  private:
+    std::string _s;
+};
+class StringSumHelper : public String {};
+
+#define ARDUINOJSON_ENABLE_ARDUINO_STRING 1
+#define ARDUINOJSON_DECODE_UNICODE 0 // as in wled.h
+#include "../../wled00/src/dependencies/json/ArduinoJson-v6.h"
+
+#define WLED_H // do not pull in the firmware headers
+
+// Arduino core
+#define PROGMEM
+#define IRAM_ATTR
+#define PSTR(s) (s)
+#define F(s) (s)
+#define FPSTR(s) (s)
+#define strlen_P strlen
+#define strncmp_P strncmp
+#define strcmp_P strcmp
+#define memcpy_P memcpy
+#define strcpy_P strcpy
+#define strcat_P strcat
+#define sprintf_P sprintf
+#define snprintf_P snprintf
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+
+#define DEBUG_PRINT(x)
+#define DEBUG_PRINTLN(x)
+#define DEBUG_PRINTF(...)
+#define DEBUG_PRINTF_P(...)
+
+using std::min;
+using std::max;
+template <typename T, typename L, typename H> static inline T constrain(T v, L lo, H hi) { return v < lo ? lo : (v > hi ? hi : v); }
+
+#include <IPAddress.h>
+
+// BSD strlcpy() of the Arduino cores (not in every libc)
+static inline size_t testStrlcpy(char *dst, const char *src, size_t size) {
+  const size_t len = strlen(src);
+  if (size) { const size_t n = min(len, size - 1); memcpy(dst, src, n); dst[n] = 0; }
+  return len;
+}
+#define strlcpy testStrlcpy
+
+// WLED allocators (PSRAM aware on the device), tracked: bytes in use, peak (realloc counts old and new block),
+// bytes copied by realloc and an optional limit to simulate a full heap
+static size_t testHeapUsed = 0, testHeapPeak = 0, testHeapCopied = 0, testHeapLimit = SIZE_MAX;
+static inline size_t &testBlockSize(void *p) { return *(static_cast<size_t*>(p) - 2); } // 16 byte header keeps alignment
+static inline void *p_malloc(size_t n) {
+  if (testHeapUsed + n > testHeapLimit) return nullptr;
+  size_t *b = static_cast<size_t*>(malloc(n + 2*sizeof(size_t)));
+  if (!b) return nullptr;
+  b[0] = n;
+  testHeapUsed += n;
+  testHeapPeak = max(testHeapPeak, testHeapUsed);
+  return b + 2;
+}
+static inline void p_free(void *p) {
+  if (!p) return;
+  testHeapUsed -= testBlockSize(p);
+  free(static_cast<size_t*>(p) - 2);
+}
+static inline void *p_realloc(void *p, size_t n) {
+  if (!p) return p_malloc(n);
+  const size_t old = testBlockSize(p);
+  if (testHeapUsed + n > testHeapLimit) return nullptr;
+  testHeapPeak = max(testHeapPeak, testHeapUsed + n); // old block is freed after copying
+  void *q = p_malloc(n);
+  if (!q) return nullptr;
+  memcpy(q, p, min(old, n));
+  testHeapCopied += min(old, n);
+  p_free(p);
+  return q;
+}
+static inline void *p_calloc(size_t c, size_t n)  { void *p = p_malloc(c * n); if (p) memset(p, 0, c * n); return p; }
+
+// test reporting
+static unsigned testFailures = 0;
+static unsigned testChecks = 0;
+
+#define CHECK(cond) do { testChecks++; if (!(cond)) { testFailures++; \
+  fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); } } while (0)
+#define CHECK_EQ(a, b) do { testChecks++; long long _a = (long long)(a), _b = (long long)(b); if (_a != _b) { testFailures++; \
+  fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", __FILE__, __LINE__, #a, #b, _a, _b); } } while (0)
+#define CHECK_NEAR(a, b, tol) do { testChecks++; double _a = (double)(a), _b = (double)(b); if (fabs(_a - _b) > (tol)) { testFailures++; \
+  fprintf(stderr, "%s:%d: CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__, #a, #b, _a, _b); } } while (0)
+
+static inline int testResult(const char *name) {
+  printf("%s: %u checks, %u failed\n", name, testChecks, testFailures);
+  return testFailures ? 1 : 0;
+}
+
+// deterministic pseudo random numbers (xorshift32), tests must be reproducible
+static uint32_t testSeed = 0x12345678;
+static inline uint32_t testRandom() { testSeed ^= testSeed << 13; testSeed ^= testSeed >> 17; testSeed ^= testSeed << 5; return testSeed; }
+static inline uint32_t testRandom(uint32_t n) { return n ? testRandom() % n : 0; }
+
+// wall clock for throughput figures
+static inline double benchSeconds() {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
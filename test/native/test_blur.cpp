@@ -0,0 +1,224 @@
+/*
+ * 2D blur (FX_blur.cpp): SWAR blur2D() against the former per pixel blur2D(), box_blur() against a plain box filter
+ * blur2D() is run with random blur amounts (rows, columns or both, with and without smear) on random frames of many
+ * sizes and has to be bit-exact with the former color_fade()/color_add() implementation (apart from first pixels of a
+ * row or column the former one left faded, see formerBlur2D()). box_blur() is compared with a separable box filter
+ * with replicated edges for every radius and 1 to 3 passes. Both blurs are timed on 64x64 and 128x128 segments.
+ */
+#include "native_test.h"
+
+#define BLACK 0
+#define RGBW32(r,g,b,w) (uint32_t((uint8_t)(w) << 24 | (uint8_t)(r) << 16 | (uint8_t)(g) << 8 | (uint8_t)(b)))
+#define R(c) ((uint8_t)((c) >> 16))
+#define G(c) ((uint8_t)((c) >> 8))
+#define B(c) ((uint8_t)(c))
+#define W(c) ((uint8_t)((c) >> 24))
+
+class Segment {
+  public:
+    static unsigned _vWidth, _vHeight;
+    mutable std::vector<uint32_t> pixels;
+
+    void setSize(unsigned w, unsigned h) { _vWidth = w; _vHeight = h; pixels.assign(w * h, 0); }
+    bool isActive() const { return true; }
+    static unsigned vWidth()  { return _vWidth; }
+    static unsigned vHeight() { return _vHeight; }
+    uint32_t *getPixels() const { return pixels.data(); }
+    void     setPixelColorRaw(unsigned i, uint32_t c) const { pixels[i] = c; }
+    uint32_t getPixelColorRaw(unsigned i) const { return pixels[i]; }
+    void box_blur(unsigned radius = 1U, bool smear = false, unsigned passes = 1) const;
+    void blur2D(uint8_t blur_x, uint8_t blur_y, bool smear = false) const;
+    void formerBlur2D(uint8_t blur_x, uint8_t blur_y, bool smear = false, bool writeAll = false) const;
+};
+unsigned Segment::_vWidth = 0, Segment::_vHeight = 0;
+
+#include "../../wled00/FX_blur.cpp"
+
+// as in colors.cpp (not inlined, called across translation units in the firmware)
+static uint32_t __attribute__((noinline)) color_add(uint32_t c1, uint32_t c2, bool preserveCR = false)
+{
+  if (c1 == BLACK) return c2;
+  if (c2 == BLACK) return c1;
+  const uint32_t TWO_CHANNEL_MASK = 0x00FF00FF;
+  uint32_t rb = ( c1     & TWO_CHANNEL_MASK) + ( c2     & TWO_CHANNEL_MASK);
+  uint32_t wg = ((c1>>8) & TWO_CHANNEL_MASK) + ((c2>>8) & TWO_CHANNEL_MASK);
+  uint32_t r = rb >> 16;
+  uint32_t b = rb & 0xFFFF;
+  uint32_t w = wg >> 16;
+  uint32_t g = wg & 0xFFFF;
+  r = r > 255 ? 255 : r;
+  g = g > 255 ? 255 : g;
+  b = b > 255 ? 255 : b;
+  w = w > 255 ? 255 : w;
+  return RGBW32(r,g,b,w);
+}
+
+static uint32_t __attribute__((noinline)) color_fade(uint32_t c1, uint8_t amount, bool video = false)
+{
+  if (amount == 255) return c1;
+  if (c1 == BLACK || amount == 0) return BLACK;
+  uint32_t scale = amount + 1;
+  const uint32_t TWO_CHANNEL_MASK = 0x00FF00FF;
+  uint32_t rb = (((c1 & TWO_CHANNEL_MASK) * scale) >> 8) &  TWO_CHANNEL_MASK;
+  uint32_t wg = (((c1 >> 8) & TWO_CHANNEL_MASK) * scale) & ~TWO_CHANNEL_MASK;
+  return rb | wg;
+}
+
+// former blur2D() (per pixel color_fade()/color_add() through the raw pixel accessors)
+// it skipped writing a pixel whose blurred value equals its original value, but the first pixel of a row or column
+// has already been overwritten then and keeps its faded value, writeAll leaves out that skip
+void Segment::formerBlur2D(uint8_t blur_x, uint8_t blur_y, bool smear, bool writeAll) const {
+  if (!isActive()) return; // not active
+  const unsigned cols = vWidth();
+  const unsigned rows = vHeight();
+  const auto XY = [&](unsigned x, unsigned y){ return x + y*cols; };
+  uint32_t lastnew = 0; // set by the first iteration
+  uint32_t last = 0;
+  if (blur_x) {
+    const uint8_t keepx = smear ? 255 : 255 - blur_x;
+    const uint8_t seepx = blur_x >> 1;
+    for (unsigned row = 0; row < rows; row++) {
+      uint32_t carryover = BLACK;
+      uint32_t curnew = BLACK;
+      for (unsigned x = 0; x < cols; x++) {
+        uint32_t cur = getPixelColorRaw(XY(x, row));
+        uint32_t part = color_fade(cur, seepx);
+        curnew = color_fade(cur, keepx);
+        if (x > 0) {
+          if (carryover) curnew = color_add(curnew, carryover);
+          uint32_t prev = color_add(lastnew, part);
+          if (last != prev || writeAll) setPixelColorRaw(XY(x - 1, row), prev);
+        } else setPixelColorRaw(XY(x, row), curnew);
+        lastnew = curnew;
+        last = cur;
+        carryover = part;
+      }
+      setPixelColorRaw(XY(cols-1, row), curnew);
+    }
+  }
+  if (blur_y) {
+    const uint8_t keepy = smear ? 255 : 255 - blur_y;
+    const uint8_t seepy = blur_y >> 1;
+    for (unsigned col = 0; col < cols; col++) {
+      uint32_t carryover = BLACK;
+      uint32_t curnew = BLACK;
+      for (unsigned y = 0; y < rows; y++) {
+        uint32_t cur = getPixelColorRaw(XY(col, y));
+        uint32_t part = color_fade(cur, seepy);
+        curnew = color_fade(cur, keepy);
+        if (y > 0) {
+          if (carryover) curnew = color_add(curnew, carryover);
+          uint32_t prev = color_add(lastnew, part);
+          if (last != prev || writeAll) setPixelColorRaw(XY(col, y - 1), prev);
+        } else setPixelColorRaw(XY(col, y), curnew);
+        lastnew = curnew;
+        last = cur;
+        carryover = part;
+      }
+      setPixelColorRaw(XY(col, rows - 1), curnew);
+    }
+  }
+}
+
+// box filter over 2*radius+1 pixels with replicated edges, rows then columns, each channel rounded down
+static void referenceBoxBlur(std::vector<uint32_t> &px, unsigned cols, unsigned rows, unsigned radius, bool smear, unsigned passes) {
+  const int d = 2 * radius + 1;
+  std::vector<uint32_t> src;
+  const auto blur1D = [&](unsigned n, unsigned count, unsigned stride, unsigned step) {
+    for (unsigned k = 0; k < count; k++) {
+      src = px;
+      for (unsigned i = 0; i < n; i++) {
+        uint32_t out = 0;
+        for (int ch = 0; ch < 32; ch += 8) {
+          unsigned sum = 0;
+          for (int j = -(int)radius; j <= (int)radius; j++) sum += (src[k * stride + constrain((int)i + j, 0, (int)n - 1) * step] >> ch) & 0xFF;
+          unsigned v = sum / d;
+          if (smear) v = max(v, (src[k * stride + i * step] >> ch) & 0xFF);
+          out |= v << ch;
+        }
+        px[k * stride + i * step] = out;
+      }
+    }
+  };
+  while (passes--) {
+    blur1D(cols, rows, cols, 1);
+    blur1D(rows, cols, 1, cols);
+  }
+}
+
+static void randomFrame(Segment &seg) {
+  const unsigned kind = testRandom(3);
+  for (auto &c : seg.pixels) {
+    if (kind == 0) c = testRandom();                                          // noise, all channels
+    else if (kind == 1) c = testRandom(8) ? 0 : testRandom() | 0x00E0E0E0;    // sparse bright dots (saturating adds)
+    else c = testRandom() & 0x00FFFFFF;                                       // RGB only
+  }
+}
+
+int main() {
+  Segment seg;
+
+  // SWAR blur2D() against the former implementation: bit-exact, except for first pixels the former skip left faded
+  static const unsigned sizes[][2] = { {1, 1}, {1, 20}, {20, 1}, {15, 16}, {16, 16}, {17, 9}, {33, 40}, {64, 64} };
+  unsigned runs = 0, mismatches = 0, skipped = 0, skippedOutside = 0;
+  for (const auto &sz : sizes) {
+    seg.setSize(sz[0], sz[1]);
+    for (unsigned i = 0; i < 400; i++, runs++) {
+      randomFrame(seg);
+      const uint8_t bx = testRandom(3) ? testRandom(256) : 0, by = testRandom(3) ? testRandom(256) : 0;
+      const bool smear = testRandom(2);
+      Segment former = seg, exact = seg;
+      former.formerBlur2D(bx, by, smear);
+      exact.formerBlur2D(bx, by, smear, true);
+      seg.blur2D(bx, by, smear);
+      if (seg.pixels != exact.pixels && !mismatches++)
+        fprintf(stderr, "blur2D mismatch: %ux%u blur %u/%u smear %d\n", sz[0], sz[1], bx, by, smear);
+      for (unsigned k = 0; k < seg.pixels.size(); k++) if (former.pixels[k] != exact.pixels[k]) {
+        skipped++;
+        if (k % sz[0] && k >= sz[0]) skippedOutside++; // only the first column and the first row are affected
+      }
+    }
+  }
+  CHECK_EQ(mismatches, 0);
+  CHECK_EQ(skippedOutside, 0);
+  printf("blur2D: %u frames, %u differ from former blur (%u first pixels were left faded by the former blur)\n", runs, mismatches, skipped);
+
+  // box_blur() against the plain box filter
+  static const unsigned boxSizes[][2] = { {1, 1}, {2, 7}, {16, 16}, {17, 5}, {40, 33} };
+  unsigned boxRuns = 0, boxMismatches = 0;
+  for (const auto &sz : boxSizes) {
+    seg.setSize(sz[0], sz[1]);
+    for (unsigned radius = 1; radius <= 10; radius++) for (unsigned passes = 1; passes <= 3; passes++) for (bool smear : {false, true}) {
+      randomFrame(seg);
+      std::vector<uint32_t> ref = seg.pixels;
+      referenceBoxBlur(ref, sz[0], sz[1], min(radius, 8U), smear, passes); // radius is limited to BLUR_MAX_RADIUS
+      seg.box_blur(radius, smear, passes);
+      boxRuns++;
+      if (seg.pixels != ref && !boxMismatches++)
+        fprintf(stderr, "box_blur mismatch: %ux%u radius %u passes %u smear %d\n", sz[0], sz[1], radius, passes, smear);
+    }
+  }
+  CHECK_EQ(boxMismatches, 0);
+  printf("box_blur: %u frames, %u differ from box filter\n", boxRuns, boxMismatches);
+
+  // time per blur
+  for (unsigned size : {64U, 128U}) {
+    seg.setSize(size, size);
+    randomFrame(seg);
+    const unsigned n = 64 * 128 * 128 / (size * size);
+    const auto bench = [&](auto blur) {
+      double t0 = benchSeconds();
+      for (unsigned i = 0; i < n; i++) { seg.pixels[i % seg.pixels.size()] |= 0x00FFFFFF; blur(); }
+      return (benchSeconds() - t0) * 1e6 / n;
+    };
+    const double former = bench([&]{ seg.formerBlur2D(128, 128); });
+    const double swar   = bench([&]{ seg.blur2D(128, 128); });
+    const double box1   = bench([&]{ seg.box_blur(1); });
+    const double box3   = bench([&]{ seg.box_blur(3, false, 3); });
+    const double box8   = bench([&]{ seg.box_blur(8, false, 3); });
+    printf("%ux%u: blur2D former %.1f us, SWAR %.1f us; box_blur r1 %.1f us, r3x3 %.1f us, r8x3 %.1f us\n",
+           size, size, former, swar, box1, box3, box8);
+  }
+
+  return testResult("blur");
+}
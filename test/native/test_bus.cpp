@@ -0,0 +1,373 @@
+/*
+ * Bulk pixel hand-off to buses (bus_manager.cpp): BusManager::setPixels() against BusManager::setPixelColor()
+ * Buses are built on a mock PolyBus that stores the channels it would send (after color order and W/CCT swaps).
+ * Random bus layouts (RGB, RGBW with all auto white modes, WWA, CCT chips, 1CH_X3, network buses, reversed,
+ * skipped pixels, color order maps, global auto white, CCT and white balance) are painted pixel by pixel and in
+ * runs of up to 64 pixels as WS2812FX::show() hands them over, the channel data of every bus has to be identical.
+ * Frames of 10240 pixels on 8 and 16 buses are timed both ways.
+ * Per bus current limiting (ABL) decided before the frame is set is compared with the former read back and repaint in
+ * BusDigital::show(): channels sent against the full brightness frame scaled once, and the time per frame. 1CH_X3
+ * buses have to restore shared IC channels with the brightness they were set with while global ABL changes it.
+ */
+#include "native_test.h"
+#include <memory>
+
+typedef uint8_t byte;
+#define ESP8266
+#define WLED_DISABLE_PERF_STATS
+#define GPIO_PIN_COUNT 16
+#define F_CPU 80000000UL
+#define OUTPUT 1
+#define LOW 0
+#define HIGH 1
+#define LED_BUILTIN 2
+static void pinMode(uint8_t, uint8_t) {}
+static void digitalWrite(uint8_t, uint8_t) {}
+static void analogWriteRange(uint32_t) {}
+static void analogWriteFreq(uint32_t) {}
+static unsigned long micros() { return 0; }
+static unsigned long millis() { return 0; }
+static void delay(unsigned long) {}
+static void yield() {}
+
+bool cctICused = false;
+bool useParallelI2S = false;
+
+// mock PolyBus (instead of bus_wrapper.h): one NeoPixelBus-like buffer per bus with the channels in wire order
+#define BusWrapper_h
+#define I_NONE 0
+#define I_MOCK 1
+struct MockNeoBus {
+  std::vector<uint8_t> ch; // R, G, B, W, WW, CW per pixel (after color order and swaps)
+  uint8_t bri = 255;        // luminance of NeoPixelBusLg, channels are scaled while they are set
+};
+static std::vector<MockNeoBus*> mockBuses; // in order of creation
+class PolyBus {
+    static bool _useParallelI2S;
+  public:
+    static inline void setParallelI2S1Output(bool b = true) { _useParallelI2S = b; }
+    static inline bool isParallelI2S1Output(void) { return _useParallelI2S; }
+    static uint8_t  getI(uint8_t busType, const uint8_t* pins, uint8_t num = 0) { return I_MOCK; }
+    static void    *create(uint8_t busType, uint8_t* pins, uint16_t len, uint8_t channel) { auto b = new MockNeoBus; b->ch.assign(len * 6, 0); mockBuses.push_back(b); return b; }
+    static void     begin(void* busPtr, uint8_t busType, uint8_t* pins, uint16_t clock_kHz) {}
+    static void     cleanup(void* busPtr, uint8_t busType) { mockBuses.erase(std::find(mockBuses.begin(), mockBuses.end(), busPtr)); delete static_cast<MockNeoBus*>(busPtr); }
+    static void     show(void* busPtr, uint8_t busType, bool consistent = true) {}
+    static bool     canShow(void* busPtr, uint8_t busType) { return true; }
+    static void     setBrightness(void* busPtr, uint8_t busType, uint8_t b) { static_cast<MockNeoBus*>(busPtr)->bri = b; }
+    static unsigned getDataSize(void* busPtr, uint8_t busType) { return static_cast<MockNeoBus*>(busPtr)->ch.size(); }
+    static unsigned memUsage(unsigned count, unsigned busType) { return count * 6; }
+    // reordering as in bus_wrapper.h, the channel store stands in for NeoPixelBus::SetPixelColor()
+    [[gnu::hot]] static void __attribute__((noinline)) setPixelColor(void* busPtr, uint8_t busType, uint16_t pix, uint32_t c, uint8_t co, uint16_t wwcw = 0) {
+      uint8_t r = c >> 16, g = c >> 8, b = c, w = c >> 24, R, G, B, W;
+      uint8_t cctWW = wwcw & 0xFF, cctCW = (wwcw>>8) & 0xFF;
+      switch (co & 0x0F) {
+        default: G = g; R = r; B = b; break;
+        case  1: G = r; R = g; B = b; break;
+        case  2: G = b; R = r; B = g; break;
+        case  3: G = r; R = b; B = g; break;
+        case  4: G = b; R = g; B = r; break;
+        case  5: G = g; R = b; B = r; break;
+      }
+      switch (co >> 4) {
+        default: W = w;                   break;
+        case  1: W = B; B = w;            break;
+        case  2: W = G; G = w;            break;
+        case  3: W = R; R = w;            break;
+        case  4: std::swap(cctWW, cctCW); W = w; break;
+      }
+      MockNeoBus *nb = static_cast<MockNeoBus*>(busPtr);
+      uint8_t *p = nb->ch.data() + pix * 6;
+      p[0] = R; p[1] = G; p[2] = B; p[3] = W; p[4] = cctWW; p[5] = cctCW;
+      if (nb->bri < 255) for (unsigned i = 0; i < 6; i++) p[i] = (p[i] * (nb->bri + 1)) >> 8; // as RgbColor::Dim()
+    }
+    [[gnu::hot]] static uint32_t getPixelColor(void* busPtr, uint8_t busType, uint16_t pix, uint8_t co) {
+      const uint8_t *p = static_cast<MockNeoBus*>(busPtr)->ch.data() + pix * 6;
+      uint8_t R = p[0], G = p[1], B = p[2], W = p[3], w = W;
+      switch (co >> 4) {
+        case 1: W = B; B = w; break;
+        case 2: W = G; G = w; break;
+        case 3: W = R; R = w; break;
+      }
+      switch (co & 0x0F) {
+        default: return ((W << 24) | (G << 8) | (R << 16) | (B));
+        case  1: return ((W << 24) | (R << 8) | (G << 16) | (B));
+        case  2: return ((W << 24) | (B << 8) | (R << 16) | (G));
+        case  3: return ((W << 24) | (B << 8) | (G << 16) | (R));
+        case  4: return ((W << 24) | (R << 8) | (B << 16) | (G));
+        case  5: return ((W << 24) | (G << 8) | (B << 16) | (R));
+      }
+    }
+};
+
+#include "../../wled00/bus_manager.cpp"
+
+namespace PinManager {
+  bool allocatePin(byte gpio, bool output, PinOwner tag) { return true; }
+  bool deallocatePin(byte gpio, PinOwner tag) { return true; }
+  bool allocateMultiplePins(const managed_pin_type *mptArray, byte arrayElementCount, PinOwner tag) { return true; }
+  bool deallocateMultiplePins(const uint8_t *pinArray, byte arrayElementCount, PinOwner tag) { return true; }
+  bool isPinOk(byte gpio, bool output) { return true; }
+  PinOwner getPinOwner(byte gpio) { return PinOwner::None; }
+}
+
+// as in colors.cpp
+uint32_t colorBalanceFromKelvin(uint16_t kelvin, uint32_t rgb) {
+  const uint32_t k = kelvin;
+  const unsigned rk = k < 6600 ? 255 : 255 - (k - 6600) / 40, gk = 180 + (k % 76), bk = k < 2000 ? 0 : min(255U, (k - 2000) / 18);
+  return RGBW32(R(rgb) * (rk + 1) >> 8, G(rgb) * (gk + 1) >> 8, B(rgb) * (bk + 1) >> 8, W(rgb));
+}
+uint16_t approximateKelvinFromRGB(uint32_t rgb) { return 1900 + ((R(rgb) + 2 * B(rgb)) << 4) % 8000; }
+
+uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, const byte *buffer, uint8_t bri, bool isRGBW) { return 0; }
+
+// channel data of all buses (digital: mock wire buffer, network: DDP/Art-Net data)
+static std::vector<uint8_t> busData() {
+  std::vector<uint8_t> d;
+  for (const auto b : mockBuses) d.insert(d.end(), b->ch.begin(), b->ch.end());
+  for (const auto &bus : BusManager::busses) {
+    if (!bus->isDigital()) for (unsigned i = 0; i < bus->getLength(); i++) {
+      const uint32_t c = bus->getPixelColor(i);
+      d.insert(d.end(), { R(c), G(c), B(c), W(c) });
+    }
+  }
+  return d;
+}
+
+static void clearBusData() {
+  for (const auto b : mockBuses) std::fill(b->ch.begin(), b->ch.end(), 0);
+  for (const auto &bus : BusManager::busses) {
+    if (!bus->isDigital()) for (unsigned i = 0; i < bus->getLength(); i++) bus->setPixelColor(i, 0);
+  }
+}
+
+// the former per pixel hand-off of WS2812FX::show()
+static void paintPixels(const std::vector<uint32_t> &px) {
+  for (size_t i = 0; i < px.size(); i++) BusManager::setPixelColor(i, px[i]);
+}
+
+// runs of up to 64 pixels as WS2812FX::show() hands them over
+static void paintRuns(const std::vector<uint32_t> &px) {
+  constexpr size_t SHOW_CHUNK = 64;
+  for (size_t p = 0; p < px.size(); p += SHOW_CHUNK) BusManager::setPixels(p, min(SHOW_CHUNK, px.size() - p), px.data() + p);
+}
+
+static void addBus(uint8_t type, uint16_t start, uint16_t len, uint8_t co, bool rev, uint8_t skip, uint8_t aw,
+                   uint8_t maPerLed = LED_MILLIAMPS_DEFAULT, uint16_t maMax = ABL_MILLIAMPS_DEFAULT) {
+  uint8_t pins[5] = { 2, 3, 4, 5, 6 };
+  BusConfig bc(type, pins, start, len, co, rev, skip, aw, 0, maPerLed, maMax);
+  if (Bus::isVirtual(type)) BusManager::busses.push_back(make_unique<BusNetwork>(bc));
+  else BusManager::busses.push_back(make_unique<BusDigital>(bc, BusManager::busses.size()));
+}
+
+// as in bus_manager.h
+static uint32_t restoreColorLossy(uint32_t c, uint8_t restoreBri) {
+  if (restoreBri < 255) {
+    uint8_t* chan = (uint8_t*) &c;
+    for (uint_fast8_t i=0; i<4; i++) {
+      uint_fast16_t val = chan[i];
+      chan[i] = ((val << 8) + restoreBri) / (restoreBri + 1); //adding _bri slightly improves recovery / stops degradation on re-scale
+    }
+  }
+  return c;
+}
+
+// former per bus ABL in BusDigital::show(): the frame has been set at the bus brightness, it is read back, summed and
+// repainted at the limited brightness (restored colors, color order 0, CCT recalculated), returns the brightness used
+static uint8_t formerLimitAndRepaint(const Bus *bus, MockNeoBus *nb, uint8_t bri) {
+  const unsigned maPerLed = bus->getLEDCurrent();
+  if (bus->getMaxCurrent() < MA_FOR_ESP/BusManager::getNumBusses() || maPerLed == 0) return bri;
+  unsigned powerBudget = (bus->getMaxCurrent() - MA_FOR_ESP/BusManager::getNumBusses());
+  powerBudget = powerBudget > bus->getLength() ? powerBudget - bus->getLength() : 0;
+  uint32_t busPowerSum = 0;
+  for (unsigned i = 0; i < bus->getLength(); i++) {
+    uint32_t c = bus->getPixelColor(i); // always returns original or restored color without brightness scaling
+    busPowerSum += R(c) + G(c) + B(c) + W(c);
+  }
+  if (bus->hasWhite()) busPowerSum = busPowerSum * 3 >> 2;
+  const unsigned milliAmps = (uint64_t(busPowerSum) * maPerLed * bri) / (765*255);
+  if (milliAmps <= powerBudget) return bri;
+  const uint8_t newBri = (bri * (powerBudget * 255 / milliAmps)) / 256 + 1;
+  PolyBus::setBrightness(nb, I_MOCK, newBri);
+  uint8_t cctWW = 0, cctCW = 0;
+  for (unsigned i = 0; i < bus->getLength(); i++) {
+    uint32_t c = restoreColorLossy(PolyBus::getPixelColor(nb, I_MOCK, i, 0), bri);
+    if (bus->hasCCT()) Bus::calculateCCT(c, cctWW, cctCW);
+    PolyBus::setPixelColor(nb, I_MOCK, i, c, 0, (cctCW<<8) | cctWW);
+  }
+  PolyBus::setBrightness(nb, I_MOCK, bri); // after PolyBus::show()
+  return newBri;
+}
+
+// channel sum of the frame as the bus sends it (busPowerSum() in FX_fcn.cpp, gamma is left out)
+static uint32_t busPowerSum(const Bus *bus, const std::vector<uint32_t> &px) {
+  uint32_t sum = 0;
+  for (unsigned i = 0; i < bus->getLength(); i++) { const uint32_t c = bus->getOutputColor(px[bus->getStart() + i], Bus::getCCT()); sum += R(c) + G(c) + B(c) + W(c); }
+  return sum;
+}
+
+// deviation of the sent channels from the full brightness channels scaled once by the brightness actually used
+struct ChannelError {
+  double sum = 0, max = 0;
+  unsigned count = 0;
+  void add(const std::vector<uint8_t> &sent, const std::vector<uint8_t> &full, uint8_t bri, unsigned from, unsigned to) {
+    for (size_t i = 0; i < sent.size(); i++) {
+      if (i % 6 < from || i % 6 >= to) continue;
+      const double e = fabs(sent[i] - full[i] * bri / 255.0);
+      sum += e; max = std::max(max, e); count++;
+    }
+  }
+  double mean() const { return count ? sum / count : 0; }
+};
+
+int main() {
+  static const uint8_t types[] = { TYPE_WS2812_RGB, TYPE_SK6812_RGBW, TYPE_WS2812_WWA, TYPE_WS2812_2CH_X3, TYPE_WS2805,
+                                   TYPE_WS2812_1CH_X3, TYPE_NET_DDP_RGB, TYPE_NET_DDP_RGBW };
+  unsigned layouts = 0, mismatches = 0, pixels = 0;
+  for (unsigned l = 0; l < 3000; l++) {
+    BusManager::busses.clear();
+    BusManager::getColorOrderMap().reset();
+    const unsigned n = 1 + testRandom(6);
+    unsigned start = 0;
+    for (unsigned b = 0; b < n; b++) {
+      const unsigned len = 1 + testRandom(testRandom(4) ? 100 : 3);
+      const uint8_t co = testRandom(6) | (testRandom(3) ? 0 : testRandom(5) << 4);
+      addBus(types[testRandom(sizeof(types))], start, len, co, testRandom(2), testRandom(4) ? 0 : testRandom(3), testRandom(5));
+      start += len + (testRandom(4) ? 0 : testRandom(5)); // gaps between buses
+    }
+    for (unsigned m = testRandom(4); m; m--) BusManager::getColorOrderMap().add(testRandom(start), 1 + testRandom(40), testRandom(6) | testRandom(5) << 4);
+    Bus::setGlobalAWMode(testRandom(3) ? AW_GLOBAL_DISABLED : testRandom(5));
+    Bus::setCCTBlend(testRandom(101));
+    switch (testRandom(4)) {
+      case 0:  BusManager::setSegmentCCT(-1); break;                             // CCT from RGB
+      case 1:  BusManager::setSegmentCCT(testRandom(256)); break;                // relative
+      case 2:  BusManager::setSegmentCCT(testRandom(256), true); break;          // white balance correction
+      default: Bus::setCCT(127); break;
+    }
+    std::vector<uint32_t> px(start + testRandom(3));
+    for (auto &c : px) c = testRandom(4) ? testRandom() : testRandom() & 0x00FFFFFF;
+
+    clearBusData();
+    paintPixels(px);
+    const std::vector<uint8_t> expected = busData();
+    clearBusData();
+    paintRuns(px);
+    layouts++;
+    pixels += px.size();
+    if (busData() != expected && !mismatches++) fprintf(stderr, "layout %u: bus data differs (%u buses)\n", l, n);
+  }
+  CHECK_EQ(mismatches, 0);
+  printf("%u bus layouts (%u pixels), %u differ between bulk and per pixel hand-off\n", layouts, pixels, mismatches);
+
+  // frames of 10240 pixels on 8 and 16 RGB buses, with and without white balance and a color order map
+  Bus::setGlobalAWMode(AW_GLOBAL_DISABLED);
+  for (unsigned buses : {8U, 16U}) for (bool extras : {false, true}) {
+    BusManager::busses.clear();
+    BusManager::getColorOrderMap().reset();
+    const unsigned total = 10240, len = total / buses;
+    for (unsigned b = 0; b < buses; b++) addBus(extras && b % 2 ? TYPE_SK6812_RGBW : TYPE_WS2812_RGB, b * len, len, COL_ORDER_GRB, b % 3 == 2, 0, RGBW_MODE_AUTO_BRIGHTER);
+    if (extras) BusManager::getColorOrderMap().add(len, len, COL_ORDER_RGB);
+    BusManager::setSegmentCCT(extras ? 100 : 127, extras);
+    std::vector<uint32_t> px(total);
+    for (auto &c : px) c = testRandom() & 0x00FFFFFF;
+    const unsigned frames = 200;
+    double t0 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) { px[f] ^= 1; paintPixels(px); }
+    double t1 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) { px[f] ^= 1; paintRuns(px); }
+    double t2 = benchSeconds();
+    printf("%u pixels on %2u buses%s: per pixel %.0f us, bulk %.0f us per frame\n", total, buses,
+           extras ? " (RGBW, white balance, color order map)" : "", (t1 - t0) * 1e6 / frames, (t2 - t1) * 1e6 / frames);
+  }
+  BusManager::busses.clear();
+
+  // per bus ABL: the limit decided before painting (one scaling while pixels are set) against the former read back and
+  // repaint; RGB and RGB+CCT buses at several brightness values, the CCT bus is painted with a segment CCT that is not
+  // the global one when the former show() repainted
+  Bus::setGlobalAWMode(AW_GLOBAL_DISABLED);
+  for (uint8_t type : {TYPE_WS2812_RGB, TYPE_WS2805}) {
+    ChannelError newErr, formerErr, newCCT, formerCCT;
+    unsigned frames = 0, limited = 0, briDiffers = 0;
+    for (uint8_t bri : {255, 160, 64}) for (unsigned f = 0; f < 20; f++) {
+      BusManager::busses.clear();
+      addBus(type, 0, 300, COL_ORDER_GRB, false, 0, RGBW_MODE_MANUAL_ONLY, 55, 1000 + testRandom(4000));
+      Bus *bus = BusManager::getBus(0);
+      MockNeoBus *nb = mockBuses[0];
+      std::vector<uint32_t> px(300);
+      for (auto &c : px) c = testRandom();
+      Bus::setCCT(50);
+
+      bus->setBrightness(255);
+      paintRuns(px);
+      const std::vector<uint8_t> full = nb->ch;
+
+      bus->setBrightness(bri);
+      bus->limitCurrent(busPowerSum(bus, px));
+      const uint8_t newBri = nb->bri;
+      paintRuns(px);
+      const std::vector<uint8_t> sentNew = nb->ch;
+      bus->show();
+
+      paintRuns(px);
+      Bus::setCCT(200); // WS2812FX::show() restored the global CCT before BusManager::show()
+      const uint8_t formerBri = formerLimitAndRepaint(bus, nb, bri);
+      const std::vector<uint8_t> sentFormer = nb->ch;
+
+      frames++;
+      limited += newBri < bri;
+      briDiffers += newBri != formerBri;
+      newErr.add(sentNew, full, newBri, 0, 4);
+      formerErr.add(sentFormer, full, formerBri, 0, 4);
+      newCCT.add(sentNew, full, newBri, 4, 6);
+      formerCCT.add(sentFormer, full, formerBri, 4, 6);
+    }
+    CHECK(limited > frames / 2);
+    CHECK(newErr.max < 1);
+    if (type == TYPE_WS2805) CHECK(newCCT.max < 1);
+    printf("ABL %s: %u of %u frames limited, channel error former %.2f (max %.1f), now %.2f (max %.1f)", type == TYPE_WS2805 ? "RGB+CCT" : "RGB",
+           limited, frames, formerErr.mean(), formerErr.max, newErr.mean(), newErr.max);
+    if (type == TYPE_WS2805) printf(", WW/CW error former %.1f (max %.0f), now %.2f (max %.1f)", formerCCT.mean(), formerCCT.max, newCCT.mean(), newCCT.max);
+    printf(", limit differs in %u frames\n", briDiffers);
+  }
+
+  // 1CH_X3 (one channel of an IC per LED) restores the other channels of the IC with the brightness they were set with:
+  // a frame limited by global ABL (BusManager::setBrightness() before painting and back after show) followed by one
+  // that is not limited
+  {
+    BusManager::busses.clear();
+    addBus(TYPE_WS2812_1CH_X3, 0, 300, COL_ORDER_RGB, false, 0, RGBW_MODE_MANUAL_ONLY, 55, 0);
+    std::vector<uint32_t> px(300);
+    unsigned bad = 0;
+    for (unsigned f = 0; f < 20; f++) {
+      const uint8_t bri = f % 2 ? 255 : 40 + testRandom(200);
+      for (auto &c : px) c = testRandom(256) << 24;
+      BusManager::setBrightness(bri);
+      paintRuns(px);
+      for (unsigned i = 0; i < 300; i++) bad += fabs(mockBuses[0]->ch[(i / 3) * 6 + i % 3] - W(px[i]) * bri / 255.0) >= 1;
+      BusManager::show();
+      BusManager::setBrightness(255);
+    }
+    CHECK_EQ(bad, 0);
+    printf("1CH_X3 with changing global brightness: %u of 6000 channels off\n", bad);
+  }
+
+  // time to hand a frame of 2048 pixels to a bus with ABL, bright (limited) and dim frames
+  BusManager::busses.clear();
+  addBus(TYPE_WS2812_RGB, 0, 2048, COL_ORDER_GRB, false, 0, RGBW_MODE_MANUAL_ONLY, 55, 5000);
+  for (bool bright : {false, true}) {
+    Bus *bus = BusManager::getBus(0);
+    std::vector<uint32_t> px(2048);
+    for (auto &c : px) c = testRandom() & (bright ? 0x00FFFFFF : 0x00070707);
+    const unsigned frames = 200;
+    unsigned limits = 0;
+    double t0 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) { px[f] ^= 1; paintRuns(px); limits += formerLimitAndRepaint(bus, mockBuses[0], 255) < 255; bus->show(); }
+    double t1 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) { px[f] ^= 1; bus->limitCurrent(busPowerSum(bus, px)); limits += mockBuses[0]->bri < 255; paintRuns(px); bus->show(); }
+    double t2 = benchSeconds();
+    CHECK_EQ(limits, bright ? 2 * frames : 0);
+    printf("2048 pixels with ABL, %s frame: former %.0f us, now %.0f us\n", bright ? "limited" : "unlimited", (t1 - t0) * 1e6 / frames, (t2 - t1) * 1e6 / frames);
+  }
+  BusManager::busses.clear();
+
+  return testResult("bus");
+}
@@ -0,0 +1,286 @@
+/*
+ * Button state machines (button.cpp) driven by simulated pin edges
+ * Edges arrive at exact milliseconds (with contact bounce) and the pin change interrupt queues them, handleButton()
+ * runs at a configurable loop period. Debounce, short/double/long press, repeated long press, AP/factory reset hold,
+ * switches and PIR sensors are checked by the presets they trigger and when. A stalled loop must still measure presses
+ * from the queued edges, a polled pin (no interrupt) is shown to miss them. Also covers queue overflow and
+ * reconfiguration of a button while edges are queued.
+ */
+#include "native_test.h"
+
+typedef uint8_t byte;
+#define WLED_MAX_BUTTONS 4
+#define WLED_DISABLE_MQTT
+#define HIGH 1
+#define LOW  0
+#define CHANGE 3
+#define OUTPUT 3
+#define OUTPUT_OPEN_DRAIN 0x13
+#define NOT_AN_INTERRUPT -1
+#define CALL_MODE_BUTTON         2
+#define CALL_MODE_BUTTON_PRESET 12
+#define SEG_OPTION_ON            2
+#define BTN_TYPE_NONE            0
+#define BTN_TYPE_RESERVED        1
+#define BTN_TYPE_PUSH            2
+#define BTN_TYPE_PUSH_ACT_HIGH   3
+#define BTN_TYPE_SWITCH          4
+#define BTN_TYPE_PIR_SENSOR      5
+#define BTN_TYPE_TOUCH           6
+#define BTN_TYPE_ANALOG          7
+#define BTN_TYPE_ANALOG_INVERTED 8
+#define BTN_TYPE_TOUCH_SWITCH    9
+
+static unsigned long now = 0;
+static unsigned long millis() { return now; }
+static void delay(unsigned long) {}
+static long map(long x, long inMin, long inMax, long outMin, long outMax) { return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin; }
+
+// GPIO: level per pin, interrupt on every pin but GPIO16 (as on ESP8266), the ISR runs as soon as the level changes
+static int  pinLevel[40];
+static void (*pinIsr[40])(void*);
+static void *pinIsrArg[40];
+static unsigned isrCalls = 0;
+static int  digitalRead(uint8_t pin) { return pinLevel[pin]; }
+static void digitalWrite(uint8_t, uint8_t) {}
+static void pinMode(uint8_t, uint8_t) {}
+static int  analogRead(uint8_t) { return 0; }
+static int  digitalPinToInterrupt(uint8_t pin) { return pin == 16 ? NOT_AN_INTERRUPT : pin; }
+static void attachInterruptArg(uint8_t irq, void (*isr)(void*), void *arg, int mode) {
+  CHECK(!pinIsr[irq]);
+  CHECK_EQ(mode, CHANGE);
+  pinIsr[irq] = isr;
+  pinIsrArg[irq] = arg;
+}
+static void detachInterrupt(uint8_t irq) { CHECK(pinIsr[irq]); pinIsr[irq] = nullptr; }
+static void setPin(int pin, int level) {
+  if (pinLevel[pin] == level) return;
+  pinLevel[pin] = level;
+  if (pinIsr[pin]) { isrCalls++; pinIsr[pin](pinIsrArg[pin]); }
+}
+
+// what the buttons trigger
+struct Action { unsigned long time; int preset; };
+static std::vector<Action> actions;
+static unsigned toggles = 0, initAPs = 0, formats = 0;
+static void applyPreset(byte index, byte mode) { CHECK_EQ(mode, CALL_MODE_BUTTON_PRESET); actions.push_back({now, index}); }
+static void toggleOnOff() { toggles++; }
+static void stateUpdated(byte) {}
+static void colorUpdated(byte) {}
+static void updateInterfaces(byte) {}
+static void setRandomColor(byte*) {}
+static void colorHStoRGB(uint16_t, byte, byte*) {}
+static unsigned getPaletteCount() { return 72; }
+
+class Segment {
+  public:
+    void setOption(uint8_t, bool) {}
+    void setOpacity(uint8_t) {}
+};
+struct MockStrip {
+  Segment seg;
+  bool isUpdating() const { return false; }
+  unsigned getModeCount() const { return 187; }
+  Segment &getSegment(unsigned) { return seg; }
+  void restartRuntime() {}
+  uint8_t getBrightness() const { return 128; }
+  bool needsUpdate() const { return false; }
+} strip;
+struct BusManager { static void on() {} static void off() {} };
+struct UsermodManager { static bool handleButton(uint8_t) { return false; } };
+struct MockFS { void format() { formats++; } } WLED_FS;
+struct WLED {
+  static WLED &instance() { static WLED w; return w; }
+  void initAP(bool) { initAPs++; }
+};
+
+static byte bri = 128, briLast = 128, effectCurrent = 0, effectSpeed = 128, effectIntensity = 128, effectPalette = 0;
+static byte colPri[4];
+static bool stateChanged = false, doReboot = false, offMode = false;
+static unsigned long lastOnTime = 0;
+static int8_t rlyPin = -1;
+static bool rlyMde = true, rlyOpenDrain = false;
+static byte macroButton[WLED_MAX_BUTTONS], macroLongPress[WLED_MAX_BUTTONS], macroDoublePress[WLED_MAX_BUTTONS];
+static int8_t btnPin[WLED_MAX_BUTTONS] = {-1, -1, -1, -1};
+static byte buttonType[WLED_MAX_BUTTONS];
+static bool buttonPressedBefore[WLED_MAX_BUTTONS];
+static bool buttonLongPressed[WLED_MAX_BUTTONS];
+static unsigned long buttonPressedTime[WLED_MAX_BUTTONS];
+static unsigned long buttonWaitTime[WLED_MAX_BUTTONS];
+
+#include "../../wled00/button.cpp"
+
+// pin edge at time t, 'bounce' adds contact chatter (alternating levels 1ms apart) before the final level
+struct Edge { unsigned long time; int pin; int level; };
+static void edge(std::vector<Edge> &edges, unsigned long t, int pin, int level, unsigned bounce = 0) {
+  for (unsigned i = 0; i < bounce; i++) edges.push_back({t + i, pin, (i & 1) ? !level : level});
+  edges.push_back({t + bounce, pin, level});
+}
+
+// runs the simulation until 'until' (relative to now), handleButton() every 'period' ms
+static void run(std::vector<Edge> edges, unsigned long until, unsigned period = 5) {
+  std::stable_sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.time < b.time; });
+  const unsigned long start = now, end = now + until;
+  size_t e = 0;
+  unsigned long nextLoop = now;
+  for (; now < end; now++) {
+    while (e < edges.size() && start + edges[e].time == now) { setPin(edges[e].pin, edges[e].level); e++; }
+    if (now >= nextLoop) { handleButton(); nextLoop = now + period; }
+  }
+}
+
+// presets triggered since 'from' (index into actions)
+static std::vector<int> presets(size_t from) {
+  std::vector<int> p;
+  for (size_t i = from; i < actions.size(); i++) p.push_back(actions[i].preset);
+  return p;
+}
+
+// a press of 'len' ms on an active low button with bounce on both edges
+static void press(std::vector<Edge> &edges, unsigned long t, int pin, unsigned long len, unsigned bounce = 6) {
+  edge(edges, t, pin, LOW, bounce);
+  edge(edges, t + bounce + len, pin, HIGH, bounce);
+}
+
+int main() {
+  // button 0: push button on GPIO4, button 1: push button on GPIO5 (repeating long press), button 2: switch on GPIO12,
+  // button 3: polled push button on GPIO16; presets: short 10*b+1, long 10*b+2, double 10*b+3
+  const int pins[WLED_MAX_BUTTONS] = {4, 5, 12, 16};
+  const byte types[WLED_MAX_BUTTONS] = {BTN_TYPE_PUSH, BTN_TYPE_PUSH, BTN_TYPE_SWITCH, BTN_TYPE_PUSH};
+  for (unsigned b = 0; b < WLED_MAX_BUTTONS; b++) {
+    btnPin[b] = pins[b];
+    buttonType[b] = types[b];
+    pinLevel[pins[b]] = HIGH;
+    macroButton[b] = 10*b + 1; macroLongPress[b] = 10*b + 2; macroDoublePress[b] = 10*b + 3;
+  }
+  now = 1000;
+  run({}, 100);
+  CHECK(btnIrqAttached[0] && btnIrqAttached[1] && btnIrqAttached[2]);
+  CHECK(!btnIrqAttached[3]);                              // GPIO16 has no interrupt, polled
+
+  // contact bounce only (30ms press): nothing
+  size_t mark = actions.size();
+  { std::vector<Edge> e; press(e, 10, 4, 30); run(e, 1000); }
+  CHECK(presets(mark).empty());
+
+  // short press: fires after the double press window (350ms after release)
+  mark = actions.size();
+  { std::vector<Edge> e; press(e, 10, 4, 150); run(e, 1000, 1); }
+  CHECK(presets(mark) == std::vector<int>{1});
+  if (actions.size() > mark) CHECK_NEAR(actions[mark].time - (now - 1000), 10 + 6 + 150 + 351, 1);
+
+  // double press
+  mark = actions.size();
+  { std::vector<Edge> e; press(e, 10, 4, 100); press(e, 300, 4, 100); run(e, 1000); }
+  CHECK(presets(mark) == std::vector<int>{3});
+
+  // two presses further apart than the double press window: two short presses
+  mark = actions.size();
+  { std::vector<Edge> e; press(e, 10, 4, 100); press(e, 600, 4, 100); run(e, 1500); }
+  CHECK(presets(mark) == std::vector<int>({1, 1}));
+
+  // long press on button 0: once after 600ms, nothing on release
+  mark = actions.size();
+  { std::vector<Edge> e; press(e, 10, 4, 1500); run(e, 2000, 1); }
+  CHECK(presets(mark) == std::vector<int>{2});
+  if (actions.size() > mark) CHECK_NEAR(actions[mark].time - (now - 2000), 10 + 6 + 601, 1);
+
+  // long press on button 1 is repeated while held (every 200ms after the first one)
+  mark = actions.size();
+  { std::vector<Edge> e; press(e, 10, 5, 1500); run(e, 2000, 1); }
+  CHECK_EQ(actions.size() - mark, 5);                     // 601, 802, 1003, 1204, 1405 after the last bounce
+  for (size_t i = mark + 1; i < actions.size(); i++) CHECK_EQ(actions[i].time - actions[i-1].time, 201);
+  for (int p : presets(mark)) CHECK_EQ(p, 12);
+
+  // loop stalled for 1.5s (e.g. file system write) while the button is pressed for 100ms:
+  // queued edges keep their timestamps, it is a short press and not a 1.5s long press
+  mark = actions.size();
+  { std::vector<Edge> e; press(e, 200, 4, 100); run(e, 1500, 1500); run({}, 1000); }
+  CHECK(presets(mark) == std::vector<int>{1});
+
+  // double press within a stalled loop
+  mark = actions.size();
+  { std::vector<Edge> e; press(e, 200, 4, 100); press(e, 450, 4, 100); run(e, 1500, 1500); run({}, 1000); }
+  CHECK(presets(mark) == std::vector<int>{3});
+
+  // same on the polled button: the press is not seen at all
+  mark = actions.size();
+  { std::vector<Edge> e; press(e, 200, 16, 100); run(e, 1500, 1500); run({}, 1000); }
+  CHECK(presets(mark).empty());
+  // ... but a polled press works with a normal loop
+  { std::vector<Edge> e; press(e, 10, 16, 100); run(e, 1000); }
+  CHECK(presets(mark) == std::vector<int>{31});
+
+  // switch: bouncing on/off edges trigger once each (after 50ms without change), a 30ms glitch is ignored
+  mark = actions.size();
+  { std::vector<Edge> e; edge(e, 10, 12, LOW, 8); edge(e, 500, 12, HIGH, 8); edge(e, 1000, 12, LOW); edge(e, 1030, 12, HIGH); run(e, 1500, 1); }
+  CHECK(presets(mark) == std::vector<int>({22, 21}));
+  if (actions.size() == mark + 2) {
+    CHECK_EQ(actions[mark].time - (now - 1500), 10 + 8 + 51);
+    CHECK_EQ(actions[mark+1].time - (now - 1500), 500 + 8 + 51);
+  }
+
+  // PIR sensor (active high) on the same button
+  buttonType[2] = BTN_TYPE_PIR_SENSOR;
+  pinLevel[12] = LOW;
+  run({}, 200);
+  mark = actions.size();
+  { std::vector<Edge> e; edge(e, 10, 12, HIGH); edge(e, 2000, 12, LOW); run(e, 2500); }
+  CHECK(presets(mark) == std::vector<int>({22, 21}));
+  CHECK(btnIrqAttached[2] && btnIrqActiveHigh[2]);
+
+  // holding button 0 for 6s opens the AP, 11s triggers a factory reset (long press action fires while held)
+  mark = actions.size();
+  { std::vector<Edge> e; press(e, 10, 4, 6000); run(e, 7000, 20); }
+  CHECK(presets(mark) == std::vector<int>{2});
+  CHECK_EQ(initAPs, 1);
+  CHECK_EQ(formats, 0);
+  { std::vector<Edge> e; press(e, 10, 4, 11000); run(e, 12000, 20); }
+  CHECK_EQ(initAPs, 1);
+  CHECK_EQ(formats, 1);
+  CHECK(doReboot);
+  doReboot = false;
+
+  // edge storm while the loop is stalled: the queue overflows, the level is resynchronised and the button works
+  mark = actions.size();
+  {
+    std::vector<Edge> e;
+    for (unsigned i = 0; i < 3 * BTN_QUEUE_SIZE; i++) e.push_back({10 + i, 4, (i & 1) ? HIGH : LOW});
+    e.push_back({10 + 3 * BTN_QUEUE_SIZE, 4, HIGH});
+    run(e, 500, 500);
+    CHECK(btnQueueOverflow);
+    run({}, 2000);
+    CHECK(!btnQueueOverflow);
+    CHECK(!buttonPressedBefore[0]);
+  }
+  { std::vector<Edge> e; press(e, 10, 4, 100); run(e, 1000); }
+  CHECK(presets(mark).size() >= 1 && presets(mark).back() == 1);
+
+  // button 0 moved to GPIO14 while a press on GPIO4 is queued: the stale edge must not leave button 0 pressed
+  mark = actions.size();
+  {
+    std::vector<Edge> e; edge(e, 10, 4, LOW);
+    run(e, 20, 50);                                       // edge queued, not yet handled
+    detachButtonInterrupt(0);                             // as in set.cpp before the pin is deallocated
+    btnPin[0] = 14;
+    pinLevel[14] = HIGH;
+    run({}, 2000);
+    CHECK(!pinIsr[4] && pinIsr[14]);
+    CHECK(!buttonPressedBefore[0]);
+    CHECK(presets(mark).empty());
+    setPin(4, HIGH);
+  }
+  { std::vector<Edge> e; press(e, 10, 4, 100); press(e, 10, 14, 100); run(e, 1000); }
+  CHECK(presets(mark) == std::vector<int>{1});           // only GPIO14 counts
+
+  // button removed: interrupt detached, no further events
+  btnPin[1] = -1;
+  run({}, 20);
+  CHECK(!pinIsr[5] && !btnIrqAttached[1]);
+  const unsigned calls = isrCalls;
+  { std::vector<Edge> e; press(e, 10, 5, 100); run(e, 1000); }
+  CHECK_EQ(isrCalls, calls);
+
+  printf("button: %zu actions, %u interrupts\n", actions.size(), isrCalls);
+  return testResult("button");
+}
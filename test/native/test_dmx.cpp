@@ -0,0 +1,205 @@
+/*
+ * DMX output (dmx_output.cpp): compiled fixture map against the former per channel output
+ * Random fixture configurations (channel functions, start, spacing, start LED), brightness and pixel data are sent
+ * through handleDMXOutput() and compared with the universe the former handleDMXOutput() wrote channel by channel.
+ * Also checks that a universe is filled once per shown frame, handed over in one write, held back while the UART is
+ * busy (ESP32) and resent while unchanged (ESPDMX), and times both fills for a full universe.
+ */
+#include "native_test.h"
+
+typedef uint8_t byte;
+#define WLED_ENABLE_DMX
+#define DMX_CHANNELS_MAX 512
+#define R(c) ((uint8_t)((c) >> 16))
+#define G(c) ((uint8_t)((c) >> 8))
+#define B(c) ((uint8_t)(c))
+#define W(c) ((uint8_t)((c) >> 24))
+
+static unsigned long now = 0;
+static unsigned long millis() { return now; }
+
+struct MockStrip {
+  std::vector<uint32_t> px;
+  uint8_t brightness = 255;
+  unsigned long lastShow = 0;
+  unsigned reads = 0;
+  void show() { lastShow = ++now; }
+  uint8_t getBrightness() const { return brightness; }
+  unsigned getLengthTotal() const { return px.size(); }
+  uint32_t getPixelColor(unsigned i) { reads++; return px[i]; }
+  unsigned long getLastShow() const { return lastShow; }
+} strip;
+
+static uint16_t e131ProxyUniverse = 0;
+static byte     DMXChannels = 7;
+static byte     DMXFixtureMap[15];
+static uint16_t DMXGap = 10;
+static uint16_t DMXStart = 10;
+static uint16_t DMXStartLED = 0;
+
+// DMX library: channel 1..512 in data[1..512], bulk writes and sent frames are counted, 'busy' models the UART
+struct MockDMX {
+  uint8_t data[DMX_CHANNELS_MAX + 1];
+  unsigned writes = 0, updates = 0;
+  bool busy = false;
+  void init(int channels) { CHECK_EQ(channels, DMX_CHANNELS_MAX); }
+  void initWrite(int channels, int) { CHECK_EQ(channels, DMX_CHANNELS_MAX); }
+  bool ready() const { return !busy; }
+  void write(const uint8_t *values, int channels) { CHECK_EQ(channels, DMX_CHANNELS_MAX); memcpy(data + 1, values, channels); writes++; }
+  void update() { updates++; }
+};
+
+// ESP32 (UART driver, non blocking) and ESP8266 (ESPDMX, blocking) builds of the module
+namespace esp32 {
+  MockDMX dmx;
+  #include "../../wled00/dmx_output.cpp"
+}
+namespace esp8266 {
+  #define ESP8266
+  MockDMX dmx;
+  #include "../../wled00/dmx_output.cpp"
+  #undef ESP8266
+}
+
+// former handleDMXOutput() (one library write per fixture channel), channels past 512 are dropped: ESPDMX clamped
+// them onto channel 512 and SparkFunDMX wrote past its buffer, the compiled map stops at the end of the universe
+static unsigned clippedFixtures = 0;
+static void referenceDMXOutput(uint8_t *universe) {
+  auto write = [&](int addr, uint8_t value) { if (addr >= 1 && addr <= DMX_CHANNELS_MAX) universe[addr] = value; };
+  uint8_t brightness = strip.getBrightness();
+  bool calc_brightness = true;
+  for (unsigned i = 0; i < DMXChannels; i++) if (DMXFixtureMap[i] == 5) calc_brightness = false;
+  uint16_t len = strip.getLengthTotal();
+  for (int i = DMXStartLED; i < len; i++) {
+    uint32_t in = strip.getPixelColor(i);
+    byte w = W(in), r = R(in), g = G(in), b = B(in);
+    int DMXFixtureStart = DMXStart + (DMXGap * (i - DMXStartLED));
+    if (DMXFixtureStart <= DMX_CHANNELS_MAX && DMXFixtureStart + DMXChannels - 1 > DMX_CHANNELS_MAX) clippedFixtures++;
+    for (int j = 0; j < DMXChannels; j++) {
+      int DMXAddr = DMXFixtureStart + j;
+      switch (DMXFixtureMap[j]) {
+        case 0: write(DMXAddr, 0); break;
+        case 1: write(DMXAddr, calc_brightness ? (r * brightness) / 255 : r); break;
+        case 2: write(DMXAddr, calc_brightness ? (g * brightness) / 255 : g); break;
+        case 3: write(DMXAddr, calc_brightness ? (b * brightness) / 255 : b); break;
+        case 4: write(DMXAddr, calc_brightness ? (w * brightness) / 255 : w); break;
+        case 5: write(DMXAddr, brightness); break;
+        case 6: write(DMXAddr, 255); break;
+      }
+    }
+  }
+}
+
+// random configuration within the limits of the DMX settings page
+static void randomConfig() {
+  DMXChannels = 1 + testRandom(15);
+  for (unsigned j = 0; j < 15; j++) DMXFixtureMap[j] = testRandom(7);
+  DMXStart = testRandom(4) ? 1 + testRandom(32) : 1 + testRandom(512);
+  DMXGap = testRandom(4) ? DMXChannels + testRandom(8) : 1 + testRandom(testRandom(8) ? 20 : 512); // may overlap
+  DMXStartLED = testRandom(3) ? 0 : testRandom(40);
+  strip.px.resize(testRandom(4) ? testRandom(200) : testRandom(1500));
+}
+
+static void randomFrame() {
+  for (auto &c : strip.px) c = testRandom();
+  if (testRandom(3) == 0) strip.brightness = testRandom(256);
+  strip.show();
+}
+
+int main() {
+  // compiled map against the former output, configuration and brightness change between frames
+  unsigned frames = 0, mismatches = 0;
+  std::vector<uint8_t> expected(DMX_CHANNELS_MAX + 1);
+  for (unsigned cfg = 0; cfg < 3500; cfg++) {
+    randomConfig();
+    for (unsigned f = 0; f < 4; f++, frames++) {
+      randomFrame();
+      std::fill(expected.begin(), expected.end(), 0);
+      referenceDMXOutput(expected.data());
+      esp32::handleDMXOutput();
+      if (memcmp(expected.data() + 1, esp32::dmx.data + 1, DMX_CHANNELS_MAX)) {
+        if (!mismatches++) fprintf(stderr, "mismatch: %u channels, start %u, gap %u, start LED %u, %zu LEDs, bri %u\n",
+                                   DMXChannels, DMXStart, DMXGap, DMXStartLED, strip.px.size(), strip.brightness);
+      }
+    }
+  }
+  CHECK_EQ(mismatches, 0);
+  CHECK(clippedFixtures > 0);                               // end of universe was covered
+  CHECK_EQ(esp32::dmx.writes, frames);                      // one bulk write per frame
+  printf("%u frames of 3500 configurations, %u differ (%u fixtures cut off at channel 512)\n", frames, mismatches, clippedFixtures);
+
+  // frame synchronous: a universe is filled only after show(), pixels are read once per frame
+  DMXChannels = 4; DMXStart = 1; DMXGap = 4; DMXStartLED = 0;
+  const byte rgbw[] = {1, 2, 3, 4};
+  memcpy(DMXFixtureMap, rgbw, sizeof(rgbw));
+  strip.px.assign(128, 0x01020304);
+  strip.brightness = 255;
+  strip.show();
+  esp32::handleDMXOutput();
+  const unsigned writes = esp32::dmx.writes;
+  strip.reads = 0;
+  strip.px[0] = 0x05060708;
+  for (unsigned i = 0; i < 100; i++) { now++; esp32::handleDMXOutput(); }
+  CHECK_EQ(strip.reads, 0);
+  CHECK_EQ(esp32::dmx.data[1], 2);
+  strip.show();
+  esp32::handleDMXOutput();
+  CHECK_EQ(strip.reads, 128);
+  CHECK_EQ(esp32::dmx.data[1], 6);
+  CHECK_EQ(esp32::dmx.data[4], 5);
+
+  // ESP32: the UART driver sends in the background, a frame is held back while the previous one is being sent
+  // and an idle universe is handed over again as soon as the previous one is done (continuous ~44 Hz)
+  esp32::dmx.busy = true;
+  strip.px[0] = 0x090A0B0C;
+  strip.show();
+  esp32::handleDMXOutput();
+  CHECK_EQ(esp32::dmx.data[1], 6);                          // UART still busy, frame pending
+  CHECK(esp32::dmxPending);
+  esp32::dmx.busy = false;
+  esp32::handleDMXOutput();
+  CHECK_EQ(esp32::dmx.data[1], 10);
+  const unsigned updates = esp32::dmx.updates;
+  for (unsigned i = 0; i < 10; i++) { now += 23; esp32::handleDMXOutput(); }
+  CHECK_EQ(esp32::dmx.updates, updates + 10);
+  CHECK(esp32::dmx.writes > writes);
+
+  // ESPDMX blocks while sending: only new frames are sent, an unchanged universe every DMX_REFRESH ms
+  esp8266::handleDMXOutput();
+  CHECK_EQ(esp8266::dmx.updates, 1);
+  CHECK_EQ(esp8266::dmx.data[1], 10);
+  for (unsigned t = 0; t < 2000; t++) { now++; esp8266::handleDMXOutput(); }
+  CHECK_EQ(esp8266::dmx.updates, 3);                        // refresh after 801 and 1602 ms
+  strip.show();
+  esp8266::handleDMXOutput();
+  CHECK_EQ(esp8266::dmx.updates, 4);
+
+  // DMX proxy mode (E1.31 universe forwarded): no output
+  e131ProxyUniverse = 1;
+  strip.show();
+  esp8266::handleDMXOutput();
+  CHECK_EQ(esp8266::dmx.updates, 4);
+  e131ProxyUniverse = 0;
+
+  // full universe (170 RGB fixtures with shutter-less brightness scaling): time per frame of both fills
+  {
+    DMXChannels = 3; DMXStart = 1; DMXGap = 3; DMXStartLED = 0;
+    const byte rgb[] = {1, 2, 3};
+    memcpy(DMXFixtureMap, rgb, sizeof(rgb));
+    strip.px.resize(170);
+    strip.brightness = 200;
+    for (auto &c : strip.px) c = testRandom();
+    const unsigned n = 20000;
+    unsigned sum = 0;
+    double t0 = benchSeconds();
+    for (unsigned i = 0; i < n; i++) { referenceDMXOutput(expected.data()); sum += expected[1 + i % 510]; }
+    double t1 = benchSeconds();
+    for (unsigned i = 0; i < n; i++) { strip.show(); esp32::handleDMXOutput(); sum += esp32::dmx.data[1 + i % 510]; }
+    double t2 = benchSeconds();
+    CHECK(!memcmp(expected.data() + 1, esp32::dmx.data + 1, 510));
+    printf("510 channels: per channel %.2f us, compiled map %.2f us per frame (%u)\n",
+           (t1 - t0) * 1e6 / n, (t2 - t1) * 1e6 / n, sum & 1);
+  }
+
+  return testResult("dmx");
+}
@@ -0,0 +1,344 @@
+/*
+ * ESP-NOW pixel stream: leader and followers (separate instances of espnow_stream.cpp) on a simulated radio channel
+ * The channel airs one packet at a time at 1 Mbit/s, QuickEspNow's send queue holds a few packets. Every follower
+ * loses packets independently (random and burst loss). Every frame a follower shows is compared with the frame the
+ * leader sent under that sequence number; loss statistics are checked against the losses actually injected.
+ * The RLE codec is also round-tripped directly and fed with random and truncated packets.
+ */
+#include "native_test.h"
+#include <map>
+#include <set>
+
+typedef uint8_t byte;
+#define R(c) ((uint8_t)((c) >> 16))
+#define G(c) ((uint8_t)((c) >> 8))
+#define B(c) ((uint8_t)(c))
+#define RGBW32(r,g,b,w) (uint32_t((byte(w) << 24) | (byte(r) << 16) | (byte(g) << 8) | (byte(b))))
+#define ESP_NOW_STATE_ON        1
+#define REALTIME_MODE_INACTIVE  0
+#define REALTIME_MODE_GENERIC   1
+#define REALTIME_MODE_ESPNOW    10
+#define ESPNOW_STREAM_OFF       0
+#define ESPNOW_STREAM_SEND      1
+#define ESPNOW_STREAM_RECEIVE   2
+
+static const uint8_t ESPNOW_BROADCAST_ADDRESS[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+static int64_t simUs = 0;
+
+// radio channel: packets are aired one after another, then received by every follower unless lost
+struct AirPacket { int64_t done; std::vector<uint8_t> data; };
+static std::deque<AirPacket> air;
+static int64_t airBusyUntil = 0;
+static unsigned airPackets = 0;
+
+class MockEspNow {
+  public:
+    static const unsigned QUEUE = 3;        // QuickEspNow's send queue
+    bool readyToSendData() const {
+      unsigned queued = 0;
+      for (auto &p : air) queued += p.done > simUs;
+      return queued < QUEUE;
+    }
+    int send(const uint8_t *, const uint8_t *data, size_t len) {
+      if (len > 250) return 1;
+      airBusyUntil = max(airBusyUntil, simUs) + 100 + 8 * len; // preamble and ack-less broadcast at 1 Mbit/s
+      air.push_back({airBusyUntil, std::vector<uint8_t>(data, data + len)});
+      airPackets++;
+      return 0;                                               // COMMS_SEND_OK
+    }
+};
+
+static uint32_t color_fade(uint32_t c, uint8_t amount, bool = false) {
+  if (amount == 255) return c;
+  return RGBW32(R(c) * (amount + 1) >> 8, G(c) * (amount + 1) >> 8, B(c) * (amount + 1) >> 8, 0);
+}
+
+// strip: the leader renders into 'px', the follower receives realtime pixels into 'px' and shows them
+struct MockStrip {
+  std::vector<uint32_t> px, shown;
+  unsigned long lastShow = 0;
+  unsigned shows = 0;
+  void (*onShow)() = nullptr;
+  uint16_t getLengthTotal() const { return px.size(); }
+  uint32_t getPixelColor(unsigned i) const { return px[i]; }
+  unsigned long getLastShow() const { return lastShow; }
+  void show() { shown = px; shows++; if (onShow) onShow(); }
+};
+
+#define NODE_ENV(MODE) \
+  static unsigned long millis() { return simUs / 1000; } \
+  static MockStrip strip; \
+  static byte bri = 255; \
+  static byte espNowStreamMode = MODE; \
+  static bool espNowStreamDelta = true; \
+  static bool enableESPNow = true; \
+  static byte statusESPNow = ESP_NOW_STATE_ON; \
+  static byte realtimeMode = REALTIME_MODE_INACTIVE; \
+  static bool realtimeOverride = false; \
+  static uint16_t realtimeTimeoutMs = 2500; \
+  static unsigned long realtimeUntil = 0; \
+  static unsigned outOfRange = 0; \
+  static void realtimeLock(uint32_t timeoutMs, byte md = REALTIME_MODE_GENERIC) { realtimeMode = md; realtimeUntil = millis() + timeoutMs; } \
+  static void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte) { if (i < strip.px.size()) strip.px[i] = RGBW32(r,g,b,0); else outOfRange++; } \
+  static MockEspNow quickEspNow;
+
+namespace leader {
+  NODE_ENV(ESPNOW_STREAM_SEND)
+  #include "../../wled00/espnow_stream.cpp"
+}
+namespace follower {
+  NODE_ENV(ESPNOW_STREAM_RECEIVE)
+  #include "../../wled00/espnow_stream.cpp"
+}
+
+// effect frame: moving gradient on a part of the strip, solid and dark areas elsewhere (RLE friendly), sparkles
+static void render(unsigned frame) {
+  auto &px = leader::strip.px;
+  const unsigned n = px.size();
+  for (unsigned i = 0; i < n; i++) {
+    if (i < n / 3)            px[i] = RGBW32((i * 4 + frame * 3) & 0xFF, 40, 255 - ((i + frame) & 0xFF), 0);
+    else if (i < 2 * n / 3)   px[i] = (frame / 50) & 1 ? RGBW32(255, 120, 0, 0) : RGBW32(0, 0, 80, 0);
+    else                      px[i] = 0;
+  }
+  for (unsigned k = 0; k < 3; k++) px[n/3 + testRandom(2*n/3)] = RGBW32(255, 255, 255, 0);
+  leader::strip.lastShow = leader::millis();
+}
+
+// frames as sent by the leader, by sequence number (last 256)
+static std::map<uint8_t, std::vector<uint8_t>> sentFrames;
+static std::map<uint8_t, unsigned> sentFragments;
+static std::map<uint8_t, int64_t> sentAt;
+
+// follower bookkeeping: what was shown, what was actually delivered per sequence number
+struct Stats { unsigned shown = 0, exact = 0, keyShown = 0, keyExact = 0; double latencySum = 0, latencyMax = 0; };
+static Stats stats;
+static std::map<uint8_t, unsigned> delivered;
+static int deliveredSeq = -1;               // frame the follower currently receives
+static unsigned expFragments = 0, expFrames = 0; // losses the follower should have reported
+static unsigned injectedLost = 0;
+static bool lastFrameKey = false;
+
+static bool sameAsSent(uint8_t seq) {
+  const auto &f = sentFrames[seq];
+  const auto &px = follower::strip.shown;
+  if (f.size() != px.size() * 3) return false;
+  for (size_t i = 0; i < px.size(); i++)
+    if (f[3*i] != R(px[i]) || f[3*i+1] != G(px[i]) || f[3*i+2] != B(px[i])) return false;
+  return true;
+}
+
+static void followerShow() {
+  const uint8_t seq = follower::rxSeq;
+  const bool exact = sameAsSent(seq);
+  stats.shown++;
+  stats.exact += exact;
+  if (lastFrameKey && delivered[seq] == sentFragments[seq]) { stats.keyShown++; stats.keyExact += exact; }
+  const double latency = (simUs - sentAt[seq]) / 1000.0;
+  stats.latencySum += latency;
+  stats.latencyMax = max(stats.latencyMax, latency);
+}
+
+// Gilbert-Elliott channel: 'loss' percent random loss, bursts of ~5 packets 'burst' percent of the time
+static unsigned loss = 0, burst = 0;
+static bool inBurst = false;
+static bool lose() {
+  if (burst) inBurst = inBurst ? testRandom(100) < 80 : testRandom(1000) < burst * 2;
+  return inBurst || testRandom(100) < loss;
+}
+
+// one millisecond: leader renders at 'fps', sends, channel delivers, follower processes and times out realtime mode
+static void step(unsigned fps, unsigned &frame, bool &leaderOn) {
+  simUs += 1000;
+  const unsigned long ms = simUs / 1000;
+  if (leaderOn && ms % (1000 / fps) == 0) render(frame++);
+  if (leaderOn) {
+    const uint32_t before = leader::txFrames;
+    leader::handleEspNowStream();
+    if (leader::txFrames != before) {
+      const uint8_t seq = leader::txSeq;
+      sentFrames[seq].assign(leader::txFrame, leader::txFrame + 3 * leader::txPixels);
+      sentFragments[seq] = leader::txCount;
+      sentAt[seq] = int64_t(leader::strip.lastShow) * 1000;
+    }
+  }
+  while (!air.empty() && air.front().done <= simUs) {
+    const auto &p = air.front().data;
+    if (lose()) injectedLost++;
+    else {
+      const uint8_t seq = p[2];
+      if (deliveredSeq >= 0 && deliveredSeq != seq) {
+        // follower moves on to a new frame: fragments missing from the previous one, frames missed in between
+        const uint8_t prev = deliveredSeq;
+        expFragments += sentFragments[prev] - delivered[prev];
+        const int8_t gap = seq - prev;
+        if (gap > 1) expFrames += gap - 1;
+      }
+      if (deliveredSeq != seq) { delivered[seq] = 0; deliveredSeq = seq; }
+      delivered[seq]++;
+      lastFrameKey = p[1] & 0x04;
+      follower::espNowStreamReceive(p.data(), p.size());
+    }
+    air.pop_front();
+  }
+  follower::handleEspNowStream();
+  if (follower::realtimeMode && ms > follower::realtimeUntil) follower::realtimeMode = REALTIME_MODE_INACTIVE;
+}
+
+static void resetRun(unsigned pixels) {
+  leader::strip.px.assign(pixels, 0);
+  follower::strip.px.assign(pixels, 0);
+  follower::strip.onShow = followerShow;
+  stats = Stats();
+  delivered.clear();
+  deliveredSeq = -1;
+  injectedLost = expFragments = expFrames = 0;
+}
+
+// lets packets of the previous run drain and the follower settle on the new strip length
+static void warmUp(unsigned fps, unsigned &frame, bool &leaderOn) {
+  for (unsigned ms = 0; ms < 100; ms++) step(fps, frame, leaderOn);
+  stats = Stats();
+}
+
+static void codecTests() {
+  uint8_t px[3 * ESPNOW_STREAM_PIXELS], enc[3 * ESPNOW_STREAM_PIXELS];
+  follower::strip.px.assign(ESPNOW_STREAM_PIXELS, 0);
+  unsigned rleUsed = 0;
+  for (unsigned t = 0; t < 20000; t++) {
+    const unsigned n = 1 + testRandom(ESPNOW_STREAM_PIXELS);
+    const unsigned colors = 1 + testRandom(t % 3 ? 4 : 256);   // few colors produce runs
+    for (unsigned i = 0; i < n; i++) {
+      const uint32_t c = (t % 5 == 0 && i > 0 && testRandom(3)) ? RGBW32(px[3*i-3], px[3*i-2], px[3*i-1], 0)
+                                                                  : testRandom(colors) * 0x10101 * 37;
+      px[3*i] = R(c); px[3*i+1] = G(c); px[3*i+2] = B(c);
+    }
+    const size_t len = leader::encodeRle(px, n, enc);
+    CHECK(len < 3 * n);                                          // 0 = send raw
+    follower::strip.px.assign(ESPNOW_STREAM_PIXELS, 0xDEAD);
+    if (len) {
+      rleUsed++;
+      CHECK(follower::decodeFragment(enc, len, 0, true));
+    } else CHECK(follower::decodeFragment(px, 3 * n, 0, false));
+    bool same = true;
+    for (unsigned i = 0; i < n; i++) same &= follower::strip.px[i] == RGBW32(px[3*i], px[3*i+1], px[3*i+2], 0);
+    for (unsigned i = n; i < ESPNOW_STREAM_PIXELS; i++) same &= follower::strip.px[i] == 0xDEAD;
+    CHECK(same);
+    if (len > 1) follower::decodeFragment(enc, 1 + testRandom(len - 1), 0, true); // truncated: no pixels beyond the fragment
+  }
+  CHECK(rleUsed > 5000);
+  CHECK_EQ(follower::outOfRange, 0);
+  CHECK(!follower::decodeFragment(px, 10, 0, false));              // raw data not a multiple of 3
+
+  // random packets: never write outside the strip, invalid ones are rejected
+  follower::strip.px.assign(300, 0);
+  follower::outOfRange = 0;
+  unsigned rejected = 0;
+  for (unsigned t = 0; t < 100000; t++) {
+    uint8_t d[250];
+    const size_t len = testRandom(251);
+    for (size_t i = 0; i < len; i++) d[i] = testRandom();
+    rejected += !follower::decodeFragment(d, len, testRandom(300), true);
+  }
+  CHECK(rejected > 50000);
+  printf("codec: %u of 20000 fragments RLE encoded, %u of 100000 random packets rejected, %u pixels beyond strip ignored\n",
+         rleUsed, rejected, follower::outOfRange);
+  follower::outOfRange = 0;
+}
+
+int main() {
+  codecTests();
+
+  unsigned frame = 0;
+  bool leaderOn = true;
+
+  // clean channel, 300 pixels at 50 fps: every frame shown exactly, no losses reported
+  resetRun(300);
+  for (unsigned ms = 0; ms < 20000; ms++) step(50, frame, leaderOn);
+  CHECK(follower::realtimeMode == REALTIME_MODE_ESPNOW);
+  CHECK(stats.shown >= 990);
+  CHECK_EQ(stats.exact, stats.shown);
+  CHECK_EQ(follower::rxLost, 0);
+  CHECK_EQ(follower::rxLostFrames, 0);
+  CHECK_EQ(leader::txSkipped, 0);
+  CHECK(stats.latencyMax < 10);
+  const double cleanLatency = stats.latencySum / stats.shown;
+  const double packetsPerFrame = double(airPackets) / leader::txFrames;
+  CHECK(packetsPerFrame < 4);                                       // delta: static fragments are not sent every frame
+  printf("clean: %u frames, %.2f packets/frame (4 fragments), latency %.2f ms mean %.2f ms max\n",
+         stats.shown, packetsPerFrame, cleanLatency, stats.latencyMax);
+
+  // 10% random loss plus bursts: statistics match the injected loss, key frames heal the picture
+  loss = 10; burst = 2;
+  resetRun(300);
+  const uint32_t lostBefore = follower::rxLost, lostFramesBefore = follower::rxLostFrames;
+  for (unsigned ms = 0; ms < 60000; ms++) step(50, frame, leaderOn);
+  const unsigned repLost = follower::rxLost - lostBefore, repFrames = follower::rxLostFrames - lostFramesBefore;
+  CHECK(injectedLost > 0);
+  CHECK_EQ(repLost, expFragments);
+  CHECK_EQ(repFrames, expFrames);
+  CHECK(stats.keyShown > 20);
+  CHECK_EQ(stats.keyExact, stats.keyShown);                         // complete key frame: picture fully healed
+  CHECK(stats.exact > stats.shown / 2);
+  printf("lossy: %u packets lost, reported %u fragments + %u frames, %u of %u frames exact, %u of %u complete key frames exact\n",
+         injectedLost, repLost, repFrames, stats.exact, stats.shown, stats.keyExact, stats.keyShown);
+
+  // without delta every frame is a key frame: every completely received frame is exact
+  leader::espNowStreamDelta = false;
+  resetRun(300);
+  for (unsigned ms = 0; ms < 20000; ms++) step(50, frame, leaderOn);
+  CHECK_EQ(stats.keyExact, stats.keyShown);
+  leader::espNowStreamDelta = true;
+  loss = 0; burst = 0;
+
+  // leader restarts with a lower sequence number: follower resyncs on the first key frame
+  resetRun(300);
+  for (unsigned ms = 0; ms < 2000; ms++) step(50, frame, leaderOn);
+  leader::espNowStreamMode = ESPNOW_STREAM_OFF;
+  leader::handleEspNowStream();                                     // frees buffers
+  leader::espNowStreamMode = ESPNOW_STREAM_SEND;
+  leader::txSeq = follower::rxSeq - 60;
+  unsigned shownBefore = stats.shown;
+  for (unsigned ms = 0; ms < 200; ms++) step(50, frame, leaderOn);
+  CHECK(stats.shown >= shownBefore + 8);
+  CHECK_EQ(stats.exact, stats.shown);
+
+  // leader silent longer than the realtime timeout, comes back with any sequence number: accepted at once
+  leaderOn = false;
+  for (unsigned ms = 0; ms < 3000; ms++) step(50, frame, leaderOn);
+  CHECK(follower::realtimeMode == REALTIME_MODE_INACTIVE);
+  leaderOn = true;
+  leader::txSeq = follower::rxSeq - 100;
+  shownBefore = stats.shown;
+  for (unsigned ms = 0; ms < 100; ms++) step(50, frame, leaderOn);
+  CHECK(stats.shown >= shownBefore + 4);
+  CHECK(follower::realtimeMode == REALTIME_MODE_ESPNOW);
+
+  // long strip without delta (2400 pixels): the channel cannot carry 50 fps, frames rendered while sending are skipped (not queued up)
+  leader::espNowStreamDelta = false;
+  resetRun(2400);
+  warmUp(50, frame, leaderOn);
+  const uint32_t skippedBefore = leader::txSkipped;
+  for (unsigned ms = 0; ms < 10000; ms++) step(50, frame, leaderOn);
+  CHECK(leader::txSkipped > skippedBefore);
+  CHECK_EQ(stats.exact, stats.shown);
+  CHECK(stats.latencyMax < 80);
+  leader::espNowStreamDelta = true;
+  printf("2400 pixels: %u frames shown, %u skipped by the leader, latency %.1f ms max\n",
+         stats.shown, leader::txSkipped - skippedBefore, stats.latencyMax);
+
+  // receive queue overflow and garbage
+  const uint32_t ovf = follower::rxOverflow, inv = follower::rxInvalid;
+  uint8_t pkt[250] = {'X', 0x01, uint8_t(follower::rxSeq + 1), 1, 0, 0};
+  for (unsigned i = 0; i < 20; i++) CHECK(follower::espNowStreamReceive(pkt, 6 + 3 * (1 + testRandom(80))));
+  CHECK_EQ(follower::rxOverflow - ovf, 20 - (ESPNOW_STREAM_QUEUE - 1));
+  for (unsigned i = 6; i < sizeof(pkt); i++) pkt[i] = 0x7F;          // literal span running past the end
+  CHECK(follower::espNowStreamReceive(pkt, 10));
+  follower::handleEspNowStream();
+  CHECK(follower::rxInvalid > inv);
+  CHECK(!follower::espNowStreamReceive(pkt, 5));                      // too short: not a stream packet
+  pkt[0] = 0x91;
+  CHECK(!follower::espNowStreamReceive(pkt, 13));                     // WiZmote, handled elsewhere
+  CHECK_EQ(follower::outOfRange, 0);
+
+  return testResult("espnow");
+}
@@ -0,0 +1,308 @@
+/*
+ * FSEQ playback (fseq_player.cpp): synthetic .fseq v2 files played from a mock file system with a timed SD card
+ * Segments are laid out on a strip and a matrix (offset, reverse, reverse_y, transpose, sparse ranges), rendered
+ * frames are put on the LEDs the way WS2812FX::blendSegment() does and every LED has to show the channels sequenced
+ * for its position. Unsupported layouts and missing files are rejected and retried. The main loop is simulated with
+ * file reads that take time: render duration (output jitter), shown frames and prefetch misses are compared with
+ * and without handleFseqPrefetch().
+ */
+#include "native_test.h"
+#include <map>
+#include <strings.h>
+
+typedef uint8_t byte;
+#define WLED_ENABLE_FSEQ
+#define RGBW32(r,g,b,w) (uint32_t((uint8_t)(w) << 24 | (uint8_t)(r) << 16 | (uint8_t)(g) << 8 | (uint8_t)(b)))
+#define IMAGE_ERROR_NONE 0
+#define IMAGE_ERROR_NO_NAME 1
+#define IMAGE_ERROR_SEG_LIMIT 2
+#define IMAGE_ERROR_UNSUPPORTED_FORMAT 3
+#define IMAGE_ERROR_FILE_MISSING 4
+#define IMAGE_ERROR_FRAME_DECODE 7
+#define IMAGE_ERROR_WAITING 254
+#define IMAGE_ERROR_PREV 255
+
+// clock in microseconds, file access advances it (SD card over SPI: 1 byte per us, 300 us per seek)
+static uint64_t nowUs = 0;
+static unsigned long millis() { return nowUs / 1000; }
+static const unsigned seekUs = 300;
+static uint64_t ioUs = 0;
+
+static std::map<std::string, std::vector<uint8_t>> files;
+
+class File {
+    const std::vector<uint8_t> *_data = nullptr;
+    size_t _pos = 0;
+  public:
+    File() = default;
+    File(const std::vector<uint8_t> *d) : _data(d) {}
+    explicit operator bool() const { return _data != nullptr; }
+    bool seek(size_t pos) {
+      if (!_data || pos > _data->size()) return false;
+      if (pos != _pos) { nowUs += seekUs; ioUs += seekUs; }
+      _pos = pos;
+      return true;
+    }
+    size_t read(uint8_t *buf, size_t len) {
+      len = min(len, _data->size() - _pos);
+      memcpy(buf, _data->data() + _pos, len);
+      _pos += len;
+      nowUs += len; ioUs += len;
+      return len;
+    }
+    void close() { _data = nullptr; }
+};
+struct MockFS {
+  File open(const char *name, const char *) { auto f = files.find(name); return f == files.end() ? File() : File(&f->second); }
+} WLED_FS;
+
+struct Segment {
+  static uint16_t maxWidth, maxHeight;
+  char    *name = nullptr;
+  uint16_t start = 0, stop = 0, startY = 0, stopY = 1, offset = 0;
+  uint8_t  grouping = 1, spacing = 0;
+  bool     reverse = false, reverse_y = false, transpose = false, mirror = false, mirror_y = false;
+  std::vector<uint32_t> px;
+
+  unsigned width()  const { return stop - start; }
+  unsigned height() const { return stopY - startY; }
+  unsigned groupLength() const { return grouping + spacing; }
+  bool     is2D() const { return height() > 1; }
+  unsigned vWidth()  const { return transpose ? height() : width(); }
+  unsigned vHeight() const { return transpose ? width() : height(); }
+  unsigned vLength() const { return is2D() ? vWidth() * vHeight() : width(); }
+  void setPixelColor(unsigned i, uint32_t c) { px[i] = c; }
+  void setPixelColorXY(unsigned x, unsigned y, uint32_t c) { px[x + y * vWidth()] = c; }
+};
+uint16_t Segment::maxWidth = 0, Segment::maxHeight = 1;
+
+struct MockStrip {
+  bool isMatrix = false;
+  unsigned long now = 0;
+} strip;
+
+#include "../../wled00/fseq_player.cpp"
+
+// channel value sequenced for frame f
+static uint8_t channel(uint32_t f, uint32_t c) { uint32_t h = (f + 1) * 2654435761U ^ (c * 40503U); return h ^ (h >> 13); }
+
+// uncompressed v2 file, 'ranges' are {start, length} pairs of stored channels (none: all channels)
+static void makeFseq(const char *name, uint32_t channels, uint32_t frames, uint8_t step, const std::vector<std::pair<uint32_t, uint32_t>> &ranges = {}) {
+  uint32_t frameSize = 0;
+  for (const auto &r : ranges) frameSize += r.second;
+  if (ranges.empty()) frameSize = channels;
+  const uint32_t dataOffset = (FSEQ_HEADER_SIZE + 6 * ranges.size() + 3) & ~3U;
+  std::vector<uint8_t> f(dataOffset + frameSize * frames, 0);
+  memcpy(f.data(), "PSEQ", 4);
+  f[4] = dataOffset; f[5] = dataOffset >> 8;
+  f[6] = 0; f[7] = 2;
+  f[8] = FSEQ_HEADER_SIZE;
+  for (int i = 0; i < 4; i++) { f[10 + i] = frameSize >> (8 * i); f[14 + i] = frames >> (8 * i); }
+  f[18] = step;
+  f[22] = ranges.size();
+  for (size_t r = 0; r < ranges.size(); r++) for (int i = 0; i < 3; i++) {
+    f[FSEQ_HEADER_SIZE + 6 * r + i]     = ranges[r].first >> (8 * i);
+    f[FSEQ_HEADER_SIZE + 6 * r + 3 + i] = ranges[r].second >> (8 * i);
+  }
+  for (uint32_t fr = 0; fr < frames; fr++) {
+    uint8_t *d = f.data() + dataOffset + fr * frameSize;
+    if (ranges.empty()) for (uint32_t c = 0; c < channels; c++) *d++ = channel(fr, c);
+    else for (const auto &r : ranges) for (uint32_t c = r.first; c < r.first + r.second; c++) *d++ = channel(fr, c);
+  }
+  files[std::string("/") + name] = f;
+}
+
+// expected color of the LED at strip index p in frame f (channels outside stored ranges are 0)
+static uint32_t expectedLED(uint32_t f, unsigned p, const std::vector<std::pair<uint32_t, uint32_t>> &ranges) {
+  uint8_t rgb[3];
+  for (unsigned k = 0; k < 3; k++) {
+    const uint32_t c = p * 3 + k;
+    bool stored = ranges.empty();
+    for (const auto &r : ranges) stored |= c >= r.first && c < r.first + r.second;
+    rgb[k] = stored ? channel(f, c) : 0;
+  }
+  return RGBW32(rgb[0], rgb[1], rgb[2], 0);
+}
+
+// segment pixels put on the strip as WS2812FX::blendSegment() does (no grouping/mirroring, those are rejected)
+static void blendSegment(const Segment &s, std::vector<uint32_t> &leds) {
+  if (strip.isMatrix) {
+    const int nCols = s.vWidth(), nRows = s.vHeight();
+    for (int r = 0; r < nRows; r++) for (int c = 0; c < nCols; c++) {
+      int x = c, y = r;
+      if (s.reverse  ) x = nCols - x - 1;
+      if (s.reverse_y) y = nRows - y - 1;
+      if (s.transpose) std::swap(x, y);
+      leds[(s.start + x) + (s.startY + y) * Segment::maxWidth] = s.px[c + r * nCols];
+    }
+  } else {
+    const int nLen = s.vLength(), length = s.width();
+    for (int k = 0; k < nLen; k++) {
+      int i = k;
+      if (s.reverse) i = nLen - i - 1;
+      int indx = s.start + i + s.offset;
+      if (indx >= s.stop) indx -= length;
+      leds[indx] = s.px[k];
+    }
+  }
+}
+
+static Segment makeSegment(const char *name, unsigned start, unsigned stop, unsigned startY, unsigned stopY) {
+  Segment s;
+  s.name = strdup(name);
+  s.start = start; s.stop = stop; s.startY = startY; s.stopY = stopY;
+  s.px.assign(s.width() * s.height(), 0);
+  return s;
+}
+
+// renders frames at random times and compares the LEDs of the segment with the sequence
+static unsigned checkLayout(Segment &s, const std::vector<std::pair<uint32_t, uint32_t>> &ranges, uint8_t step, uint32_t frames) {
+  std::vector<uint32_t> leds(Segment::maxWidth * Segment::maxHeight, 0);
+  unsigned bad = 0;
+  for (unsigned i = 0; i < 40; i++) {
+    strip.now = testRandom(step * frames * 3);
+    const byte err = renderFseqToSegment(s);
+    if (err != IMAGE_ERROR_NONE && err != IMAGE_ERROR_WAITING) { bad++; continue; }
+    blendSegment(s, leds);
+    const uint32_t f = (strip.now / step) % frames;
+    for (unsigned y = s.startY; y < s.stopY; y++) for (unsigned x = s.start; x < s.stop; x++) {
+      const unsigned p = x + y * Segment::maxWidth;
+      bad += leds[p] != expectedLED(f, p, ranges);
+    }
+    if (testRandom(2)) handleFseqPrefetch();
+  }
+  endFseqPlayback(&s);
+  return bad;
+}
+
+struct LoopStats { unsigned shown = 0, skipped = 0, misses = 0; double firstMs = 0, renderMaxMs = 0, renderAvgMs = 0; };
+
+// main loop for 'seconds': strip.service() every 'frameTime' ms renders the segment, then prefetch if enabled
+static LoopStats runLoop(Segment &s, unsigned frameTime, bool prefetch, unsigned seconds) {
+  LoopStats st;
+  uint64_t lastShow = nowUs, renderUs = 0;
+  int32_t lastFrame = -1;
+  const uint64_t end = nowUs + seconds * 1000000ULL;
+  while (nowUs < end) {
+    if (nowUs - lastShow >= frameTime * 1000U) {
+      lastShow = nowUs;
+      strip.now = millis();
+      const uint64_t t0 = nowUs;
+      const byte err = renderFseqToSegment(s);
+      const uint64_t dt = nowUs - t0;
+      if (lastFrame < 0) st.firstMs = dt / 1000.0; // file is opened and the first frame read
+      else {
+        renderUs += dt;
+        st.renderMaxMs = std::max(st.renderMaxMs, dt / 1000.0);
+      }
+      if (err == IMAGE_ERROR_NONE) {
+        const int32_t f = findFseqPlayer(&s)->bufFrame[findFseqPlayer(&s)->front];
+        if (lastFrame >= 0 && f > lastFrame + 1) st.skipped += f - lastFrame - 1;
+        lastFrame = f;
+        st.shown++;
+      }
+      nowUs += 2000; // rest of strip.service() and show()
+    }
+    if (prefetch) handleFseqPrefetch();
+    nowUs += 500; // rest of the loop
+  }
+  st.misses = findFseqPlayer(&s)->prefetchMisses;
+  st.renderAvgMs = renderUs / 1000.0 / max(1U, st.shown - 1);
+  endFseqPlayback(&s);
+  return st;
+}
+
+int main() {
+  // 1D strip of 300 LEDs, segments with offset and reverse, full and sparse files
+  Segment::maxWidth = 300; Segment::maxHeight = 1;
+  strip.isMatrix = false;
+  const std::vector<std::pair<uint32_t, uint32_t>> none, sparse = {{30, 200}, {400, 300}};
+  makeFseq("strip.fseq", 900, 50, 25);
+  makeFseq("sparse.fseq", 900, 50, 25, sparse);
+  unsigned bad = 0, layouts = 0;
+  for (const char *name : {"strip.fseq", "sparse.fseq"}) {
+    const auto &ranges = strcmp(name, "sparse.fseq") ? none : sparse;
+    for (unsigned n = 0; n < 30; n++, layouts++) {
+      const unsigned a = testRandom(290), b = a + 1 + testRandom(300 - a);
+      Segment s = makeSegment(name, a, b, 0, 1);
+      s.reverse = testRandom(2);
+      s.offset  = testRandom(2) ? testRandom(s.width()) : 0;
+      bad += checkLayout(s, ranges, 25, 50);
+    }
+  }
+
+  // 32x16 matrix, segments with reverse, reverse_y and transpose
+  Segment::maxWidth = 32; Segment::maxHeight = 16;
+  strip.isMatrix = true;
+  makeFseq("matrix.fseq", 32 * 16 * 3, 40, 50);
+  makeFseq("msparse.fseq", 32 * 16 * 3, 40, 50, {{0, 32 * 3 * 4}, {32 * 3 * 6 + 30, 500}});
+  for (const char *name : {"matrix.fseq", "msparse.fseq"}) {
+    const std::vector<std::pair<uint32_t, uint32_t>> ranges = strcmp(name, "msparse.fseq") ? none : std::vector<std::pair<uint32_t, uint32_t>>{{0, 32 * 3 * 4}, {32 * 3 * 6 + 30, 500}};
+    for (unsigned n = 0; n < 40; n++, layouts++) {
+      const unsigned x0 = testRandom(31), x1 = x0 + 1 + testRandom(32 - x0), y0 = testRandom(15), y1 = y0 + 2 + testRandom(15 - y0);
+      Segment s = makeSegment(name, x0, x1, y0, min(y1, 16U));
+      s.reverse = testRandom(2); s.reverse_y = testRandom(2); s.transpose = testRandom(2);
+      s.px.assign(s.vLength(), 0);
+      bad += checkLayout(s, ranges, 50, 40);
+    }
+  }
+  CHECK_EQ(bad, 0);
+  printf("%u segment layouts, %u LEDs differ from the sequence\n", layouts, bad);
+
+  // full matrix: rows continue each other and are read as one span
+  {
+    Segment s = makeSegment("matrix.fseq", 0, 32, 0, 16);
+    CHECK_EQ(renderFseqToSegment(s), IMAGE_ERROR_NONE);
+    CHECK_EQ(findFseqPlayer(&s)->numSpans, 1);
+    endFseqPlayback(&s);
+  }
+
+  // grouping and mirroring are rejected, a missing file is retried after FSEQ_RETRY
+  {
+    Segment s = makeSegment("matrix.fseq", 0, 8, 0, 8);
+    s.grouping = 2;
+    const uint64_t io = ioUs;
+    CHECK_EQ(renderFseqToSegment(s), IMAGE_ERROR_UNSUPPORTED_FORMAT);
+    CHECK_EQ(renderFseqToSegment(s), IMAGE_ERROR_UNSUPPORTED_FORMAT);
+    CHECK_EQ(ioUs, io);                                                   // rejected before the file is opened
+    endFseqPlayback(&s);
+    s.grouping = 1; s.mirror = true;
+    CHECK_EQ(renderFseqToSegment(s), IMAGE_ERROR_UNSUPPORTED_FORMAT);
+    s.mirror = false;
+    CHECK_EQ(renderFseqToSegment(s), IMAGE_ERROR_NONE);                 // layout changed, opened again
+    endFseqPlayback(&s);
+
+    Segment m = makeSegment("later.fseq", 0, 8, 0, 8);
+    CHECK_EQ(renderFseqToSegment(m), IMAGE_ERROR_FILE_MISSING);
+    makeFseq("later.fseq", 32 * 16 * 3, 10, 50);                          // uploaded afterwards
+    nowUs += 500000;
+    CHECK_EQ(renderFseqToSegment(m), IMAGE_ERROR_PREV);
+    nowUs += 600000;
+    CHECK_EQ(renderFseqToSegment(m), IMAGE_ERROR_NONE);
+    endFseqPlayback(&m);
+  }
+
+  // main loop with timed file reads: 900 LED strip (one 2.7 kB span) and a 24x12 segment of a 64x32 matrix (12 spans)
+  struct Case { const char *label; unsigned mw, mh, x0, x1, y0, y1; bool matrix; };
+  const Case cases[] = { {"900 LEDs", 900, 1, 0, 900, 0, 1, false}, {"24x12 of 64x32", 64, 32, 20, 44, 10, 22, true} };
+  makeFseq("long.fseq", 900 * 3, 400, 25);
+  makeFseq("mlong.fseq", 64 * 32 * 3, 400, 25);
+  for (const Case &c : cases) {
+    Segment::maxWidth = c.mw; Segment::maxHeight = c.mh;
+    strip.isMatrix = c.matrix;
+    LoopStats st[2];
+    for (int prefetch = 0; prefetch < 2; prefetch++) {
+      Segment s = makeSegment(c.matrix ? "mlong.fseq" : "long.fseq", c.x0, c.x1, c.y0, c.y1);
+      st[prefetch] = runLoop(s, 24, prefetch, 8);
+    }
+    CHECK(st[1].renderMaxMs < st[0].renderMaxMs);
+    CHECK(st[1].misses <= 2);                                             // only after a stall
+    CHECK(st[1].skipped <= st[0].skipped);
+    printf("%s, 25 ms per frame: first frame %.2f ms, then render without prefetch avg %.2f max %.2f ms, with prefetch "
+           "avg %.2f max %.2f ms; %u/%u frames shown, %u/%u skipped, %u prefetch misses\n", c.label, st[1].firstMs,
+           st[0].renderAvgMs, st[0].renderMaxMs, st[1].renderAvgMs, st[1].renderMaxMs, st[0].shown, st[1].shown,
+           st[0].skipped, st[1].skipped, st[1].misses);
+  }
+
+  return testResult("fseq");
+}
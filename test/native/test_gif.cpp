@@ -0,0 +1,284 @@
+/*
+ * GIF playback (image_loader.cpp): frame cache, scaled row blits and several segments sharing the decoder
+ * Uncompressed test GIFs (see GifDecoder.h) are played on segments of other sizes (up and down scaled, 1D) and every
+ * shown frame has to match a nearest-neighbour scaled reference. Looping GIFs are played from the cache after the
+ * first loop without the decoder and without file reads, without PSRAM the cache budget is shared by all GIFs and
+ * GIFs too large for a canvas are drawn directly, segments streaming that way hand the decoder over and resume.
+ * CPU time per frame is measured for 16x16 to 128x64 GIFs: the former per-pixel drawing against decoding into the
+ * canvas while caching, playing from the cache and streaming. Decompression is not part of the figures (the test
+ * decoder only copies pixels), on the device every frame played from the cache also saves the LZW decoding.
+ */
+#include "native_test.h"
+#include <map>
+#include "GifDecoder.h"
+
+typedef uint8_t byte;
+#define WLED_ENABLE_GIF
+#define RGBW32(r,g,b,w) (uint32_t((uint8_t)(w) << 24 | (uint8_t)(r) << 16 | (uint8_t)(g) << 8 | (uint8_t)(b)))
+#define IMAGE_ERROR_NONE 0
+#define IMAGE_ERROR_NO_NAME 1
+#define IMAGE_ERROR_SEG_LIMIT 2
+#define IMAGE_ERROR_UNSUPPORTED_FORMAT 3
+#define IMAGE_ERROR_FILE_MISSING 4
+#define IMAGE_ERROR_DECODER_ALLOC 5
+#define IMAGE_ERROR_GIF_DECODE 6
+#define IMAGE_ERROR_FRAME_DECODE 7
+#define IMAGE_ERROR_WAITING 254
+#define IMAGE_ERROR_PREV 255
+
+static unsigned long nowMs = 0;
+static unsigned long millis() { return nowMs; }
+
+static uint8_t gammaT[256];
+#define gamma8(c) gammaT[c]
+
+static bool psramSafe = true, psramPresent = true;
+static bool psramFound() { return psramPresent; }
+
+static std::map<std::string, std::vector<uint8_t>> files;
+static size_t bytesRead = 0;
+
+class File {
+    const std::vector<uint8_t> *_data = nullptr;
+    size_t _pos = 0;
+  public:
+    File() = default;
+    File(const std::vector<uint8_t> *d) : _data(d) {}
+    explicit operator bool() const { return _data != nullptr; }
+    bool seek(size_t pos) { if (!_data || pos > _data->size()) return false; _pos = pos; return true; }
+    size_t position() const { return _pos; }
+    size_t size() const { return _data ? _data->size() : 0; }
+    int read() { if (!_data || _pos >= _data->size()) return -1; bytesRead++; return (*_data)[_pos++]; }
+    size_t read(uint8_t *buf, size_t len) {
+      if (!_data) return 0;
+      len = min(len, _data->size() - _pos);
+      memcpy(buf, _data->data() + _pos, len);
+      _pos += len;
+      bytesRead += len;
+      return len;
+    }
+    void close() { _data = nullptr; }
+};
+struct MockFS {
+  File open(const char *name, const char *) { auto f = files.find(name); return f == files.end() ? File() : File(&f->second); }
+} WLED_FS;
+
+// segment with a plain pixel buffer (the firmware maps every pixel through the segment geometry, not part of the figures)
+struct Segment {
+  char    *name = nullptr;
+  uint8_t  speed = 128;
+  unsigned w = 0, h = 1;
+  std::vector<uint32_t> px;
+
+  void     setSize(unsigned width, unsigned height) { w = width; h = height; px.assign(w * h, 0); }
+  uint16_t width()   const { return w; } // as in FX.h
+  uint16_t height()  const { return h; }
+  unsigned vWidth()  const { return w; }
+  unsigned vHeight() const { return h; }
+  bool     is2D()    const { return h > 1; }
+  void __attribute__((noinline)) setPixelColorXY(int x, int y, uint32_t c) { if (unsigned(x) < w && unsigned(y) < h) px[x + y * w] = c; }
+  void setPixelColorXY(int x, int y, byte r, byte g, byte b, byte white = 0) { setPixelColorXY(x, y, RGBW32(r,g,b,white)); }
+  void __attribute__((noinline)) setPixelColor(int i, uint32_t c) { if (unsigned(i) < w * h) px[i] = c; }
+  void fill(uint32_t c) { std::fill(px.begin(), px.end(), c); }
+};
+
+#include "../../wled00/image_loader.cpp"
+
+// pixel of test GIF 'id' in frame f
+static void gifPixel(unsigned id, unsigned f, unsigned x, unsigned y, uint8_t rgb[3]) {
+  uint32_t v = (id * 0x9E3779B1U) ^ ((f + 1) * 2654435761U) ^ (x * 40503U) ^ (y * 0x85EBCA77U);
+  v ^= v >> 15; v *= 0x2C1B3C6DU; v ^= v >> 12;
+  rgb[0] = v; rgb[1] = v >> 8; rgb[2] = v >> 16;
+}
+
+static uint16_t frameDelay(unsigned f) { return 40 + 10 * (f % 4); }
+
+static void makeGif(const char *name, unsigned id, unsigned w, unsigned h, unsigned frames, bool zeroDelay = false) {
+  std::vector<uint8_t> d = { 'T', 'G', 'I', 'F', uint8_t(w), uint8_t(w >> 8), uint8_t(h), uint8_t(h >> 8) };
+  for (unsigned f = 0; f < frames; f++) {
+    const uint16_t delay = zeroDelay ? 0 : frameDelay(f);
+    d.push_back(delay); d.push_back(delay >> 8);
+    uint8_t rgb[3];
+    for (unsigned y = 0; y < h; y++) for (unsigned x = 0; x < w; x++) { gifPixel(id, f, x, y, rgb); d.insert(d.end(), rgb, rgb + 3); }
+  }
+  files[std::string("/") + name] = d;
+}
+
+// nearest-neighbour scaled frame f as the segment has to show it, through RGB565 (canvas) or at full color (drawn directly)
+static bool showsFrame(const Segment &seg, unsigned id, unsigned gw, unsigned gh, unsigned f, bool rgb565) {
+  uint8_t rgb[3];
+  for (unsigned y = 0; y < seg.h; y++) for (unsigned x = 0; x < seg.w; x++) {
+    gifPixel(id, f, x * gw / seg.w, y * gh / seg.h, rgb);
+    const uint32_t c = rgb565 ? fromRGB565(toRGB565(rgb[0], rgb[1], rgb[2])) : RGBW32(gamma8(rgb[0]), gamma8(rgb[1]), gamma8(rgb[2]), 0);
+    if (seg.px[x + y * seg.w] != c) return false;
+  }
+  return true;
+}
+
+static void endAll() {
+  for (auto &p : gifPlayers) if (p.seg) endImagePlayback(p.seg);
+}
+
+// former drawing: two divisions and a scaling loop per GIF pixel, color set pixel by pixel
+static Segment *formerSeg;
+static uint16_t formerWidth, formerHeight;
+static void formerDrawPixelCallback(int16_t x, int16_t y, uint8_t red, uint8_t green, uint8_t blue) {
+  int16_t outY = y * formerSeg->height() / formerHeight;
+  int16_t outX = x * formerSeg->width()  / formerWidth;
+  for (int16_t i = 0; i < (formerSeg->width()+(formerWidth-1)) / formerWidth; i++) {
+    for (int16_t j = 0; j < (formerSeg->height()+(formerHeight-1)) / formerHeight; j++) {
+      formerSeg->setPixelColorXY(outX + i, outY + j, gamma8(red), gamma8(green), gamma8(blue));
+    }
+  }
+}
+
+int main() {
+  for (unsigned i = 0; i < 256; i++) gammaT[i] = unsigned(pow(i / 255.0, 2.2) * 255 + 0.5);
+
+  // scaled playback from the cache (PSRAM): every frame matches the reference, delays are kept
+  static const unsigned layouts[][4] = { {16, 16, 16, 16}, {16, 8, 32, 32}, {32, 32, 20, 12}, {24, 20, 7, 5}, {10, 10, 30, 1}, {64, 32, 64, 32} };
+  unsigned shown = 0, wrong = 0, wrongDelay = 0;
+  for (unsigned l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+    const unsigned gw = layouts[l][0], gh = layouts[l][1], frames = 3 + l;
+    makeGif("a.gif", l, gw, gh, frames);
+    Segment seg;
+    seg.setSize(layouts[l][2], layouts[l][3]);
+    seg.name = const_cast<char*>("a.gif");
+    const unsigned decodesBefore = decoder.frameDecodes, deallocsBefore = decoder.deallocs;
+    nowMs += 1000;
+    for (unsigned k = 0; k < 3 * frames; k++) {
+      CHECK_EQ(renderImageToSegment(seg), IMAGE_ERROR_NONE);
+      if (!showsFrame(seg, l, gw, gh, k % frames, true) && !wrong++) fprintf(stderr, "layout %u: frame %u wrong\n", l, k);
+      shown++;
+      if (k == 0) continue; // the first frame is late (no previous frame), its delay is compensated
+      // next frame exactly after the delay of this one
+      nowMs += frameDelay(k % frames) - 1;
+      if (renderImageToSegment(seg) != IMAGE_ERROR_WAITING) wrongDelay++;
+      nowMs++;
+    }
+    const GifPlayer *p = findGifPlayer(&seg);
+    CHECK(p && p->complete && !p->streaming);
+    CHECK_EQ(p->frameCount, frames);
+    CHECK_EQ(decoder.frameDecodes - decodesBefore, frames + 1); // one loop and the wrap to the first frame
+    CHECK_EQ(decoder.deallocs - deallocsBefore, 1);
+    CHECK(decoderOwner == nullptr && !file && p->canvas == nullptr);
+    CHECK_EQ(testHeapUsed, frames * gw * gh * sizeof(uint16_t));
+    bytesRead = 0;
+    for (unsigned k = 0; k < frames; k++) { nowMs += 100; renderImageToSegment(seg); }
+    CHECK_EQ(bytesRead, 0);
+    endImagePlayback(&seg);
+    CHECK_EQ(testHeapUsed, 0);
+  }
+  CHECK_EQ(wrong, 0);
+  CHECK_EQ(wrongDelay, 0);
+  printf("%u frames on %u layouts shown from cache, %u wrong, %u with wrong delay\n", shown, unsigned(sizeof(layouts) / sizeof(layouts[0])), wrong, wrongDelay);
+
+  // without PSRAM: one cache budget for all GIFs, a GIF that does not fit into it streams through its canvas
+  psramPresent = false;
+  makeGif("b.gif", 100, 32, 32, 5);
+  makeGif("c.gif", 101, 32, 32, 5);
+  Segment segB, segC;
+  segB.setSize(32, 32); segB.name = const_cast<char*>("b.gif");
+  segC.setSize(16, 16); segC.name = const_cast<char*>("c.gif");
+  unsigned shownB = 0, shownC = 0, waitingC = 0;
+  wrong = 0;
+  for (unsigned i = 0; i < 40; i++) {
+    nowMs += 100;
+    if (renderImageToSegment(segB) == IMAGE_ERROR_NONE && !showsFrame(segB, 100, 32, 32, shownB++ % 5, true)) wrong++;
+    const byte r = renderImageToSegment(segC);
+    if (r == IMAGE_ERROR_WAITING) waitingC++;
+    else if (r == IMAGE_ERROR_NONE && !showsFrame(segC, 101, 32, 32, shownC++ % 5, true)) wrong++;
+  }
+  const GifPlayer *pB = findGifPlayer(&segB), *pC = findGifPlayer(&segC);
+  CHECK(pB->complete && !pB->streaming);
+  CHECK(!pC->complete && pC->streaming && pC->canvas);
+  CHECK(pB->cacheBytes + pC->cacheBytes <= WLED_GIF_CACHE_DRAM);
+  CHECK_EQ(waitingC, 5); // until b.gif is cached
+  CHECK_EQ(wrong, 0);
+  printf("shared cache: %u + %u bytes cached, c.gif streams, waited %u frames for the decoder, %u of %u frames wrong\n",
+         unsigned(pB->cacheBytes), unsigned(pC->cacheBytes), waitingC, wrong, shownB + shownC);
+  endAll();
+
+  // without PSRAM and too large for a canvas: drawn directly, two such GIFs hand the decoder over and resume
+  makeGif("d.gif", 102, 160, 120, 4);
+  makeGif("e.gif", 103, 130, 130, 3);
+  Segment segD, segE;
+  segD.setSize(80, 60);  segD.name = const_cast<char*>("d.gif");
+  segE.setSize(200, 40); segE.name = const_cast<char*>("e.gif");
+  unsigned shownD = 0, shownE = 0;
+  wrong = 0;
+  for (unsigned i = 0; i < 30; i++) {
+    nowMs += 100;
+    if (renderImageToSegment(segD) == IMAGE_ERROR_NONE && !showsFrame(segD, 102, 160, 120, shownD++ % 4, false)) wrong++;
+    if (renderImageToSegment(segE) == IMAGE_ERROR_NONE && !showsFrame(segE, 103, 130, 130, shownE++ % 3, false)) wrong++;
+  }
+  CHECK(findGifPlayer(&segD)->streaming && !findGifPlayer(&segD)->canvas);
+  CHECK(shownD >= 14 && shownE >= 14); // every other render after the first hand-over
+  CHECK_EQ(wrong, 0);
+  CHECK_EQ(testHeapUsed, 0);
+  printf("drawn directly: %u + %u frames shown alternating, %u wrong\n", shownD, shownE, wrong);
+  endAll();
+  psramPresent = true;
+
+  // CPU time per frame, GIF and segment of the same size
+  static const unsigned sizes[][2] = { {16, 16}, {32, 32}, {64, 32}, {64, 64}, {128, 64} };
+  const unsigned frames = 8;
+  for (const auto &sz : sizes) {
+    const unsigned gw = sz[0], gh = sz[1], loops = max(2U, 8 * 128 * 64 / (gw * gh * frames));
+    makeGif("bench.gif", 200, gw, gh, frames, true);
+    Segment seg;
+    seg.setSize(gw, gh);
+    seg.name = const_cast<char*>("bench.gif");
+
+    // former: decode and draw every frame
+    formerSeg = &seg;
+    formerWidth = gw; formerHeight = gh;
+    GifDecoder<320,320,12,true> formerDecoder;
+    file = WLED_FS.open("/bench.gif", "r");
+    formerDecoder.setDrawPixelCallback(formerDrawPixelCallback);
+    formerDecoder.setFileSeekCallback(fileSeekCallback);
+    formerDecoder.setFilePositionCallback(filePositionCallback);
+    formerDecoder.setFileReadCallback(fileReadCallback);
+    formerDecoder.setFileReadBlockCallback(fileReadBlockCallback);
+    formerDecoder.setFileSizeCallback(fileSizeCallback);
+    formerDecoder.startDecoding();
+    double t0 = benchSeconds();
+    for (unsigned i = 0; i < loops * frames; i++) formerDecoder.decodeFrame(false);
+    const double former = (benchSeconds() - t0) * 1e6 / (loops * frames);
+    file.close();
+
+    // first loop: decode into the canvas, cache and blit
+    double caching = 0;
+    for (unsigned i = 0; i < loops; i++) {
+      t0 = benchSeconds();
+      for (unsigned k = 0; k < frames; k++) renderImageToSegment(seg);
+      caching += benchSeconds() - t0;
+      if (i + 1 < loops) endImagePlayback(&seg);
+    }
+    caching = caching * 1e6 / (loops * frames);
+
+    // from the cache
+    renderImageToSegment(seg);
+    CHECK(findGifPlayer(&seg)->complete);
+    t0 = benchSeconds();
+    for (unsigned i = 0; i < loops * frames; i++) renderImageToSegment(seg);
+    const double cached = (benchSeconds() - t0) * 1e6 / (loops * frames);
+    endImagePlayback(&seg);
+
+    // streaming: no heap left for the cache after the first frame
+    renderImageToSegment(seg);
+    testHeapLimit = testHeapUsed;
+    renderImageToSegment(seg);
+    CHECK(findGifPlayer(&seg)->streaming);
+    t0 = benchSeconds();
+    for (unsigned i = 0; i < loops * frames; i++) renderImageToSegment(seg);
+    const double streaming = (benchSeconds() - t0) * 1e6 / (loops * frames);
+    CHECK(showsFrame(seg, 200, gw, gh, (1 + loops * frames) % frames, true));
+    endImagePlayback(&seg);
+    testHeapLimit = SIZE_MAX;
+
+    printf("%ux%u GIF: former %.1f us/frame; caching %.1f, from cache %.1f, streaming %.1f us/frame\n", gw, gh, former, caching, cached, streaming);
+  }
+
+  return testResult("gif");
+}
@@ -0,0 +1,348 @@
+/*
+ * Compiled ir.json command table (ir.cpp) with a custom remote (irEnabled 8)
+ * ir.json is served from a mock file system that counts opens and bytes read. Checks the compiler (all command kinds,
+ * ignored keys, duplicates, malformed files, pool limit), the hash table with many codes, dispatch of key presses and
+ * repeats through decodeIR(), and that only a changed or re-uploaded ir.json is read again (never on repeated keys).
+ */
+#include "native_test.h"
+#include <cctype>
+#include <cstdarg>
+#include <map>
+
+typedef uint8_t byte;
+#define CALL_MODE_BUTTON         2
+#define CALL_MODE_BUTTON_PRESET 12
+#define ERR_FS_IRLOAD           13
+#define JSON_BUFFER_SIZE     32767
+#define FX_MODE_STATIC           0
+#define FX_MODE_BREATH           2
+#define FX_MODE_RAINBOW          8
+#define FX_MODE_RAINBOW_CYCLE    9
+#define FX_MODE_COLORTWINKLE    74
+#define FX_MODE_METEOR          76
+#define FX_MODE_RAIN            43
+#define FX_MODE_FIRE_FLICKER    45
+#define FX_MODE_PALETTE         65
+#define RGBW32(r,g,b,w) (uint32_t((uint8_t)(w) << 24 | (uint8_t)(r) << 16 | (uint8_t)(g) << 8 | (uint8_t)(b)))
+#define R(c) ((uint8_t)((c) >> 16))
+#define G(c) ((uint8_t)((c) >> 8))
+#define B(c) ((uint8_t)(c))
+#define W(c) ((uint8_t)((c) >> 24))
+#define GET_BIT(var,bit) (((var)>>(bit))&0x01)
+
+static unsigned long now = 0;
+static unsigned long millis() { return now; }
+
+// file system: ir.json content with size and modification time, opens and bytes read are counted
+static std::string irJson;
+static bool irJsonExists = false;
+static time_t irJsonTime = 0;
+static unsigned fsOpens = 0;
+static size_t fsRead = 0;
+class File {
+  public:
+    File() {}
+    File(const std::string *data, time_t t) : _data(data), _time(t) {}
+    explicit operator bool() const { return _data != nullptr; }
+    size_t size() const { return _data->size(); }
+    time_t getLastWrite() const { return _time; }
+    int read() { if (_pos >= _data->size()) return -1; fsRead++; return (uint8_t)(*_data)[_pos++]; }
+    size_t readBytes(char *buf, size_t len) { size_t n = 0; int c; while (n < len && (c = read()) >= 0) buf[n++] = c; return n; }
+    bool find(const char *target) { // Stream::find()
+      const size_t len = strlen(target);
+      size_t matched = 0;
+      int c;
+      while ((c = read()) >= 0) {
+        matched = (c == target[matched]) ? matched + 1 : (c == target[0]);
+        if (matched == len) return true;
+      }
+      return false;
+    }
+    void close() {}
+  private:
+    const std::string *_data = nullptr;
+    size_t _pos = 0;
+    time_t _time = 0;
+};
+struct MockFS {
+  File open(const char *path, const char *mode) {
+    CHECK(!strcmp(path, "/ir.json") && !strcmp(mode, "r"));
+    fsOpens++;
+    return irJsonExists ? File(&irJson, irJsonTime) : File();
+  }
+} WLED_FS;
+static void writeIRJson(const std::string &s) { irJson = s; irJsonExists = true; irJsonTime++; }
+
+// JSON buffer
+static DynamicJsonDocument gDoc(JSON_BUFFER_SIZE);
+static JsonDocument *pDoc = &gDoc;
+static bool jsonLocked = false, jsonLockBusy = false;
+static bool requestJSONBufferLock(uint8_t) { if (jsonLocked || jsonLockBusy) return false; jsonLocked = true; return true; }
+static void releaseJSONBufferLock() { CHECK(jsonLocked); jsonLocked = false; }
+
+// what key presses trigger
+static std::vector<std::string> calls;
+static void call(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static void call(const char *fmt, ...) { char b[256]; va_list a; va_start(a, fmt); vsnprintf(b, sizeof(b), fmt, a); va_end(a); calls.push_back(b); }
+struct AsyncWebServerRequest;
+static bool handleSet(AsyncWebServerRequest*, const String &req, bool apply) { CHECK(!apply); call("set %s", req.c_str()); return true; }
+static void savePreset(byte index, const char *pname, JsonObject) { call("save %u %s", index, pname); }
+static bool deserializeState(JsonObject root, byte mode, byte = 0) {
+  CHECK(jsonLocked);
+  std::string s; serializeJson(root, s); call("state %s %u", s.c_str(), mode); return true;
+}
+static void applyPresetWithFallback(uint8_t preset, uint8_t mode, uint8_t fx, uint8_t pal) { call("preset %u %u %u %u", preset, mode, fx, pal); }
+static void stateUpdated(byte) {}
+static void toggleOnOff() {}
+static unsigned getPaletteCount() { return 72; }
+static void setValuesFromMainSeg() {}
+static void setValuesFromFirstSelectedSeg() {}
+static uint8_t hw_random8(uint32_t n) { return testRandom(n); }
+
+struct CRGB {
+  uint8_t red = 0, green = 0, blue = 0;
+  CRGB(uint32_t c) : red(c >> 16), green(c >> 8), blue(c) {}
+};
+struct CHSV { uint8_t h = 0, s = 0, v = 0; };
+static CHSV rgb2hsv(CRGB) { return CHSV(); }
+static void hsv2rgb_rainbow(const CHSV&, CRGB&) {}
+
+class Segment {
+  public:
+    uint32_t colors[3] = {0, 0, 0};
+    uint8_t  speed = 128, intensity = 128, palette = 0, mode = 0;
+    uint16_t cct = 127;
+    bool isActive() const { return true; }
+    bool isSelected() const { return true; }
+    void setMode(uint8_t m) { mode = m; }
+    void setPalette(uint8_t p) { palette = p; }
+    void setColor(uint8_t slot, uint32_t c) { colors[slot] = c; }
+    void setCCT(uint16_t k) { cct = k; }
+    uint8_t getLightCapabilities() const { return 0x01; }
+};
+struct MockStrip {
+  Segment seg;
+  unsigned mainSegment = 0;
+  bool isUpdating() const { return false; }
+  unsigned getModeCount() const { return 187; }
+  unsigned getSegmentsNum() const { return 1; }
+  Segment &getSegment(unsigned) { return seg; }
+  Segment &getMainSegment() { return seg; }
+  Segment &getFirstSelectedSeg() { return seg; }
+  uint8_t getMainSegmentId() const { return mainSegment; }
+} strip;
+
+// IR receiver, codes are fed to decodeIR() directly
+struct decode_results { uint64_t value; };
+class IRrecv {
+  public:
+    IRrecv(int) {}
+    void enableIRIn() {}
+    void disableIRIn() {}
+    bool decode(decode_results*) { return false; }
+    void resume() {}
+};
+struct MockSerial { size_t printf_P(const char*, ...) { return 0; } } Serial;
+
+static byte bri = 128, briLast = 128, whiteLast = 128, effectCurrent = 0, effectSpeed = 128, effectIntensity = 128, effectPalette = 0;
+static byte irEnabled = 8, errorFlag = 0;
+static int8_t irPin = 4;
+static bool irApplyToAllSelected = true, stateChanged = false, nightlightActive = false, serialCanTX = false;
+static unsigned long nightlightStartTime = 0;
+
+#include "../../wled00/ir.cpp"
+
+// key press followed by 'repeats' repeat codes (every 110ms as sent by NEC remotes), returns calls made
+static std::vector<std::string> key(uint32_t code, unsigned repeats = 0) {
+  calls.clear();
+  decodeIR(code);
+  for (unsigned i = 0; i < repeats; i++) { now += 110; decodeIR(0xFFFFFFFF); }
+  now += 500;
+  return calls;
+}
+
+static const char *pool(const irCommand *c) { return c ? irPool + c->str : ""; }
+
+static const char sample[] =
+  "{\n"
+  "  \"0xFF629D\": {\"cmd\": \"T=2\", \"rpt\": true, \"label\": \"Toggle on/off\"},\n"
+  "  \"0xFF9867\": {\"cmd\": \"A=~16\", \"label\": \"Inc brightness\"},\n"
+  "  \"0xFF38C7\": {\"cmd\": {\"bri\": 10, \"seg\": [{\"id\": 1, \"fx\": 2}]}, \"label\": \"Dim to 10 } \\\" {\"},\n"
+  "  \"0xFF22DD\": {\"cmd\": \"!presetFallback\", \"PL\": 1, \"FX\": 16, \"FP\": 6, \"label\": \"Preset 1\"},\n"
+  "  \"0xFF02FD\": {\"cmd\": \"!presetFallback\", \"PL\": 3},\n"
+  "  \"0xFFC23D\": {\"cmd\": \"!incBri\"}, \"0xFF30CF\": {\"cmd\": \"!decBri\"},\n"
+  "  \"0xFF7A85\": {\"cmd\": {\"psave\": 5}},\n"
+  "  \"0xFF18E7\": {\"cmd\": \"win&FX=~&SS=1\"},\n"
+  "  \"0xFF10EF\": {\"cmd\": \"!unknown\"},\n"
+  "  \"label\": \"keys other than codes are ignored\", \"0x0\": {\"cmd\": \"T=0\"}, \"0xFF906F\": \"not an object\",\n"
+  "  \"0XFFE01F\": {\"cmd\": \"first\"},\n"
+  "  \"0xffe01f\": {\"cmd\": \"last one wins\"}\n"
+  "}\n";
+
+int main() {
+  // compiler: every command kind
+  writeIRJson(sample);
+  compileIRTable();
+  CHECK(!jsonLocked && !irTableDirty && !irFileMissing);
+  CHECK_EQ(irCommands, 12);                                 // duplicate key counted twice, stored once
+  const irCommand *c = findIRCommand(0xFF629D);
+  CHECK(c && c->action == IR_CMD_API && c->repeatable && !strcmp(pool(c), "win&T=2"));
+  c = findIRCommand(0xFF9867);
+  CHECK(c && c->action == IR_CMD_API && c->repeatable && !strcmp(pool(c), "win&A=~16"));
+  c = findIRCommand(0xFF38C7);
+  CHECK(c && c->action == IR_CMD_JSON && !c->repeatable && !strcmp(pool(c), "{\"bri\":10,\"seg\":[{\"id\":1,\"fx\":2}]}"));
+  c = findIRCommand(0xFF22DD);
+  CHECK(c && c->action == IR_CMD_PRESET_FB && c->param[0] == 1 && c->param[1] == 16 && c->param[2] == 6);
+  c = findIRCommand(0xFF02FD);
+  CHECK(c && c->action == IR_CMD_PRESET_FB && c->param[0] == 3 && c->param[1] == 255 && c->param[2] == 0);
+  c = findIRCommand(0xFFC23D);
+  CHECK(c && c->action == IR_CMD_INC_BRI && c->repeatable);
+  c = findIRCommand(0xFF30CF);
+  CHECK(c && c->action == IR_CMD_DEC_BRI && c->repeatable);
+  c = findIRCommand(0xFF7A85);
+  CHECK(c && c->action == IR_CMD_PSAVE && c->param[0] == 5);
+  c = findIRCommand(0xFF18E7);
+  CHECK(c && c->action == IR_CMD_API && c->repeatable && !strcmp(pool(c), "win&FX=~&SS=1"));
+  c = findIRCommand(0xFF10EF);
+  CHECK(c && c->action == IR_CMD_NONE);
+  c = findIRCommand(0xFFE01F);
+  CHECK(c && c->action == IR_CMD_API && !c->repeatable && !strcmp(pool(c), "win&last one wins"));
+  CHECK(!findIRCommand(0) && !findIRCommand(0xFF906F) && !findIRCommand(0x12345678));
+  CHECK_EQ(testHeapUsed, (sizeof(irCommand) << irTableBits) + irPoolLen); // pool sized exactly
+  CHECK(irCommands * 4 <= (3U << irTableBits));                          // load factor <= 75%
+
+  // dispatch through decodeIR()
+  CHECK(key(0xFF629D) == std::vector<std::string>{"set win&T=2"});
+  irApplyToAllSelected = false; strip.mainSegment = 2;
+  CHECK(key(0xFF629D) == std::vector<std::string>{"set win&T=2&SS=2"});
+  CHECK(key(0xFF18E7) == std::vector<std::string>{"set win&FX=~&SS=1"});   // segment given, not appended
+  irApplyToAllSelected = true; strip.mainSegment = 0;
+  CHECK(key(0xFF38C7) == std::vector<std::string>{"state {\"bri\":10,\"seg\":{\"fx\":2}} 12"});
+  CHECK(key(0xFF7A85) == std::vector<std::string>{"save 5 IR Preset 5"});
+  CHECK(key(0xFF22DD) == std::vector<std::string>{"preset 1 12 16 6"});
+  CHECK(key(0xFF10EF).empty());
+  bri = 20;
+  key(0xFFC23D, 3);                                                       // key and 3 repeats: 26, 34, 43, 56
+  CHECK_EQ(bri, 56);
+  key(0xFF30CF);
+  CHECK_EQ(bri, 43);
+  CHECK(key(0xFF9867, 2) == std::vector<std::string>({"set win&A=~16", "set win&A=~16", "set win&A=~16"}));
+  CHECK(key(0xFF38C7, 2) == std::vector<std::string>{"state {\"bri\":10,\"seg\":{\"fx\":2}} 12"}); // again (pool not modified by parsing), not repeatable
+  CHECK(key(0x12345678).empty() && !errorFlag);
+
+  // a brightness ramp (key held for 5s) does not touch the file system
+  fsOpens = 0; fsRead = 0;
+  calls.clear();
+  CHECK_EQ(key(0xFF9867, 45).size(), 46);
+  CHECK_EQ(fsOpens, 0);
+  CHECK_EQ(fsRead, 0);
+
+  // ir.json edited on the device: noticed on the first new key press after 5s, never on repeats
+  std::string edited = sample;
+  edited.replace(edited.find("A=~16"), 5, "A=~32");
+  writeIRJson(edited);
+  now += IR_FILE_CHECK;
+  fsOpens = 0;
+  CHECK(key(0xFF9867, 10) == std::vector<std::string>(11, "set win&A=~32"));
+  CHECK_EQ(fsOpens, 3);                                                   // stamp check + 2 compiler passes
+  fsOpens = 0;
+  key(0xFF9867);                                                          // checked less than 5s ago
+  CHECK_EQ(fsOpens, 0);
+  now += IR_FILE_CHECK;
+  key(0xFF9867);                                                          // unchanged: stamp check only
+  CHECK_EQ(fsOpens, 1);
+
+  // upload through /edit: reloadIRTable() compiles on the next key press without waiting
+  edited.replace(edited.find("A=~32"), 5, "A=~8");
+  writeIRJson(edited);
+  reloadIRTable();
+  CHECK(key(0xFF9867) == std::vector<std::string>{"set win&A=~8"});
+
+  // JSON buffer busy: previous table is used, new one is compiled on a later key press
+  edited.replace(edited.find("A=~8"), 4, "A=~4");
+  writeIRJson(edited);
+  reloadIRTable();
+  jsonLockBusy = true;
+  CHECK(key(0xFF9867) == std::vector<std::string>{"set win&A=~8"});
+  jsonLockBusy = false;
+  CHECK(key(0xFF9867) == std::vector<std::string>{"set win&A=~4"});
+
+  // ir.json deleted: unknown code sets the error flag; created again: picked up after 5s
+  irJsonExists = false;
+  reloadIRTable();
+  CHECK(key(0xFF9867).empty());
+  CHECK_EQ(errorFlag, ERR_FS_IRLOAD);
+  CHECK_EQ(testHeapUsed, 0);
+  errorFlag = 0;
+  writeIRJson(sample);
+  now += IR_FILE_CHECK;
+  CHECK(key(0xFF629D) == std::vector<std::string>{"set win&T=2"});
+
+  // malformed ir.json: entries up to the error are used
+  std::string broken = sample;
+  broken.resize(broken.find("\"0xFF22DD\"") + 20);
+  writeIRJson(broken);
+  reloadIRTable();
+  CHECK(key(0xFF38C7).size() == 1);
+  CHECK(key(0xFF22DD).empty());
+  writeIRJson("");
+  reloadIRTable();
+  CHECK(key(0xFF38C7).empty());
+  CHECK_EQ(testHeapUsed, 0);
+
+  // many codes: every code is found, others are not, probe sequences stay short
+  {
+    std::map<uint32_t, std::string> codes;
+    std::string json = "{";
+    while (codes.size() < 500) {
+      const uint32_t code = testRandom() | 1;
+      if (codes.count(code)) continue;
+      codes[code] = "PL=" + std::to_string(codes.size());
+      char entry[64];
+      snprintf(entry, sizeof(entry), "%s\"0x%X\":{\"cmd\":\"%s\"}", codes.size() > 1 ? "," : "", code, codes[code].c_str());
+      json += entry;
+    }
+    json += "}";
+    writeIRJson(json);
+    reloadIRTable();
+    key(1);
+    CHECK_EQ(irCommands, codes.size());
+    size_t poolLen = 0;
+    for (auto &kv : codes) {
+      c = findIRCommand(kv.first);
+      CHECK(c && !strcmp(pool(c), ("win&" + kv.second).c_str()));
+      poolLen += 4 + kv.second.size() + 1;
+    }
+    CHECK_EQ(irPoolLen, poolLen);
+    unsigned misses = 0, maxProbe = 0;
+    const size_t mask = (1U << irTableBits) - 1;
+    for (unsigned i = 0; i < 100000; i++) {
+      const uint32_t code = testRandom() & ~1U;
+      if (!findIRCommand(code)) misses++;
+      unsigned probe = 1;
+      for (size_t j = irTableHome(code); irTable[j].code; j = (j + 1) & mask) probe++;
+      maxProbe = max(maxProbe, probe);
+    }
+    CHECK_EQ(misses, 100000);
+    CHECK(maxProbe < 64);
+    printf("500 codes: %u slots, %zu pool bytes, %zu bytes total, longest unsuccessful probe %u\n",
+           1U << irTableBits, irPoolLen, testHeapUsed, maxProbe);
+  }
+
+  // command pool larger than 64k (16 bit offsets): no table, nothing leaks
+  {
+    std::string json = "{";
+    const std::string cmd(200, 'x');
+    for (unsigned i = 1; i <= 400; i++) json += (i > 1 ? ",\"0x" : "\"0x") + std::to_string(i) + "\":{\"cmd\":\"" + cmd + "\"}";
+    json += "}";
+    writeIRJson(json);
+    reloadIRTable();
+    CHECK(key(0x1).empty());
+    CHECK(!irTable && !irPool);
+    CHECK_EQ(testHeapUsed, 0);
+  }
+
+  freeIRTable();
+  CHECK_EQ(testHeapUsed, 0);
+  return testResult("ir");
+}
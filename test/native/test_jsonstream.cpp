@@ -0,0 +1,339 @@
+/*
+ * Incremental state parser (JsonStateStream) fuzzed against the DOM path (deserializeJson() + deserializeState())
+ * Random state documents are fed in random chunks. deserializeStateHead(), deserializeSegment() and friends are
+ * replaced by recorders; both paths have to pass the same members, segments and tail (including "seg" for "psave").
+ * Mutated (mostly invalid) documents must not crash, overflow or leave the stream or the JSON lock busy.
+ */
+#include "native_test.h"
+#include <map>
+
+typedef uint8_t byte;
+#define CALL_MODE_DIRECT_CHANGE 1
+#define JSON_BUFFER_SIZE      32767
+#define JSON_STREAM_REST_SIZE 2048
+#define JSON_STREAM_UNIT_SIZE 6144
+#define JSON_STREAM_SEG_KEEP  16384
+
+static uint32_t now = 0;
+static uint32_t millis() { return now; }
+
+static DynamicJsonDocument doc(JSON_BUFFER_SIZE);
+static JsonDocument *pDoc = &doc;
+static bool jsonLocked = false, lockBusy = false;
+static bool requestJSONBufferLock(uint8_t) { if (jsonLocked || lockBusy) return false; jsonLocked = true; pDoc->clear(); return true; }
+static void releaseJSONBufferLock() { jsonLocked = false; }
+
+struct MockStrip {
+  int suspended = 0;
+  void suspend() { suspended++; }
+  void waitForIt() {}
+  void resume() { suspended--; }
+} strip;
+
+// what the state functions were given
+struct Calls {
+  std::map<std::string, std::string> head, tail;
+  std::vector<std::string> segs;
+  std::string pin;
+  unsigned heads = 0, tails = 0, order = 0; // order: segment applied after tail
+  void clear() { *this = Calls(); }
+};
+static Calls rec;
+
+static std::string json(JsonVariantConst v) { std::string s; char buf[8192]; serializeJson(v, buf, sizeof(buf)); s = buf; return s; }
+
+void deserializeStateHead(JsonObject root, byte &, byte) {
+  CHECK(jsonLocked);
+  rec.heads++;
+  for (JsonPair kv : root) {
+    if (!strcmp(kv.key().c_str(), "seg")) continue; // DOM path passes everything
+    CHECK(!rec.head.count(kv.key().c_str()));        // every member once
+    rec.head[kv.key().c_str()] = json(kv.value());
+  }
+}
+bool deserializeStateTail(JsonObject root, byte, byte) {
+  CHECK(jsonLocked);
+  rec.tails++;
+  for (JsonPair kv : root) rec.tail[kv.key().c_str()] = json(kv.value());
+  return root["v"] | false;
+}
+bool deserializeSegment(JsonObject elem, byte it, byte) {
+  CHECK(jsonLocked && strip.suspended == 1);
+  if (rec.tails) rec.order++;
+  rec.segs.push_back("[" + std::to_string(it) + "]" + json(elem));
+  return true;
+}
+void deserializeSegmentObject(JsonObject segObj, byte) {
+  CHECK(jsonLocked && strip.suspended == 1);
+  if (rec.tails) rec.order++;
+  rec.segs.push_back("{}" + json(segObj));
+}
+void purgeDeletedSegments(size_t deleted) {
+  if (deleted) rec.segs.push_back("purge " + std::to_string(deleted));
+}
+void checkSettingsPIN(const char *pin) { rec.pin = pin ? pin : "(null)"; }
+
+#include "../../wled00/jsonstream.h"
+#include "../../wled00/jsonstream.cpp"
+
+// reference: deserializeState() in json.cpp (without presets)
+static bool domState(const std::string &in, bool &verbose) {
+  DynamicJsonDocument dom(JSON_BUFFER_SIZE);
+  if (deserializeJson(dom, in.c_str(), in.size()) || !dom.is<JsonObject>()) return false;
+  jsonLocked = true;
+  JsonObject root = dom.as<JsonObject>();
+  byte callMode = CALL_MODE_DIRECT_CHANGE;
+  deserializeStateHead(root, callMode, 0);
+  JsonVariant segVar = root["seg"];
+  if (!segVar.isNull()) {
+    strip.suspend();
+    if (segVar.is<JsonObject>()) deserializeSegmentObject(segVar, 0);
+    else {
+      int it = 0;
+      size_t deleted = 0;
+      for (JsonObject elem : segVar.as<JsonArray>())
+        if (deserializeSegment(elem, it++, 0) && !elem["stop"].isNull() && elem["stop"] == 0) deleted++;
+      purgeDeletedSegments(deleted);
+    }
+    strip.resume();
+  }
+  if (root.containsKey("pin")) checkSettingsPIN(root["pin"].as<const char*>());
+  verbose = deserializeStateTail(root, callMode, 0);
+  jsonLocked = false;
+  return true;
+}
+
+static JsonStateStream stream;
+
+static bool streamState(const std::string &in, size_t maxChunk, bool &verbose, const void *owner = &stream) {
+  if (!stream.begin(owner, CALL_MODE_DIRECT_CHANGE, true)) return false;
+  for (size_t pos = 0; pos < in.size(); ) {
+    const size_t n = min(in.size() - pos, (size_t)1 + testRandom(maxChunk));
+    stream.write(owner, (const uint8_t*)in.data() + pos, n);
+    pos += n;
+  }
+  return stream.end(owner, verbose);
+}
+
+// random JSON (valid), whitespace anywhere between tokens
+static void ws(std::string &s) { static const char w[] = " \t\r\n"; while (!testRandom(5)) s += w[testRandom(4)]; }
+
+static void genString(std::string &s) {
+  static const char *parts[] = {"a", "Seg", "seg", "{", "}", "[", "]", ",", ":", "\\\"", "\\\\", "\\n", "\\u0041", " ", "\\/"};
+  s += '"';
+  for (unsigned n = testRandom(6); n; n--) s += parts[testRandom(sizeof(parts)/sizeof(parts[0]))];
+  s += '"';
+}
+
+static void genValue(std::string &s, unsigned depth) {
+  ws(s);
+  switch (testRandom(depth ? 9 : 6)) {
+    case 0: s += std::to_string((int)testRandom(512) - 100); break;
+    case 1: s += std::to_string(testRandom(100000)) + "." + std::to_string(testRandom(100)); break;
+    case 2: genString(s); break;
+    case 3: s += testRandom(2) ? "true" : "false"; break;
+    case 4: s += "null"; break;
+    case 5: s += std::to_string(testRandom(256)); break;
+    case 6: case 7: {
+      s += '{';
+      for (unsigned n = testRandom(4), i = 0; i < n; i++) {
+        if (i) s += ',';
+        ws(s); s += "\"k" + std::to_string(i) + "\""; ws(s); s += ':';
+        genValue(s, depth - 1);
+      }
+      ws(s); s += '}';
+      break;
+    }
+    default: {
+      s += '[';
+      for (unsigned n = testRandom(4), i = 0; i < n; i++) { if (i) s += ','; genValue(s, depth - 1); }
+      ws(s); s += ']';
+      break;
+    }
+  }
+  ws(s);
+}
+
+static void genSegment(std::string &s) {
+  static const char *keys[] = {"id", "start", "stop", "fx", "sx", "ix", "pal", "col", "on", "n", "i", "sel"};
+  s += '{';
+  for (unsigned n = testRandom(6), i = 0; i < n; i++) {
+    if (i) s += ',';
+    ws(s); s += std::string("\"") + keys[testRandom(12)] + std::to_string(i) + "\":";
+    if (!testRandom(6)) s += "0"; else genValue(s, 2);
+  }
+  if (!testRandom(4)) s += std::string(s.back() == '{' ? "" : ",") + "\"stop\":0"; // deleted segment
+  s += '}';
+  ws(s);
+}
+
+static std::string genState() {
+  static const char *keys[] = {"on", "bri", "transition", "tt", "tb", "nl", "udpn", "lor", "mainseg", "ps", "pd", "psave",
+                               "pdel", "v", "pin", "playlist", "win", "n", "ib", "o", "ql", "rb", "x", "seg "};
+  std::string s = "{";
+  const int segAt = testRandom(4) ? (int)testRandom(5) : -1;
+  unsigned n = 1 + testRandom(5);
+  for (unsigned i = 0; i < n || (int)i <= segAt; i++) {
+    if (i) s += ',';
+    ws(s);
+    if ((int)i == segAt) {
+      s += "\"seg\""; ws(s); s += ':'; ws(s);
+      switch (testRandom(8)) {
+        case 0:  genValue(s, 0); break; // scalar, ignored
+        case 1:  case 2: genSegment(s); break;
+        default: {
+          s += '[';
+          for (unsigned k = testRandom(5), j = 0; j < k; j++) {
+            if (j) s += ',';
+            ws(s);
+            if (testRandom(6)) genSegment(s); else genValue(s, 1); // also non-object elements
+          }
+          ws(s); s += ']';
+        }
+      }
+    } else {
+      std::string key = keys[testRandom(sizeof(keys)/sizeof(keys[0]))];
+      if (testRandom(3) || s.find("\"" + key + "\"") != std::string::npos) key += std::to_string(i); // else exact key, e.g. "psave" or "pin"
+      s += "\"" + key + "\"";
+      ws(s); s += ':';
+      genValue(s, 3);
+    }
+  }
+  ws(s);
+  s += '}';
+  return s;
+}
+
+static void equivalence() {
+  unsigned docs = 0, withSeg = 0, withSave = 0;
+  for (unsigned iter = 0; iter < 20000; iter++) {
+    std::string in = genState();
+    if (in.find("\"pin\"") != std::string::npos && in.find("\"pin\":\"") == std::string::npos) continue; // pin is a string
+
+    bool vDom = false, vStream = false;
+    rec.clear();
+    const bool okDom = domState(in, vDom);
+    Calls dom = rec;
+    rec.clear();
+    const bool okStream = streamState(in, iter & 1 ? 64 : 3, vStream);
+    CHECK(!jsonLocked && strip.suspended == 0);
+    CHECK(okDom);
+    if (!okDom) { fprintf(stderr, "invalid document: %s\n", in.c_str()); continue; }
+    CHECK(okStream);
+    if (!okStream) { fprintf(stderr, "not applied: %s\n", in.c_str()); continue; }
+    docs++;
+
+    // DOM passes scalar "seg" on (saved with presets), the stream drops it
+    const bool segIsDoc = dom.tail.count("seg") && (dom.tail["seg"][0] == '{' || dom.tail["seg"][0] == '[');
+    const bool save = dom.tail.count("psave") && dom.tail["psave"] != "null";
+    if (!segIsDoc) dom.tail.erase("seg");
+    else withSeg++;
+    if (!save || !segIsDoc) { dom.tail.erase("seg"); rec.tail.erase("seg"); }
+    else withSave++;
+
+    const bool same = rec.head == dom.head && rec.tail == dom.tail && rec.segs == dom.segs && rec.pin == dom.pin;
+    CHECK(same);
+    CHECK_EQ(vStream, vDom);
+    CHECK(rec.heads >= 1 && rec.heads <= 2 && rec.tails == 1 && rec.order == 0);
+    if (!same) {
+      fprintf(stderr, "differs: %s\n", in.c_str());
+      if (testFailures > 20) break;
+    }
+  }
+  printf("%u documents equivalent (%u with segments, %u saving presets with segments)\n", docs, withSeg, withSave);
+  CHECK(docs > 15000 && withSeg > 5000 && withSave > 100);
+}
+
+// mutated documents: anything may happen except crashes, a held lock or a stream that stays busy
+static void mutations() {
+  unsigned applied = 0;
+  for (unsigned iter = 0; iter < 20000; iter++) {
+    std::string in = genState();
+    for (unsigned m = 1 + testRandom(3); m; m--) {
+      const size_t p = testRandom(in.size());
+      switch (testRandom(3)) {
+        case 0: in.erase(p, 1 + testRandom(4)); break;
+        case 1: in.insert(p, 1, "{}[],:\"\\a1 "[testRandom(12)]); break;
+        default: in[p] = (char)testRandom(256); break;
+      }
+    }
+    bool verbose;
+    rec.clear();
+    applied += streamState(in, 16, verbose);
+    CHECK(!jsonLocked && strip.suspended == 0);
+    CHECK(stream.begin(&applied)); // previous owner released
+    stream.end(&applied, verbose);
+  }
+  printf("%u of 20000 mutated documents applied\n", applied);
+}
+
+static void limits() {
+  bool verbose;
+  std::string big = "{\"on\":true,\"x\":\"" + std::string(JSON_STREAM_REST_SIZE, 'a') + "\"}";
+  CHECK(!streamState(big, 100, verbose)); // members other than "seg" are bounded
+
+  // mismatched bracket after a scalar element used to recurse between SegArr and SegElem forever
+  CHECK(!streamState("{\"seg\":[1}", 100, verbose));
+  CHECK(!streamState("{\"seg\":[{\"id\":0},2}}", 100, verbose));
+
+  // segments are applied one at a time, the whole "seg" array may exceed the JSON buffer
+  std::string segs = "{\"bri\":10,\"seg\":[";
+  for (unsigned i = 0; i < 200; i++) segs += std::string(i ? "," : "") + "{\"id\":" + std::to_string(i) + ",\"n\":\"" + std::string(200, 'n') + "\"}";
+  segs += "],\"v\":true}";
+  CHECK(segs.size() > JSON_BUFFER_SIZE);
+  rec.clear();
+  CHECK(streamState(segs, 1460, verbose));
+  CHECK(verbose);
+  CHECK_EQ(rec.segs.size(), 200);
+  CHECK(rec.head["bri"] == "10");
+
+  // single segment object larger than JSON_STREAM_UNIT_SIZE
+  std::string unit = "{\"seg\":{\"n\":\"" + std::string(JSON_STREAM_UNIT_SIZE, 'n') + "\"}}";
+  CHECK(!streamState(unit, 1460, verbose));
+
+  // saving a preset needs the raw "seg" text, bounded by JSON_STREAM_SEG_KEEP
+  std::string save = segs;
+  save.insert(1, "\"psave\":3,");
+  for (unsigned i = 0; save.size() < JSON_STREAM_SEG_KEEP + 100; i++) save.insert(save.find("],\"v\""), ",{\"id\":" + std::to_string(i) + ",\"n\":\"" + std::string(200, 'n') + "\"}");
+  rec.clear();
+  CHECK(!streamState(save, 1460, verbose));
+  CHECK(rec.tails == 0); // preset not saved without its segments
+  std::string small = "{\"psave\":3,\"seg\":[{\"id\":0,\"fx\":1},{\"id\":1,\"stop\":0}],\"n\":\"x\"}";
+  rec.clear();
+  CHECK(streamState(small, 4, verbose));
+  CHECK(rec.tail["seg"] == "[{\"id\":0,\"fx\":1},{\"id\":1,\"stop\":0}]");
+  CHECK(rec.segs.back() == "purge 1");
+
+  // the JSON buffer lock is held by someone else (e.g. a preset is being applied)
+  lockBusy = true;
+  rec.clear();
+  CHECK(!streamState(small, 4, verbose));
+  CHECK(rec.segs.empty() && rec.tails == 0);
+  lockBusy = false;
+
+  // "pin" is only honoured if the transport accepts it
+  rec.clear();
+  CHECK(stream.begin(&rec, CALL_MODE_DIRECT_CHANGE, false));
+  stream.write(&rec, (const uint8_t*)"{\"pin\":\"1234\"}", 14);
+  CHECK(stream.end(&rec, verbose));
+  CHECK(rec.pin.empty());
+
+  // second owner is refused while the first one is active, unless it stalls
+  int a, b;
+  CHECK(stream.begin(&a));
+  CHECK(!stream.begin(&b));
+  CHECK(!stream.write(&b, (const uint8_t*)"{}", 2));
+  CHECK(!stream.end(&b, verbose));
+  now += 1001;
+  CHECK(stream.begin(&b));
+  CHECK(!stream.write(&a, (const uint8_t*)"{}", 2));
+  CHECK(stream.write(&b, (const uint8_t*)"{}", 2));
+  CHECK(stream.end(&b, verbose));
+}
+
+int main() {
+  equivalence();
+  mutations();
+  limits();
+  return testResult("jsonstream");
+}
@@ -0,0 +1,238 @@
+/*
+ * Game of Life engine (FX_life.cpp): bitboard generations against a cell by cell evaluation of the rules
+ * Every rule of mode_2Dgameoflife() is run for many generations on random worlds whose width is below, at and above
+ * multiples of 32 (wrap-around across word boundaries), alive/dying planes and the color of newborn cells have to
+ * match. Mutations may only suppress a birth or spawn a cell with two neighbours. A generation of the former
+ * implementation (one color per cell, read back from the segment) is timed against the bitboard step on 32x32 to 128x128.
+ */
+#include "native_test.h"
+
+static uint8_t hw_random8() { return testRandom(); }
+static uint8_t hw_random8(uint32_t n) { return (uint8_t(testRandom()) * n) >> 8; }
+
+// as in FX.h
+typedef struct LifeState {
+  uint32_t bgColor;
+  uint16_t crc[2];
+  uint16_t birth;
+  uint16_t survive;
+  uint8_t  states;
+  uint8_t  rule;
+  uint8_t  gen;
+  uint8_t  crcIdx;
+} lifeState;
+
+#include "../../wled00/FX_life.cpp"
+
+// rules of mode_2Dgameoflife()
+static const char *const rules[] = { "B3/S23", "B36/S23", "B2/S", "B3678/S34678", "B3/S12345", "B2/S/C3" };
+
+struct World {
+  int cols, rows, wpr;
+  std::vector<uint32_t> alive, dying;
+  std::vector<uint8_t>  color;
+  World(int c, int r) : cols(c), rows(r), wpr((c + 31) >> 5), alive(wpr * r), dying(wpr * r), color(c * r) {}
+  bool get(const std::vector<uint32_t> &p, int x, int y) const { return (p[y * wpr + (x >> 5)] >> (x & 31)) & 1; }
+  void set(std::vector<uint32_t> &p, int x, int y, bool v) {
+    uint32_t &w = p[y * wpr + (x >> 5)];
+    w = v ? w | (1U << (x & 31)) : w & ~(1U << (x & 31));
+  }
+  int neighbours(int x, int y) const {
+    int n = 0;
+    for (int j = -1; j <= 1; j++) for (int i = -1; i <= 1; i++) if (i || j) n += get(alive, (x + i + cols) % cols, (y + j + rows) % rows);
+    return n;
+  }
+  void randomize(unsigned density) {
+    for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) set(alive, x, y, testRandom(100) < density);
+    std::fill(dying.begin(), dying.end(), 0);
+    for (auto &c : color) c = testRandom(6) * 40; // few colors, dominant color has to be decided often
+  }
+};
+
+// one generation evaluated cell by cell
+static void referenceGeneration(const lifeState &s, const World &cur, World &next) {
+  next.color = cur.color;
+  for (int y = 0; y < cur.rows; y++) for (int x = 0; x < cur.cols; x++) {
+    const int n = cur.neighbours(x, y);
+    const bool alive = cur.get(cur.alive, x, y), dying = cur.get(cur.dying, x, y);
+    bool nAlive = false, nDying = false;
+    if (alive) {
+      nAlive = s.survive >> n & 1;
+      nDying = !nAlive && s.states > 2;
+    } else if (!dying && (s.birth >> n & 1)) {
+      nAlive = true;
+      // dominant color of the live neighbours, of equally frequent colors the one seen first (row by row) wins
+      int count[256] = {0}, order[8], found = 0;
+      for (int j = -1; j <= 1; j++) for (int i = -1; i <= 1; i++) {
+        const int xx = (x + i + cur.cols) % cur.cols, yy = (y + j + cur.rows) % cur.rows;
+        if ((i || j) && cur.get(cur.alive, xx, yy)) {
+          const uint8_t c = cur.color[yy * cur.cols + xx];
+          if (!count[c]++) order[found++] = c;
+        }
+      }
+      int best = -1;
+      for (int k = 0; k < found; k++) if (best < 0 || count[order[k]] > count[best]) best = order[k];
+      if (best >= 0) next.color[y * cur.cols + x] = best;
+    }
+    next.set(next.alive, x, y, nAlive);
+    next.set(next.dying, x, y, nDying);
+  }
+}
+
+static void step(const lifeState &s, const World &cur, World &next, bool mutate) {
+  next.color = cur.color;
+  lifeGeneration(&s, cur.alive.data(), cur.dying.data(), next.alive.data(), next.dying.data(), next.color.data(), cur.cols, cur.rows, mutate);
+}
+
+// former mode_2Dgameoflife() generation: colors are read back from the segment and compared with the background color
+typedef struct ColorCount {
+  uint32_t color;
+  int8_t count;
+} colorCount;
+
+static uint32_t paletteColor(uint8_t i) { return 0x010101U * i | 0x800000U; }
+
+static void formerGeneration(std::vector<uint32_t> &leds, std::vector<uint32_t> &prevLeds, int cols, int rows, uint32_t backgroundColor) {
+  const auto XY = [&](int x, int y) { return (x%cols) + (y%rows) * cols; };
+  for (int x = 0; x < cols; x++) for (int y = 0; y < rows; y++) prevLeds[XY(x,y)] = leds[XY(x,y)]; // getPixelColorXY()
+
+  for (int x = 0; x < cols; x++) for (int y = 0; y < rows; y++) {
+    colorCount colorsCount[9];
+    for (int i=0; i<9; i++) colorsCount[i] = {backgroundColor, 0};
+    int neighbors = 0;
+    for (int i = -1; i <= 1; i++) for (int j = -1; j <= 1; j++) {
+      if (i==0 && j==0) continue;
+      int xx = x+i, yy = y+j;
+      if (x+i < 0) xx = cols-1; else if (x+i >= cols) xx = 0;
+      if (y+j < 0) yy = rows-1; else if (y+j >= rows) yy = 0;
+      unsigned xy = XY(xx, yy);
+      if (prevLeds[xy] != backgroundColor) {
+        neighbors++;
+        bool colorFound = false;
+        int k;
+        for (k=0; k<9 && colorsCount[k].count != 0; k++)
+          if (colorsCount[k].color == prevLeds[xy]) {
+            colorsCount[k].count++;
+            colorFound = true;
+          }
+        if (!colorFound) colorsCount[k] = {prevLeds[xy], 1};
+      }
+    }
+    uint32_t col = prevLeds[XY(x,y)];
+    if      ((col != backgroundColor) && (neighbors <  2)) leds[XY(x,y)] = backgroundColor;
+    else if ((col != backgroundColor) && (neighbors >  3)) leds[XY(x,y)] = backgroundColor;
+    else if ((col == backgroundColor) && (neighbors == 3)) {
+      colorCount dominantColorCount = {backgroundColor, 0};
+      for (int i=0; i<9 && colorsCount[i].count != 0; i++)
+        if (colorsCount[i].count > dominantColorCount.count) dominantColorCount = colorsCount[i];
+      if (dominantColorCount.count > 0 && hw_random8(128)) leds[XY(x,y)] = dominantColorCount.color;
+    } else if ((col == backgroundColor) && (neighbors == 2) && !hw_random8(128)) {
+      leds[XY(x,y)] = paletteColor(hw_random8());
+    }
+  }
+}
+
+int main() {
+  // rule strings
+  lifeState s;
+  parseLifeRule("B3/S23", &s);
+  CHECK_EQ(s.birth, 1 << 3); CHECK_EQ(s.survive, (1 << 2) | (1 << 3)); CHECK_EQ(s.states, 2);
+  parseLifeRule("B2/S/C3", &s);
+  CHECK_EQ(s.birth, 1 << 2); CHECK_EQ(s.survive, 0); CHECK_EQ(s.states, 3);
+  parseLifeRule("b3678/s34678/c9", &s);
+  CHECK_EQ(s.birth, 0x1C8); CHECK_EQ(s.survive, 0x1D8); CHECK_EQ(s.states, 3);
+
+  // bitboard generations against the cell by cell rules
+  static const int sizes[][2] = { {1, 1}, {3, 2}, {8, 8}, {31, 7}, {32, 32}, {33, 17}, {64, 48}, {100, 37} };
+  unsigned generations = 0, mismatches = 0, births = 0;
+  for (const char *rule : rules) {
+    parseLifeRule(rule, &s);
+    for (const auto &sz : sizes) {
+      for (unsigned density : {15U, 35U, 60U}) {
+        World a(sz[0], sz[1]), b(sz[0], sz[1]), ref(sz[0], sz[1]);
+        a.randomize(density);
+        for (unsigned g = 0; g < 40; g++, generations++) {
+          referenceGeneration(s, a, ref);
+          step(s, a, b, false);
+          for (int y = 0; y < a.rows; y++) for (int x = 0; x < a.cols; x++) births += !a.get(a.alive, x, y) && b.get(b.alive, x, y);
+          if (b.alive != ref.alive || b.dying != ref.dying || b.color != ref.color) {
+            if (!mismatches++) fprintf(stderr, "mismatch: %s %dx%d generation %u\n", rule, a.cols, a.rows, g);
+            break;
+          }
+          std::swap(a, b);
+        }
+      }
+    }
+  }
+  CHECK_EQ(mismatches, 0);
+  CHECK(births > 100000);
+  printf("%u generations of %zu rules, %u births, %u differ\n", generations, sizeof(rules) / sizeof(rules[0]), births, mismatches);
+
+  // mutation: a birth may be suppressed and a dead cell with two neighbours may be spawned, at most one of each per word
+  {
+    parseLifeRule("B3/S23", &s);
+    World a(45, 30), b(45, 30), ref(45, 30);
+    a.randomize(35);
+    unsigned suppressed = 0, spawned = 0, invalid = 0;
+    for (unsigned g = 0; g < 500; g++) {
+      if (g % 100 == 0) a.randomize(35);
+      referenceGeneration(s, a, ref);
+      step(s, a, b, true);
+      for (int y = 0; y < a.rows; y++) for (int w = 0; w < a.wpr; w++) {
+        unsigned sup = 0, spa = 0;
+        for (int x = w * 32; x < min(a.cols, w * 32 + 32); x++) {
+          const bool r = ref.get(ref.alive, x, y), m = b.get(b.alive, x, y);
+          if (r && !m) { sup++; if (a.get(a.alive, x, y)) invalid++; }        // only a birth may be suppressed
+          if (!r && m) { spa++; if (a.get(a.alive, x, y) || a.neighbours(x, y) != 2) invalid++; }
+        }
+        if (sup > 1 || spa > 1) invalid++;
+        suppressed += sup; spawned += spa;
+        if (w == a.wpr - 1 && b.alive[y * a.wpr + w] >> (a.cols & 31)) invalid++; // no cells past the last column
+      }
+      std::swap(a, b);
+    }
+    CHECK_EQ(invalid, 0);
+    CHECK(suppressed > 0);
+    CHECK(spawned > 0);
+    printf("mutation: %u births suppressed, %u cells spawned in 500 generations\n", suppressed, spawned);
+  }
+
+  // time per generation: former per cell implementation against the bitboard step (B3/S23)
+  parseLifeRule("B3/S23", &s);
+  static const int bench[][2] = { {32, 32}, {64, 64}, {128, 128} };
+  for (const auto &sz : bench) {
+    const int cols = sz[0], rows = sz[1];
+    const unsigned n = 64 * 128 * 128 / (cols * rows) * 4;
+    std::vector<uint32_t> leds(cols * rows), prev(cols * rows);
+    World a(cols, rows), b(cols, rows);
+    unsigned sum = 0;
+    double t0 = benchSeconds();
+    for (unsigned i = 0; i < n; i++) {
+      if (i % 64 == 0) for (auto &c : leds) c = testRandom(2) ? paletteColor(testRandom()) : 0;
+      formerGeneration(leds, prev, cols, rows, 0);
+      sum += leds[i % leds.size()];
+    }
+    double t1 = benchSeconds();
+    for (unsigned i = 0; i < n; i++) {
+      if (i % 64 == 0) a.randomize(50);
+      step(s, a, b, true);
+      // repaint of changed cells as in mode_2Dgameoflife()
+      for (int y = 0; y < rows; y++) for (int w = 0; w < a.wpr; w++) {
+        const unsigned idx = y * a.wpr + w;
+        for (uint32_t d = a.alive[idx] ^ b.alive[idx]; d; d &= d - 1) {
+          const int x = (w << 5) + __builtin_ctz(d);
+          leds[y * cols + x] = (b.alive[idx] >> (x & 31) & 1) ? paletteColor(b.color[y * cols + x]) : 0;
+        }
+      }
+      std::swap(a, b);
+      sum += leds[i % leds.size()];
+    }
+    double t2 = benchSeconds();
+    const size_t formerData = 3 * cols * rows + 2 * sizeof(uint16_t);
+    const size_t data = sizeof(lifeState) + 4 * a.wpr * rows * sizeof(uint32_t) + cols * rows;
+    printf("%dx%d: former %.1f us, bitboard %.1f us per generation, segment data %zu -> %zu bytes (%u)\n",
+           cols, rows, (t1 - t0) * 1e6 / n, (t2 - t1) * 1e6 / n, formerData, data, sum & 1);
+  }
+
+  return testResult("life");
+}
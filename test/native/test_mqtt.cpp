@@ -0,0 +1,340 @@
+/*
+ * MQTT state publishing against a broker stand-in
+ * The AsyncMqttClient stand-in accepts publishes into a bounded TCP send buffer that drains at a configurable rate
+ * (0 = stalled link) and records what reaches the broker, retained messages included. Synthetic slider sweeps from the
+ * UI call publishMqtt() on every step while handleMqtt() runs every loop; messages per second are compared with the
+ * former behaviour (/g, /c and /v on every change). Also covers (re)connect, the JSON state topic, drops on a full
+ * send buffer and incoming messages.
+ */
+#include "native_test.h"
+#include <functional>
+#include <new>
+#include <map>
+#include <Print.h>
+
+typedef uint8_t byte;
+#define CALL_MODE_DIRECT_CHANGE 1
+#define MQTT_MAX_TOPIC_LEN  32
+#define MQTT_MAX_SERVER_LEN 32
+
+static unsigned long now = 10000;
+static unsigned long millis() { return now; }
+
+// broker stand-in behind AsyncMqttClient's API
+struct AsyncMqttClientMessageProperties { uint8_t qos; bool dup; bool retain; };
+namespace AsyncMqttClientInternals {
+  typedef std::function<void(bool sessionPresent)> OnConnectUserCallback;
+  typedef std::function<void(char*, char*, AsyncMqttClientMessageProperties, size_t, size_t, size_t)> OnMessageUserCallback;
+}
+struct Message { unsigned long time; std::string topic, payload; bool retain; };
+
+class AsyncMqttClient {
+  public:
+    // link: TCP send buffer of 'space' bytes, 'rate' bytes per ms reach the broker (0 = stalled)
+    size_t space = 5744, queued = 0, rate = 1000;
+    bool   up = true;
+    std::vector<Message> received;
+    std::map<std::string, std::string> retained;
+    std::vector<std::string> subscriptions;
+    std::string server, will, clientId;
+    uint16_t port = 0, keepAlive = 0;
+    unsigned refused = 0;
+    AsyncMqttClientInternals::OnConnectUserCallback onConnectCb;
+    AsyncMqttClientInternals::OnMessageUserCallback onMessageCb;
+
+    AsyncMqttClient& onConnect(AsyncMqttClientInternals::OnConnectUserCallback cb) { onConnectCb = cb; return *this; }
+    AsyncMqttClient& onMessage(AsyncMqttClientInternals::OnMessageUserCallback cb) { onMessageCb = cb; return *this; }
+    AsyncMqttClient& setServer(IPAddress ip, uint16_t p) { server = ip.toString().c_str(); port = p; return *this; }
+    AsyncMqttClient& setServer(const char *host, uint16_t p) { server = host; port = p; return *this; }
+    AsyncMqttClient& setClientId(const char *id) { clientId = id; return *this; }
+    AsyncMqttClient& setCredentials(const char *, const char *) { return *this; }
+    AsyncMqttClient& setWill(const char *topic, uint8_t, bool, const char *payload) { will = std::string(topic) + "=" + payload; return *this; }
+    AsyncMqttClient& setKeepAlive(uint16_t s) { keepAlive = s; return *this; }
+    bool connected() const { return _connected; }
+    void connect() { if (!up) return; _connected = true; queued = 0; if (onConnectCb) onConnectCb(false); }
+    void disconnect() { _connected = false; }
+    uint16_t subscribe(const char *topic, uint8_t) { subscriptions.push_back(topic); return ++_packetId; }
+    uint16_t publish(const char *topic, uint8_t qos, bool retain, const char *payload = nullptr, size_t length = 0, bool dup = false, uint16_t message_id = 0) {
+      if (!_connected) return 0;
+      if (payload && !length) length = strlen(payload);
+      const size_t needed = 5 + strlen(topic) + length; // fixed header, remaining length, topic length
+      if (queued + needed > space) { refused++; return 0; }
+      queued += needed;
+      received.push_back({now, topic, std::string(payload, length), retain});
+      if (retain) retained[topic] = received.back().payload;
+      return ++_packetId;
+    }
+    void tick() { queued -= min(queued, rate); }
+    // incoming message, optionally split into parts as AsyncMqttClient delivers large payloads
+    void deliver(const char *topic, const char *payload, size_t part = SIZE_MAX) {
+      const size_t total = strlen(payload);
+      std::string t(topic);
+      for (size_t index = 0; index < total || index == 0; index += part) {
+        const size_t len = min(part, total - index);
+        std::string chunk(payload + index, len);
+        onMessageCb(&t[0], &chunk[0], AsyncMqttClientMessageProperties{0, false, false}, len, index, total);
+        if (!total) break;
+      }
+    }
+  private:
+    bool     _connected = false;
+    uint16_t _packetId = 0;
+};
+
+// WLED globals and functions used by mqtt.cpp
+#define WLED_CONNECTED true
+#define WLED_MQTT_CONNECTED (mqtt != nullptr && mqtt->connected())
+static AsyncMqttClient *mqtt = nullptr;
+static bool mqttEnabled = true;
+static char mqttStatusTopic[MQTT_MAX_TOPIC_LEN + 8] = "";
+static char mqttDeviceTopic[MQTT_MAX_TOPIC_LEN + 1] = "wled/a1b2c3";
+static char mqttGroupTopic[MQTT_MAX_TOPIC_LEN + 1]  = "wled/all";
+static char mqttServer[MQTT_MAX_SERVER_LEN + 1]     = "192.168.1.2";
+static char mqttUser[41] = "";
+static char mqttPass[65] = "";
+static char mqttClientID[41] = "WLED-a1b2c3";
+static uint16_t mqttPort = 1883;
+static bool retainMqttMsg = false;
+static bool mqttJsonState = false;
+static uint16_t mqttMinInterval = 250;
+static uint16_t mqttMaxInterval = 0;
+
+static byte bri = 128, briLast = 128;
+static byte colPri[] = {255, 160, 0, 0};
+static byte currentPreset = 0;
+static int16_t currentPlaylist = -1;
+
+struct Segment { uint8_t mode = 0, speed = 128, intensity = 128, palette = 0; };
+static struct { Segment main; const Segment &getMainSegment() const { return main; } } strip;
+
+// DynamicBuffer of the AsyncWebServer fork
+class DynamicBuffer {
+  std::vector<char> _data;
+  public:
+  explicit DynamicBuffer(size_t size) : _data(size) {}
+  char *data() { return _data.data(); }
+  size_t size() const { return _data.size(); }
+};
+
+static unsigned stateUpdates = 0, usermodMessages = 0;
+static std::string lastApi;
+static void stateUpdated(byte) { stateUpdates++; }
+static void colorUpdated(byte) { stateUpdates++; }
+static void toggleOnOff() { if (bri) { briLast = bri; bri = 0; } else bri = briLast; }
+static void colorFromDecOrHexString(byte *rgb, const char *in) {
+  const uint32_t c = strtoul(in + (in[0] == '#'), nullptr, in[0] == '#' ? 16 : 10);
+  rgb[0] = c >> 16; rgb[1] = c >> 8; rgb[2] = c; rgb[3] = c >> 24;
+}
+static StaticJsonDocument<1024> doc;
+static JsonDocument *pDoc = &doc;
+static bool requestJSONBufferLock(uint8_t) { return true; }
+static void releaseJSONBufferLock() {}
+static bool deserializeState(JsonObject root, byte = CALL_MODE_DIRECT_CHANGE, byte = 0) {
+  lastApi.clear();
+  serializeJson(root, lastApi);
+  if (root["bri"].is<int>()) bri = root["bri"];
+  return true;
+}
+struct AsyncWebServerRequest;
+static bool handleSet(AsyncWebServerRequest *, const String& req, bool = true) { lastApi = req.c_str(); return true; }
+namespace UsermodManager {
+  static void onMqttConnect(bool) {}
+  static bool onMqttMessage(char *, char *) { usermodMessages++; return false; }
+}
+// XML API response as published on <device>/v
+static void XML_response(Print& dest) {
+  char buf[128];
+  snprintf(buf, sizeof(buf), "<?xml version=\"1.0\" ?><vs><ac>%u</ac><cl>%u</cl><cl>%u</cl><cl>%u</cl><fx>%u</fx><ds>WLED</ds></vs>",
+           bri, colPri[0], colPri[1], colPri[2], strip.main.mode);
+  dest.print(buf);
+}
+
+#include "../../wled00/mqtt.cpp"
+
+// runs the loop for 'ms' milliseconds, handleMqtt() every millisecond
+static void run(unsigned ms) {
+  for (unsigned i = 0; i < ms; i++) {
+    now++;
+    handleMqtt();
+    mqtt->tick();
+  }
+}
+
+static unsigned count(size_t from, const char *suffix) {
+  const std::string topic = std::string(mqttDeviceTopic) + suffix;
+  unsigned n = 0;
+  for (size_t i = from; i < mqtt->received.size(); i++) n += mqtt->received[i].topic == topic;
+  return n;
+}
+
+static const Message *last(const char *suffix) {
+  const std::string topic = std::string(mqttDeviceTopic) + suffix;
+  for (size_t i = mqtt->received.size(); i--; ) if (mqtt->received[i].topic == topic) return &mqtt->received[i];
+  return nullptr;
+}
+
+static JsonObject info() {
+  static StaticJsonDocument<256> d;
+  d.clear();
+  serializeMqttInfo(d.to<JsonObject>());
+  return d["mqtt"];
+}
+
+// slider sweep from the UI: 'hz' changes per second for 'seconds', brightness (and optionally color) follow the slider
+struct Sweep { unsigned changes, messages; double perSecond, formerPerSecond; };
+static Sweep sweep(unsigned seconds, unsigned hz, bool color) {
+  const size_t from = mqtt->received.size();
+  const unsigned step = 1000 / hz;
+  Sweep s{};
+  for (unsigned t = 0; t < seconds * 1000; t += step) {
+    bri = 1 + (t / step) % 255;
+    if (color) colPri[1] = (t / step * 7) % 256;
+    publishMqtt();
+    s.changes++;
+    run(step);
+  }
+  s.messages = mqtt->received.size() - from;
+  s.perSecond = double(s.messages) / seconds;
+  s.formerPerSecond = 3.0 * s.changes / seconds; // /g, /c and /v on every change
+  return s;
+}
+
+int main() {
+  // connect: client created, LWT set, topics subscribed, "online" and the complete state published
+  CHECK(initMqtt());
+  CHECK(mqtt != nullptr && mqtt->connected());
+  CHECK(mqtt->server == "192.168.1.2" && mqtt->port == 1883 && mqtt->clientId == "WLED-a1b2c3");
+  CHECK(mqtt->will == "wled/a1b2c3/status=offline");
+  CHECK_EQ(mqtt->subscriptions.size(), 6);
+  CHECK(mqtt->retained["wled/a1b2c3/status"] == "online");
+  run(1);
+  CHECK_EQ(count(0, "/g"), 1);
+  CHECK_EQ(count(0, "/c"), 1);
+  CHECK_EQ(count(0, "/v"), 1);
+  CHECK(last("/g")->payload == "128");
+  CHECK(last("/c")->payload == "#FFA000");
+  CHECK(last("/v")->payload.find("<ac>128</ac>") != std::string::npos);
+
+  // idle: nothing is published, unchanged state is not republished either
+  size_t mark = mqtt->received.size();
+  run(5000);
+  publishMqtt();
+  run(1000);
+  CHECK_EQ(mqtt->received.size(), mark);
+
+  // brightness slider at 50 Hz for 10 s
+  const Sweep briSweep = sweep(10, 50, false);
+  run(1000);
+  CHECK(briSweep.perSecond <= 2 * 1000.0 / mqttMinInterval + 1); // /g and /v per interval
+  CHECK(briSweep.formerPerSecond > 10 * briSweep.perSecond);
+  CHECK_EQ(count(mark, "/c"), 0);                                 // color did not change
+  CHECK(last("/g")->payload == std::to_string(bri));              // broker ends up with the final value
+  unsigned long prev = 0;
+  unsigned tooSoon = 0;
+  for (size_t i = mark; i < mqtt->received.size(); i++) {
+    if (mqtt->received[i].topic != "wled/a1b2c3/g") continue;
+    if (prev && mqtt->received[i].time - prev < mqttMinInterval) tooSoon++;
+    prev = mqtt->received[i].time;
+  }
+  CHECK_EQ(tooSoon, 0);
+  CHECK(info()["coal"].as<unsigned>() > briSweep.changes / 2);
+
+  // brightness and color at 100 Hz, retained
+  retainMqttMsg = true;
+  mark = mqtt->received.size();
+  const Sweep colSweep = sweep(10, 100, true);
+  run(1000);
+  CHECK(colSweep.perSecond <= 3 * 1000.0 / mqttMinInterval + 1);
+  CHECK(count(mark, "/c") > 0);
+  char hex[8];
+  snprintf(hex, sizeof(hex), "#%02X%02X%02X", colPri[0], colPri[1], colPri[2]);
+  CHECK(mqtt->retained["wled/a1b2c3/c"] == hex);
+  CHECK(mqtt->retained["wled/a1b2c3/g"] == std::to_string(bri));
+
+  // faster publishing interval trades messages for latency
+  mqttMinInterval = 100;
+  const Sweep fastSweep = sweep(5, 50, false);
+  run(1000);
+  CHECK(fastSweep.perSecond <= 2 * 1000.0 / mqttMinInterval + 1);
+  CHECK(fastSweep.perSecond > briSweep.perSecond);
+  mqttMinInterval = 250;
+
+  // compact JSON state topic, republished every mqttMaxInterval seconds without changes
+  mqttJsonState = true;
+  mqttMaxInterval = 2;
+  currentPreset = 3;
+  strip.main.mode = 9;
+  publishMqtt();
+  mark = mqtt->received.size();
+  run(7000);
+  const unsigned states = count(mark, "/state");
+  CHECK(states >= 3 && states <= 4);
+  CHECK_EQ(count(mark, "/g"), 0);
+  StaticJsonDocument<1024> state;
+  CHECK(deserializeJson(state, last("/state")->payload) == DeserializationError::Ok);
+  CHECK(state["on"] == true && state["bri"] == bri && state["ps"] == 3 && state["pl"] == -1 && state["fx"] == 9);
+  CHECK(state["col"] == hex);
+  mqttMaxInterval = 0;
+  mark = mqtt->received.size();
+  run(7000);
+  CHECK_EQ(count(mark, "/state"), 0);                              // only on change
+
+  // stalled link: publishes are refused and counted, at most one pending slot per topic, current values after recovery
+  const unsigned droppedBefore = info()["drop"];
+  mqtt->rate = 0;
+  mqtt->space = mqtt->queued + 20;                                   // room for a single /g message
+  mark = mqtt->received.size();
+  const Sweep stalled = sweep(5, 50, true);
+  const unsigned dropped = info()["drop"].as<unsigned>() - droppedBefore;
+  CHECK(dropped > 0);
+  CHECK(dropped <= 4u * (5000 / mqttMinInterval + 1));               // one attempt per topic and cycle, no backlog
+  CHECK(info()["q"].as<unsigned>() >= 1 && info()["q"].as<unsigned>() <= 4);
+  CHECK(stalled.messages <= 1);
+  mqtt->rate = 1000;
+  mqtt->space = 5744;
+  run(1000);
+  CHECK_EQ(info()["q"].as<unsigned>(), 0);
+  CHECK(last("/g")->payload == std::to_string(bri));
+  snprintf(hex, sizeof(hex), "#%02X%02X%02X", colPri[0], colPri[1], colPri[2]);
+  CHECK(last("/c")->payload == hex);
+
+  // reconnect: everything is published again although nothing changed
+  mqtt->disconnect();
+  mark = mqtt->received.size();
+  run(1000);
+  CHECK_EQ(mqtt->received.size(), mark);
+  CHECK(initMqtt());
+  run(1);
+  CHECK_EQ(count(mark, "/g"), 1);
+  CHECK_EQ(count(mark, "/c"), 1);
+  CHECK_EQ(count(mark, "/v"), 1);
+  CHECK_EQ(count(mark, "/state"), 1);
+  CHECK_EQ(count(mark, "/status"), 1);
+
+  // incoming messages: brightness, toggle, color, JSON API in parts, HTTP API, foreign topic
+  mqtt->deliver("wled/a1b2c3", "77");
+  CHECK_EQ(bri, 77);
+  mqtt->deliver("wled/all", "T");
+  CHECK_EQ(bri, 0);
+  mqtt->deliver("wled/all", "ON");
+  CHECK_EQ(bri, 77);
+  mqtt->deliver("wled/a1b2c3/col", "#102030");
+  CHECK(colPri[0] == 0x10 && colPri[1] == 0x20 && colPri[2] == 0x30);
+  mqtt->deliver("wled/a1b2c3/api", "{\"on\":true,\"bri\":200,\"seg\":[{\"fx\":12}]}", 7);
+  CHECK_EQ(bri, 200);
+  CHECK(lastApi == "{\"on\":true,\"bri\":200,\"seg\":[{\"fx\":12}]}");
+  mqtt->deliver("wled/all/api", "T=2&A=40");
+  CHECK(lastApi == "win&T=2&A=40");
+  mqtt->deliver("home/sensor/temp", "21.5");
+  CHECK_EQ(usermodMessages, 1);
+  mark = mqtt->received.size();
+  publishMqtt();
+  run(300);
+  CHECK(last("/g")->payload == "200");
+  CHECK(last("/c")->payload == "#102030");
+
+  printf("slider 50 Hz: %.1f msg/s (was %.0f), slider+color 100 Hz: %.1f msg/s (was %.0f), 100 ms interval: %.1f msg/s, "
+         "%u drops on a stalled link\n", briSweep.perSecond, briSweep.formerPerSecond, colSweep.perSecond, colSweep.formerPerSecond,
+         fastSweep.perSecond, dropped);
+  return testResult("mqtt");
+}
@@ -0,0 +1,122 @@
+/*
+ * Node directory (NodesTable) with hundreds of nodes on several subnets
+ * Nodes announce themselves at random, the list is refreshed (aged) in between. The table is checked against
+ * a plain map after every round: lookups, capacity bound, eviction of the oldest node, aging and slot enumeration.
+ */
+#include "native_test.h"
+#include <map>
+#include <set>
+
+#define WLED_MAX_NODES 150
+#define NODE_MAX_AGE   10
+#include "../../wled00/NodeStruct.h"
+
+static NodesTable Nodes;
+static std::map<uint32_t, uint8_t> model; // ip -> age
+
+// every node enumerated exactly once (as serializeNodes() does) and found again by its IP
+static void checkConsistent() {
+  std::set<uint32_t> seen;
+  for (size_t i = 0; i < NodesTable::capacity(); i++) {
+    const NodeStruct *n = Nodes.slot(i);
+    if (!n) continue;
+    CHECK(seen.insert(n->ip).second);
+    CHECK(Nodes.find(IPAddress(n->ip)) == n);
+    auto m = model.find(n->ip);
+    CHECK(m != model.end() && m->second == n->age);
+  }
+  CHECK_EQ(seen.size(), Nodes.size());
+  CHECK_EQ(model.size(), Nodes.size());
+  CHECK(Nodes.size() <= WLED_MAX_NODES);
+}
+
+// info packet from node: insert or refresh, the table replaces the node not heard from for the longest time when full
+static void announce(IPAddress ip) {
+  const bool known = model.count(uint32_t(ip));
+  uint8_t maxAge = 0;
+  for (auto &m : model) maxAge = max(maxAge, m.second);
+  NodeStruct *n = Nodes.insert(ip);
+  CHECK(n != nullptr);
+  if (!n) return;
+  if (!known) {
+    CHECK(n->nodeName[0] == 0 && n->build == 0); // new slot is zeroed
+    if (model.size() == WLED_MAX_NODES) {
+      // exactly one of the oldest nodes was dropped
+      unsigned dropped = 0;
+      for (auto it = model.begin(); it != model.end(); ) {
+        if (!Nodes.find(IPAddress(it->first))) { CHECK_EQ(it->second, maxAge); dropped++; it = model.erase(it); }
+        else ++it;
+      }
+      CHECK_EQ(dropped, 1);
+    }
+  }
+  n->age = 0;
+  snprintf(n->nodeName, sizeof(n->nodeName), "WLED-%s", ip.toString().c_str());
+  n->build = 2506160;
+  model[uint32_t(ip)] = 0;
+}
+
+static void refresh() {
+  Nodes.age(NODE_MAX_AGE + 1);
+  for (auto it = model.begin(); it != model.end(); ) {
+    if (it->second < 255) it->second++;
+    if (it->second >= NODE_MAX_AGE + 1) it = model.erase(it);
+    else ++it;
+  }
+}
+
+int main() {
+  CHECK(NodesTable::capacity() >= WLED_MAX_NODES * 4 / 3); // load factor <= 75%
+  CHECK(Nodes.find(IPAddress(10,0,0,1)) == nullptr);     // nothing allocated yet
+  CHECK(Nodes.insert(IPAddress(0,0,0,0)) == nullptr);    // 0 marks free slots
+
+  // same last octet on different subnets are different nodes (the old map was keyed by the last octet)
+  announce(IPAddress(192,168,1,20));
+  announce(IPAddress(192,168,2,20));
+  announce(IPAddress(10,0,0,20));
+  CHECK_EQ(Nodes.size(), 3);
+  CHECK(strcmp(Nodes.find(IPAddress(192,168,2,20))->nodeName, "WLED-192.168.2.20") == 0);
+  checkConsistent();
+
+  // 400 nodes on four subnets, each announces with its own probability (some rarely, some always)
+  std::vector<IPAddress> fleet;
+  std::vector<unsigned> chance;
+  for (unsigned net = 0; net < 4; net++)
+    for (unsigned host = 1; host <= 100; host++) {
+      fleet.push_back(IPAddress(10, 1, net, host));
+      chance.push_back(5 + testRandom(90));
+    }
+
+  unsigned peak = 0;
+  for (unsigned round = 0; round < 300; round++) {
+    for (size_t i = 0; i < fleet.size(); i++) if (testRandom(100) < chance[i]) announce(fleet[testRandom(fleet.size())]);
+    checkConsistent();
+    peak = max(peak, (unsigned)Nodes.size());
+    refresh();
+    checkConsistent();
+  }
+  CHECK_EQ(peak, WLED_MAX_NODES);
+
+  // silent fleet is forgotten after NODE_MAX_AGE refreshes
+  for (unsigned round = 1; round < NODE_MAX_AGE; round++) refresh(); // last round already refreshed once
+  CHECK(Nodes.size() > 0);
+  refresh();
+  CHECK_EQ(Nodes.size(), 0);
+  checkConsistent();
+
+  // lookup cost with a full table
+  for (unsigned i = 0; i < WLED_MAX_NODES; i++) announce(fleet[i]);
+  const unsigned lookups = 2000000;
+  unsigned hits = 0;
+  const double t0 = benchSeconds();
+  for (unsigned i = 0; i < lookups; i++) hits += Nodes.find(fleet[i % fleet.size()]) != nullptr;
+  const double dt = benchSeconds() - t0;
+  CHECK_EQ(hits, lookups / fleet.size() * WLED_MAX_NODES + min<unsigned>(lookups % fleet.size(), WLED_MAX_NODES));
+
+  Nodes.clear();
+  CHECK_EQ(Nodes.size(), 0);
+  CHECK(Nodes.slot(0) == nullptr);
+
+  printf("capacity %zu, %.1f ns per lookup with %u nodes\n", NodesTable::capacity(), dt * 1e9 / lookups, WLED_MAX_NODES);
+  return testResult("nodes");
+}
@@ -0,0 +1,225 @@
+/*
+ * Adaptive frame pacing (FX_pacing.cpp): show interval of a simulated strip under changing effect and output cost
+ * The stand-in WS2812FX runs service() as in FX_fcn.cpp: render cost advances the clock, show() waits for an async
+ * transfer still on the wire and blocks for synchronous outputs. Phases: light effects (limited by the target FPS),
+ * heavy effects, a long async output, a slow synchronous output and light effects again. The show interval has to
+ * follow what the load sustains without oscillating, never drop below the configured frame time, come back to it
+ * after PACING_HOLD and report the right limit; missed deadlines and the time left to the rest of the loop are
+ * compared with the fixed frame time.
+ */
+#include "native_test.h"
+#include <climits>
+
+using std::min;
+using std::max;
+
+// clock in microseconds, rendering and outputs advance it
+static uint64_t nowUs = 0;
+static unsigned long millis() { return nowUs / 1000; }
+static unsigned long micros() { return nowUs; }
+
+// as in FX.h (ESP32)
+#define MIN_FRAME_DELAY    2
+#define FPS_UNLIMITED      0
+#define WLED_PACING_LOAD   75
+#define PACING_HOLD        2000
+#define PACE_TARGET        0
+#define PACE_EFFECTS       1
+#define PACE_OUTPUT        2
+
+// output cost of the current phase: wire time of the async bus, transmit time of the synchronous one
+static struct { unsigned asyncUs = 0, syncUs = 0; uint64_t wireFree = 0; } output;
+
+namespace BusManager {
+  void getPacingTimes(unsigned &asyncUs, unsigned &syncUs) { asyncUs = output.asyncUs; syncUs = output.syncUs; }
+}
+
+class WS2812FX {
+  public:
+    unsigned long timeToNextFrame() const;
+    void setTargetFps(unsigned fps);
+    void setAdaptiveFps(bool enable);
+    void service();
+
+    uint16_t getShowTime() const  { return _showtime; }
+    uint16_t getFrameTime() const { return _frametime; }
+    uint8_t getPaceLimit() const  { return _paceLimit; }
+    uint32_t getRenderTime() const { return _renderUs; }
+    uint8_t getSlowestSegment() const { return _slowestSeg; }
+    uint16_t getSlowestSegmentTime() const { return _slowestSegUs; }
+
+    uint32_t effectUs = 4000, effectJitterUs = 0; // render cost of a frame, the slowest segment takes half of it
+    uint32_t _missedDeadlines = 0;
+    uint64_t busyUs = 0;                          // time spent in service()
+    std::vector<uint32_t> intervals;              // between shown frames, us
+    uint64_t lastShowUs = 0;
+
+  private:
+    bool _suspend = false, _triggered = false, _adaptiveFps = false;
+    uint16_t _frametime = 0, _showtime = 0;
+    uint8_t  _targetFps = 42;
+    uint8_t  _paceLimit = PACE_TARGET, _slowestSeg = 0;
+    uint16_t _slowestSegUs = 0;
+    uint32_t _renderUs = 0, _busShowUs = 0;
+    unsigned long _paceLowSince = 0, _lastServiceShow = 0;
+
+    bool isFrameRateLimited() const { return _targetFps != FPS_UNLIMITED || _adaptiveFps; }
+    void updatePacing(uint32_t renderUs, uint32_t segUs, uint8_t segId);
+};
+
+#include "../../wled00/FX_pacing.cpp"
+
+// as in WS2812FX::service() and show()
+void WS2812FX::service() {
+  unsigned long nowUp = millis();
+  unsigned long elapsed = nowUp - _lastServiceShow;
+  if (_suspend || elapsed <= MIN_FRAME_DELAY) return;
+  if (!_triggered && isFrameRateLimited()) {
+    if (elapsed < _showtime) return;
+  }
+  const uint64_t frameStart = micros();
+  if (isFrameRateLimited() && _lastServiceShow && elapsed > _showtime + _showtime/2) _missedDeadlines++;
+  const uint32_t renderUs = effectUs + (effectJitterUs ? testRandom(2 * effectJitterUs) - effectJitterUs : 0);
+  nowUs += renderUs;
+  _lastServiceShow = nowUp;
+  if (lastShowUs) intervals.push_back(nowUs - lastShowUs);
+  lastShowUs = nowUs;
+  const uint64_t busShowStart = micros();
+  if (output.wireFree > nowUs) nowUs = output.wireFree;  // previous frame still on the wire
+  output.wireFree = nowUs + output.asyncUs;
+  nowUs += output.syncUs;
+  _busShowUs = micros() - busShowStart;
+  updatePacing(micros() - frameStart - _busShowUs, renderUs / 2, 3);
+  busyUs += micros() - frameStart;
+  _triggered = false;
+}
+
+static WS2812FX strip;
+
+static uint32_t percentile(std::vector<uint32_t> v, unsigned pct) {
+  if (v.empty()) return 0;
+  std::sort(v.begin(), v.end());
+  return v[(v.size() - 1) * pct / 100];
+}
+
+struct Phase {
+  const char *name;
+  uint32_t effectUs, jitterUs, asyncUs, syncUs;
+  uint8_t limit;
+};
+
+// show interval the phase needs: load leaves the rest of the loop its share, async outputs finish their frame
+static unsigned needMs(const Phase &p) {
+  const unsigned cpuUs = (p.effectUs + p.syncUs) * 100 / WLED_PACING_LOAD;
+  return (max(cpuUs, p.asyncUs) + 999) / 1000;
+}
+
+struct PhaseStats {
+  unsigned changes = 0, reversals = 0, missed = 0, frames = 0;
+  unsigned changesAfter = 0;                      // show interval changes once it fits the load
+  uint16_t minShow = 0xFFFF, maxShow = 0, endShow = 0;
+  uint8_t endLimit = 0;
+  uint32_t reachedMs = UINT32_MAX;                // time the show interval first fits the load (with headroom)
+  uint32_t p50 = 0, spread = 0;                   // show interval median and p99 - p1
+  unsigned freePct = 0;                           // time left to the rest of the loop
+};
+
+// WLED::loop() passes for one phase: service() and 300 us of other handlers and network
+static PhaseStats runPhase(const Phase &p, unsigned seconds) {
+  strip.effectUs = p.effectUs;
+  strip.effectJitterUs = p.jitterUs;
+  output.asyncUs = p.asyncUs;
+  output.syncUs = p.syncUs;
+  strip.intervals.clear();
+  strip.busyUs = 0;
+  const uint32_t missed = strip._missedDeadlines;
+  PhaseStats s;
+  uint16_t show = strip.getShowTime();
+  int dir = 0;
+  const unsigned want = p.limit == PACE_TARGET ? strip.getFrameTime() : needMs(p) + needMs(p) / 8;
+  const uint64_t start = nowUs, end = nowUs + seconds * 1000000ULL;
+  while (nowUs < end) {
+    strip.service();
+    nowUs += 300;
+    if (strip.getShowTime() != show) {
+      const int d = strip.getShowTime() > show ? 1 : -1;
+      if (dir && d != dir) s.reversals++;
+      dir = d;
+      show = strip.getShowTime();
+      s.changes++;
+      s.changesAfter += s.reachedMs != UINT32_MAX;
+    }
+    if (s.reachedMs == UINT32_MAX && (p.limit == PACE_TARGET ? show == want : show >= want)) s.reachedMs = (nowUs - start) / 1000;
+    s.minShow = min(s.minShow, show);
+    s.maxShow = max(s.maxShow, show);
+  }
+  s.endShow = show;
+  s.endLimit = strip.getPaceLimit();
+  s.missed = strip._missedDeadlines - missed;
+  s.frames = strip.intervals.size();
+  s.p50 = percentile(strip.intervals, 50);
+  s.spread = percentile(strip.intervals, 99) - percentile(strip.intervals, 1);
+  s.freePct = 100 - strip.busyUs * 100 / (end - start);
+  return s;
+}
+
+int main() {
+  nowUs = 1000000;
+  //                         effect  jitter  async   sync   limit
+  static const Phase phases[] = {
+    { "light effects",       4000,   1000,   9000,   0,     PACE_TARGET  }, // 300 LEDs on RMT
+    { "heavy effects",       30000,  3000,   9000,   0,     PACE_EFFECTS },
+    { "long async output",   4000,   1000,   60000,  0,     PACE_OUTPUT  }, // 2000 LEDs on one RMT channel
+    { "slow sync output",    4000,   1000,   0,      20000, PACE_OUTPUT  }, // bit-banged output
+    { "light effects again", 4000,   1000,   9000,   0,     PACE_TARGET  },
+  };
+  const unsigned seconds = 30;
+  const size_t count = sizeof(phases) / sizeof(phases[0]);
+  PhaseStats adaptive[count], fixed[count];
+
+  strip.setTargetFps(42);
+  strip.setAdaptiveFps(false);
+  for (size_t i = 0; i < count; i++) fixed[i] = runPhase(phases[i], seconds);
+  strip.setAdaptiveFps(true);
+  for (size_t i = 0; i < count; i++) adaptive[i] = runPhase(phases[i], seconds);
+  const uint16_t frameMs = strip.getFrameTime();
+
+  for (size_t i = 0; i < count; i++) {
+    const Phase &p = phases[i];
+    const PhaseStats &a = adaptive[i], &f = fixed[i];
+    printf("%-20s fixed: %4u frames, interval p50 %5u us, spread %5u us, %3u missed, %2u%% free | "
+           "adaptive: show %2u ms (%2u-%2u, %2u changes, %u reversals, fits at %5u ms), limit %u, %4u frames, interval p50 %5u us, spread %5u us, %3u missed, %2u%% free\n",
+           p.name, f.frames, f.p50, f.spread, f.missed, f.freePct,
+           a.endShow, a.minShow, a.maxShow, a.changes, a.reversals, a.reachedMs, a.endLimit, a.frames, a.p50, a.spread, a.missed, a.freePct);
+
+    // the limit is reported with and without adaptive pacing
+    CHECK_EQ(a.endLimit, p.limit);
+    CHECK_EQ(f.endLimit, p.limit);
+    // never faster than configured
+    CHECK(a.minShow >= frameMs);
+    // follows the sustainable rate with headroom of 1/8 (plus the dead band when coming down)
+    const unsigned need = needMs(p);
+    if (p.limit == PACE_TARGET) CHECK_EQ(a.endShow, frameMs);
+    else {
+      CHECK(a.endShow >= need);
+      CHECK(a.endShow <= need + need / 8 + 1 + need / 16);
+      CHECK(a.freePct + 1 >= 100 - WLED_PACING_LOAD);
+      CHECK(a.freePct > f.freePct);
+    }
+    // stable cadence: rises follow the averaged cost within a few hundred frames, the way down takes halving steps
+    // after PACING_HOLD each, no back and forth under jitter
+    CHECK_EQ(a.reversals, 0);
+    CHECK(a.reachedMs <= (a.endShow >= a.maxShow ? 2000U : 6 * (PACING_HOLD + 100U)));
+    CHECK(a.missed <= 1);
+    CHECK(a.missed <= f.missed);
+  }
+  // heavy effects with jitter: once the average has caught up, at most one more rise to the upper end of the jitter
+  CHECK(adaptive[1].changesAfter <= 2);
+
+  // averaged effect time of the slowest segment
+  CHECK_EQ(strip.getSlowestSegment(), 3);
+  CHECK_NEAR(strip.getSlowestSegmentTime(), 2000, 300);
+  CHECK_NEAR(strip.getRenderTime(), 4000, 600);
+
+  return testResult("pacing");
+}
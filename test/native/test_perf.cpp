@@ -0,0 +1,228 @@
+/*
+ * Frame/loop timing statistics (perf.cpp): histogram buckets, percentiles, decay and the /json/perf object, and the
+ * cost of tracing a frame
+ * Known span durations are recorded and read back through serializePerf(). A synthetic frame (effects per segment,
+ * blending, conversion and hand-off to a bus, spans placed as in WLED::loop() and WS2812FX::service()/show()) is timed
+ * with tracing on and with the no-op spans of WLED_DISABLE_PERF_STATS, the spans of a frame of 2048 LEDs have to cost
+ * less than 1% of it.
+ */
+#include "native_test.h"
+
+using std::max;
+#define strncpy_P strncpy
+
+// Arduino core
+static unsigned long nowMs = 0;
+static unsigned long millis() { return nowMs; }
+
+// ESP.getCycleCount() reads the CCOUNT register in one cycle, reading a host counter (rdtsc, clock_gettime()) costs
+// far more than that (tens of ns when virtualized), a counter of register read cost keeps the comparison fair
+static uint32_t cpuMHz = 240;
+static uint32_t cycleCount = 0;
+struct EspClass {
+  uint32_t getCycleCount() { return cycleCount += 2411; }
+  uint32_t getCpuFreqMHz() { return cpuMHz; }
+} ESP;
+
+// WS2812FX
+struct {
+  uint16_t getFps() const { return 42; }
+  uint32_t getMissedDeadlines() const { return 3; }
+} strip;
+
+#include "../../wled00/perf.h"
+#include "../../wled00/perf.cpp"
+
+static void recordUs(uint8_t span, uint32_t us) { perfRecord(span, us * cpuMHz); }
+
+static JsonObject spanStats(JsonDocument &doc, const char *name) {
+  doc.clear();
+  serializePerf(doc.to<JsonObject>());
+  return doc["spans"][name];
+}
+
+// spans as compiled with and without WLED_DISABLE_PERF_STATS
+struct TraceOn {
+  static uint32_t start() { return perfStart(); }
+  static void end(uint8_t span, uint32_t start) { perfEnd(span, start); }
+  static void endEffect(uint8_t mode, uint32_t start) { perfEndEffect(mode, start); }
+  static void decay() { perfDecay(); }
+};
+struct TraceOff {
+  static uint32_t start() { return 0; }
+  static void end(uint8_t span, uint32_t start) {}
+  static void endEffect(uint8_t mode, uint32_t start) {}
+  static void decay() {}
+};
+
+static const unsigned SEGMENTS = 8, MAX_SEGLEN = 256;
+static unsigned SEGLEN = MAX_SEGLEN;
+static uint32_t segPixels[SEGMENTS][MAX_SEGLEN], framePixels[SEGMENTS * MAX_SEGLEN];
+static uint8_t busBuffer[SEGMENTS * MAX_SEGLEN * 3], wireBuffer[SEGMENTS * MAX_SEGLEN * 3 * 4];
+static uint8_t gammaT[256];
+
+// channel math as in colors.cpp (color_fade(), color_blend(), color_wheel())
+static inline uint32_t fade(uint32_t c, uint8_t amount) {
+  const uint32_t scale = amount + 1;
+  return (((c & 0x00FF00FF) * scale >> 8) & 0x00FF00FF) | (((c >> 8 & 0x00FF00FF) * scale) & 0xFF00FF00);
+}
+static inline uint32_t blend(uint32_t a, uint32_t b, uint8_t t) {
+  const uint32_t ia = 255 - t;
+  return ((((a & 0x00FF00FF) * ia + (b & 0x00FF00FF) * t) >> 8) & 0x00FF00FF) | ((((a >> 8 & 0x00FF00FF) * ia + (b >> 8 & 0x00FF00FF) * t)) & 0xFF00FF00);
+}
+static inline uint32_t wheel(uint8_t pos) {
+  pos = 255 - pos;
+  if (pos < 85)  return (uint32_t(255 - pos * 3) << 16) | (pos * 3);
+  if (pos < 170) { pos -= 85; return (uint32_t(pos * 3) << 8) | (255 - pos * 3); }
+  pos -= 170;
+  return (uint32_t(pos * 3) << 16) | (uint32_t(255 - pos * 3) << 8);
+}
+
+// Segment::setPixelColor(): bounds, reverse, mirror and segment brightness
+static __attribute__((noinline)) void segSetPixelColor(unsigned s, int i, uint32_t c, uint8_t opacity, bool reverse, bool mirror) {
+  if (i < 0 || i >= int(mirror ? SEGLEN / 2 : SEGLEN)) return;
+  c = fade(c, opacity);
+  segPixels[s][reverse ? SEGLEN - 1 - i : i] = c;
+  if (mirror) segPixels[s][SEGLEN - 1 - i] = c;
+}
+
+// PolyBus::setPixelColor(): color order and the bus buffer
+static __attribute__((noinline)) void busSetPixelColor(unsigned pix, uint32_t c) {
+  busBuffer[pix * 3]     = c >> 8;
+  busBuffer[pix * 3 + 1] = c >> 16;
+  busBuffer[pix * 3 + 2] = c;
+}
+
+// loop pass that renders one frame, spans as in WLED::loop(), WS2812FX::service(), show() and BusManager::show()
+template <typename Trace> static uint32_t loopPass(unsigned frame) {
+  const uint32_t loopStart = Trace::start();
+  Trace::decay();
+  const uint32_t networkStart = Trace::start();
+  Trace::end(PERF_NETWORK, networkStart);
+  const uint32_t usermodStart = Trace::start();
+  Trace::end(PERF_USERMODS, usermodStart);
+
+  const uint32_t serviceStart = Trace::start();
+  for (unsigned s = 0; s < SEGMENTS; s++) { // rainbow cycle like effects
+    const uint32_t effectStart = Trace::start();
+    for (unsigned i = 0; i < SEGLEN; i++) segSetPixelColor(s, i, wheel(frame * 3 + i * (s + 4)), 200 + s, s & 1, false);
+    Trace::endEffect(s, effectStart);
+  }
+  for (unsigned s = 0; s < SEGMENTS; s++) { // blendSegment() with a transition
+    const uint32_t blendStart = Trace::start();
+    const uint8_t progress = frame * 5 + s * 31;
+    for (unsigned i = 0; i < SEGLEN; i++) {
+      uint32_t &p = framePixels[s * SEGLEN + i];
+      p = blend(p, segPixels[s][i], progress);
+    }
+    Trace::end(PERF_BLEND, blendStart);
+  }
+  const uint32_t convertStart = Trace::start(); // gamma32(), bus brightness and color order
+  for (unsigned i = 0; i < SEGMENTS * SEGLEN; i++) {
+    const uint32_t c = framePixels[i];
+    busSetPixelColor(i, fade(uint32_t(gammaT[c >> 16 & 0xFF]) << 16 | uint32_t(gammaT[c >> 8 & 0xFF]) << 8 | gammaT[c & 0xFF], 180));
+  }
+  Trace::end(PERF_CONVERT, convertStart);
+  const uint32_t showStart = Trace::start(); // NeoPixelBus encodes 2 bits per wire byte (ESP8266 UART method)
+  static const uint8_t bits2[4] = { 0b110111, 0b000111, 0b110100, 0b000100 };
+  for (unsigned i = 0; i < SEGMENTS * SEGLEN * 3; i++) {
+    const uint8_t b = busBuffer[i];
+    for (unsigned k = 0; k < 4; k++) wireBuffer[i * 4 + k] = bits2[(b >> (6 - 2 * k)) & 3];
+  }
+  Trace::end(PERF_BUS_SHOW, showStart);
+  Trace::end(PERF_SERVICE, serviceStart);
+
+  Trace::end(PERF_LOOP, loopStart);
+  return wireBuffer[frame % (SEGMENTS * SEGLEN * 12)];
+}
+
+int main() {
+  // every value falls into a bucket whose representative value is within a third of it
+  unsigned off = 0;
+  for (uint32_t us = 0; us < 5000000; us += 1 + us / 64) {
+    const uint32_t v = perfBucketValue(perfBucket(us));
+    off += fabs(double(v) - us) > us / 3.0;
+    off += perfBucket(us) > perfBucket(us + 1);
+  }
+  CHECK_EQ(off, 0);
+
+  // 98% of the samples at 100 us, 2% at 5 ms
+  StaticJsonDocument<2048> doc;
+  for (unsigned i = 0; i < 1000; i++) recordUs(PERF_BLEND, i % 50 == 7 ? 5000 : 100);
+  JsonObject blend = spanStats(doc, "blend");
+  CHECK_EQ(blend["n"].as<unsigned>(), 1000);
+  CHECK_EQ(blend["avg"].as<unsigned>(), 198);
+  CHECK_NEAR(blend["p50"].as<unsigned>(), 100, 25);
+  CHECK_NEAR(blend["p99"].as<unsigned>(), 5000, 1250);
+  CHECK_EQ(blend["max"].as<unsigned>(), 5000);
+  CHECK_EQ(doc["mhz"].as<unsigned>(), cpuMHz);
+  CHECK_EQ(doc["missed"].as<unsigned>(), 3);
+  CHECK_EQ(spanStats(doc, "show")["n"].as<unsigned>(), 0);
+  CHECK_EQ(spanStats(doc, "show")["p99"].as<unsigned>(), 0);
+
+  // a window later counts are halved and the max of the previous window is still reported, then it is gone
+  nowMs += PERF_WINDOW;
+  perfDecay();
+  blend = spanStats(doc, "blend");
+  CHECK_EQ(blend["n"].as<unsigned>(), 500);
+  CHECK_EQ(blend["max"].as<unsigned>(), 5000);
+  CHECK_NEAR(blend["p99"].as<unsigned>(), 5000, 1250);
+  recordUs(PERF_BLEND, 300);
+  nowMs += PERF_WINDOW / 2;
+  perfDecay(); // not due yet
+  CHECK_EQ(spanStats(doc, "blend")["n"].as<unsigned>(), 501);
+  nowMs += PERF_WINDOW / 2;
+  perfDecay();
+  CHECK_EQ(spanStats(doc, "blend")["max"].as<unsigned>(), 300);
+
+  // a saturated bucket halves the histogram, ratios (and percentiles) are kept
+  for (unsigned i = 0; i < 200000; i++) recordUs(PERF_BUS_SHOW, i % 4 ? 20 : 2000);
+  JsonObject show = spanStats(doc, "show");
+  CHECK(show["n"].as<unsigned>() < 200000);
+  CHECK_NEAR(show["p50"].as<unsigned>(), 20, 5);
+  CHECK_NEAR(show["p99"].as<unsigned>(), 2000, 500);
+  CHECK_NEAR(show["avg"].as<unsigned>(), 515, 30);
+
+  // the slowest effect call of the window is reported with its mode
+  perfRecordEffect(12, 800 * cpuMHz);
+  perfRecordEffect(40, 3000 * cpuMHz);
+  perfRecordEffect(12, 900 * cpuMHz);
+  spanStats(doc, "effect");
+  CHECK_EQ(doc["slowfx"]["fx"].as<unsigned>(), 40);
+  CHECK_EQ(doc["slowfx"]["us"].as<unsigned>(), 3000);
+
+  for (unsigned i = 0; i < 256; i++) gammaT[i] = powf(i / 255.0f, 2.8f) * 255.0f + 0.5f;
+
+  // cost of a span (two counter reads and perfRecord()), then frames with and without tracing: blocks of frames
+  // alternate (fastest blocks and the median ratio); the host renders pixels much faster relative to the span
+  // bookkeeping than the ESP does, the overhead is checked for the spans of a frame against the untraced frame
+  const unsigned spanRuns = 10000000;
+  double t0 = benchSeconds();
+  for (unsigned i = 0; i < spanRuns; i++) { const uint32_t start = perfStart(); perfEnd(i % PERF_SPAN_COUNT, start); }
+  const double spanCost = (benchSeconds() - t0) / spanRuns;
+  const unsigned spans = 7 + 2 * SEGMENTS;
+  for (unsigned len : {64U, 256U}) {
+    SEGLEN = len;
+    const unsigned blocks = 40, frames = 50000 / len;
+    double on = 1e9, noTrace = 1e9;
+    std::vector<double> ratios;
+    uint32_t sum = 0;
+    for (unsigned b = 0; b < blocks; b++) {
+      double t0 = benchSeconds();
+      for (unsigned f = 0; f < frames; f++) sum += loopPass<TraceOff>(f);
+      double t1 = benchSeconds();
+      for (unsigned f = 0; f < frames; f++) sum += loopPass<TraceOn>(f);
+      double t2 = benchSeconds();
+      noTrace = std::min(noTrace, (t1 - t0) / frames);
+      on = std::min(on, (t2 - t1) / frames);
+      ratios.push_back((t2 - t1) / (t1 - t0));
+    }
+    std::nth_element(ratios.begin(), ratios.begin() + blocks / 2, ratios.end());
+    const double overhead = spans * spanCost / noTrace;
+    if (len == 256) CHECK(overhead < 0.01);
+    printf("frame of %u LEDs in %u segments: %.2f us without tracing, %.2f us with %u spans of %.1f ns (overhead %.2f%%, median of blocks %+.1f%%) (%u)\n",
+           SEGMENTS * len, SEGMENTS, noTrace * 1e6, on * 1e6, spans, spanCost * 1e9, overhead * 100, (ratios[blocks / 2] - 1) * 100, sum & 1);
+  }
+
+  return testResult("perf");
+}
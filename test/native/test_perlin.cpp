@@ -0,0 +1,74 @@
+/*
+ * Batched Perlin noise (perlin.cpp): perlin16_row()/perlin8_row() against perlin16()/perlin8() value by value
+ * Rows of random length are generated at random coordinates with small steps (many values per lattice cell), large
+ * steps (a new cell for every value) and steps that wrap the 16 bit coordinates of perlin8(), results have to be
+ * bit-exact. Frames of 64x64 and 128x128 noise values are timed both ways, with scales like those of the noise effects.
+ */
+#include "native_test.h"
+
+// as in fcn_declare.h
+int32_t perlin1D_raw(uint32_t x, bool is16bit = false);
+int32_t perlin2D_raw(uint32_t x, uint32_t y, bool is16bit = false);
+int32_t perlin3D_raw(uint32_t x, uint32_t y, uint32_t z, bool is16bit = false);
+
+#include "../../wled00/perlin.cpp"
+
+static uint32_t randomStep() {
+  switch (testRandom(4)) {
+    case 0:  return testRandom(0x400);      // many values per cell
+    case 1:  return testRandom(0x10000);    // about one cell per value
+    case 2:  return testRandom();           // coordinates wrap
+    default: return 0x10000 - testRandom(8);
+  }
+}
+
+int main() {
+  const unsigned rows = 20000;
+  unsigned values = 0, mismatches = 0;
+  uint16_t out16[200];
+  uint8_t  out8[200];
+  for (unsigned r = 0; r < rows; r++) {
+    const unsigned count = 1 + testRandom(200);
+    const uint32_t x = testRandom(), y = testRandom(), z = testRandom(), step = randomStep();
+    unsigned bad = 0;
+
+    perlin16_row(out16, count, x, step, y);
+    for (unsigned i = 0; i < count; i++) bad += out16[i] != perlin16(x + i * step, y);
+    perlin16_row(out16, count, x, step, y, z);
+    for (unsigned i = 0; i < count; i++) bad += out16[i] != perlin16(x + i * step, y, z);
+    const uint16_t x8 = x, y8 = y, z8 = z, step8 = step;
+    perlin8_row(out8, count, x8, step8, y8);
+    for (unsigned i = 0; i < count; i++) bad += out8[i] != perlin8(uint16_t(x8 + i * step8), y8);
+    perlin8_row(out8, count, x8, step8, y8, z8);
+    for (unsigned i = 0; i < count; i++) bad += out8[i] != perlin8(uint16_t(x8 + i * step8), y8, z8);
+
+    values += 4 * count;
+    if (bad && !mismatches) fprintf(stderr, "mismatch: x %08x y %08x z %08x step %08x count %u\n", x, y, z, step, count);
+    mismatches += bad;
+  }
+  CHECK_EQ(mismatches, 0);
+  printf("%u values in %u rows, %u differ\n", values, rows, mismatches);
+
+  // frames of noise as Noise 2D (perlin8 3D) and Soap (perlin16 3D, 32 bit coordinates) generate them
+  for (unsigned size : {64U, 128U}) {
+    const unsigned frames = 64 * 128 * 128 / (size * size);
+    std::vector<uint8_t>  buf8(size);
+    std::vector<uint16_t> buf16(size);
+    unsigned sum = 0;
+    const uint16_t scale = 30;
+    const uint32_t scale32 = 0x4000;
+    double t0 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) for (unsigned y = 0; y < size; y++) for (unsigned x = 0; x < size; x++) sum += perlin8(x * scale, y * scale, f * 4);
+    double t1 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) for (unsigned y = 0; y < size; y++) { perlin8_row(buf8.data(), size, 0, scale, y * scale, f * 4); sum += buf8[y]; }
+    double t2 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) for (unsigned y = 0; y < size; y++) for (unsigned x = 0; x < size; x++) sum += perlin16(x * scale32, y * scale32, f << 12);
+    double t3 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) for (unsigned y = 0; y < size; y++) { perlin16_row(buf16.data(), size, 0, scale32, y * scale32, f << 12); sum += buf16[y]; }
+    double t4 = benchSeconds();
+    printf("%ux%u frame: perlin8 3D %.0f -> %.0f us, perlin16 3D %.0f -> %.0f us (%u)\n", size, size,
+           (t1 - t0) * 1e6 / frames, (t2 - t1) * 1e6 / frames, (t3 - t2) * 1e6 / frames, (t4 - t3) * 1e6 / frames, sum & 1);
+  }
+
+  return testResult("perlin");
+}
@@ -0,0 +1,248 @@
+/*
+ * Binary pixel upload (pixelstream.cpp): round trip and throughput against the JSON "i" path
+ * Random images are encoded in every format (with and without RLE), cut into random chunks as HTTP or
+ * WebSocket would deliver them and decoded into a stand-in segment.
+ */
+#include "native_test.h"
+
+#define RGBW32(r,g,b,w) (uint32_t((uint8_t)(w) << 24 | (uint8_t)(r) << 16 | (uint8_t)(g) << 8 | (uint8_t)(b)))
+#define NOBLEND 0
+
+static uint32_t now = 0;
+static uint32_t millis() { return now; }
+
+struct CRGBPalette16 { uint32_t entries[16]; };
+static uint32_t ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t, int) { return pal.entries[index >> 4]; }
+
+struct Segment {
+  std::vector<uint32_t> px;
+  bool    freeze = false;
+  bool    active = true;
+  uint8_t palette = 0;
+  bool isActive() const { return active; }
+  bool isInTransition() const { return false; }
+  void startTransition(int) {}
+  void loadPalette(CRGBPalette16 &pal, uint8_t) { for (unsigned i = 0; i < 16; i++) pal.entries[i] = RGBW32(i*16, 255 - i*16, i, 0); }
+  void clear() { std::fill(px.begin(), px.end(), 0); }
+  void setRawPixelColor(int i, uint32_t c) { if (i >= 0 && (size_t)i < px.size()) px[i] = c; }
+};
+
+struct MockStrip {
+  Segment seg[2];
+  unsigned triggers = 0;
+  uint8_t getMainSegmentId() const { return 1; }
+  uint8_t getSegmentsNum() const { return 2; }
+  Segment &getSegment(uint8_t id) { return seg[id]; }
+  void setTransition(int) {}
+  void setBrightness(uint8_t, bool) {}
+  void trigger() { triggers++; }
+} strip;
+
+static bool jsonTransitionOnce = false;
+static uint8_t bri = 128;
+static uint8_t scaledBri(uint8_t b) { return b; }
+
+#include "../../wled00/pixelstream.cpp"
+
+// expected color of an encoded pixel
+static uint32_t decodeRef(uint8_t fmt, const uint8_t *p) {
+  CRGBPalette16 pal;
+  switch (fmt) {
+    case PX_FMT_RGBW: return RGBW32(p[0], p[1], p[2], p[3]);
+    case PX_FMT_565: {
+      const unsigned v = p[0] | (p[1] << 8), r = v >> 11, g = (v >> 5) & 63, b = v & 31;
+      return RGBW32((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 0); // bit replication, 0 and full scale are exact
+    }
+    case PX_FMT_PAL:  strip.seg[0].loadPalette(pal, 0); return pal.entries[p[0] >> 4];
+    default:          return RGBW32(p[0], p[1], p[2], 0);
+  }
+}
+
+static const uint8_t strideOf[] = {3, 4, 2, 1};
+
+static std::vector<uint8_t> header(uint8_t fmt, uint8_t seg, uint32_t offset) {
+  return { PX_MAGIC, fmt, seg, 0, uint8_t(offset), uint8_t(offset >> 8), uint8_t(offset >> 16), uint8_t(offset >> 24) };
+}
+
+// PackBits: runs of 2..129 equal pixels, literal spans of 1..128 pixels
+static void encodeRle(std::vector<uint8_t> &out, const std::vector<uint8_t> &pixels, unsigned stride) {
+  const size_t n = pixels.size() / stride;
+  auto same = [&](size_t a, size_t b) { return !memcmp(&pixels[a*stride], &pixels[b*stride], stride); };
+  size_t i = 0;
+  while (i < n) {
+    size_t run = 1;
+    while (i + run < n && run < 129 && same(i, i + run)) run++;
+    if (run >= 2) {
+      out.push_back(uint8_t(run + 126));
+      out.insert(out.end(), &pixels[i*stride], &pixels[i*stride] + stride);
+      i += run;
+      continue;
+    }
+    size_t lit = 1;
+    while (i + lit < n && lit < 128 && !(i + lit + 1 < n && same(i + lit, i + lit + 1))) lit++;
+    out.push_back(uint8_t(lit - 1));
+    out.insert(out.end(), &pixels[i*stride], &pixels[(i+lit)*stride]);
+    i += lit;
+  }
+}
+
+// sends message in random chunks, returns result of pixelStreamEnd()
+static int upload(const void *owner, const std::vector<uint8_t> &msg, size_t maxChunk) {
+  if (!pixelStreamBegin(owner)) return -2;
+  size_t pos = 0;
+  while (pos < msg.size()) {
+    const size_t n = min(msg.size() - pos, (size_t)1 + testRandom(maxChunk));
+    pixelStreamWrite(owner, msg.data() + pos, n);
+    pos += n;
+  }
+  return pixelStreamEnd(owner);
+}
+
+// image with flat areas so that RLE has runs and literals
+static std::vector<uint8_t> randomImage(size_t n, unsigned stride) {
+  std::vector<uint8_t> img(n * stride);
+  for (size_t i = 0; i < n; ) {
+    uint8_t p[4] = { uint8_t(testRandom()), uint8_t(testRandom()), uint8_t(testRandom()), uint8_t(testRandom()) };
+    size_t len = testRandom(4) ? 1 : 1 + testRandom(300);
+    for (; len && i < n; len--, i++) memcpy(&img[i*stride], p, stride);
+  }
+  return img;
+}
+
+static void roundTrip() {
+  int owner;
+  for (unsigned iter = 0; iter < 400; iter++) {
+    const uint8_t fmt = iter & 3;
+    const bool rle = iter & 4;
+    const unsigned stride = strideOf[fmt];
+    const size_t segLen = 1 + testRandom(3000);
+    const uint32_t offset = testRandom(segLen);
+    const size_t n = 1 + testRandom(segLen - offset);
+    Segment &seg = strip.seg[1];
+    seg.px.assign(segLen, 0xDEADBEEF);
+    seg.freeze = false;
+
+    const std::vector<uint8_t> img = randomImage(n, stride);
+    std::vector<uint8_t> msg = header(fmt | (rle ? PX_FMT_RLE : 0), 255, offset);
+    if (rle) encodeRle(msg, img, stride);
+    else     msg.insert(msg.end(), img.begin(), img.end());
+
+    const unsigned triggers = strip.triggers;
+    CHECK_EQ(upload(&owner, msg, iter % 3 ? 1460 : 7), n); // TCP segments or tiny pieces (pixels split across chunks)
+    CHECK_EQ(strip.triggers, triggers + 1);
+    CHECK(seg.freeze);
+    unsigned bad = 0;
+    for (size_t i = 0; i < segLen; i++) {
+      const uint32_t expect = (i >= offset && i < offset + n) ? decodeRef(fmt, &img[(i - offset) * stride]) : 0; // rest cleared
+      if (seg.px[i] != expect) bad++;
+    }
+    CHECK_EQ(bad, 0);
+  }
+}
+
+static void invalid() {
+  int a, b;
+  strip.seg[0].px.assign(16, 0);
+  strip.seg[1].px.assign(16, 0);
+  std::vector<uint8_t> msg = header(PX_FMT_RGB, 0, 0);
+  msg.insert(msg.end(), {1,2,3, 4,5});
+  CHECK_EQ(upload(&a, msg, 100), -1);                     // last pixel incomplete
+  msg = header(PX_FMT_RGB | PX_FMT_RLE, 0, 0);
+  msg.insert(msg.end(), {0x90, 1,2,3, 0x05, 1,2,3});
+  CHECK_EQ(upload(&a, msg, 100), -1);                     // literal span incomplete
+  msg = header(7, 0, 0);
+  CHECK_EQ(upload(&a, msg, 100), -1);                     // unknown format
+  msg = header(PX_FMT_RGB, 5, 0);
+  CHECK_EQ(upload(&a, msg, 100), -1);                     // no such segment
+  msg = header(PX_FMT_RGB, 0, 0); msg[0] = '{';
+  CHECK_EQ(upload(&a, msg, 100), -1);                     // not a pixel message
+  CHECK_EQ(upload(&a, {'P', 0, 0}, 100), -1);             // header incomplete
+  strip.seg[0].active = false;
+  CHECK_EQ(upload(&a, header(PX_FMT_RGB, 0, 0), 100), -1); // inactive segment
+  strip.seg[0].active = true;
+  msg = header(PX_FMT_RGB, 0, 14);
+  msg.insert(msg.end(), {1,2,3, 4,5,6, 7,8,9});
+  CHECK_EQ(upload(&a, msg, 100), 3);                      // pixels beyond segment end are ignored
+  CHECK_EQ(strip.seg[0].px[15], RGBW32(4,5,6,0));
+
+  // concurrent uploads: the second client is refused until the first one finishes or stalls
+  CHECK(pixelStreamBegin(&a));
+  CHECK(!pixelStreamBegin(&b));
+  CHECK(!pixelStreamWrite(&b, msg.data(), msg.size()));
+  CHECK_EQ(pixelStreamEnd(&b), -1);
+  now += PX_TIMEOUT + 1;
+  CHECK(pixelStreamBegin(&b));
+  CHECK(!pixelStreamWrite(&a, msg.data(), msg.size())); // abandoned
+  CHECK_EQ(pixelStreamEnd(&a), -1);
+  CHECK(pixelStreamWrite(&b, msg.data(), msg.size()));
+  CHECK_EQ(pixelStreamEnd(&b), 3);
+}
+
+// JSON reference: {"seg":{"id":0,"i":["RRGGBB",...]}} handled like deserializeSegment() does (without locking pDoc)
+// note that iarr[i] walks the array from its start, as in json.cpp
+static bool colorFromHexString(uint8_t *rgb, const char *in) {
+  if (in == nullptr) return false;
+  const size_t inputSize = strnlen(in, 9);
+  if (inputSize != 6 && inputSize != 8) return false;
+  const uint32_t c = strtoul(in, NULL, 16);
+  if (inputSize == 6) { rgb[0] = c >> 16; rgb[1] = c >> 8; rgb[2] = c; }
+  else                { rgb[0] = c >> 24; rgb[1] = c >> 16; rgb[2] = c >> 8; rgb[3] = c; }
+  return true;
+}
+
+static void applyJson(const String &json, DynamicJsonDocument &doc, Segment &seg) {
+  deserializeJson(doc, json);
+  JsonArray iarr = doc["seg"]["i"];
+  unsigned iStart = 0;
+  for (size_t i = 0; i < iarr.size(); i++) {
+    uint8_t rgbw[4] = {0,0,0,0};
+    colorFromHexString(rgbw, iarr[i].as<const char*>());
+    seg.setRawPixelColor(iStart++, RGBW32(rgbw[0], rgbw[1], rgbw[2], rgbw[3]));
+  }
+}
+
+static void throughput() {
+  const size_t n = 1500;
+  const unsigned reps = 300;
+  Segment &seg = strip.seg[0];
+  seg.px.assign(n, 0);
+  const std::vector<uint8_t> img = randomImage(n, 3);
+
+  std::vector<uint8_t> raw = header(PX_FMT_RGB, 0, 0), rle = header(PX_FMT_RGB | PX_FMT_RLE, 0, 0);
+  raw.insert(raw.end(), img.begin(), img.end());
+  encodeRle(rle, img, 3);
+  String json = "{\"seg\":{\"id\":0,\"i\":[";
+  for (size_t i = 0; i < n; i++) {
+    char hex[12];
+    snprintf(hex, sizeof(hex), "%s\"%02X%02X%02X\"", i ? "," : "", img[i*3], img[i*3+1], img[i*3+2]);
+    json += hex;
+  }
+  json += "]}}";
+
+  int owner;
+  double t = benchSeconds();
+  for (unsigned r = 0; r < reps; r++) { seg.freeze = false; upload(&owner, raw, 1460); }
+  const double tRaw = benchSeconds() - t;
+  t = benchSeconds();
+  for (unsigned r = 0; r < reps; r++) { seg.freeze = false; upload(&owner, rle, 1460); }
+  const double tRle = benchSeconds() - t;
+  DynamicJsonDocument doc(65536); // more than JSON_BUFFER_SIZE on any device
+  t = benchSeconds();
+  for (unsigned r = 0; r < reps; r++) applyJson(json, doc, seg);
+  const double tJson = benchSeconds() - t;
+  CHECK_EQ(seg.px[n-1], RGBW32(img[3*n-3], img[3*n-2], img[3*n-1], 0));
+  CHECK(doc.capacity() >= doc.memoryUsage() && !doc.overflowed());
+
+  const double px = double(n) * reps;
+  printf("%zu px: binary %zu B %.1f Mpx/s, RLE %zu B %.1f Mpx/s, JSON %zu B %.1f Mpx/s (+%zu B document)\n",
+    n, raw.size(), px / tRaw / 1e6, rle.size(), px / tRle / 1e6, json.length(), px / tJson / 1e6, doc.memoryUsage());
+  CHECK(tRaw * 2 < tJson);
+  CHECK(raw.size() * 2 < json.length());
+}
+
+int main() {
+  roundTrip();
+  invalid();
+  throughput();
+  return testResult("pixelstream");
+}
@@ -0,0 +1,164 @@
+/*
+ * Main loop background tasks (scheduler.cpp): frame start jitter of a simulated WLED::loop() before and after
+ * Tasks are modelled on the handlers of WLED::loop() with their periods and maximum deferrals: cheap latency critical
+ * handlers on every pass, UDP bursts, usermods redrawing a display, Alexa, a Hue poll with a blocking HTTP request and
+ * presets loaded from flash. The former loop ran all handlers in a fixed order and strip.service() last, the new one
+ * services the strip first and lets runLoopTasks() fill the slack. Frame start lateness, missed deadlines (more than
+ * half a frame late) and the longest time between two calls of every task are compared; no task may wait longer
+ * than its maxDefer plus the two passes it is called in.
+ */
+#include "native_test.h"
+
+#define WLED_DISABLE_PERF_STATS
+#include "../../wled00/perf.h"
+
+// clock in microseconds, tasks and rendering advance it
+static uint64_t nowUs = 0;
+static unsigned long millis() { return nowUs / 1000; }
+static unsigned long micros() { return nowUs; }
+static void yield() {}
+
+// frame timing of WS2812FX::service() and timeToNextFrame() at 42 fps (ESP32)
+#define MIN_FRAME_DELAY 2
+static struct {
+  unsigned long lastServiceShow = 0;
+  uint16_t showtime = 1000 / 42;
+  std::vector<uint32_t> late; // us after due
+  unsigned missed = 0;
+
+  unsigned long timeToNextFrame() const {
+    unsigned long elapsed = millis() - lastServiceShow;
+    unsigned long minDelay = std::max((unsigned)showtime, MIN_FRAME_DELAY + 1U);
+    return elapsed >= minDelay ? 0 : minDelay - elapsed;
+  }
+  void service() {
+    unsigned long elapsed = millis() - lastServiceShow;
+    if (elapsed <= MIN_FRAME_DELAY || elapsed < showtime) return;
+    late.push_back(nowUs - (lastServiceShow + showtime) * 1000ULL);
+    if (elapsed > showtime + showtime / 2U) missed++;
+    lastServiceShow = millis();
+    nowUs += 4000 + testRandom(2000); // effects, conversion and show
+  }
+} strip;
+
+// as in fcn_declare.h
+typedef struct LoopTask {
+  void        (*fn)();
+  bool        (*ready)();  // nullptr = always ready
+  uint16_t      period;    // ms
+  uint16_t      maxDefer;  // ms
+  uint8_t       perfSpan;  // PERF_* span to record or 255
+  uint16_t      costUs;    // expected cost: peak of recent runs (halves every LOOP_TASK_COST_DECAY ms)
+  unsigned long lastRun;
+} loopTask;
+void runLoopTasks(loopTask *tasks, size_t count);
+
+#include "../../wled00/scheduler.cpp"
+
+// handlers that do their work when it is due (cost in us)
+struct Work {
+  uint32_t idleUs, workUs, intervalMs;
+  unsigned long lastWork = 0;
+  uint64_t lastCall = 0;
+  uint32_t maxGapUs = 0;
+  void call() {
+    if (lastCall) maxGapUs = std::max<uint32_t>(maxGapUs, nowUs - lastCall);
+    lastCall = nowUs;
+    nowUs += idleUs;
+    if (intervalMs && millis() - lastWork >= intervalMs) { lastWork = millis(); nowUs += workUs; }
+  }
+};
+static Work cheap        = { 60, 0, 0 };       // time, IR, connection, transitions, IO, playlist
+static Work notify       = { 80, 0, 0 };       // UDP notifier and realtime, bursts of packets below
+static Work usermods     = { 150, 6000, 250 }; // display redraw
+static Work alexa        = { 30, 4000, 5000 }; // discovery answer
+static Work ota          = { 20, 0, 0 };
+static Work nightlight   = { 5, 0, 0 };
+static Work hue          = { 5, 15000, 2500 }; // blocking HTTP poll
+static Work presets      = { 5, 8000, 10000 }; // preset loaded from flash
+static void handleCheap()         { cheap.call(); }
+static void handleNotifications() { notify.call(); if (testRandom(50) == 0) nowUs += 1500; }
+static void loopUsermods()        { usermods.call(); }
+static void handleAlexa()         { alexa.call(); }
+static void handleOTA()           { ota.call(); }
+static void handleNightlight()    { nightlight.call(); }
+static void handleHue()           { hue.call(); }
+static void handlePresets()       { presets.call(); }
+
+// period and maximum deferral as in the task table of wled.cpp
+static loopTask loopTasks[] = {
+  { handleCheap,         nullptr, 0,  0, 255 },
+  { handleNotifications, nullptr, 0,  0, 255 },
+  { loopUsermods,        nullptr, 0, 10, 255 },
+  { handleAlexa,         nullptr, 0, 20, 255 },
+  { handleOTA,           nullptr, 0, 20, 255 },
+  { handleNightlight,    nullptr, 0, 20, 255 },
+  { handleHue,           nullptr, 0, 50, 255 },
+  { handlePresets,       nullptr, 0,  0, 255 },
+};
+static const size_t taskCount = sizeof(loopTasks) / sizeof(loopTasks[0]);
+static Work *works[] = { &cheap, &notify, &usermods, &alexa, &ota, &nightlight, &hue, &presets };
+static const char *names[] = { "cheap handlers", "notifications", "usermods", "Alexa", "OTA", "nightlight", "Hue", "presets" };
+
+struct LoopStats {
+  std::vector<uint32_t> late;
+  unsigned missed = 0, passes = 0;
+  uint32_t maxPassUs = 0;
+  uint32_t maxGapUs[taskCount];
+};
+
+// WLED::loop() passes for the given time
+static LoopStats simulate(bool scheduled, unsigned seconds) {
+  for (auto w : works) { w->lastWork = 0; w->lastCall = 0; w->maxGapUs = 0; }
+  for (auto &t : loopTasks) { t.costUs = 0; t.lastRun = 0; }
+  strip.late.clear();
+  strip.missed = 0;
+  strip.lastServiceShow = millis();
+  LoopStats s;
+  const uint64_t end = nowUs + seconds * 1000000ULL;
+  while (nowUs < end) {
+    const uint64_t passStart = nowUs;
+    if (scheduled) {
+      strip.service();
+      runLoopTasks(loopTasks, taskCount);
+    } else {
+      for (auto &t : loopTasks) t.fn(); // as in the former WLED::loop(): all handlers, then strip.service()
+      strip.service();
+    }
+    nowUs += 100; // MDNS, WebSocket, watchdog
+    s.maxPassUs = std::max<uint32_t>(s.maxPassUs, nowUs - passStart);
+    s.passes++;
+  }
+  s.late = strip.late;
+  std::sort(s.late.begin(), s.late.end());
+  s.missed = strip.missed;
+  for (size_t i = 0; i < taskCount; i++) s.maxGapUs[i] = works[i]->maxGapUs;
+  return s;
+}
+
+static uint32_t percentile(const std::vector<uint32_t> &v, unsigned pct) { return v.empty() ? 0 : v[(v.size() - 1) * pct / 100]; }
+
+int main() {
+  nowUs = 1000000;
+  const unsigned seconds = 300;
+  const LoopStats former = simulate(false, seconds);
+  const LoopStats now = simulate(true, seconds);
+
+  printf("%u s at 42 fps, frame start late: p50 %u us, p90 %u us, p99 %u us, max %u us, %u of %u frames missed before\n",
+         seconds, percentile(former.late, 50), percentile(former.late, 90), percentile(former.late, 99), former.late.back(), former.missed, unsigned(former.late.size()));
+  printf("%u s at 42 fps, frame start late: p50 %u us, p90 %u us, p99 %u us, max %u us, %u of %u frames missed now\n",
+         seconds, percentile(now.late, 50), percentile(now.late, 90), percentile(now.late, 99), now.late.back(), now.missed, unsigned(now.late.size()));
+  CHECK(now.late.size() >= former.late.size());
+  CHECK(percentile(now.late, 99) < percentile(former.late, 99));
+  CHECK(now.missed < former.missed);
+
+  // deferred tasks still run within their maximum deferral (ms resolution) plus the passes of both calls
+  for (size_t i = 0; i < taskCount; i++) {
+    const uint32_t bound = (loopTasks[i].maxDefer + 1) * 1000 + 2 * now.maxPassUs;
+    CHECK(now.maxGapUs[i] <= bound);
+    printf("%-14s calls %5u us apart at most before, %5u us now (max. deferral %u ms)\n", names[i], former.maxGapUs[i], now.maxGapUs[i], loopTasks[i].maxDefer);
+  }
+  printf("longest loop pass %u us before, %u us now\n", former.maxPassUs, now.maxPassUs);
+
+  return testResult("scheduler");
+}
@@ -0,0 +1,252 @@
+/*
+ * Adalight/TPM2 serial handler (wled_serial.cpp) replaying recorded host streams
+ * The streams are built the way Prismatik/Hyperion ("Ada"), the "AdW" RGBW framing and TPM2 senders write them,
+ * interleaved with commands, JSON, noise and corrupted headers, and arrive in random UART chunks between
+ * handleSerial() calls. Every frame shown has to match what was sent; "AdW" frame counter gaps are counted.
+ */
+#include "native_test.h"
+#include <cstdarg>
+
+typedef uint8_t byte;
+#define CALL_MODE_DIRECT_CHANGE   1
+#define REALTIME_MODE_ADALIGHT    5
+#define ERR_NORAM                 8
+#define ERR_JSON                  9
+#define VERSION                   2506160
+#define JSON_BUFFER_SIZE          32767
+#define JSON_STREAM_REST_SIZE     2048
+#define JSON_STREAM_UNIT_SIZE     6144
+#define JSON_STREAM_SEG_KEEP      16384
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define lowByte(w)  ((uint8_t)((w) & 0xFF))
+#define R(c) ((uint8_t)((c) >> 16))
+#define G(c) ((uint8_t)((c) >> 8))
+#define B(c) ((uint8_t)(c))
+#define W(c) ((uint8_t)((c) >> 24))
+static inline uint8_t qadd8(uint8_t a, uint8_t b) { return min(255, a + b); }
+
+static uint32_t now = 0;
+static uint32_t millis() { return now; }
+
+// UART: bytes "arrive" in the receive buffer, output is captured
+class MockSerial {
+  public:
+    std::deque<uint8_t> rx;
+    std::string tx;
+    uint32_t baud = 115200;
+    explicit operator bool() const { return true; }
+    int available() const { return rx.size(); }
+    int peek() const { return rx.empty() ? -1 : rx.front(); }
+    int read() { if (rx.empty()) return -1; const int c = rx.front(); rx.pop_front(); return c; }
+    size_t readBytes(uint8_t *buf, size_t len) { size_t n = 0; for (; n < len && !rx.empty(); n++) buf[n] = read(); return n; }
+    size_t write(uint8_t c) { tx += (char)c; return 1; }
+    size_t write(const uint8_t *d, size_t n) { tx.append((const char*)d, n); return n; }
+    size_t print(const char *s) { tx += s; return strlen(s); }
+    size_t print(unsigned long v) { return print(std::to_string(v).c_str()); }
+    size_t println(const char *s = "") { print(s); return print("\r\n") + strlen(s); }
+    size_t println(unsigned long v) { print(v); return print("\r\n"); }
+    size_t printf_P(const char *fmt, ...) { char b[128]; va_list a; va_start(a, fmt); vsnprintf(b, sizeof(b), fmt, a); va_end(a); return print(b); }
+    void flush() {}
+    void begin(uint32_t rate) { baud = rate; }
+} Serial;
+
+struct MockStrip {
+  std::vector<uint32_t> px = std::vector<uint32_t>(2048);
+  std::vector<std::vector<uint32_t>> shown; // pixels of every frame shown
+  unsigned used = 0;                        // pixels set since last show
+  int suspended = 0;
+  void show() { shown.emplace_back(px.begin(), px.begin() + used); used = 0; }
+  unsigned getLengthTotal() const { return 4; }
+  uint32_t getPixelColor(unsigned i) const { return px[i]; }
+  uint32_t getLastShow() const { return shown.size(); }
+  void suspend() { suspended++; }
+  void waitForIt() {}
+  void resume() { suspended--; }
+} strip;
+
+static bool serialCanRX = true, serialCanTX = true;
+static byte realtimeOverride = 0;
+static uint16_t realtimeTimeoutMs = 2500;
+static unsigned realtimeLocks = 0;
+static void realtimeLock(uint32_t, byte mode) { CHECK_EQ(mode, REALTIME_MODE_ADALIGHT); realtimeLocks++; }
+static void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w) {
+  if (i < strip.px.size()) strip.px[i] = uint32_t(w) << 24 | uint32_t(r) << 16 | uint32_t(g) << 8 | b;
+  strip.used = max(strip.used, i + 1U);
+}
+static unsigned improv = 0;
+static void handleImprovPacket() { improv++; Serial.rx.clear(); }
+
+// JSON API through the real JsonStateStream, state functions only record
+static DynamicJsonDocument doc(JSON_BUFFER_SIZE);
+static JsonDocument *pDoc = &doc;
+static bool jsonLocked = false;
+static bool requestJSONBufferLock(uint8_t) { if (jsonLocked) return false; jsonLocked = true; pDoc->clear(); return true; }
+static void releaseJSONBufferLock() { jsonLocked = false; }
+static std::vector<int> jsonBri;
+void deserializeStateHead(JsonObject root, byte &, byte) { if (root.containsKey("bri")) jsonBri.push_back(root["bri"]); }
+bool deserializeStateTail(JsonObject root, byte, byte) { return root["v"] | false; }
+bool deserializeSegment(JsonObject, byte, byte) { return true; }
+void deserializeSegmentObject(JsonObject, byte) {}
+void purgeDeletedSegments(size_t) {}
+void checkSettingsPIN(const char *) {}
+void serializeState(JsonObject root) { root["on"] = true; }
+void serializeInfo(JsonObject root) { root["ver"] = "test"; }
+
+#include "../../wled00/jsonstream.h"
+#include "../../wled00/jsonstream.cpp"
+#include "../../wled00/wled_serial.cpp"
+
+// sender side
+typedef std::vector<uint8_t> Bytes;
+
+static Bytes adaFrame(const std::vector<uint32_t> &px, bool rgbw = false, uint8_t seq = 0) {
+  const unsigned n = px.size() - 1; // LED count - 1
+  Bytes b = { 'A', 'd', uint8_t(rgbw ? 'W' : 'a'), uint8_t(n >> 8), uint8_t(n), uint8_t((n >> 8) ^ (n & 0xFF) ^ 0x55) };
+  if (rgbw) b.push_back(seq);
+  for (uint32_t c : px) {
+    b.insert(b.end(), { R(c), G(c), B(c) });
+    if (rgbw) b.push_back(W(c));
+  }
+  return b;
+}
+
+static Bytes tpm2Frame(const std::vector<uint32_t> &px) {
+  const unsigned len = px.size() * 3;
+  Bytes b = { 0xC9, 0xDA, uint8_t(len >> 8), uint8_t(len) };
+  for (uint32_t c : px) b.insert(b.end(), { R(c), G(c), B(c) });
+  b.push_back(0x36);
+  return b;
+}
+
+// pixel values without bytes that are commands when seen outside a frame
+static std::vector<uint32_t> randomPixels(unsigned n, bool rgbw) {
+  std::vector<uint32_t> px(n);
+  for (auto &c : px) c = testRandom() & (rgbw ? 0x3F3F3F3F : 0x003F3F3F);
+  return px;
+}
+
+// delivers the recording in UART sized pieces, handleSerial() runs in between (main loop)
+static void replay(const Bytes &rec, unsigned maxChunk) {
+  for (size_t pos = 0; pos < rec.size(); ) {
+    const size_t n = min(rec.size() - pos, (size_t)1 + testRandom(maxChunk));
+    Serial.rx.insert(Serial.rx.end(), rec.begin() + pos, rec.begin() + pos + n);
+    pos += n;
+    now++;
+    handleSerial();
+  }
+  for (unsigned i = 0; i < 100 && Serial.rx.size(); i++) handleSerial();
+  CHECK_EQ(Serial.rx.size(), 0);
+}
+
+static void mixedSession() {
+  Bytes rec;
+  std::vector<std::vector<uint32_t>> sent;
+  auto add = [&](const Bytes &b) { rec.insert(rec.end(), b.begin(), b.end()); };
+  for (unsigned f = 0; f < 300; f++) {
+    const unsigned n = 1 + testRandom(f % 10 ? 300 : 1500);
+    switch (testRandom(3)) {
+      case 0: sent.push_back(randomPixels(n, false)); add(adaFrame(sent.back())); break;
+      case 1: sent.push_back(randomPixels(n, true));  add(adaFrame(sent.back(), true, serialSeq + f)); break; // counter continues
+      default: sent.push_back(randomPixels(n, false)); add(tpm2Frame(sent.back())); break;
+    }
+    if (!testRandom(10)) add({ 0x00, 0x13, 'x', 0x0A });                  // noise between frames
+    if (!testRandom(20)) add({ 'A', 'd', 'a', 0x00, 0x05, 0x00, 1, 2, 3 }); // corrupted header, data scanned as noise
+  }
+  const size_t shownBefore = strip.shown.size();
+  const uint32_t lostBefore = serialLost;
+  // counter of "AdW" frames above is the frame number, all other frames count as lost for "AdW"
+  serialSeq = 0;
+  replay(rec, 300);
+  CHECK_EQ(strip.shown.size() - shownBefore, sent.size());
+  unsigned bad = 0;
+  for (size_t i = 0; i < sent.size() && shownBefore + i < strip.shown.size(); i++) bad += strip.shown[shownBefore + i] != sent[i];
+  CHECK_EQ(bad, 0);
+  CHECK(serialLost > lostBefore);
+}
+
+static void frameCounter() {
+  Bytes rec;
+  std::vector<uint32_t> px = randomPixels(50, true);
+  serialSeq = 10;
+  const uint32_t lostBefore = serialLost;
+  const uint8_t seqs[] = { 10, 11, 12, 15, 16, 20, 21 }; // 2 + 3 frames lost
+  for (uint8_t s : seqs) { Bytes f = adaFrame(px, true, s); rec.insert(rec.end(), f.begin(), f.end()); }
+  replay(rec, 64);
+  CHECK_EQ(serialLost - lostBefore, 5);
+  CHECK_EQ(serialSeq, 22);
+  CHECK(strip.shown.back() == px);
+}
+
+static void commands() {
+  Serial.tx.clear();
+  replay({ 'v' }, 1);
+  CHECK(Serial.tx.find("WLED 2506160") != std::string::npos);
+  Serial.tx.clear();
+  replay({ 0xC9, 0xAA }, 1);                   // TPM2 ping
+  CHECK(Serial.tx == "\xAC");
+  replay({ 0xB7 }, 1);
+  CHECK_EQ(Serial.baud, 1500000);
+  replay({ 0xB0 }, 1);
+  CHECK_EQ(Serial.baud, 115200);
+
+  // JSON between frames, split arbitrarily
+  const char *cmd = "{\"bri\":42,\"seg\":[{\"id\":0,\"fx\":9}],\"v\":true}";
+  Bytes rec(cmd, cmd + strlen(cmd));
+  Bytes f = adaFrame(randomPixels(20, false));
+  rec.insert(rec.end(), f.begin(), f.end());
+  const size_t shown = strip.shown.size();
+  Serial.tx.clear();
+  replay(rec, 5);
+  CHECK(jsonBri.size() == 1 && jsonBri.back() == 42);
+  CHECK(Serial.tx.find("{\"state\":{\"on\":true},\"info\":{\"ver\":\"test\"}}") != std::string::npos); // verbose response
+  CHECK_EQ(strip.shown.size(), shown + 1);
+
+  // invalid JSON is reported and the following frame is still received
+  const char *bad = "{\"bri\":}";
+  rec.assign(bad, bad + strlen(bad));
+  rec.insert(rec.end(), f.begin(), f.end());
+  Serial.tx.clear();
+  replay(rec, 3);
+  CHECK(Serial.tx.find("{\"error\":9}") != std::string::npos);
+  CHECK_EQ(strip.shown.size(), shown + 2);
+
+  // incomplete JSON times out
+  replay({ '{', '"', 'o' }, 1);
+  now += 101;
+  handleSerial();
+  CHECK(!jsonLocked);
+  CHECK_EQ(strip.shown.size(), shown + 2);
+  Serial.tx.clear();
+  replay(f, 7);
+  CHECK_EQ(strip.shown.size(), shown + 3);
+
+  // realtime override: frames are consumed but not shown
+  realtimeOverride = 1;
+  replay(f, 16);
+  realtimeOverride = 0;
+  CHECK_EQ(strip.shown.size(), shown + 3);
+}
+
+// parser cost per byte (UART at 2 Mbaud delivers 200 kB/s)
+static void throughput() {
+  Bytes rec;
+  const std::vector<uint32_t> px = randomPixels(1500, false);
+  const Bytes f = adaFrame(px);
+  for (unsigned i = 0; i < 400; i++) rec.insert(rec.end(), f.begin(), f.end());
+  const size_t shown = strip.shown.size();
+  const double t0 = benchSeconds();
+  replay(rec, 256); // ESP32 UART RX buffer default
+  const double dt = benchSeconds() - t0;
+  CHECK_EQ(strip.shown.size(), shown + 400);
+  printf("%.1f MB/s (%.0f frames/s of 1500 LEDs)\n", rec.size() / dt / 1e6, 400 / dt);
+}
+
+int main() {
+  mixedSession();
+  frameCounter();
+  commands();
+  throughput();
+  CHECK_EQ(improv, 0);
+  CHECK_EQ(realtimeLocks, strip.shown.size() + 1); // override frame locks but does not show
+  return testResult("serial");
+}
@@ -0,0 +1,244 @@
+/*
+ * Snapshot responses (settings scripts) sent through a mock response sink
+ * A settings script with a growing number of buses/usermods is generated the way getSettingsJS() does it (many small
+ * prints), sent in TCP sized pieces and compared byte by byte. Heap is tracked by the p_* allocators: peak while the
+ * script is generated, memory held during the transfer and bytes copied by realloc. Figures are compared with the
+ * buffering of the former AsyncResponseStream (exact growth) and with regenerating the output per chunk.
+ * (/json/cfg is serialized from the locked JSON buffer while it is sent and allocates nothing.)
+ */
+#include "native_test.h"
+#include <functional>
+#include <Print.h>
+
+// AsyncWebServer mock, the response keeps the filler until it is destroyed (also on early disconnect)
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+struct AsyncWebServerResponse {
+  String            contentType;
+  size_t            contentLength;
+  AwsResponseFiller filler;
+};
+struct AsyncWebServerRequest {
+  AsyncWebServerResponse *beginResponse(const String& type, size_t len, AwsResponseFiller filler) {
+    return new AsyncWebServerResponse{type, len, filler};
+  }
+};
+
+#include "../../wled00/snapshot.h"
+
+static AsyncWebServerRequest request;
+
+// settings script for the LED page: per bus and per usermod a couple of form values (like printSetFormValue())
+static void settingsScript(Print &dest, unsigned buses, unsigned usermods) {
+  char key[16];
+  dest.print("function GetV(){var d=document;");
+  for (unsigned b = 0; b < buses; b++) {
+    dest.print("addLEDs(1);");
+    const char *fields[] = {"L0", "L1", "LC", "LS", "CO", "LT", "SL", "RF", "AW", "SP", "LA", "MA"};
+    for (const char *f : fields) {
+      snprintf(key, sizeof(key), "%s%u", f, b);
+      dest.print("d.Sf."); dest.print(key); dest.print(".value="); dest.print(int((b * 37 + f[1]) % 300)); dest.print(';');
+    }
+  }
+  for (unsigned u = 0; u < usermods; u++) {
+    dest.print("addInfo('um"); dest.print(u); dest.print(":pin[]',0,'','GPIO');");
+    dest.print("d.Sf['um"); dest.print(u); dest.print(":name'].value=\"Usermod number "); dest.print(u); dest.print("\";");
+  }
+  dest.print('}');
+}
+
+// counts what is generated and keeps it for comparison
+class StringPrint : public Print {
+  public:
+  std::string s;
+  size_t write(const uint8_t *buffer, size_t size) override { s.append((const char*)buffer, size); return size; }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+};
+
+// former AsyncResponseStream buffering: cbuf grown by exactly what is missing on every write
+class StreamModel : public Print {
+  uint8_t *_buf = nullptr;
+  size_t   _len = 0, _cap = 0;
+  public:
+  StreamModel() { _buf = static_cast<uint8_t*>(p_malloc(_cap = 1460)); }
+  ~StreamModel() { p_free(_buf); }
+  size_t write(const uint8_t *buffer, size_t size) override {
+    if (_len + size > _cap) {
+      uint8_t *buf = static_cast<uint8_t*>(p_realloc(_buf, _len + size + 1));
+      if (!buf) return 0;
+      _buf = buf;
+      _cap = _len + size + 1;
+    }
+    memcpy(_buf + _len, buffer, size);
+    _len += size;
+    return size;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+};
+
+// output window of a chunked response that regenerates everything up to the window (first version of the change)
+class WindowPrint : public Print {
+  uint8_t *_dest;
+  size_t   _from, _to, _pos = 0;
+  public:
+  WindowPrint(uint8_t *dest, size_t from, size_t len) : _dest(dest), _from(from), _to(from + len) {}
+  size_t write(const uint8_t *buffer, size_t size) override {
+    for (size_t i = 0; i < size; i++, _pos++) if (_pos >= _from && _pos < _to) _dest[_pos - _from] = buffer[i];
+    return size;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t generated() const { return _pos; }
+};
+
+// pulls the response like the TCP stack does (window between 536 and 2920 bytes), optionally gives up after 'abortAt' bytes
+static std::string sink(AsyncWebServerResponse *response, size_t abortAt = SIZE_MAX) {
+  std::string out;
+  uint8_t window[2920];
+  while (out.size() < response->contentLength && out.size() < abortAt) {
+    const size_t n = response->filler(window, 536 + testRandom(2920 - 536 + 1), out.size());
+    if (!n) break;
+    out.append((const char*)window, n);
+  }
+  return out;
+}
+
+struct Figures { size_t len, peak, held, copied; };
+
+static Figures sendSnapshot(unsigned buses, unsigned usermods, const std::string &expected) {
+  Figures f{};
+  testHeapPeak = testHeapUsed = testHeapCopied = 0;
+  SnapshotPrint snap;
+  settingsScript(snap, buses, usermods);
+  CHECK(!snap.failed());
+  f.len = snap.length();
+  AsyncWebServerResponse *response = beginSnapshotResponse(&request, "application/javascript", snap);
+  CHECK_EQ(snap.length(), 0);                    // blocks are owned by the response
+  f.peak = testHeapPeak;
+  f.held = testHeapUsed;                         // kept while the response is sent
+  f.copied = testHeapCopied;
+  CHECK_EQ(response->contentLength, expected.size());
+  CHECK(sink(response) == expected);
+  delete response;
+  CHECK_EQ(testHeapUsed, 0);
+  return f;
+}
+
+static Figures sendStreamModel(unsigned buses, unsigned usermods) {
+  Figures f{};
+  testHeapPeak = testHeapUsed = testHeapCopied = 0;
+  {
+    StreamModel stream;
+    settingsScript(stream, buses, usermods);
+    f.peak = testHeapPeak;
+    f.held = testHeapUsed;
+    f.copied = testHeapCopied;
+  }
+  CHECK_EQ(testHeapUsed, 0);
+  return f;
+}
+
+// bytes generated when every chunk regenerates the output up to its end
+static size_t regenerated(unsigned buses, unsigned usermods, const std::string &expected) {
+  size_t total = 0;
+  std::string out;
+  uint8_t window[1436];
+  while (out.size() < expected.size()) {
+    WindowPrint w(window, out.size(), sizeof(window));
+    settingsScript(w, buses, usermods);
+    total += w.generated();
+    out.append((const char*)window, min(sizeof(window), expected.size() - out.size()));
+  }
+  CHECK(out == expected);
+  return total;
+}
+
+int main() {
+  printf("%-8s %8s | %-22s | %-22s | %s\n", "buses/um", "bytes", "snapshot peak/held/cpy", "stream peak/held/cpy", "regenerated");
+  const unsigned sizes[][2] = {{1, 0}, {4, 2}, {10, 5}, {20, 10}, {36, 20}};
+  for (auto &sz : sizes) {
+    StringPrint ref;
+    settingsScript(ref, sz[0], sz[1]);
+    const std::string &expected = ref.s;
+
+    const Figures s = sendSnapshot(sz[0], sz[1], expected);
+    const Figures m = sendStreamModel(sz[0], sz[1]);
+    const size_t regen = regenerated(sz[0], sz[1], expected);
+    CHECK_EQ(s.len, expected.size());
+    const size_t blockData = sizeof(SnapshotBlock::data);
+    CHECK_EQ(s.held, (s.len + blockData - 1) / blockData * sizeof(SnapshotBlock)); // content and one partly filled block
+    CHECK_EQ(s.peak, s.held);                             // no realloc: nothing held twice
+    CHECK_EQ(s.copied, 0);
+    if (s.len > 4096) {
+      CHECK(s.peak < m.peak);                             // below the exact growth of AsyncResponseStream
+      CHECK(m.copied > 4 * s.len);                        // exact growth copies O(n^2)
+      CHECK(regen > 2 * s.len);                           // regeneration per chunk generates O(n^2)
+    }
+    printf("%3u/%-4u %8zu | %6zu %6zu %8zu | %6zu %6zu %8zu | %zu\n", sz[0], sz[1], s.len,
+           s.peak, s.held, s.copied, m.peak, m.held, m.copied, regen);
+  }
+
+  // client disconnects in the middle of the transfer: snapshot is freed with the response
+  {
+    StringPrint ref;
+    settingsScript(ref, 36, 20);
+    testHeapUsed = 0;
+    SnapshotPrint snap;
+    settingsScript(snap, 36, 20);
+    const size_t len = snap.length();
+    AsyncWebServerResponse *response = beginSnapshotResponse(&request, "application/javascript", snap);
+    const std::string part = sink(response, len / 3);
+    CHECK(part.size() < len && ref.s.compare(0, part.size(), part) == 0);
+    CHECK(testHeapUsed > 0);
+    delete response;
+    CHECK_EQ(testHeapUsed, 0);
+  }
+
+  // concurrent requests share nothing: each response owns its snapshot
+  {
+    testHeapUsed = 0;
+    SnapshotPrint a, b;
+    settingsScript(a, 4, 0);
+    settingsScript(b, 20, 3);
+    AsyncWebServerResponse *ra = beginSnapshotResponse(&request, "application/javascript", a);
+    AsyncWebServerResponse *rb = beginSnapshotResponse(&request, "application/javascript", b);
+    StringPrint refA, refB;
+    settingsScript(refA, 4, 0);
+    settingsScript(refB, 20, 3);
+    delete ra;
+    CHECK(sink(rb) == refB.s);
+    delete rb;
+    CHECK_EQ(testHeapUsed, 0);
+  }
+
+  // full heap: generation fails cleanly, nothing leaks (serveSettingsJS() answers 503)
+  {
+    testHeapUsed = 0;
+    testHeapLimit = 4000;
+    SnapshotPrint snap;
+    settingsScript(snap, 36, 20);
+    CHECK(snap.failed());
+    CHECK(snap.length() <= testHeapLimit);
+    CHECK_EQ(snap.write((const uint8_t*)"x", 1), 0);   // stays failed
+    testHeapLimit = SIZE_MAX;
+  }
+  CHECK_EQ(testHeapUsed, 0);
+
+  // content is requested again from an earlier position (and across block boundaries in odd sizes)
+  {
+    StringPrint ref;
+    settingsScript(ref, 10, 5);
+    SnapshotPrint snap;
+    settingsScript(snap, 10, 5);
+    AsyncWebServerResponse *response = beginSnapshotResponse(&request, "application/javascript", snap);
+    uint8_t window[1500];
+    for (unsigned i = 0; i < 200; i++) {
+      const size_t index = testRandom(ref.s.size()), maxLen = 1 + testRandom(sizeof(window));
+      const size_t n = response->filler(window, maxLen, index);
+      CHECK_EQ(n, min(maxLen, ref.s.size() - index));
+      CHECK(ref.s.compare(index, n, std::string((const char*)window, n)) == 0);
+    }
+    delete response;
+    CHECK_EQ(testHeapUsed, 0);
+  }
+
+  return testResult("snapshot");
+}
@@ -0,0 +1,239 @@
+/*
+ * Scrolling text: pre-rasterized bitmap (rasterizeText()/drawText()) against drawCharacter() per letter
+ * Every font, rotation and gradient mode is drawn at scroll positions covering partly visible text, the output has to
+ * be identical to the per character path of mode_2Dscrollingtext(). Also covers UTF-8/Latin-1 input, proportional
+ * spacing and the bitmap cache, and times a frame of both paths on matrices of different width.
+ */
+#include "native_test.h"
+
+typedef uint8_t byte;
+#define RGBW32(r,g,b,w) (uint32_t((uint8_t)(w) << 24 | (uint8_t)(r) << 16 | (uint8_t)(g) << 8 | (uint8_t)(b)))
+#define pgm_read_byte_near(p) (*(const uint8_t *)(p))
+#define LINEARBLEND_NOWRAP 2
+#define WLED_MAX_SEGNAME_LEN 64
+
+struct CRGB {
+  uint8_t r = 0, g = 0, b = 0;
+  CRGB() = default;
+  CRGB(uint32_t c) : r(c >> 16), g(c >> 8), b(c) {}
+};
+struct CRGBW {
+  uint32_t color32;
+  CRGBW(CRGB c) : color32(RGBW32(c.r, c.g, c.b, 0)) {}
+};
+struct CRGBPalette16 {
+  CRGB entries[16];
+  CRGBPalette16() = default;
+  CRGBPalette16(CRGB a, CRGB b) { // gradient
+    for (int i = 0; i < 16; i++) entries[i] = RGBW32(a.r + (b.r - a.r) * i / 15, a.g + (b.g - a.g) * i / 15, a.b + (b.b - a.b) * i / 15, 0);
+  }
+};
+static CRGB ColorFromPalette(const CRGBPalette16 &pal, uint8_t index, uint8_t, int) {
+  const CRGB &a = pal.entries[index >> 4], &b = pal.entries[min(15, (index >> 4) + 1)];
+  const int f = index & 15;
+  return RGBW32(a.r + (b.r - a.r) * f / 16, a.g + (b.g - a.g) * f / 16, a.b + (b.b - a.b) * f / 16, 0);
+}
+
+// as in FX.h
+typedef struct TextRaster {
+  uint32_t hash;
+  uint16_t width;
+  uint16_t rowBytes;
+  uint8_t  height;
+  uint8_t  glyphH;
+  int8_t   rotate;
+  uint8_t  bits[];
+} textRaster;
+
+#define SEGPALETTE Segment::getCurrentPalette()
+class Segment {
+  public:
+    static unsigned      _vWidth, _vHeight;
+    static CRGBPalette16 _currentPalette;
+    mutable std::vector<uint32_t> pixels;
+    mutable unsigned outside = 0;
+
+    void setSize(unsigned w, unsigned h) { _vWidth = w; _vHeight = h; pixels.assign(w * h, 0); }
+    void clear() { std::fill(pixels.begin(), pixels.end(), 0); }
+    bool isActive() const { return true; }
+    static unsigned vWidth()  { return _vWidth; }
+    static unsigned vHeight() { return _vHeight; }
+    static const CRGBPalette16 &getCurrentPalette() { return _currentPalette; }
+    void setPixelColorXYRaw(unsigned x, unsigned y, uint32_t c) const {
+      if (x >= _vWidth || y >= _vHeight) { outside++; return; }
+      pixels[x + y * _vWidth] = c;
+    }
+    void drawCharacter(unsigned char chr, int16_t x, int16_t y, uint8_t w, uint8_t h, uint32_t color, uint32_t col2 = 0, int8_t rotate = 0) const;
+    static size_t textRasterSize(size_t chars, uint8_t w, uint8_t h, int8_t rotate);
+    static bool rasterizeText(textRaster *t, size_t size, const char *text, uint8_t w, uint8_t h, int8_t rotate, bool proportional);
+    void drawText(const textRaster *t, int x, int y, uint32_t color, uint32_t col2 = 0) const;
+};
+unsigned      Segment::_vWidth = 0, Segment::_vHeight = 0;
+CRGBPalette16 Segment::_currentPalette;
+
+#include "../../wled00/FX_text.cpp"
+
+static const uint8_t fonts[5][2] = {{4, 6}, {5, 8}, {6, 8}, {7, 9}, {5, 12}};
+static Segment seg;
+
+// text raster in segment data as mode_2Dscrollingtext() allocates it
+struct Raster {
+  std::vector<uint8_t> data;
+  size_t size;
+  Raster(uint8_t w, uint8_t h, int8_t rotate) : size(Segment::textRasterSize(WLED_MAX_SEGNAME_LEN, w, h, rotate)) { data.assign(size, 0); }
+  textRaster *get() { return reinterpret_cast<textRaster*>(data.data()); }
+};
+
+// per character path of mode_2Dscrollingtext()
+static void drawLetters(const char *text, int x, int y, uint8_t w, uint8_t h, int8_t rotate, uint32_t col1, uint32_t col2) {
+  const int rotLW = (rotate == 1 || rotate == -1) ? h : w;
+  for (int i = 0; text[i]; i++) {
+    const int xoffset = x + rotLW * i;
+    if (xoffset + rotLW < 0) continue;
+    seg.drawCharacter(text[i], xoffset, y, w, h, col1, col2, rotate);
+  }
+}
+
+static bool sameBits(const textRaster *a, const textRaster *b) {
+  return a->width == b->width && a->height == b->height && a->rowBytes == b->rowBytes &&
+         !memcmp(a->bits, b->bits, a->rowBytes * a->height);
+}
+
+static unsigned setBits(const textRaster *t) {
+  unsigned n = 0;
+  for (unsigned i = 0; i < unsigned(t->rowBytes * t->height); i++) n += __builtin_popcount(t->bits[i]);
+  return n;
+}
+
+static void identicalOutput() {
+  const char *texts[] = {
+    " !\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_",
+    "`abcdefghijklmnopqrstuvwxyz{|}~ 12:34:56 16.10.2026",
+    "^^ Way out ^^",
+    "W",
+  };
+  const int8_t rotations[] = {-2, -1, 0, 1, 2};
+  const unsigned dims[][2] = {{64, 16}, {16, 32}, {32, 8}};
+  const uint32_t pal1 = RGBW32(255, 0, 0, 0), pal2 = RGBW32(0, 0, 255, 0);
+  for (int i = 0; i < 16; i++) Segment::_currentPalette.entries[i] = RGBW32(i * 16, 255 - i * 16, 64, 0);
+
+  unsigned frames = 0, mismatches = 0;
+  std::vector<uint32_t> expected;
+  for (auto &dim : dims) {
+    seg.setSize(dim[0], dim[1]);
+    const int cols = dim[0], rows = dim[1];
+    for (auto &font : fonts) for (int8_t rotate : rotations) for (const char *text : texts) {
+      Raster r(font[0], font[1], rotate);
+      CHECK(Segment::rasterizeText(r.get(), r.size, text, font[0], font[1], rotate, false));
+      const int rotLW = (rotate == 1 || rotate == -1) ? font[1] : font[0];
+      const int rotLH = (rotate == 1 || rotate == -1) ? font[0] : font[1];
+      const int width = strlen(text) * rotLW;
+      CHECK_EQ(r.get()->width, width);
+      for (int aux0 = 0; aux0 < width + cols; aux0 += 1 + testRandom(5)) {
+        const int x = cols - aux0;
+        const int y = (rows - rotLH) / 2 + int(testRandom(rows)) - rows / 2; // Y offset slider, may clip
+        const uint32_t colors[][2] = {{pal1, pal1}, {pal1, pal2}, {pal1, 0}};  // single color, gradient, palette
+        const auto &c = colors[testRandom(3)];
+        seg.clear();
+        drawLetters(text, x, y, font[0], font[1], rotate, c[0], c[1]);
+        expected = seg.pixels;
+        seg.clear();
+        seg.drawText(r.get(), x, y, c[0], c[1]);
+        mismatches += seg.pixels != expected;
+        frames++;
+      }
+    }
+  }
+  CHECK_EQ(mismatches, 0);
+  CHECK_EQ(seg.outside, 0);
+  printf("identical output: %u frames (5 fonts, 5 rotations, 3 matrices, clipped positions)\n", frames);
+}
+
+static void textInput() {
+  // UTF-8 and Latin-1 are transliterated (fonts are ASCII only)
+  Raster a(5, 8, 0), b(5, 8, 0);
+  auto same = [&](const char *x, const char *y) {
+    a.get()->hash = b.get()->hash = 0;
+    return Segment::rasterizeText(a.get(), a.size, x, 5, 8, 0, false) &&
+           Segment::rasterizeText(b.get(), b.size, y, 5, 8, 0, false) && sameBits(a.get(), b.get());
+  };
+  CHECK(same("Gr\xC3\xBC\xC3\x9F" "e 21.5\xC2\xB0" "C", "Gruse 21.5oC")); // UTF-8
+  CHECK(same("Gr\xFC\xDF" "e 21.5\xB0" "C", "Gruse 21.5oC"));             // Latin-1
+  CHECK(same("\xC3\x80\xC3\xA9\xC3\xB1\xC3\xBF", "Aeny"));
+  CHECK(same("5 \xE2\x82\xAC", "5 ?"));                                     // other code points (euro sign)
+  CHECK(same("\xF0\x9F\x98\x80!", "?!"));                                   // 4 byte sequence (emoji)
+  CHECK(same("a\xC2\x85" "b\x01" "c\x7F", "abc"));                          // control characters are not drawn
+  CHECK(same("caf\xC3", "cafA"));                                           // cut off sequence: Latin-1
+  CHECK(same("", ""));
+  CHECK_EQ(a.get()->width, 0);
+
+  // proportional spacing: narrow glyphs take less room, no pixel is lost, not applied to sideways text
+  for (auto &font : fonts) {
+    Raster fixed(font[0], font[1], 0), prop(font[0], font[1], 0);
+    const char *text = "Wil lim 1.5 mmm";
+    CHECK(Segment::rasterizeText(fixed.get(), fixed.size, text, font[0], font[1], 0, false));
+    CHECK(Segment::rasterizeText(prop.get(), prop.size, text, font[0], font[1], 0, true));
+    CHECK(prop.get()->width < fixed.get()->width);
+    CHECK_EQ(setBits(prop.get()), setBits(fixed.get()));
+    Raster ii(font[0], font[1], 0), mm(font[0], font[1], 0);
+    Segment::rasterizeText(ii.get(), ii.size, "iiii", font[0], font[1], 0, true);
+    Segment::rasterizeText(mm.get(), mm.size, "mmmm", font[0], font[1], 0, true);
+    CHECK(ii.get()->width < mm.get()->width);
+    Raster side(font[0], font[1], 1), sideProp(font[0], font[1], 1);
+    Segment::rasterizeText(side.get(), side.size, text, font[0], font[1], 1, false);
+    Segment::rasterizeText(sideProp.get(), sideProp.size, text, font[0], font[1], 1, true);
+    CHECK(sameBits(side.get(), sideProp.get()));
+  }
+
+  // full name with proportional glyphs (up to w+1 wide) fits the allocated size, too small a buffer is refused
+  for (auto &font : fonts) for (int8_t rotate : {-1, 0, 2}) {
+    Raster r(font[0], font[1], rotate);
+    const std::string full(WLED_MAX_SEGNAME_LEN, 'W');
+    CHECK(Segment::rasterizeText(r.get(), r.size, full.c_str(), font[0], font[1], rotate, true));
+    CHECK(!Segment::rasterizeText(r.get(), r.size - 1, (full + "x").c_str(), font[0], font[1], rotate, true));
+  }
+  CHECK(!Segment::rasterizeText(a.get(), a.size, "abc", 3, 3, 0, false)); // no such font
+
+  // bitmap is only rebuilt if text or parameters change
+  Raster c(6, 8, 0);
+  CHECK(Segment::rasterizeText(c.get(), c.size, "cached", 6, 8, 0, false));
+  const uint8_t marked = c.get()->bits[0] ^= 0xFF; // would be overwritten by a rebuild
+  CHECK(Segment::rasterizeText(c.get(), c.size, "cached", 6, 8, 0, false));
+  CHECK_EQ(c.get()->bits[0], marked);
+  CHECK(Segment::rasterizeText(c.get(), c.size, "cached", 6, 8, 0, true)); // spacing changed
+  CHECK(c.get()->bits[0] != marked);
+}
+
+// one frame of the effect's drawing for both paths, text scrolls across the whole width
+static void benchmark(unsigned cols, unsigned rows, const char *text, uint8_t w, uint8_t h) {
+  seg.setSize(cols, rows);
+  Raster r(w, h, 0);
+  const int width = strlen(text) * w;
+  const unsigned frames = 20000;
+  const uint32_t c1 = RGBW32(255, 128, 0, 0), c2 = RGBW32(0, 64, 255, 0);
+  double best[2] = {1e9, 1e9};
+  for (int rep = 0; rep < 3; rep++) {
+    double t0 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) drawLetters(text, int(cols) - int(f % (width + cols)), (rows - h) / 2, w, h, 0, c1, c2);
+    best[0] = min(best[0], (benchSeconds() - t0) / frames);
+    t0 = benchSeconds();
+    for (unsigned f = 0; f < frames; f++) {
+      Segment::rasterizeText(r.get(), r.size, text, w, h, 0, false); // cached after the first frame
+      seg.drawText(r.get(), int(cols) - int(f % (width + cols)), (rows - h) / 2, c1, c2);
+    }
+    best[1] = min(best[1], (benchSeconds() - t0) / frames);
+  }
+  CHECK(best[1] < best[0]);
+  printf("%3ux%-3u %2zu chars %ux%u: drawCharacter %6.2f us, bitmap %5.2f us per frame (%.1fx)\n",
+         cols, rows, strlen(text), w, h, best[0] * 1e6, best[1] * 1e6, best[0] / best[1]);
+}
+
+int main() {
+  identicalOutput();
+  textInput();
+  benchmark(32, 8, "12:34", 4, 6);
+  benchmark(64, 16, "12:34:56 Mon 16.10.2026 21.5oC", 5, 8);
+  benchmark(128, 16, "12:34:56 Monday 16. October 2026 - 21.5oC 45% humidity", 6, 8);
+  benchmark(256, 32, "12:34:56 Monday 16. October 2026 - 21.5oC 45% humidity", 7, 9);
+  return testResult("text");
+}
@@ -0,0 +1,122 @@
+/*
+ * Two instances of timesync.cpp exchanging packets over a simulated lossy WiFi link
+ * Node A is the reference, node B polls it. The clocks have different offsets and rates (crystal tolerance),
+ * one direction suffers from random queueing delays. B's effect clock has to follow A's within 5 ms from lock on
+ * and within 2 ms (timebase resolution plus estimation error) once the skew estimate has settled.
+ */
+#include "native_test.h"
+
+#define TIMESYNC_MAGIC 14
+
+static int64_t simUs = 0; // true time
+
+struct Packet { int64_t at; int to; IPAddress from; std::vector<uint8_t> data; };
+static std::deque<Packet> air;
+static bool linkUp = true;
+static unsigned sent = 0, lost = 0;
+
+static const IPAddress ipOf[2] = { IPAddress(10,0,0,1), IPAddress(10,0,0,2) };
+
+class MockUdp {
+  public:
+    explicit MockUdp(int self) : _self(self) {}
+    int beginPacket(IPAddress ip, uint16_t) { _to = ip == ipOf[0] ? 0 : 1; _buf.clear(); return 1; }
+    size_t write(const uint8_t *d, size_t n) { _buf.insert(_buf.end(), d, d + n); return n; }
+    int endPacket() {
+      sent++;
+      if (!linkUp || testRandom(100) < 5) { lost++; return 1; } // 5% loss
+      int64_t delay = 800 + testRandom(400);                     // air time and stack
+      if (_self == 0 && testRandom(100) < 40) delay += testRandom(25000); // congested downlink
+      air.push_back({simUs + delay, _to, ipOf[_self], _buf});
+      return 1;
+    }
+  private:
+    int _self, _to = 0;
+    std::vector<uint8_t> _buf;
+};
+
+struct MockStrip { uint32_t timebase = 0; };
+
+#define NODE_ENV(IDX, OFFSET_US, PPM) \
+  static int64_t esp_timer_get_time() { return (int64_t)((double)simUs * (1.0 + (PPM) * 1e-6)) + (OFFSET_US); } \
+  static uint32_t millis() { return esp_timer_get_time() / 1000; } \
+  static MockUdp notifierUdp(IDX); \
+  static MockStrip strip; \
+  static uint16_t udpPort = 21324; \
+  static bool udpConnected = true;
+
+namespace nodeA {
+  NODE_ENV(0, 3700000123LL, -40)
+  #include "../../wled00/timesync.cpp"
+}
+namespace nodeB {
+  NODE_ENV(1, 17000456LL, 160)
+  #include "../../wled00/timesync.cpp"
+}
+
+static void deliver(int64_t until) {
+  // packets may overtake each other, deliver in time order
+  std::stable_sort(air.begin(), air.end(), [](const Packet &a, const Packet &b) { return a.at < b.at; });
+  while (!air.empty() && air.front().at <= until) {
+    Packet p = air.front();
+    air.pop_front();
+    simUs = p.at;
+    if (p.to == 0) nodeA::handleTimeSyncPacket(p.data.data(), p.data.size(), p.from, nodeA::timeSyncClock());
+    else           nodeB::handleTimeSyncPacket(p.data.data(), p.data.size(), p.from, nodeB::timeSyncClock());
+  }
+}
+
+// effect clock (strip.now = millis() + timebase, modulo 2^32) difference B - A in us
+static int32_t stripDiffUs() {
+  const int32_t ms = (int32_t)((nodeB::millis() + nodeB::strip.timebase) - (nodeA::millis() + nodeA::strip.timebase));
+  return ms * 1000 + (int32_t)(nodeB::timeSyncClock() % 1000) - (int32_t)(nodeA::timeSyncClock() % 1000);
+}
+
+int main() {
+  nodeA::strip.timebase = 0xDEADBEEF; // arbitrary effect phase on the reference
+  nodeB::timeSyncReference(ipOf[0]);   // B applied a notification from A
+
+  const IPAddress none;
+  CHECK(!nodeB::timeSyncLocked(ipOf[0]));
+
+  int64_t lockedAt = -1;
+  int32_t worst = 0, worstSettled = 0;
+  unsigned jumps = 0;
+  uint32_t lastBase = nodeB::strip.timebase;
+  for (int64_t t = 0; t < 180000000LL; t += 1000) {
+    deliver(t);
+    simUs = t;
+    nodeA::handleTimeSync(); // no reference, must not send anything
+    nodeB::handleTimeSync();
+    if (lockedAt < 0 && nodeB::timeSyncLocked(ipOf[0])) lockedAt = t;
+    if (lockedAt >= 0 && t > lockedAt && t < 150000000LL) {
+      worst = max(worst, abs(stripDiffUs()));
+      if (t > lockedAt + 60000000LL) worstSettled = max(worstSettled, abs(stripDiffUs()));
+      // once acquired the timebase is only slewed (<= 1 ms per 20 ms), never stepped
+      if (t > lockedAt + 1000000LL && abs((int32_t)(nodeB::strip.timebase - lastBase)) > 1) jumps++;
+    }
+    lastBase = nodeB::strip.timebase;
+    if (t == 150000000LL) {
+      StaticJsonDocument<512> doc;
+      nodeB::serializeTimeSync(doc.to<JsonObject>());
+      const float expect = ((1.0 - 40e-6) / (1.0 + 160e-6) - 1.0) * 1e6; // ~ -200 ppm
+      CHECK(doc["tsync"]["lock"].as<bool>());
+      CHECK(doc["tsync"]["ref"] == "10.0.0.1");
+      CHECK_NEAR(doc["tsync"]["skew"].as<float>(), expect, 40);
+      CHECK(doc["tsync"]["rej"].as<int>() > 0); // congested samples were filtered
+      linkUp = false;                            // reference vanishes
+    }
+  }
+
+  CHECK(lockedAt >= 0);
+  CHECK(lockedAt < 10000000LL); // four samples at fast poll rate (with some loss)
+  CHECK(worst <= 5000);
+  CHECK(worstSettled <= 2000);
+  CHECK_EQ(jumps, 0);
+  CHECK(sent > 40 && lost > 0);
+  CHECK(!nodeB::timeSyncLocked(ipOf[0])); // lost after TIMESYNC_TIMEOUT without replies
+  CHECK(!nodeA::timeSyncLocked(none));
+  printf("locked after %lld ms, worst error %d us (settled %d us), %u/%u packets lost\n",
+    (long long)lockedAt / 1000, worst, worstSettled, lost, sent);
+  return testResult("timesync");
+}
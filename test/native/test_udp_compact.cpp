@@ -0,0 +1,318 @@
+/*
+ * Compact sync (udp_compact.cpp): v13 encoder/decoder round trip and bytes per update against plain v12 packets
+ * A session of UI changes (brightness and color drags, effect and slider changes on all segments, segments added and
+ * removed, presets) is turned into v12 images as notify() builds them, including the timebase and system time that
+ * change with every packet, and sent with one retransmission each. Every image the receiver rebuilds has to equal the
+ * sender's, also with packets lost (the receiver requests a keyframe) and with a second sender; truncated or
+ * malformed deltas must never be applied.
+ */
+#include "native_test.h"
+#include "IPAddress.h"
+
+using std::min;
+
+static unsigned long nowMs = 0;
+static unsigned long millis() { return nowMs; }
+
+// as in FX.h and const.h (ESP32)
+struct WS2812FX {
+  static constexpr unsigned getMaxSegments() { return 32; }
+};
+#define UDP_COMPACT_MAGIC 13
+
+#include "../../wled00/udp_compact.h"
+#include "../../wled00/udp_compact.cpp"
+
+struct Seg {
+  uint16_t start, stop;
+  uint8_t mode = 0, speed = 128, intensity = 128, palette = 0, opacity = 255, cct = 127;
+  uint8_t custom1 = 128, custom2 = 128, custom3 = 16;
+  uint16_t options = 0x04; // on
+  uint32_t colors[3] = { 0xFFA000, 0, 0 };
+};
+
+static struct {
+  uint8_t bri = 128, callMode = 1, nightlight = 0, syncGroups = 1;
+  uint16_t transitionDelay = 700;
+  uint32_t timebase = 0;
+  std::vector<Seg> segs;
+} state;
+
+// v12 image as built by notify(), returns used length
+static size_t buildImage(uint8_t *out, bool followUp) {
+  memset(out, 0xEE, WLEDPACKETSIZE); // unused part is not initialised either
+  const Seg &main = state.segs[0];
+  auto col = [&](size_t ofs, uint32_t c) { out[ofs] = c >> 16; out[ofs+1] = c >> 8; out[ofs+2] = c; out[ofs+3] = c >> 24; };
+  out[0] = 0; out[1] = state.callMode; out[2] = state.bri;
+  out[3] = main.colors[0] >> 16; out[4] = main.colors[0] >> 8; out[5] = main.colors[0];
+  out[6] = state.nightlight; out[7] = 60; out[8] = main.mode; out[9] = main.speed; out[10] = main.colors[0] >> 24;
+  out[11] = 13;
+  col(12, main.colors[1]);
+  out[16] = main.intensity;
+  out[17] = state.transitionDelay; out[18] = state.transitionDelay >> 8;
+  out[19] = main.palette;
+  col(20, main.colors[2]);
+  out[24] = followUp;
+  const uint32_t t = millis() + state.timebase;
+  out[25] = t >> 24; out[26] = t >> 16; out[27] = t >> 8; out[28] = t;
+  const uint32_t sec = 1760000000 + millis() / 1000;
+  const uint16_t ms = millis() % 1000;
+  out[29] = 1;
+  out[30] = sec >> 24; out[31] = sec >> 16; out[32] = sec >> 8; out[33] = sec;
+  out[34] = ms >> 8; out[35] = ms;
+  out[36] = state.syncGroups;
+  out[37] = 255; out[38] = main.cct;
+  out[39] = state.segs.size();
+  out[40] = UDP_SEG_SIZE;
+  for (size_t s = 0; s < state.segs.size(); s++) {
+    const Seg &g = state.segs[s];
+    const size_t ofs = SEG_OFFSET + s*UDP_SEG_SIZE;
+    out[ofs] = s;
+    out[ofs+1] = g.start >> 8; out[ofs+2] = g.start; out[ofs+3] = g.stop >> 8; out[ofs+4] = g.stop;
+    out[ofs+5] = 1; out[ofs+6] = 0; out[ofs+7] = 0; out[ofs+8] = 0;
+    out[ofs+9] = g.options & 0x8F; out[ofs+10] = g.opacity;
+    out[ofs+11] = g.mode; out[ofs+12] = g.speed; out[ofs+13] = g.intensity; out[ofs+14] = g.palette;
+    col(ofs+15, g.colors[0]); col(ofs+19, g.colors[1]); col(ofs+23, g.colors[2]);
+    out[ofs+27] = g.cct; out[ofs+28] = g.options >> 8;
+    out[ofs+29] = g.custom1; out[ofs+30] = g.custom2; out[ofs+31] = g.custom3;
+    out[ofs+32] = 0; out[ofs+33] = 0; out[ofs+34] = 0; out[ofs+35] = 1;
+  }
+  return SEG_OFFSET + state.segs.size()*UDP_SEG_SIZE;
+}
+
+struct Link {
+  CompactSyncEncoder tx;
+  CompactSyncDecoder rx;
+  IPAddress ip = IPAddress(192, 168, 1, 10);
+  unsigned lossPct = 0;
+  uint64_t v12Bytes = 0, v13Bytes = 0;
+  unsigned updates = 0, packets = 0, keyframes = 0, maxDeltasBetweenKeys = 0, deltasSinceKey = 0;
+  unsigned lost = 0, nacks = 0, applied = 0, mismatches = 0, outOfSync = 0, maxOutOfSyncMs = 0;
+  size_t maxPacket = 0;
+  unsigned long lostSince = 0, nackTime = 0;
+  bool inSync = false;
+};
+
+static uint8_t udpOut[41 + 32*UDP_SEG_SIZE];
+static uint8_t sentImg[41 + 32*UDP_SEG_SIZE]; // image of the first transmission, a retransmission carries it again
+
+// sends one packet of notify() and delivers it unless lost, returns true if the receiver sent a NACK that arrived
+static bool sendPacket(Link &l, bool followUp) {
+  const size_t len = buildImage(udpOut, followUp);
+  size_t pktLen = 0;
+  const uint8_t *pkt = l.tx.encode(udpOut, len, followUp, state.syncGroups, pktLen);
+  CHECK(pkt != nullptr);
+  if (!followUp) memcpy(sentImg, udpOut, len);
+  CHECK(pktLen <= UDP_COMPACT_MAXSIZE);
+  CHECK(pktLen <= UDP_COMPACT_HDR + len);
+  l.maxPacket = std::max(l.maxPacket, pktLen);
+  l.v12Bytes += len;
+  l.v13Bytes += pktLen;
+  l.packets++;
+  if (!followUp) {
+    if (pkt[1] & UDP_COMPACT_KEY) { l.keyframes++; l.deltasSinceKey = 0; }
+    else l.maxDeltasBetweenKeys = std::max(l.maxDeltasBetweenKeys, ++l.deltasSinceKey);
+  }
+  if (l.lossPct && testRandom(100) < l.lossPct) { l.lost++; return false; }
+  switch (l.rx.decode(pkt, pktLen, l.ip)) {
+    case CompactSyncDecoder::Applied:
+      l.applied++;
+      // receivers apply the image like a v12 packet: used part equals the sender's, the rest is cleared
+      if (memcmp(l.rx.image(), sentImg, len) || l.rx.image()[WLEDPACKETSIZE - 1] != 0) l.mismatches++;
+      if (!l.inSync && l.lostSince) l.maxOutOfSyncMs = std::max<unsigned>(l.maxOutOfSyncMs, millis() - l.lostSince);
+      l.inSync = true;
+      return false;
+    case CompactSyncDecoder::Lost:
+      if (l.inSync) { l.outOfSync++; l.lostSince = millis(); }
+      l.inSync = false;
+      // requestSyncKeyframe(): at most one NACK per second, it may be lost as well
+      if (millis() - l.nackTime < 1000) return false;
+      l.nackTime = millis();
+      l.nacks++;
+      if (l.lossPct && testRandom(100) < l.lossPct) return false;
+      l.tx.requestKeyframe();
+      return true;
+    default:
+      return false;
+  }
+}
+
+// notify() with one retransmission (udpNumRetries 1) 250 ms later, as handleNotifications() sends it; a NACK is
+// answered with the current state 100 ms after the last packet
+static void notifyUpdate(Link &l) {
+  l.updates++;
+  bool nack = sendPacket(l, false);
+  nowMs += 250;
+  nack |= sendPacket(l, true);
+  while (nack) {
+    nowMs += 100;
+    nack = sendPacket(l, false);
+  }
+}
+
+// a user session: slider and color drags on the main segment, changes of all segments, segments added and removed
+static void session(Link &l, unsigned rounds) {
+  for (unsigned r = 0; r < rounds; r++) {
+    for (int i = 0; i < 20; i++) { state.bri = 20 + i * 10 + testRandom(5); notifyUpdate(l); nowMs += 100; }
+    for (int i = 0; i < 20; i++) { state.segs[0].colors[0] = (testRandom(256) << 16) | (testRandom(256) << 8) | testRandom(256); notifyUpdate(l); nowMs += 100; }
+    for (int i = 0; i < 5; i++) { const uint8_t fx = testRandom(180); for (auto &g : state.segs) g.mode = fx; notifyUpdate(l); nowMs += 2000; }
+    for (int i = 0; i < 15; i++) { for (auto &g : state.segs) g.speed = 50 + i * 10; notifyUpdate(l); nowMs += 100; }
+    for (int i = 0; i < 10; i++) { state.segs[testRandom(state.segs.size())].intensity = testRandom(256); notifyUpdate(l); nowMs += 300; }
+    if (state.segs.size() < 6) {
+      Seg g; g.start = state.segs.back().stop; g.stop = g.start + 60; state.segs.push_back(g);
+    } else state.segs.pop_back();
+    notifyUpdate(l);
+    // preset: everything changes
+    for (auto &g : state.segs) { g.mode = testRandom(180); g.palette = testRandom(70); g.colors[0] = testRandom(0xFFFFFF); g.colors[1] = testRandom(0xFFFFFF); g.custom1 = testRandom(256); }
+    state.callMode = 6; notifyUpdate(l); state.callMode = 1;
+    nowMs += 5000;
+  }
+}
+
+static void resetState() {
+  state.segs.clear();
+  for (uint16_t s = 0; s < 3; s++) { Seg g; g.start = s * 100; g.stop = g.start + 100; state.segs.push_back(g); }
+  state.bri = 128;
+}
+
+int main() {
+  nowMs = 100000;
+
+  // loss free: every packet applied and exact, deltas between keyframes bounded
+  Link clean;
+  resetState();
+  session(clean, 40);
+  CHECK_EQ(clean.mismatches, 0);
+  CHECK_EQ(clean.nacks, 0);
+  CHECK_EQ(clean.applied, clean.updates); // retransmissions are dropped by sequence number
+  CHECK_EQ(clean.packets, 2 * clean.updates);
+  CHECK(clean.maxDeltasBetweenKeys <= UDP_KEYFRAME_DELTAS);
+  CHECK(clean.v13Bytes * 100 < clean.v12Bytes * 50);
+  printf("%u updates, %u packets: %llu bytes v12, %llu bytes v13 (%.1f%%), %.1f / %.1f bytes per packet, %u keyframes, max %zu bytes\n",
+         clean.updates, clean.packets, (unsigned long long)clean.v12Bytes, (unsigned long long)clean.v13Bytes, 100.0 * clean.v13Bytes / clean.v12Bytes,
+         double(clean.v12Bytes) / clean.packets, double(clean.v13Bytes) / clean.packets, clean.keyframes, clean.maxPacket);
+
+  // per kind of change (one update, no retransmission): bytes of a delta against the plain packet
+  {
+    Link l;
+    resetState();
+    size_t len, pktLen;
+    auto send = [&](const char *what) {
+      nowMs += 100;
+      len = buildImage(udpOut, false);
+      const uint8_t *pkt = l.tx.encode(udpOut, len, false, 1, pktLen);
+      CHECK(l.rx.decode(pkt, pktLen, l.ip) == CompactSyncDecoder::Applied);
+      CHECK(!memcmp(l.rx.image(), udpOut, len));
+      if (what) printf("  %-32s %3zu bytes v12, %3zu bytes v13%s\n", what, len, pktLen, (pkt[1] & UDP_COMPACT_KEY) ? " (keyframe)" : "");
+      return pktLen;
+    };
+    send(nullptr);
+    CHECK(send("nothing but time") < 30);
+    state.bri = 10;
+    CHECK(send("brightness") < 30);
+    state.segs[0].colors[0] = 0x123456;
+    CHECK(send("main segment color") < 40);
+    for (auto &g : state.segs) g.mode = 42;
+    CHECK(send("effect of 3 segments") < 45);
+    Seg g; g.start = 300; g.stop = 360; state.segs.push_back(g);
+    CHECK(send("segment added") < 70);
+    state.segs.pop_back();
+    CHECK(send("segment removed") < 30);
+    for (auto &g : state.segs) for (auto &c : g.colors) c = testRandom(0xFFFFFF);
+    send("all colors of 3 segments");
+  }
+
+  // 5% and 20% loss: never a wrong image, back in sync with the next keyframe
+  for (unsigned loss : { 5U, 20U }) {
+    Link lossy;
+    lossy.lossPct = loss;
+    resetState();
+    session(lossy, 40);
+    CHECK_EQ(lossy.mismatches, 0);
+    CHECK(lossy.outOfSync > 0);
+    CHECK(lossy.rx.getGaps() > 0);
+    CHECK(lossy.maxOutOfSyncMs <= UDP_KEYFRAME_MS);
+    CHECK(lossy.v13Bytes * 100 < lossy.v12Bytes * 60);
+    printf("%u%% loss: %u of %u packets lost, %u times out of sync (at most %u ms), %u NACKs, %u keyframes, %llu bytes v13 (%.1f%% of v12)\n",
+           loss, lossy.lost, lossy.packets, lossy.outOfSync, lossy.maxOutOfSyncMs, lossy.nacks, lossy.keyframes,
+           (unsigned long long)lossy.v13Bytes, 100.0 * lossy.v13Bytes / lossy.v12Bytes);
+  }
+
+  // a second sender's delta is not applied to the first sender's image, its keyframe is
+  {
+    Link a, b;
+    b.ip = IPAddress(192, 168, 1, 11);
+    resetState();
+    size_t len, pktLen;
+    len = buildImage(udpOut, false);
+    const uint8_t *pkt = a.tx.encode(udpOut, len, false, 1, pktLen);
+    CHECK(a.rx.decode(pkt, pktLen, a.ip) == CompactSyncDecoder::Applied);
+    CHECK(a.rx.isFollowing(a.ip));
+    pkt = b.tx.encode(udpOut, len, false, 1, pktLen);
+    nowMs += 100; state.bri = 1;
+    len = buildImage(udpOut, false);
+    pkt = b.tx.encode(udpOut, len, false, 1, pktLen);
+    CHECK(!(pkt[1] & UDP_COMPACT_KEY));
+    CHECK(a.rx.decode(pkt, pktLen, b.ip) == CompactSyncDecoder::Lost);
+    CHECK(!a.rx.isFollowing(a.ip));
+    b.tx.requestKeyframe();
+    pkt = b.tx.encode(udpOut, len, false, 1, pktLen);
+    CHECK(a.rx.decode(pkt, pktLen, b.ip) == CompactSyncDecoder::Applied);
+    CHECK(!memcmp(a.rx.image(), udpOut, len));
+    CHECK(a.rx.isFollowing(b.ip));
+    nowMs += 2 * UDP_KEYFRAME_MS + 1;
+    CHECK(!a.rx.isFollowing(b.ip)); // plain packets of b are applied again
+  }
+
+  // deltas truncated within a record or with a segment index out of range are never applied, bit errors never leave
+  // an image with an invalid structure (a cut between records is a shorter valid delta, UDP only delivers whole
+  // datagrams and the largest compact packet fits UDP_IN_MAXSIZE)
+  {
+    Link l;
+    resetState();
+    size_t len = buildImage(udpOut, false), pktLen;
+    const uint8_t *pkt = l.tx.encode(udpOut, len, false, 1, pktLen);
+    CHECK(l.rx.decode(pkt, pktLen, l.ip) == CompactSyncDecoder::Applied);
+    unsigned truncatedApplied = 0, badId = 0, fuzzBad = 0;
+    for (int i = 0; i < 2000; i++) {
+      nowMs += 100;
+      state.segs[testRandom(3)].colors[testRandom(3)] = testRandom(0xFFFFFF);
+      len = buildImage(udpOut, false);
+      pkt = l.tx.encode(udpOut, len, false, 1, pktLen);
+      if (pkt[1] & UDP_COMPACT_KEY) { l.rx.decode(pkt, pktLen, l.ip); continue; }
+      std::vector<uint8_t> p(pkt, pkt + pktLen);
+      const int kind = i % 3;
+      // record boundaries: header bitmap and bytes, then index, bitmap and bytes of each segment
+      std::vector<size_t> ends;
+      size_t n = UDP_COMPACT_HDR + (SEG_OFFSET + 7) / 8;
+      for (size_t j = 0; j < (SEG_OFFSET + 7) / 8; j++) n += __builtin_popcount(p[UDP_COMPACT_HDR + j]);
+      const size_t firstSeg = n;
+      ends.push_back(n);
+      while (n < p.size()) {
+        size_t e = n + 1 + (UDP_SEG_SIZE + 7) / 8;
+        for (size_t j = 0; j < (UDP_SEG_SIZE + 7) / 8; j++) e += __builtin_popcount(p[n + 1 + j]);
+        ends.push_back(n = e);
+      }
+      CHECK_EQ(n, pktLen);
+      if (kind == 0) {                                                            // truncated within a record
+        const size_t cut = UDP_COMPACT_HDR + testRandom(pktLen - UDP_COMPACT_HDR);
+        if (std::find(ends.begin(), ends.end(), cut) != ends.end()) continue;
+        p.resize(cut);
+      } else if (kind == 1) {                                                     // segment index out of range
+        if (firstSeg >= p.size()) continue;
+        p[firstSeg] = 32 + testRandom(200);
+      } else for (int k = 0; k < 3; k++) p[UDP_COMPACT_HDR + testRandom(p.size() - UDP_COMPACT_HDR)] ^= 1 << testRandom(8); // bit errors
+      const CompactSyncDecoder::Result r = l.rx.decode(p.data(), p.size(), l.ip);
+      if (kind == 0 && r == CompactSyncDecoder::Applied) truncatedApplied++;
+      if (kind == 1 && r != CompactSyncDecoder::Lost) badId++;
+      if (r == CompactSyncDecoder::Applied && (l.rx.image()[40] != UDP_SEG_SIZE || l.rx.image()[39] > 32)) fuzzBad++;
+      if (r != CompactSyncDecoder::Applied) { l.tx.requestKeyframe(); continue; }
+      // a bit error may hit data bytes only, the next keyframe repairs the image
+    }
+    CHECK_EQ(truncatedApplied, 0);
+    CHECK_EQ(badId, 0);
+    CHECK_EQ(fuzzBad, 0);
+  }
+
+  return testResult("udp_compact");
+}
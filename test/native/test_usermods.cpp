@@ -0,0 +1,227 @@
+/*
+ * Usermod loop budgeting (um_manager.cpp): synthetic slow usermods in a simulated WLED main loop
+ * Usermods modelled on BME68X, the four line display, multi_relay and a temperature sensor rate limit their own work
+ * and declare loop periods like the real ones, two light usermods run on every pass. Frames are due every FRAMETIME,
+ * the lateness of frame starts (jitter) and the usermod time per loop pass are compared with the former
+ * UsermodManager::loop() that called every usermod on every pass; usermods have to keep their work rate and the
+ * reported load has to match the simulated cost.
+ *
+ * Usermods are registered in .dtors.tbl.usermods.* like on the ESP; on Linux the linker puts these sections into
+ * .fini_array, so the test leaves with _exit() and the table is not run as destructors.
+ */
+#include "native_test.h"
+#include "Print.h"
+#include <cassert>
+#include <unistd.h>
+
+#define WLED_DISABLE_MQTT
+#define WLED_DISABLE_ESPNOW
+#define USERMOD_ID_RESERVED    0
+#define USERMOD_ID_UNSPECIFIED 1
+
+// clock in microseconds, usermods and the simulated loop advance it
+static uint64_t nowUs = 0;
+static unsigned long millis() { return nowUs / 1000; }
+static unsigned long micros() { return nowUs; }
+
+// as in fcn_declare.h
+typedef struct UM_Exchange_Data {
+  size_t u_size = 0;
+} um_data_t;
+
+class Usermod {
+  protected:
+    um_data_t *um_data;
+  public:
+    Usermod() : um_data(nullptr) {};
+    virtual ~Usermod() { if (um_data) delete um_data; }
+    virtual void setup() = 0;
+    virtual void loop() = 0;
+    virtual void handleOverlayDraw() {}
+    virtual bool handleButton(uint8_t b) { return false; }
+    virtual bool getUMData(um_data_t **data) { if (data) *data = nullptr; return false; };
+    virtual void connected() {}
+    virtual void appendConfigData(Print& settingsScript);
+    virtual void addToJsonState(JsonObject& obj) {}
+    virtual void addToJsonInfo(JsonObject& obj) {}
+    virtual void readFromJsonState(JsonObject& obj) {}
+    virtual void addToConfig(JsonObject& obj) {}
+    virtual bool readFromConfig(JsonObject& obj) { return true; }
+    virtual void onMqttConnect(bool sessionPresent) {}
+    virtual bool onMqttMessage(char* topic, char* payload) { return false; }
+    virtual bool onEspNowMessage(uint8_t* sender, uint8_t* payload, uint8_t len) { return false; }
+    virtual void onUpdateBegin(bool) {}
+    virtual void onStateChange(uint8_t mode) {}
+    virtual uint16_t getId() {return USERMOD_ID_UNSPECIFIED;}
+    virtual uint16_t getLoopPeriod() { return 0; }
+  private:
+    static Print* oappend_shim;
+    virtual void appendConfigData() {}
+};
+
+namespace UsermodManager {
+  void loop();
+  void handleOverlayDraw();
+  bool handleButton(uint8_t b);
+  bool getUMData(um_data_t **um_data, uint8_t mod_id = USERMOD_ID_RESERVED);
+  void setup();
+  void connected();
+  void appendConfigData(Print&);
+  void addToJsonState(JsonObject& obj);
+  void addToJsonInfo(JsonObject& obj);
+  void readFromJsonState(JsonObject& obj);
+  void addToConfig(JsonObject& obj);
+  bool readFromConfig(JsonObject& obj);
+  void onUpdateBegin(bool);
+  void onStateChange(uint8_t);
+  Usermod* lookup(uint16_t mod_id);
+  size_t getModCount();
+};
+
+#define REGISTER_USERMOD(x) Usermod* const um_##x __attribute__((__section__(".dtors.tbl.usermods.1"), used)) = &x
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Warray-bounds" // the zero length table delimiters
+#include "../../wled00/um_manager.cpp"
+#pragma GCC diagnostic pop
+
+// usermod that limits its own work to one run per interval (0: works on every call), a call costs idleUs,
+// a run workUs on top; loop periods are declared as by the usermods it is modelled on
+class SimUsermod : public Usermod {
+  public:
+    const char *name;
+    uint16_t id, period, interval;
+    uint32_t idleUs, workUs;
+    unsigned long lastWork = 0;
+    unsigned calls = 0, works = 0;
+    uint64_t busyUs = 0;
+    static bool declarePeriods;
+
+    SimUsermod(const char *n, uint16_t i, uint16_t p, uint16_t iv, uint32_t idle, uint32_t work)
+    : name(n), id(i), period(p), interval(iv), idleUs(idle), workUs(work) {}
+    void setup() override {}
+    void loop() override {
+      calls++;
+      nowUs += idleUs;
+      busyUs += idleUs;
+      if (interval && millis() - lastWork < interval) return;
+      lastWork = millis();
+      works++;
+      nowUs += workUs;
+      busyUs += workUs;
+    }
+    uint16_t getId() override { return id; }
+    uint16_t getLoopPeriod() override { return declarePeriods ? period : 0; }
+    void reset() { lastWork = 0; calls = works = 0; busyUs = 0; }
+};
+bool SimUsermod::declarePeriods = true;
+
+//                       name                id   period interval  idle us  work us
+static SimUsermod bme68x("BME68X",           10,  250,   3000,     5,       12000); // I2C read and BSEC processing
+static SimUsermod display("four line display", 11, 50,   250,      20,      9000);  // redraw over I2C
+static SimUsermod relay("multi_relay",       12,  100,   100,      5,       300);
+static SimUsermod temp("temperature",        13,  0,     5000,     10,      6000);  // 1-wire read, no period declared
+static SimUsermod audio("audio sync",        14,  0,     0,        40,      0);
+static SimUsermod buttons("buttons",         15,  0,     0,        15,      0);
+REGISTER_USERMOD(bme68x);
+REGISTER_USERMOD(display);
+REGISTER_USERMOD(relay);
+REGISTER_USERMOD(temp);
+REGISTER_USERMOD(audio);
+REGISTER_USERMOD(buttons);
+static SimUsermod *sims[] = { &bme68x, &display, &relay, &temp, &audio, &buttons };
+
+// as in the former UsermodManager::loop()
+static void formerLoop() {
+  for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) (*mod)->loop();
+}
+
+static const uint32_t FRAME_US = 24000, RENDER_US = 5000, HANDLERS_US = 300; // 42 fps, service() and other handlers
+
+struct LoopStats {
+  std::vector<uint32_t> late; // frame start after due, us
+  uint32_t maxUsermodPass = 0;
+  unsigned passes = 0, overBudget = 0;
+};
+
+// WLED::loop() passes: strip.service() when a frame is due, other handlers and usermods
+static LoopStats simulate(bool budgeted, unsigned seconds) {
+  LoopStats s;
+  for (auto m : sims) m->reset();
+  SimUsermod::declarePeriods = budgeted;
+  const uint64_t end = nowUs + seconds * 1000000ULL;
+  uint64_t lastShow = nowUs;
+  while (nowUs < end) {
+    if (nowUs - lastShow >= FRAME_US) {
+      s.late.push_back(nowUs - lastShow - FRAME_US);
+      lastShow = nowUs;
+      nowUs += RENDER_US;
+    }
+    nowUs += HANDLERS_US;
+    const uint64_t start = nowUs;
+    if (budgeted) UsermodManager::loop(); else formerLoop();
+    const uint32_t us = nowUs - start;
+    s.maxUsermodPass = std::max(s.maxUsermodPass, us);
+    s.overBudget += us > WLED_USERMOD_LOOP_BUDGET;
+    s.passes++;
+  }
+  std::sort(s.late.begin(), s.late.end());
+  return s;
+}
+
+static uint32_t percentile(const std::vector<uint32_t> &v, unsigned pct) { return v.empty() ? 0 : v[(v.size() - 1) * pct / 100]; }
+
+int main() {
+  CHECK_EQ(UsermodManager::getModCount(), 6);
+  CHECK(UsermodManager::lookup(12) == &relay);
+  nowUs = 1000000;
+  UsermodManager::setup();
+
+  const unsigned seconds = 120;
+  const LoopStats former = simulate(false, seconds);
+  std::vector<unsigned> formerWorks, formerCalls;
+  for (auto m : sims) { formerWorks.push_back(m->works); formerCalls.push_back(m->calls); }
+  const LoopStats now = simulate(true, seconds);
+
+  uint32_t maxWork = 0;
+  for (auto m : sims) maxWork = std::max(maxWork, m->idleUs + m->workUs);
+  printf("%u s, %u frames: frame start late p50 %u us, p99 %u us, max %u us before, p50 %u us, p99 %u us, max %u us now\n", seconds, unsigned(now.late.size()),
+         percentile(former.late, 50), percentile(former.late, 99), former.late.back(), percentile(now.late, 50), percentile(now.late, 99), now.late.back());
+  printf("usermods per pass: max %u us in %u passes (%u over budget) before, max %u us in %u passes (%u over budget) now\n",
+         former.maxUsermodPass, former.passes, former.overBudget, now.maxUsermodPass, now.passes, now.overBudget);
+
+  // a pass runs at most one usermod beyond the budget, a frame waits at most for one such pass (a single slow call
+  // cannot be split, percentiles stay as they were)
+  CHECK(now.maxUsermodPass <= WLED_USERMOD_LOOP_BUDGET + maxWork);
+  CHECK(now.late.back() <= HANDLERS_US + WLED_USERMOD_LOOP_BUDGET + maxWork);
+  CHECK(now.late.back() < former.late.back());
+
+  // usermods that limit their work do it as often as before, calls of periodic usermods are cut down, every-pass
+  // usermods run on almost every pass
+  for (size_t i = 0; i < sizeof(sims) / sizeof(sims[0]); i++) {
+    const SimUsermod *m = sims[i];
+    if (m->interval) CHECK_NEAR(m->works, formerWorks[i], formerWorks[i] / 20 + 1);
+    else CHECK(m->calls > now.passes * 95 / 100);
+    if (m->period) CHECK(m->calls <= seconds * 1000 / m->period + 1);
+    printf("%-18s %6u works in %6u calls before, %6u works in %6u calls now\n", m->name, formerWorks[i], formerCalls[i], m->works, m->calls);
+  }
+
+  // /json/info "umload": [avg us, max us, CPU share per mille, deferred runs] of the last window, in "um" order
+  StaticJsonDocument<2048> doc;
+  JsonObject info = doc.to<JsonObject>();
+  UsermodManager::addToJsonInfo(info);
+  JsonArray load = info["umload"];
+  CHECK_EQ(load.size(), 6);
+  for (size_t i = 0; i < load.size(); i++) {
+    CHECK_EQ(info["um"][i].as<unsigned>(), sims[i]->id);
+    const double share = sims[i]->busyUs / (seconds * 1000.0); // per mille over the whole run
+    CHECK_NEAR(load[i][2].as<unsigned>(), share, share / 2 + 2);
+    CHECK(load[i][1].as<unsigned>() <= sims[i]->idleUs + sims[i]->workUs);
+  }
+  std::string json;
+  serializeJson(load, json);
+  printf("umload %s\n", json.c_str());
+
+  fflush(stdout);
+  _exit(testResult("usermods"));
+}
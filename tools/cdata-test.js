@@ -72,6 +72,23 @@ describe('Function', () => {
       });
     });
   });
+
+  describe('contentHash', async () => {
+    it('should return the 32 bit FNV-1a hash as 8 hex digits', async () => {
+      assert.strictEqual(cdata.contentHash(''), '811c9dc5');
+      assert.strictEqual(cdata.contentHash('a'), 'e40c292c');
+      assert.strictEqual(cdata.contentHash(Buffer.from('foobar')), 'bf9cf968');
+    });
+  });
+
+  describe('versionAssetUrls', async () => {
+    it('should append the content hash to referenced sub-resources', async () => {
+      const html = cdata.versionAssetUrls('<script src="common.js"></script>', testFolderPath);
+      assert.strictEqual(html, '<script src="common.js"></script>'); // no common.js in test folder
+      fs.writeFileSync(path.join(testFolderPath, 'common.js'), 'a');
+      assert.strictEqual(cdata.versionAssetUrls('<script src="common.js"></script>', testFolderPath), '<script src="common.js?v=e40c292c"></script>');
+    });
+  });
 });
 
 describe('Script', () => {
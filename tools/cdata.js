@@ -24,7 +24,7 @@ const minifyHtml = require("html-minifier-terser").minify;
 const packageJson = require("../package.json");
 
 // Export functions for testing
-module.exports = { isFileNewerThan, isAnyFileInFolderNewerThan };
+module.exports = { isFileNewerThan, isAnyFileInFolderNewerThan, contentHash, versionAssetUrls };
 
 const output = ["wled00/html_ui.h", "wled00/html_pixart.h", "wled00/html_cpal.h", "wled00/html_pxmagic.h", "wled00/html_settings.h", "wled00/html_other.h"]
 
@@ -98,6 +98,28 @@ function adoptVersionAndRepo(html) {
   return html;
 }
 
+// 32 bit FNV-1a hash as 8 hex digits, used as ETag and as cache busting version of sub-resources
+function contentHash(data) {
+  const buf = Buffer.isBuffer(data) ? data : Buffer.from(data, "utf-8");
+  let h = 0x811c9dc5;
+  for (const b of buf) {
+    h = Math.imul(h ^ b, 0x01000193) >>> 0;
+  }
+  return h.toString(16).padStart(8, "0");
+}
+
+// append content hash of shared sub-resources to their URLs so the browser may cache them forever
+// (a new build changes the URL instead of requiring revalidation)
+function versionAssetUrls(html, srcDir) {
+  for (const asset of ["common.js", "style.css"]) {
+    const file = path.join(srcDir, asset);
+    if (!html.includes(`"${asset}"`) || !fs.existsSync(file)) continue;
+    const hash = contentHash(adoptVersionAndRepo(fs.readFileSync(file, "utf-8")));
+    html = html.replaceAll(`"${asset}"`, `"${asset}?v=${hash}"`);
+  }
+  return html;
+}
+
 async function minify(str, type = "plain") {
   const options = {
     collapseWhitespace: true,
@@ -137,6 +159,7 @@ async function writeHtmlGzipped(sourceFile, resultFile, page) {
       if (error) throw error;
 
       html = adoptVersionAndRepo(html);
+      const hash = contentHash(html);
       const originalLength = html.length;
       html = await minify(html, "html-minify");
       const result = zlib.gzipSync(html, { level: zlib.constants.Z_BEST_COMPRESSION });
@@ -144,6 +167,7 @@ async function writeHtmlGzipped(sourceFile, resultFile, page) {
       const array = hexdump(result);
       let src = singleHeader;
       src += `const uint16_t PAGE_${page}_L = ${result.length};\n`;
+      src += `const uint32_t PAGE_${page}_H = 0x${hash};\n`;
       src += `const uint8_t PAGE_${page}[] PROGMEM = {\n${array}\n};\n\n`;
       console.info("Writing " + resultFile);
       fs.writeFileSync(resultFile, src);
@@ -157,13 +181,16 @@ async function specToChunk(srcDir, s) {
   if (s.method == "plaintext" || s.method == "gzip") {
     let str = buf.toString("utf-8");
     str = adoptVersionAndRepo(str);
+    if (s.filter == "html-minify") str = versionAssetUrls(str, srcDir);
     const originalLength = str.length;
     if (s.method == "gzip") {
+      const hash = contentHash(str);
       if (s.mangle) str = s.mangle(str);
       const zip = zlib.gzipSync(await minify(str, s.filter), { level: zlib.constants.Z_BEST_COMPRESSION });
       console.info("Minified and compressed " + s.file + " from " + originalLength + " to " + zip.length + " bytes");
       const result = hexdump(zip);
       chunk += `const uint16_t ${s.name}_length = ${zip.length};\n`;
+      chunk += `const uint32_t ${s.name}_hash = 0x${hash};\n`;
       chunk += `const uint8_t ${s.name}[] PROGMEM = {\n${result}\n};\n\n`;
       return chunk;
     } else {
@@ -175,6 +202,7 @@ async function specToChunk(srcDir, s) {
   } else if (s.method == "binary") {
     const result = hexdump(buf);
     chunk += `const uint16_t ${s.name}_length = ${buf.length};\n`;
+    chunk += `const uint32_t ${s.name}_hash = 0x${contentHash(buf)};\n`;
     chunk += `const uint8_t ${s.name}[] PROGMEM = {\n${result}\n};\n\n`;
     return chunk;
   }
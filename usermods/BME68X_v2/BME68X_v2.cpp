@@ -45,6 +45,7 @@
 	 public:
 	 /* Public: Functions */
 	 uint16_t getId();
+	 uint16_t getLoopPeriod() { return 250; }	// Sensor is read every few seconds, no need to poll on every WLED loop pass
 	 void loop();								// Loop of the user module called by wled main in loop
 	 void setup();								// Setup of the user module called by wled main
 	 void addToConfig(JsonObject& root);			// Extends the settings/user module settings page to include the user module requirements. The settings are written from the wled core to the configuration file.
@@ -145,6 +145,7 @@ class MultiRelay : public Usermod {
      * This could be used in the future for the system to determine whether your usermod is installed.
      */
     inline uint16_t getId() override { return USERMOD_ID_MULTI_RELAY; }
+    inline uint16_t getLoopPeriod() override { return 100; } // relays and off timer are updated 10 times/s
 
     /**
      * switch relay on/off
@@ -311,5 +311,13 @@ class FourLineDisplayUsermod : public Usermod {
       uint16_t getId() override {
         return USERMOD_ID_FOUR_LINE_DISP;
       }
+
+      /*
+       * getLoopPeriod() lets the usermod manager call loop() less often: the display is refreshed every
+       * refreshRate ms (>= 250 ms) at most, so polling on every WLED loop pass is not needed.
+       */
+      uint16_t getLoopPeriod() override {
+        return 50;
+      }
   };
   
\ No newline at end of file
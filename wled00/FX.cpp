@@ -2206,10 +2206,11 @@ uint16_t mode_noise16_2() {
   unsigned scale = 1000;                                        // the "zoom factor" for the noise
   SEGENV.step += (1 + (SEGMENT.speed >> 1));
 
+  unsigned shift_x = SEGENV.step >> 6;                          // x as a function of time
+  uint16_t noiseRow[32];
   for (unsigned i = 0; i < SEGLEN; i++) {
-    unsigned shift_x = SEGENV.step >> 6;                        // x as a function of time
-    uint32_t real_x = (i + shift_x) * scale;                    // calculate the coordinates within the noise field
-    unsigned noise = perlin16(real_x, 0, 4223) >> 8;            // get the noise data and scale it down
+    if (i % 32 == 0) perlin16_row(noiseRow, min(SEGLEN - i, 32U), (i + shift_x) * scale, scale, 0, 4223); // calculate the noise in blocks of 32 pixels
+    unsigned noise = noiseRow[i % 32] >> 8;                     // get the noise data and scale it down
     unsigned index = sin8_t(noise * 3);                           // map led color based on noise data
 
     SEGMENT.setPixelColor(i, SEGMENT.color_from_palette(index, false, PALETTE_SOLID_WRAP, 0, noise));
@@ -2244,8 +2245,10 @@ static const char _data_FX_MODE_NOISE16_3[] PROGMEM = "Noise 3@!;!;!;;pal=35";
 //https://github.com/aykevl/ledstrip-spark/blob/master/ledstrip.ino
 uint16_t mode_noise16_4() {
   uint32_t stp = (strip.now * SEGMENT.speed) >> 7;
+  uint16_t noiseRow[32];
   for (unsigned i = 0; i < SEGLEN; i++) {
-    int index = perlin16(uint32_t(i) << 12, stp);
+    if (i % 32 == 0) perlin16_row(noiseRow, min(SEGLEN - i, 32U), uint32_t(i) << 12, 1 << 12, stp); // calculate the noise in blocks of 32 pixels
+    int index = noiseRow[i % 32];
     SEGMENT.setPixelColor(i, SEGMENT.color_from_palette(index, false, PALETTE_SOLID_WRAP, 0));
   }
   return FRAMETIME;
@@ -4441,9 +4444,15 @@ static const char _data_FX_MODE_WASHING_MACHINE[] PROGMEM = "Washing Machine@!,!
 
 /*
   Image effect
-  Draws a .gif image from filesystem on the matrix/strip
+  Draws a .gif image or plays an .fseq sequence from filesystem on the matrix/strip
 */
 uint16_t mode_image(void) {
+  #ifdef WLED_ENABLE_FSEQ
+  if (isFseqFile(SEGMENT.name)) {
+    renderFseqToSegment(SEGMENT);
+    return FRAMETIME;
+  }
+  #endif
   #ifndef WLED_ENABLE_GIF
   return mode_static();
   #else
@@ -5083,112 +5092,104 @@ static const char _data_FX_MODE_2DFRIZZLES[] PROGMEM = "Frizzles@X frequency,Y f
 ///////////////////////////////////////////
 //   2D Cellular Automata Game of life   //
 ///////////////////////////////////////////
-typedef struct ColorCount {
-  CRGB color;
-  int8_t count;
-} colorCount;
+// Cell states are kept in bitboards (32 cells per word, one bit per cell), generations are computed in FX_life.cpp.
+// A separate byte plane holds the palette index of each cell.
+// Supports Life-like rules (B/S notation) and 3-state "Generations" rules (Brian's Brain) selected by a slider.
+static const char _gol_rule_conway[]   PROGMEM = "B3/S23";
+static const char _gol_rule_highlife[] PROGMEM = "B36/S23";
+static const char _gol_rule_seeds[]    PROGMEM = "B2/S";
+static const char _gol_rule_daynight[] PROGMEM = "B3678/S34678";
+static const char _gol_rule_maze[]     PROGMEM = "B3/S12345";
+static const char _gol_rule_brain[]    PROGMEM = "B2/S/C3";  // Brian's Brain
+static const char * const _gol_rules[] PROGMEM = {
+  _gol_rule_conway, _gol_rule_highlife, _gol_rule_seeds, _gol_rule_daynight, _gol_rule_maze, _gol_rule_brain
+};
+#define GOL_NUM_RULES (sizeof(_gol_rules)/sizeof(_gol_rules[0]))
 
 uint16_t mode_2Dgameoflife(void) { // Written by Ewoud Wijma, inspired by https://natureofcode.com/book/chapter-7-cellular-automata/ and https://github.com/DougHaber/nlife-color
   if (!strip.isMatrix || !SEGMENT.is2D()) return mode_static(); // not a 2D set-up
 
   const int cols = SEG_W;
   const int rows = SEG_H;
-  const auto XY = [&](int x, int y) { return (x%cols) + (y%rows) * cols; };
-  const unsigned dataSize = sizeof(CRGB) * SEGMENT.length();  // using width*height prevents reallocation if mirroring is enabled
-  const int crcBufferLen = 2; //(SEGMENT.width() + SEGMENT.height())*71/100; // roughly sqrt(2)/2 for better repetition detection (Ewowi)
+  const int wpr  = (cols + 31) >> 5;                                  // words per row
+  const size_t planeLen = wpr * rows;                                 // words per bit plane
+  const uint32_t lastMask = (cols & 31) ? (1U << (cols & 31)) - 1 : 0xFFFFFFFFU; // valid bits in last word of a row
+  const size_t dataSize = sizeof(lifeState) + 4 * planeLen * sizeof(uint32_t) + SEGMENT.length(); // 2 generations * (alive + dying) + color plane
 
-  if (!SEGENV.allocateData(dataSize + sizeof(uint16_t)*crcBufferLen)) return mode_static(); //allocation failed
-  CRGB *prevLeds = reinterpret_cast<CRGB*>(SEGENV.data);
-  uint16_t *crcBuffer = reinterpret_cast<uint16_t*>(SEGENV.data + dataSize); 
+  if (!SEGENV.allocateData(dataSize)) return mode_static(); //allocation failed
+  lifeState *state = reinterpret_cast<lifeState*>(SEGENV.data);
+  uint32_t  *planes = reinterpret_cast<uint32_t*>(SEGENV.data + sizeof(lifeState));
+  uint8_t   *colorIdx = SEGENV.data + sizeof(lifeState) + 4 * planeLen * sizeof(uint32_t);
 
-  CRGB backgroundColor = SEGCOLOR(1);
+  const uint32_t bgc = SEGCOLOR(1);
+  const unsigned rule = (SEGMENT.custom1 * GOL_NUM_RULES) >> 8;  // 0 to GOL_NUM_RULES-1
+  bool repaint = false;
 
-  if (SEGENV.call == 0 || strip.now - SEGMENT.step > 3000) {
+  if (SEGENV.call == 0 || strip.now - SEGENV.step > 3000 || rule != state->rule) {
     SEGENV.step = strip.now;
-    SEGENV.aux0 = 0;
-
-    //give the leds random state and colors (based on intensity, colors from palette or all posible colors are chosen)
-    for (int x = 0; x < cols; x++) for (int y = 0; y < rows; y++) {
-      unsigned state = hw_random8()%2;
-      if (state == 0)
-        SEGMENT.setPixelColorXY(x,y, backgroundColor);
-      else
-        SEGMENT.setPixelColorXY(x,y, SEGMENT.color_from_palette(hw_random8(), false, PALETTE_SOLID_WRAP, 255));
-    }
-
-    for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) prevLeds[XY(x,y)] = CRGB::Black;
-    memset(crcBuffer, 0, sizeof(uint16_t)*crcBufferLen);
+    state->rule = rule;
+    parseLifeRule((const char *)pgm_read_ptr(&_gol_rules[rule]), state);
+    state->gen = 0;
+    state->crc[0] = state->crc[1] = state->crcIdx = 0;
+    memset(planes, 0, 4 * planeLen * sizeof(uint32_t));
+    // give the cells random state and colors from palette
+    for (int y = 0; y < rows; y++) for (int w = 0; w < wpr; w++) planes[y*wpr + w] = hw_random() & (w == wpr-1 ? lastMask : 0xFFFFFFFFU);
+    for (unsigned i = 0; i < SEGMENT.length(); i++) colorIdx[i] = hw_random8();
+    repaint = true;
   } else if (strip.now - SEGENV.step < FRAMETIME_FIXED * (uint32_t)map(SEGMENT.speed,0,255,64,4)) {
     // update only when appropriate time passes (in 42 FPS slots)
-    return FRAMETIME;
-  }
-
-  //copy previous leds (save previous generation)
-  //NOTE: using lossy getPixelColor() is a benefit as endlessly repeating patterns will eventually fade out causing a reset
-  for (int x = 0; x < cols; x++) for (int y = 0; y < rows; y++) prevLeds[XY(x,y)] = SEGMENT.getPixelColorXY(x,y);
-
-  //calculate new leds
-  for (int x = 0; x < cols; x++) for (int y = 0; y < rows; y++) {
-
-    colorCount colorsCount[9]; // count the different colors in the 3*3 matrix
-    for (int i=0; i<9; i++) colorsCount[i] = {backgroundColor, 0}; // init colorsCount
-
-    // iterate through neighbors and count them and their different colors
-    int neighbors = 0;
-    for (int i = -1; i <= 1; i++) for (int j = -1; j <= 1; j++) { // iterate through 3*3 matrix
-      if (i==0 && j==0) continue; // ignore itself
-      // wrap around segment
-      int xx = x+i, yy = y+j;
-      if (x+i < 0) xx = cols-1; else if (x+i >= cols) xx = 0;
-      if (y+j < 0) yy = rows-1; else if (y+j >= rows) yy = 0;
-
-      unsigned xy = XY(xx, yy); // previous cell xy to check
-      // count different neighbours and colors
-      if (prevLeds[xy] != backgroundColor) {
-        neighbors++;
-        bool colorFound = false;
-        int k;
-        for (k=0; k<9 && colorsCount[k].count != 0; k++)
-          if (colorsCount[k].color == prevLeds[xy]) {
-            colorsCount[k].count++;
-            colorFound = true;
+    if (state->bgColor == bgc) return FRAMETIME;
+    repaint = true; // background changed, repaint without advancing
+  } else {
+    const uint32_t *alive = planes + (state->gen ? 2*planeLen : 0);
+    const uint32_t *dying = alive + planeLen;
+    uint32_t *nAlive = planes + (state->gen ? 0 : 2*planeLen);
+    uint32_t *nDying = nAlive + planeLen;
+    lifeGeneration(state, alive, dying, nAlive, nDying, colorIdx, cols, rows, SEGMENT.check1);
+
+    // paint only cells that changed state
+    if (state->bgColor == bgc) {
+      for (int y = 0; y < rows; y++) for (int w = 0; w < wpr; w++) {
+        const unsigned idx = y * wpr + w;
+        for (uint32_t d = (alive[idx] ^ nAlive[idx]) | (dying[idx] ^ nDying[idx]); d; d &= d - 1) {
+          const unsigned bit = __builtin_ctz(d);
+          const int x = (w << 5) + bit;
+          uint32_t col = bgc;
+          if ((nAlive[idx] | nDying[idx]) >> bit & 1) {
+            col = SEGMENT.color_from_palette(colorIdx[y * cols + x], false, PALETTE_SOLID_WRAP, 255);
+            if (nDying[idx] >> bit & 1) col = color_blend(col, bgc, 192);
           }
-        if (!colorFound) colorsCount[k] = {prevLeds[xy], 1}; //add new color found in the array
+          SEGMENT.setPixelColorXY(x, y, col);
+        }
+      }
+    } else repaint = true;
+    state->gen ^= 1;
+
+    // check if we had same CRC and reset if needed (same CRC would mean image did not change or was repeating itself)
+    uint16_t crc = crc16((const unsigned char*)nAlive, planeLen * sizeof(uint32_t));
+    if (crc != state->crc[0] && crc != state->crc[1]) SEGENV.step = strip.now; //if no repetition avoid reset
+    state->crc[state->crcIdx] = crc;
+    state->crcIdx ^= 1;
+  }
+
+  if (repaint) {
+    const uint32_t *alive = planes + (state->gen ? 2*planeLen : 0);
+    const uint32_t *dying = alive + planeLen;
+    for (int y = 0; y < rows; y++) for (int x = 0; x < cols; x++) {
+      const unsigned idx = y * wpr + (x >> 5);
+      uint32_t col = bgc;
+      if ((alive[idx] | dying[idx]) >> (x & 31) & 1) {
+        col = SEGMENT.color_from_palette(colorIdx[y * cols + x], false, PALETTE_SOLID_WRAP, 255);
+        if (dying[idx] >> (x & 31) & 1) col = color_blend(col, bgc, 192);
       }
-    } // i,j
-
-    // Rules of Life
-    uint32_t col = uint32_t(prevLeds[XY(x,y)]) & 0x00FFFFFF;  // uint32_t operator returns RGBA, we want RGBW -> cut off "alpha" byte
-    uint32_t bgc = RGBW32(backgroundColor.r, backgroundColor.g, backgroundColor.b, 0);
-    if      ((col != bgc) && (neighbors <  2)) SEGMENT.setPixelColorXY(x,y, bgc); // Loneliness
-    else if ((col != bgc) && (neighbors >  3)) SEGMENT.setPixelColorXY(x,y, bgc); // Overpopulation
-    else if ((col == bgc) && (neighbors == 3)) {                                  // Reproduction
-      // find dominant color and assign it to a cell
-      colorCount dominantColorCount = {backgroundColor, 0};
-      for (int i=0; i<9 && colorsCount[i].count != 0; i++)
-        if (colorsCount[i].count > dominantColorCount.count) dominantColorCount = colorsCount[i];
-      // assign the dominant color w/ a bit of randomness to avoid "gliders"
-      if (dominantColorCount.count > 0 && hw_random8(128)) SEGMENT.setPixelColorXY(x,y, dominantColorCount.color);
-    } else if ((col == bgc) && (neighbors == 2) && !hw_random8(128)) {               // Mutation
-      SEGMENT.setPixelColorXY(x,y, SEGMENT.color_from_palette(hw_random8(), false, PALETTE_SOLID_WRAP, 255));
-    }
-    // else do nothing!
-  } //x,y
-
-  // calculate CRC16 of leds
-  uint16_t crc = crc16((const unsigned char*)prevLeds, dataSize);
-  // check if we had same CRC and reset if needed
-  bool repetition = false;
-  for (int i=0; i<crcBufferLen && !repetition; i++) repetition = (crc == crcBuffer[i]); // (Ewowi)
-  // same CRC would mean image did not change or was repeating itself
-  if (!repetition) SEGENV.step = strip.now; //if no repetition avoid reset
-  // remember CRCs across frames
-  crcBuffer[SEGENV.aux0] = crc;
-  ++SEGENV.aux0 %= crcBufferLen;
+      SEGMENT.setPixelColorXY(x, y, col);
+    }
+    state->bgColor = bgc;
+  }
 
   return FRAMETIME;
 } // mode_2Dgameoflife()
-static const char _data_FX_MODE_2DGAMEOFLIFE[] PROGMEM = "Game Of Life@!;!,!;!;2";
+static const char _data_FX_MODE_2DGAMEOFLIFE[] PROGMEM = "Game Of Life@!,,Rule,,,Mutation;!,!;!;2;c1=0,o1=1";
 
 
 /////////////////////////
@@ -5499,11 +5500,13 @@ uint16_t mode_2Dnoise(void) {                  // By Andrew Tuline
   const int rows = SEG_H;
 
   const unsigned scale  = SEGMENT.intensity+2;
+  const uint16_t z = strip.now / (16 - SEGMENT.speed/16);
+  uint8_t noiseRow[32];
 
   for (int y = 0; y < rows; y++) {
     for (int x = 0; x < cols; x++) {
-      uint8_t pixelHue8 = perlin8(x * scale, y * scale, strip.now / (16 - SEGMENT.speed/16));
-      SEGMENT.setPixelColorXY(x, y, ColorFromPalette(SEGPALETTE, pixelHue8));
+      if (x % 32 == 0) perlin8_row(noiseRow, min(cols - x, 32), x * scale, scale, y * scale, z); // calculate the noise in blocks of 32 pixels
+      SEGMENT.setPixelColorXY(x, y, ColorFromPalette(SEGPALETTE, noiseRow[x % 32]));
     }
   }
 
@@ -6161,8 +6164,13 @@ uint16_t mode_2Dscrollingtext(void) {
     }
   }
 
+  // text is rendered into a bitmap once (and whenever it changes) which is then drawn at the scroll position
+  const size_t dataSize = Segment::textRasterSize(WLED_MAX_SEGNAME_LEN, letterWidth, letterHeight, rotate);
+  textRaster *raster = SEGENV.allocateData(dataSize) ? reinterpret_cast<textRaster*>(SEGENV.data) : nullptr;
+  if (raster && !Segment::rasterizeText(raster, dataSize, text, letterWidth, letterHeight, rotate, SEGMENT.check2)) raster = nullptr;
+
   const int  numberOfLetters = strlen(text);
-  int width = (numberOfLetters * rotLW);
+  int width = raster ? raster->width : (numberOfLetters * rotLW);
   int yoffset = map(SEGMENT.intensity, 0, 255, -rows/2, rows/2) + (rows-rotLH)/2;
   if (width <= cols) {
     // scroll vertically (e.g. ^^ Way out ^^) if it fits
@@ -6200,7 +6208,8 @@ uint16_t mode_2Dscrollingtext(void) {
     }
   } else col2 = col1; // force characters to use single color (from palette)
 
-  for (int i = 0; i < numberOfLetters; i++) {
+  if (raster) SEGMENT.drawText(raster, int(cols) - int(SEGENV.aux0), yoffset, col1, col2);
+  else for (int i = 0; i < numberOfLetters; i++) { // not enough memory: draw character by character
     int xoffset = int(cols) - int(SEGENV.aux0) + rotLW*i;
     if (xoffset + rotLW < 0) continue; // don't draw characters off-screen
     SEGMENT.drawCharacter(text[i], xoffset, yoffset, letterWidth, letterHeight, col1, col2, rotate);
@@ -6208,7 +6217,7 @@ uint16_t mode_2Dscrollingtext(void) {
 
   return FRAMETIME;
 }
-static const char _data_FX_MODE_2DSCROLLTEXT[] PROGMEM = "Scrolling Text@!,Y Offset,Trail,Font size,Rotate,Gradient,,Reverse;!,!,Gradient;!;2;ix=128,c1=0,rev=0,mi=0,rY=0,mY=0";
+static const char _data_FX_MODE_2DSCROLLTEXT[] PROGMEM = "Scrolling Text@!,Y Offset,Trail,Font size,Rotate,Gradient,Proportional,Reverse;!,!,Gradient;!;2;ix=128,c1=0,rev=0,mi=0,rY=0,mY=0";
 
 
 ////////////////////////////
@@ -6259,10 +6268,8 @@ uint16_t mode_2Dplasmarotozoom() {
   // plasma
   for (int j = 0; j < rows; j++) {
     int index = j*cols;
-    for (int i = 0; i < cols; i++) {
-      if (SEGMENT.check1) plasma[index+i] = (i * 4 ^ j * 4) + ms / 6;
-      else                plasma[index+i] = inoise8(i * 40, j * 40, ms);
-    }
+    if (SEGMENT.check1) for (int i = 0; i < cols; i++) plasma[index+i] = (i * 4 ^ j * 4) + ms / 6;
+    else                perlin8_row(plasma + index, cols, 0, 40, j * 40, ms);
   }
 
   // rotozoom
@@ -7598,11 +7605,12 @@ uint16_t mode_2Dsoap() {
   if (SEGENV.call == 0) for (int i = 0; i < 3; i++) noisecoord[i] = hw_random(); // init
   else                  for (int i = 0; i < 3; i++) noisecoord[i] += mov;
 
-  for (int i = 0; i < cols; i++) {
-    int32_t ioffset = scale32_x * (i - cols / 2);
-    for (int j = 0; j < rows; j++) {
-      int32_t joffset = scale32_y * (j - rows / 2);
-      uint8_t data = perlin16(noisecoord[0] + ioffset, noisecoord[1] + joffset, noisecoord[2]) >> 8;
+  uint16_t noiseRow[32];
+  for (int j = 0; j < rows; j++) {
+    int32_t joffset = scale32_y * (j - rows / 2);
+    for (int i = 0; i < cols; i++) {
+      if (i % 32 == 0) perlin16_row(noiseRow, min(cols - i, 32), noisecoord[0] + scale32_x * (i - cols / 2), scale32_x, noisecoord[1] + joffset, noisecoord[2]); // calculate the noise in blocks of 32 pixels
+      uint8_t data = noiseRow[i % 32] >> 8;
       noise3d[XY(i,j)] = scale8(noise3d[XY(i,j)], smoothness) + scale8(data, 255 - smoothness);
     }
   }
@@ -10669,7 +10677,7 @@ void WS2812FX::setupEffectData() {
   addEffect(FX_MODE_TWO_DOTS, &mode_two_dots, _data_FX_MODE_TWO_DOTS);
   addEffect(FX_MODE_FAIRYTWINKLE, &mode_fairytwinkle, _data_FX_MODE_FAIRYTWINKLE);
   addEffect(FX_MODE_RUNNING_DUAL, &mode_running_dual, _data_FX_MODE_RUNNING_DUAL);
-  #ifdef WLED_ENABLE_GIF
+  #if defined(WLED_ENABLE_GIF) || defined(WLED_ENABLE_FSEQ)
   addEffect(FX_MODE_IMAGE, &mode_image, _data_FX_MODE_IMAGE);
   #endif
   addEffect(FX_MODE_TRICOLOR_CHASE, &mode_tricolor_chase, _data_FX_MODE_TRICOLOR_CHASE);
@@ -79,6 +79,16 @@ extern byte realtimeMode;           // used in getMappedPixelIndex()
 #endif
 #define FPS_UNLIMITED    0
 
+// adaptive frame pacing (frame rate follows measured effect and LED output cost)
+#ifndef WLED_PACING_LOAD
+  #define WLED_PACING_LOAD 75                                             // max. % of time spent rendering, rest is left to network and other tasks
+#endif
+#define PACING_KEEPALIVE   1000                                           // refresh period (ms) of idle Solid segments
+#define PACING_HOLD        2000                                           // frame cost has to stay low this long (ms) before frame rate is raised again
+#define PACE_TARGET        0                                              // frame rate limited by configured target FPS
+#define PACE_EFFECTS       1                                              // frame rate limited by effect calculation and pixel conversion
+#define PACE_OUTPUT        2                                              // frame rate limited by LED output
+
 // FPS calculation (can be defined as compile flag for debugging)
 #ifndef FPS_CALC_AVG
 #define FPS_CALC_AVG 7 // average FPS calculation over this many frames (moving average)
@@ -413,6 +423,33 @@ typedef enum mapping1D2D {
   M12_sPinwheel = 4
 } mapping1D2D_t;
 
+// text rasterized once into a 1 bit per pixel bitmap in its final rotation (see Segment::rasterizeText())
+typedef struct TextRaster {
+  uint32_t hash;      // of text and rendering parameters, bitmap is only rebuilt if it changes
+  uint16_t width;     // pixels in scroll (x) direction
+  uint16_t rowBytes;
+  uint8_t  height;
+  uint8_t  glyphH;    // font height, gradient runs along glyph rows
+  int8_t   rotate;
+  uint8_t  bits[];    // height rows, MSB is leftmost pixel
+} textRaster;
+
+// Game of Life state kept in segment data in front of the bit planes (see mode_2Dgameoflife())
+typedef struct LifeState {
+  uint32_t bgColor;     // background color used for last paint (repaint everything if changed)
+  uint16_t crc[2];      // CRCs of previous generations (repetition detection)
+  uint16_t birth;       // bit n set: dead cell with n live neighbours is born
+  uint16_t survive;     // bit n set: live cell with n live neighbours survives
+  uint8_t  states;      // 2 = Life-like, 3 = Generations (live cells that do not survive are "dying" for one generation)
+  uint8_t  rule;        // selected rule index
+  uint8_t  gen;         // current buffer set (0/1)
+  uint8_t  crcIdx;
+} lifeState;
+
+// FX_life.cpp
+void parseLifeRule(const char *rule, lifeState *s);
+void lifeGeneration(const lifeState *s, const uint32_t *alive, const uint32_t *dying, uint32_t *nAlive, uint32_t *nDying, uint8_t *colorIdx, int cols, int rows, bool mutate);
+
 class WS2812FX;
 
 // segment, 76 bytes
@@ -747,7 +784,7 @@ class Segment {
     inline void fadePixelColorXY(uint16_t x, uint16_t y, uint8_t fade) const                   { setPixelColorXY(x, y, color_fade(getPixelColorXY(x,y), fade, true)); }
     inline void blurCols(fract8 blur_amount, bool smear = false) const                         { blur2D(0, blur_amount, smear); } // blur all columns (50% faster than full 2D blur)
     inline void blurRows(fract8 blur_amount, bool smear = false) const                         { blur2D(blur_amount, 0, smear); } // blur all rows (50% faster than full 2D blur)
-    //void box_blur(unsigned r = 1U, bool smear = false); // 2D box blur
+    void box_blur(unsigned radius = 1U, bool smear = false, unsigned passes = 1) const; // 2D box blur (3 passes approximate gaussian blur)
     void blur2D(uint8_t blur_x, uint8_t blur_y, bool smear = false) const;
     void moveX(int delta, bool wrap = false) const;
     void moveY(int delta, bool wrap = false) const;
@@ -756,6 +793,9 @@ class Segment {
     void fillCircle(uint16_t cx, uint16_t cy, uint8_t radius, uint32_t c, bool soft = false) const;
     void drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint32_t c, bool soft = false) const;
     void drawCharacter(unsigned char chr, int16_t x, int16_t y, uint8_t w, uint8_t h, uint32_t color, uint32_t col2 = 0, int8_t rotate = 0) const;
+    static size_t textRasterSize(size_t chars, uint8_t w, uint8_t h, int8_t rotate);
+    static bool rasterizeText(textRaster *t, size_t size, const char *text, uint8_t w, uint8_t h, int8_t rotate, bool proportional);
+    void drawText(const textRaster *t, int x, int y, uint32_t color, uint32_t col2 = 0) const;
     void wu_pixel(uint32_t x, uint32_t y, CRGB c) const;
     inline void drawCircle(uint16_t cx, uint16_t cy, uint8_t radius, CRGB c, bool soft = false) const { drawCircle(cx, cy, radius, RGBW32(c.r,c.g,c.b,0), soft); }
     inline void fillCircle(uint16_t cx, uint16_t cy, uint8_t radius, CRGB c, bool soft = false) const { fillCircle(cx, cy, radius, RGBW32(c.r,c.g,c.b,0), soft); }
@@ -782,7 +822,7 @@ class Segment {
     inline void addPixelColorXY(int x, int y, byte r, byte g, byte b, byte w = 0, bool saturate = false) const { addPixelColor(x, RGBW32(r,g,b,w), saturate); }
     inline void addPixelColorXY(int x, int y, CRGB c, bool saturate = false) const         { addPixelColor(x, RGBW32(c.r,c.g,c.b,0), saturate); }
     inline void fadePixelColorXY(uint16_t x, uint16_t y, uint8_t fade) const               { fadePixelColor(x, fade); }
-    //inline void box_blur(unsigned i, bool vertical, fract8 blur_amount) {}
+    inline void box_blur(unsigned radius = 1U, bool smear = false, unsigned passes = 1) const {}
     inline void blur2D(uint8_t blur_x, uint8_t blur_y, bool smear = false) {}
     inline void blurCols(fract8 blur_amount, bool smear = false) { blur(blur_amount, smear); } // blur all columns (50% faster than full 2D blur)
     inline void blurRows(fract8 blur_amount, bool smear = false) {}
@@ -797,6 +837,7 @@ class Segment {
     inline void drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, CRGB c, bool soft = false) {}
     inline void drawCharacter(unsigned char chr, int16_t x, int16_t y, uint8_t w, uint8_t h, uint32_t color, uint32_t = 0, int8_t = 0) {}
     inline void drawCharacter(unsigned char chr, int16_t x, int16_t y, uint8_t w, uint8_t h, CRGB c, CRGB c2, int8_t rotate = 0) {}
+    inline void drawText(const textRaster *t, int x, int y, uint32_t color, uint32_t col2 = 0) {}
     inline void wu_pixel(uint32_t x, uint32_t y, CRGB c) {}
   #endif
   friend class WS2812FX;
@@ -835,12 +876,20 @@ class WS2812FX {
       _length(DEFAULT_LED_COUNT),
       _transitionDur(750),
       _frametime(FRAMETIME_FIXED),
+      _showtime(FRAMETIME_FIXED),
       _cumulativeFps(WLED_FPS << FPS_CALC_SHIFT),
       _targetFps(WLED_FPS),
       _isServicing(false),
       _isOffRefreshRequired(false),
       _hasWhiteChannel(false),
       _triggered(false),
+      _adaptiveFps(false),
+      _paceLimit(PACE_TARGET),
+      _slowestSeg(0),
+      _slowestSegUs(0),
+      _renderUs(0),
+      _busShowUs(0),
+      _paceLowSince(0),
       _segment_index(0),
       _mainSegment(0),
       _modeCount(MODE_COUNT),
@@ -848,7 +897,8 @@ class WS2812FX {
       customMappingTable(nullptr),
       customMappingSize(0),
       _lastShow(0),
-      _lastServiceShow(0)
+      _lastServiceShow(0),
+      _missedDeadlines(0)
     {
       _mode.reserve(_modeCount);     // allocate memory to prevent initial fragmentation (does not increase size())
       _modeData.reserve(_modeCount); // allocate memory to prevent initial fragmentation (does not increase size())
@@ -885,6 +935,7 @@ class WS2812FX {
       blendSegment(const Segment &topSegment) const,    // blends topSegment into pixels
       show(),                                     // initiates LED output
       setTargetFps(unsigned fps),
+      setAdaptiveFps(bool enable),
       setupEffectData(),                          // add default effects to the list; defined in FX.cpp
       waitForIt();                                // wait until frame is over (service() has finished or time for 1 frame has passed)
 
@@ -917,6 +968,7 @@ class WS2812FX {
     inline bool isOffRefreshRequired() const { return _isOffRefreshRequired; }  // returns true if strip requires regular updates (i.e. TM1814 chipset)
     inline bool isSuspended() const          { return _suspend; }               // returns true if strip.service() execution is suspended
     inline bool needsUpdate() const          { return _triggered; }             // returns true if strip received a trigger() request
+    inline bool isAdaptiveFps() const        { return _adaptiveFps; }           // returns true if frame rate follows measured frame cost
 
     uint8_t paletteBlend;
     uint8_t getActiveSegmentsNum() const;
@@ -932,13 +984,20 @@ class WS2812FX {
     inline uint8_t getMainSegmentId() const { return _mainSegment; }      // returns main segment index
     inline uint8_t getTargetFps() const     { return _targetFps; }        // returns rough FPS value for las 2s interval
     inline uint8_t getModeCount() const     { return _modeCount; }        // returns number of registered modes/effects
+    inline uint8_t getPaceLimit() const     { return _paceLimit; }        // returns what limits the frame rate (PACE_TARGET, PACE_EFFECTS, PACE_OUTPUT)
+    inline uint8_t getSlowestSegment() const { return _slowestSeg; }      // returns index of segment with the most expensive effect in last frame
 
     uint16_t getLengthPhysical() const;
     uint16_t getLengthTotal() const; // will include virtual/nonexistent pixels in matrix
 
     inline uint16_t getFps() const          { return (millis() - _lastShow > 2000) ? 0 : (FPS_MULTIPLIER * _cumulativeFps) >> FPS_CALC_SHIFT; } // Returns the refresh rate of the LED strip (_cumulativeFps is stored in fixed point)
     inline uint16_t getFrameTime() const    { return _frametime; }        // returns amount of time a frame should take (in ms)
+    inline uint16_t getShowTime() const     { return _showtime; }         // returns time between shown frames (in ms), differs from frame time when adaptive pacing slows output
     inline uint16_t getMinShowDelay() const { return MIN_FRAME_DELAY; }   // returns minimum amount of time strip.service() can be delayed (constant)
+    inline uint32_t getMissedDeadlines() const { return _missedDeadlines; } // returns number of frames started more than half a frame late
+    unsigned long   timeToNextFrame() const;                               // returns ms until strip.service() will render next frame (0 = due)
+    inline uint32_t getRenderTime() const   { return _renderUs; }         // returns averaged CPU time (us) of a frame (effects + conversion + blocking outputs excluded)
+    inline uint16_t getSlowestSegmentTime() const { return _slowestSegUs; } // returns averaged effect time (us) of the most expensive segment
     inline uint16_t getLength() const       { return _length; }           // returns actual amount of LEDs on a strip (2D matrix may have less LEDs than W*H)
     inline uint16_t getTransition() const   { return _transitionDur; }    // returns currently set transition time (in ms)
     inline uint16_t getMappedPixelIndex(uint16_t index) const {           // convert logical address to physical
@@ -1016,6 +1075,7 @@ class WS2812FX {
     uint16_t _transitionDur;
 
     uint16_t _frametime;
+    uint16_t _showtime;      // frame time adapted by pacing, effects keep using _frametime
     uint16_t _cumulativeFps;
     uint8_t  _targetFps;
 
@@ -1025,8 +1085,19 @@ class WS2812FX {
       bool _isOffRefreshRequired : 1; //periodic refresh is required for the strip to remain off.
       bool _hasWhiteChannel      : 1;
       bool _triggered            : 1;
+      bool _adaptiveFps          : 1; // frame time is adapted to measured frame cost
     };
 
+    uint8_t  _paceLimit;
+    uint8_t  _slowestSeg;
+    uint16_t _slowestSegUs;
+    uint32_t _renderUs;
+    uint32_t _busShowUs;     // time spent in BusManager::show() during last show()
+    unsigned long _paceLowSince;
+
+    inline bool isFrameRateLimited() const { return _targetFps != FPS_UNLIMITED || _adaptiveFps; }
+    void updatePacing(uint32_t renderUs, uint32_t segUs, uint8_t segId);
+
     uint8_t _segment_index;
     uint8_t _mainSegment;
 
@@ -1041,6 +1112,7 @@ class WS2812FX {
 
     unsigned long _lastShow;
     unsigned long _lastServiceShow;
+    uint32_t      _missedDeadlines;
 
     friend class Segment;
 };
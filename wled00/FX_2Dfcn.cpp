@@ -240,136 +240,6 @@ uint32_t IRAM_ATTR_YN Segment::getPixelColorXY(int x, int y) const {
   return getPixelColorXYRaw(x,y);
 }
 
-// 2D blurring, can be asymmetrical
-void Segment::blur2D(uint8_t blur_x, uint8_t blur_y, bool smear) const {
-  if (!isActive()) return; // not active
-  const unsigned cols = vWidth();
-  const unsigned rows = vHeight();
-  const auto XY = [&](unsigned x, unsigned y){ return x + y*cols; };
-  uint32_t lastnew; // not necessary to initialize lastnew and last, as both will be initialized by the first loop iteration
-  uint32_t last;
-  if (blur_x) {
-    const uint8_t keepx = smear ? 255 : 255 - blur_x;
-    const uint8_t seepx = blur_x >> 1;
-    for (unsigned row = 0; row < rows; row++) { // blur rows (x direction)
-      uint32_t carryover = BLACK;
-      uint32_t curnew = BLACK;
-      for (unsigned x = 0; x < cols; x++) {
-        uint32_t cur = getPixelColorRaw(XY(x, row));
-        uint32_t part = color_fade(cur, seepx);
-        curnew = color_fade(cur, keepx);
-        if (x > 0) {
-          if (carryover) curnew = color_add(curnew, carryover);
-          uint32_t prev = color_add(lastnew, part);
-          // optimization: only set pixel if color has changed
-          if (last != prev) setPixelColorRaw(XY(x - 1, row), prev);
-        } else setPixelColorRaw(XY(x, row), curnew); // first pixel
-        lastnew = curnew;
-        last = cur; // save original value for comparison on next iteration
-        carryover = part;
-      }
-      setPixelColorRaw(XY(cols-1, row), curnew); // set last pixel
-    }
-  }
-  if (blur_y) {
-    const uint8_t keepy = smear ? 255 : 255 - blur_y;
-    const uint8_t seepy = blur_y >> 1;
-    for (unsigned col = 0; col < cols; col++) {
-      uint32_t carryover = BLACK;
-      uint32_t curnew = BLACK;
-      for (unsigned y = 0; y < rows; y++) {
-        uint32_t cur = getPixelColorRaw(XY(col, y));
-        uint32_t part = color_fade(cur, seepy);
-        curnew = color_fade(cur, keepy);
-        if (y > 0) {
-          if (carryover) curnew = color_add(curnew, carryover);
-          uint32_t prev = color_add(lastnew, part);
-          // optimization: only set pixel if color has changed
-          if (last != prev) setPixelColorRaw(XY(col, y - 1), prev);
-        } else setPixelColorRaw(XY(col, y), curnew); // first pixel
-        lastnew = curnew;
-        last = cur; //save original value for comparison on next iteration
-        carryover = part;
-      }
-      setPixelColorRaw(XY(col, rows - 1), curnew);
-    }
-  }
-}
-
-/*
-// 2D Box blur
-void Segment::box_blur(unsigned radius, bool smear) {
-  if (!isActive() || radius == 0) return; // not active
-  if (radius > 3) radius = 3;
-  const unsigned d = (1 + 2*radius) * (1 + 2*radius); // averaging divisor
-  const unsigned cols = vWidth();
-  const unsigned rows = vHeight();
-  uint16_t *tmpRSum = new uint16_t[cols*rows];
-  uint16_t *tmpGSum = new uint16_t[cols*rows];
-  uint16_t *tmpBSum = new uint16_t[cols*rows];
-  uint16_t *tmpWSum = new uint16_t[cols*rows];
-  // fill summed-area table (https://en.wikipedia.org/wiki/Summed-area_table)
-  for (unsigned x = 0; x < cols; x++) {
-    unsigned rS, gS, bS, wS;
-    unsigned index;
-    rS = gS = bS = wS = 0;
-    for (unsigned y = 0; y < rows; y++) {
-      index = x * cols + y;
-      if (x > 0) {
-        unsigned index2 = (x - 1) * cols + y;
-        tmpRSum[index] = tmpRSum[index2];
-        tmpGSum[index] = tmpGSum[index2];
-        tmpBSum[index] = tmpBSum[index2];
-        tmpWSum[index] = tmpWSum[index2];
-      } else {
-        tmpRSum[index] = 0;
-        tmpGSum[index] = 0;
-        tmpBSum[index] = 0;
-        tmpWSum[index] = 0;
-      }
-      uint32_t c = getPixelColorXY(x, y);
-      rS += R(c);
-      gS += G(c);
-      bS += B(c);
-      wS += W(c);
-      tmpRSum[index] += rS;
-      tmpGSum[index] += gS;
-      tmpBSum[index] += bS;
-      tmpWSum[index] += wS;
-    }
-  }
-  // do a box blur using pre-calculated sums
-  for (unsigned x = 0; x < cols; x++) {
-    for (unsigned y = 0; y < rows; y++) {
-      // sum = D + A - B - C where k = (x,y)
-      // +----+-+---- (x)
-      // |    | |
-      // +----A-B
-      // |    |k|
-      // +----C-D
-      // |
-      //(y)
-      unsigned x0 = x < radius ? 0 : x - radius;
-      unsigned y0 = y < radius ? 0 : y - radius;
-      unsigned x1 = x >= cols - radius ? cols - 1 : x + radius;
-      unsigned y1 = y >= rows - radius ? rows - 1 : y + radius;
-      unsigned A = x0 * cols + y0;
-      unsigned B = x1 * cols + y0;
-      unsigned C = x0 * cols + y1;
-      unsigned D = x1 * cols + y1;
-      unsigned r = tmpRSum[D] + tmpRSum[A] - tmpRSum[C] - tmpRSum[B];
-      unsigned g = tmpGSum[D] + tmpGSum[A] - tmpGSum[C] - tmpGSum[B];
-      unsigned b = tmpBSum[D] + tmpBSum[A] - tmpBSum[C] - tmpBSum[B];
-      unsigned w = tmpWSum[D] + tmpWSum[A] - tmpWSum[C] - tmpWSum[B];
-      setPixelColorXY(x, y, RGBW32(r/d, g/d, b/d, w/d));
-    }
-  }
-  delete[] tmpRSum;
-  delete[] tmpGSum;
-  delete[] tmpBSum;
-  delete[] tmpWSum;
-}
-*/
 void Segment::moveX(int delta, bool wrap) const {
   if (!isActive() || !delta) return; // not active
   const int vW = vWidth();   // segment width in logical pixels (can be 0 if segment is inactive)
@@ -570,51 +440,6 @@ void Segment::drawLine(uint16_t x0, uint16_t y0, uint16_t x1, uint16_t y1, uint3
   }
 }
 
-#include "src/font/console_font_4x6.h"
-#include "src/font/console_font_5x8.h"
-#include "src/font/console_font_5x12.h"
-#include "src/font/console_font_6x8.h"
-#include "src/font/console_font_7x9.h"
-
-// draws a raster font character on canvas
-// only supports: 4x6=24, 5x8=40, 5x12=60, 6x8=48 and 7x9=63 fonts ATM
-void Segment::drawCharacter(unsigned char chr, int16_t x, int16_t y, uint8_t w, uint8_t h, uint32_t color, uint32_t col2, int8_t rotate) const {
-  if (!isActive()) return; // not active
-  if (chr < 32 || chr > 126) return; // only ASCII 32-126 supported
-  chr -= 32; // align with font table entries
-  const int font = w*h;
-
-  // if col2 == BLACK then use currently selected palette for gradient otherwise create gradient from color and col2
-  CRGBPalette16 grad = col2 ? CRGBPalette16(CRGB(color), CRGB(col2)) : SEGPALETTE; // selected palette as gradient
-
-  for (int i = 0; i<h; i++) { // character height
-    uint8_t bits = 0;
-    switch (font) {
-      case 24: bits = pgm_read_byte_near(&console_font_4x6[(chr * h) + i]); break;  // 4x6 font
-      case 40: bits = pgm_read_byte_near(&console_font_5x8[(chr * h) + i]); break;  // 5x8 font
-      case 48: bits = pgm_read_byte_near(&console_font_6x8[(chr * h) + i]); break;  // 6x8 font
-      case 63: bits = pgm_read_byte_near(&console_font_7x9[(chr * h) + i]); break;  // 7x9 font
-      case 60: bits = pgm_read_byte_near(&console_font_5x12[(chr * h) + i]); break; // 5x12 font
-      default: return;
-    }
-    CRGBW c = ColorFromPalette(grad, (i+1)*255/h, 255, LINEARBLEND_NOWRAP); // NOBLEND is faster
-    for (int j = 0; j<w; j++) { // character width
-      int x0, y0;
-      switch (rotate) {
-        case -1: x0 = x + (h-1) - i; y0 = y + (w-1) - j; break; // -90 deg
-        case -2:
-        case  2: x0 = x + j;         y0 = y + (h-1) - i; break; // 180 deg
-        case  1: x0 = x + i;         y0 = y + j;         break; // +90 deg
-        default: x0 = x + (w-1) - j; y0 = y + i;         break; // no rotation
-      }
-      if (x0 < 0 || x0 >= (int)vWidth() || y0 < 0 || y0 >= (int)vHeight()) continue; // drawing off-screen
-      if (((bits>>(j+(8-w))) & 0x01)) { // bit set
-        setPixelColorXYRaw(x0, y0, c.color32);
-      }
-    }
-  }
-}
-
 #define WU_WEIGHT(a,b) ((uint8_t) (((a)*(b)+(a)+(b))>>8))
 void Segment::wu_pixel(uint32_t x, uint32_t y, CRGB c) const {      //awesome wu_pixel procedure by reddit u/sutaburosu
   if (!isActive()) return; // not active
@@ -0,0 +1,151 @@
+/*
+  FX_blur.cpp contains 2D blurring of segment pixels (blur2D() and box_blur())
+
+  Copyright (c) 2022  Blaz Kristan (https://blaz.at/home)
+  Licensed under the EUPL v. 1.2 or later
+  Adapted from code originally licensed under the MIT license
+*/
+#include "wled.h"
+
+#ifndef WLED_DISABLE_2D
+
+// two-channel SWAR helpers for blurring: a color is split into R&B and W&G words with 16 bit per channel
+// scaling and saturating addition of both halves are bit-exact to color_fade() and color_add()
+#define BLUR_2CH_MASK   0x00FF00FFU
+#define BLUR_TILE       16 // number of columns processed at once in column passes (keeps accessed rows cache resident)
+#define BLUR_MAX_RADIUS 8  // largest box_blur() radius
+static inline uint32_t scale2ch(uint32_t ch, uint32_t scale) { return ((ch * scale) >> 8) & BLUR_2CH_MASK; }
+static inline uint32_t addsat2ch(uint32_t a, uint32_t b) {
+  uint32_t s = a + b;                             // each channel is at most 0x1FE
+  return (s | (((s >> 8) & 0x00010001U) * 0xFF)) & BLUR_2CH_MASK;
+}
+static inline uint32_t max2ch(uint32_t a, uint32_t b) {
+  uint32_t mask = ((((b | 0x01000100U) - a) & 0x01000100U) >> 8) * 0xFF; // 0xFF where b >= a
+  return (b & mask) | (a & ~mask);
+}
+
+// 2D blurring, can be asymmetrical
+void Segment::blur2D(uint8_t blur_x, uint8_t blur_y, bool smear) const {
+  if (!isActive()) return; // not active
+  const unsigned cols = vWidth();
+  const unsigned rows = vHeight();
+  uint32_t *px = getPixels();
+  if (blur_x) {
+    const uint32_t keepx = (smear ? 255 : 255 - blur_x) + 1; // +1 for correct scaling using bitshifts (same as color_fade())
+    const uint32_t seepx = (blur_x >> 1) + 1;
+    for (unsigned row = 0; row < rows; row++) { // blur rows (x direction)
+      uint32_t *line = px + row * cols;
+      uint32_t carryRB = 0, carryWG = 0;
+      uint32_t lastRB = 0, lastWG = 0;
+      for (unsigned x = 0; x < cols; x++) {
+        const uint32_t cur = line[x];
+        const uint32_t rb = cur & BLUR_2CH_MASK, wg = (cur >> 8) & BLUR_2CH_MASK;
+        const uint32_t partRB = scale2ch(rb, seepx), partWG = scale2ch(wg, seepx);
+        const uint32_t newRB = addsat2ch(scale2ch(rb, keepx), carryRB);
+        const uint32_t newWG = addsat2ch(scale2ch(wg, keepx), carryWG);
+        if (x > 0) line[x-1] = addsat2ch(lastRB, partRB) | (addsat2ch(lastWG, partWG) << 8);
+        lastRB = newRB; lastWG = newWG;
+        carryRB = partRB; carryWG = partWG;
+      }
+      line[cols-1] = lastRB | (lastWG << 8); // set last pixel
+    }
+  }
+  if (blur_y) {
+    const uint32_t keepy = (smear ? 255 : 255 - blur_y) + 1;
+    const uint32_t seepy = (blur_y >> 1) + 1;
+    // process columns in tiles so that each pass over the rows touches only a few consecutive pixels
+    uint32_t carryRB[BLUR_TILE], carryWG[BLUR_TILE], lastRB[BLUR_TILE], lastWG[BLUR_TILE];
+    for (unsigned col0 = 0; col0 < cols; col0 += BLUR_TILE) {
+      const unsigned tile = min(cols - col0, (unsigned)BLUR_TILE);
+      memset(carryRB, 0, sizeof(carryRB));
+      memset(carryWG, 0, sizeof(carryWG));
+      for (unsigned y = 0; y < rows; y++) {
+        uint32_t *line = px + y * cols + col0;
+        uint32_t *prev = line - cols; // only used if y > 0
+        for (unsigned t = 0; t < tile; t++) {
+          const uint32_t cur = line[t];
+          const uint32_t rb = cur & BLUR_2CH_MASK, wg = (cur >> 8) & BLUR_2CH_MASK;
+          const uint32_t partRB = scale2ch(rb, seepy), partWG = scale2ch(wg, seepy);
+          const uint32_t newRB = addsat2ch(scale2ch(rb, keepy), carryRB[t]);
+          const uint32_t newWG = addsat2ch(scale2ch(wg, keepy), carryWG[t]);
+          if (y > 0) prev[t] = addsat2ch(lastRB[t], partRB) | (addsat2ch(lastWG[t], partWG) << 8);
+          lastRB[t] = newRB; lastWG[t] = newWG;
+          carryRB[t] = partRB; carryWG[t] = partWG;
+        }
+      }
+      uint32_t *line = px + (rows - 1) * cols + col0;
+      for (unsigned t = 0; t < tile; t++) line[t] = lastRB[t] | (lastWG[t] << 8); // set last pixels
+    }
+  }
+}
+
+// 2D box blur (separable, edge pixels are replicated), repeated passes approximate a gaussian blur (3 passes are close enough)
+// smear keeps the brighter of the original and the blurred value for each channel
+void Segment::box_blur(unsigned radius, bool smear, unsigned passes) const {
+  if (!isActive() || radius == 0) return; // not active
+  if (radius > BLUR_MAX_RADIUS) radius = BLUR_MAX_RADIUS;
+  const unsigned cols = vWidth();
+  const unsigned rows = vHeight();
+  const unsigned d = 2*radius + 1;
+  const uint32_t recip = ((1U << 20) + d - 1) / d; // 20 bit fixed point reciprocal of the averaging divisor, exact for sums up to 255*(2*BLUR_MAX_RADIUS+1)
+  const auto div2ch = [recip](uint32_t sum) -> uint32_t { return (((sum >> 16) * recip) >> 20) << 16 | (((sum & 0xFFFF) * recip) >> 20); };
+  uint32_t *px = getPixels();
+  uint32_t line[BLUR_MAX_RADIUS + 1];                // original pixels of last radius+1 pixels of current row
+  uint32_t ring[(BLUR_MAX_RADIUS + 1) * BLUR_TILE];  // original pixels of last radius+1 rows of current column tile
+  uint32_t sumRB[BLUR_TILE], sumWG[BLUR_TILE];
+
+  while (passes--) {
+    // rows (x direction), sums of R&B and W&G fit into 16 bit channels
+    for (unsigned y = 0; y < rows; y++) {
+      uint32_t *row = px + y * cols;
+      uint32_t sRB = (radius + 1) * (row[0] & BLUR_2CH_MASK), sWG = (radius + 1) * ((row[0] >> 8) & BLUR_2CH_MASK);
+      for (unsigned i = 1; i <= radius; i++) {
+        const uint32_t c = row[min(i, cols - 1)];
+        sRB += c & BLUR_2CH_MASK; sWG += (c >> 8) & BLUR_2CH_MASK;
+      }
+      for (unsigned x = 0; x < cols; x++) {
+        const uint32_t orig = line[x % (radius + 1)] = row[x];
+        uint32_t rb = div2ch(sRB), wg = div2ch(sWG);
+        if (smear) { rb = max2ch(rb, orig & BLUR_2CH_MASK); wg = max2ch(wg, (orig >> 8) & BLUR_2CH_MASK); }
+        row[x] = rb | (wg << 8);
+        if (x + 1 < cols) {
+          const uint32_t cIn = row[min(x + radius + 1, cols - 1)];                      // not yet overwritten
+          const uint32_t cOut = line[(x < radius ? 0 : x - radius) % (radius + 1)];     // already overwritten, use saved original
+          sRB += (cIn & BLUR_2CH_MASK) - (cOut & BLUR_2CH_MASK);
+          sWG += ((cIn >> 8) & BLUR_2CH_MASK) - ((cOut >> 8) & BLUR_2CH_MASK);
+        }
+      }
+    }
+    // columns (y direction) in tiles, originals of overwritten rows are kept in a small ring buffer
+    for (unsigned col0 = 0; col0 < cols; col0 += BLUR_TILE) {
+      const unsigned tile = min(cols - col0, (unsigned)BLUR_TILE);
+      uint32_t *top = px + col0;
+      for (unsigned t = 0; t < tile; t++) {
+        sumRB[t] = (radius + 1) * (top[t] & BLUR_2CH_MASK);
+        sumWG[t] = (radius + 1) * ((top[t] >> 8) & BLUR_2CH_MASK);
+      }
+      for (unsigned i = 1; i <= radius; i++) {
+        const uint32_t *src = px + min(i, rows - 1) * cols + col0;
+        for (unsigned t = 0; t < tile; t++) { sumRB[t] += src[t] & BLUR_2CH_MASK; sumWG[t] += (src[t] >> 8) & BLUR_2CH_MASK; }
+      }
+      for (unsigned y = 0; y < rows; y++) {
+        uint32_t *dst = px + y * cols + col0;
+        uint32_t *orig = ring + (y % (radius + 1)) * BLUR_TILE;
+        const uint32_t *in  = px + min(y + radius + 1, rows - 1) * cols + col0;              // not yet overwritten
+        const uint32_t *out = ring + ((y < radius ? 0 : y - radius) % (radius + 1)) * BLUR_TILE; // already overwritten, use saved original
+        memcpy(orig, dst, tile * sizeof(uint32_t));
+        for (unsigned t = 0; t < tile; t++) {
+          uint32_t rb = div2ch(sumRB[t]), wg = div2ch(sumWG[t]);
+          if (smear) { rb = max2ch(rb, orig[t] & BLUR_2CH_MASK); wg = max2ch(wg, (orig[t] >> 8) & BLUR_2CH_MASK); }
+          dst[t] = rb | (wg << 8);
+          if (y + 1 < rows) {
+            sumRB[t] += (in[t] & BLUR_2CH_MASK) - (out[t] & BLUR_2CH_MASK);
+            sumWG[t] += ((in[t] >> 8) & BLUR_2CH_MASK) - ((out[t] >> 8) & BLUR_2CH_MASK);
+          }
+        }
+      }
+    }
+  }
+}
+
+#endif // WLED_DISABLE_2D
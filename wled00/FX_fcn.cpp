@@ -205,6 +205,9 @@ void Segment::resetIfRequired() {
   #ifdef WLED_ENABLE_GIF
   endImagePlayback(this);
   #endif
+  #ifdef WLED_ENABLE_FSEQ
+  endFseqPlayback(this);
+  #endif
 }
 
 CRGBPalette16 &Segment::loadPalette(CRGBPalette16 &targetPalette, uint8_t pal) {
@@ -1027,7 +1030,6 @@ void Segment::blur(uint8_t blur_amount, bool smear) const {
   if (is2D()) {
     // compatibility with 2D
     blur2D(blur_amount, blur_amount, smear); // symmetrical 2D blur
-    //box_blur(map(blur_amount,1,255,1,3), smear);
     return;
   }
 #endif
@@ -1198,11 +1200,17 @@ void WS2812FX::service() {
   now = nowUp + timebase;
   unsigned long elapsed = nowUp - _lastServiceShow;
   if (_suspend || elapsed <= MIN_FRAME_DELAY) return;   // keep wifi alive - no matter if triggered or unlimited
-  if (!_triggered && (_targetFps != FPS_UNLIMITED)) {   // unlimited mode = no frametime
-    if (elapsed < _frametime) return;                   // too early for service
+  if (!_triggered && isFrameRateLimited()) {            // unlimited mode = no frametime
+    if (elapsed < _showtime) return;                    // too early for service
   }
 
   bool doShow = false;
+  uint32_t serviceStart = perfStart();
+  unsigned long frameStart = micros();
+  uint32_t slowestSegUs = 0;
+  uint8_t  slowestSeg = 0;
+  // frame started more than half a frame late (main loop was busy elsewhere)
+  if (isFrameRateLimited() && _lastServiceShow && elapsed > _showtime + _showtime/2) _missedDeadlines++;
 
   _isServicing = true;
   _segment_index = 0;
@@ -1218,10 +1226,12 @@ void WS2812FX::service() {
     if (!seg.isActive()) continue;
 
     // last condition ensures all solid segments are updated at the same time
-    if (nowUp > seg.next_time || _triggered || (doShow && seg.mode == FX_MODE_STATIC))
+    // (with adaptive pacing segment buffers are relied upon to hold solid content, they are refreshed at keep-alive rate)
+    if (nowUp > seg.next_time || _triggered || (doShow && seg.mode == FX_MODE_STATIC && !_adaptiveFps))
     {
       doShow = true;
       unsigned frameDelay = FRAMETIME;
+      unsigned long segStart = micros();
 
       if (!seg.freeze) { //only run effect function if not frozen
         // Effect blending
@@ -1229,7 +1239,9 @@ void WS2812FX::service() {
         seg.beginDraw(prog);                // set up parameters for get/setPixelColor() (will also blend colors and palette if blend style is FADE)
         _currentSegment = &seg;             // set current segment for effect functions (SEGMENT & SEGENV)
         // workaround for on/off transition to respect blending style
+        uint32_t effectStart = perfStart();
         frameDelay = (*_mode[seg.mode])();  // run new/current mode (needed for bri workaround)
+        perfEndEffect(seg.mode, effectStart);
         seg.call++;
         // if segment is in transition and no old segment exists we don't need to run the old mode
         // (blendSegments() takes care of On/Off transitions and clipping)
@@ -1245,6 +1257,9 @@ void WS2812FX::service() {
         }
         if (seg.isInTransition() && frameDelay > FRAMETIME) frameDelay = FRAMETIME; // force faster updates during transition
       }
+      if (_adaptiveFps && seg.mode == FX_MODE_STATIC && !seg.isInTransition() && !_isOffRefreshRequired) frameDelay = max(frameDelay, (unsigned)PACING_KEEPALIVE);
+      uint32_t segUs = micros() - segStart;
+      if (segUs > slowestSegUs) { slowestSegUs = segUs; slowestSeg = _segment_index; }
 
       seg.next_time = nowUp + frameDelay;
     }
@@ -1259,6 +1274,8 @@ void WS2812FX::service() {
     Segment::handleRandomPalette(); // slowly transition random palette; move it into for loop when each segment has individual random palette
     _lastServiceShow = nowUp; // update timestamp, for precise FPS control
     show();
+    perfEnd(PERF_SERVICE, serviceStart);
+    updatePacing(micros() - frameStart - _busShowUs, slowestSegUs, slowestSeg);
   }
   #ifdef WLED_DEBUG
   if ((_targetFps != FPS_UNLIMITED) && (millis() - nowUp > _frametime)) DEBUG_PRINTF_P(PSTR("Slow strip %u/%d.\n"), (unsigned)(millis()-nowUp), (int)_frametime);
@@ -1526,8 +1543,50 @@ void WS2812FX::blendSegment(const Segment &topSegment) const {
   Segment::setClippingRect(0, 0);             // disable clipping for overlays
 }
 
+static inline uint32_t pixelPower(uint32_t c, bool useWackyWS2815PowerModel) {
+  byte r = R(c), g = G(c), b = B(c), w = W(c);
+  if (useWackyWS2815PowerModel) return (max(max(r,g),b)) * 3; //ignore white component on WS2815 power calculation
+  return r + g + b + w;
+}
+
+// sums up channel values of the bus' pixels in the composited frame (max would be getLength()*765 as white is excluded)
+// bus pixels are physical, the frame is logical: with a ledmap the sum uses the same physical->logical gather table as
+// painting in show(); if there was no RAM for the table (mapped == true, gather == nullptr) all logical pixels are mapped
+// with output != nullptr colors are converted as the bus will send them (gamma, auto white and white balance from the
+// pixel's CCT (output->pixelCCT) or the global bus CCT (output->cct)) so that current added by auto white is accounted for
+struct PowerSumOutput {
+  bool           applyGamma;
+  bool           correctWB;
+  int16_t        cct;
+  const uint8_t *pixelCCT;
+};
+
+static uint32_t busPowerSum(const Bus *bus, const uint32_t *pixels, const uint16_t *gather, bool mapped, bool useWackyWS2815PowerModel, const PowerSumOutput *output = nullptr) {
+  uint32_t sum = 0;
+  const unsigned start = bus->getStart(), end = start + bus->getLength();
+  const unsigned totalLen = strip.getLengthTotal();
+  const auto power = [&](unsigned i) -> uint32_t {
+    if (!output) return pixelPower(pixels[i], useWackyWS2815PowerModel);
+    const int16_t cct = output->pixelCCT ? (output->correctWB ? 1900 + (output->pixelCCT[i] << 5) : output->pixelCCT[i]) : output->cct;
+    return pixelPower(bus->getOutputColor(output->applyGamma ? gamma32(pixels[i]) : pixels[i], cct), useWackyWS2815PowerModel);
+  };
+  if (mapped && !gather) {
+    for (unsigned i = 0; i < totalLen; i++) {
+      const unsigned p = strip.getMappedPixelIndex(i);
+      if (p >= start && p < end) sum += power(i);
+    }
+    return sum;
+  }
+  for (unsigned p = start; p < end && p < totalLen; p++) {
+    const unsigned i = gather ? gather[p] : p;
+    if (i == 0xFFFF) continue; // physical pixel is not painted
+    sum += power(i);
+  }
+  return sum;
+}
+
 // To disable brightness limiter we either set output max current to 0 or single LED current to 0
-static uint8_t estimateCurrentAndLimitBri(uint8_t brightness, uint32_t *pixels) {
+static uint8_t estimateCurrentAndLimitBri(uint8_t brightness, const uint32_t *pixels, const uint16_t *gather, bool mapped) {
   unsigned milliAmpsMax = BusManager::ablMilliampsMax();
   if (milliAmpsMax > 0) {
     unsigned milliAmpsTotal = 0;
@@ -1547,23 +1606,14 @@ static uint8_t estimateCurrentAndLimitBri(uint8_t brightness, uint32_t *pixels)
       avgMilliAmpsPerLED += maPL * bus->getLength();
       lengthDigital += bus->getLength();
       // sum up the usage of each LED on digital bus
-      uint32_t busPowerSum = 0;
-      for (unsigned j = 0; j < bus->getLength(); j++) {
-        uint32_t c = pixels[j + bus->getStart()];
-        byte r = R(c), g = G(c), b = B(c), w = W(c);
-        if (useWackyWS2815PowerModel) { //ignore white component on WS2815 power calculation
-          busPowerSum += (max(max(r,g),b)) * 3;
-        } else {
-          busPowerSum += (r + g + b + w);
-        }
-      }
+      uint32_t powerSum = busPowerSum(bus, pixels, gather, mapped, useWackyWS2815PowerModel);
       // RGBW led total output with white LEDs enabled is still 50mA, so each channel uses less
       if (bus->hasWhite()) {
-        busPowerSum *= 3;
-        busPowerSum >>= 2; //same as /= 4
+        powerSum *= 3;
+        powerSum >>= 2; //same as /= 4
       }
       // powerSum has all the values of channels summed (max would be getLength()*765 as white is excluded) so convert to milliAmps
-      milliAmpsTotal += (busPowerSum * maPL * brightness) / (765*255);
+      milliAmpsTotal += (powerSum * maPL * brightness) / (765*255);
     }
     if (lengthDigital > 0) {
       avgMilliAmpsPerLED /= lengthDigital;
@@ -1603,7 +1653,9 @@ void WS2812FX::show() {
     for (size_t i = 0; i < totalLen; i++) _pixels[i] = BLACK; // memset(_pixels, 0, sizeof(uint32_t) * getLengthTotal());
     // blend all segments into (cleared) buffer
     for (Segment &seg : _segments) if (seg.isActive() && (seg.on || seg.isInTransition())) {
+      uint32_t blendStart = perfStart();
       blendSegment(seg);              // blend segment's buffer into frame buffer
+      perfEnd(PERF_BLEND, blendStart);
     }
   }
 
@@ -1611,23 +1663,71 @@ void WS2812FX::show() {
   show_callback callback = _callback;
   if (callback) callback(); // will call setPixelColor or setRealtimePixelColor
 
+  uint32_t convertStart = perfStart();
+  // with a ledmap active, gather[] holds the logical pixel shown by each physical pixel (last one mapped to it wins)
+  // physical pixels without a logical pixel are 0xFFFF and are left untouched
+  uint16_t *gather = nullptr;
+  const bool useMap = customMappingSize > 0 && (realtimeMode == REALTIME_MODE_INACTIVE || realtimeRespectLedMaps);
+  if (useMap) {
+    gather = static_cast<uint16_t*>(d_malloc(totalLen * sizeof(uint16_t)));
+    if (gather) {
+      for (size_t p = 0; p < totalLen; p++) gather[p] = 0xFFFF;
+      for (size_t i = 0; i < customMappingSize; i++) if (customMappingTable[i] < totalLen) gather[customMappingTable[i]] = i;
+      for (size_t p = customMappingSize; p < totalLen; p++) gather[p] = p; // unmapped tail is painted 1:1 (after mapped pixels)
+    }
+  }
+
   // determine ABL brightness
-  uint8_t newBri = estimateCurrentAndLimitBri(_brightness, _pixels);
+  uint8_t newBri = estimateCurrentAndLimitBri(_brightness, _pixels, gather, useMap);
   if (newBri != _brightness) BusManager::setBrightness(newBri);
+  const bool noGamma = realtimeMode && arlsDisableGammaCorrection;
+  // per bus ABL (max current defined per bus) is decided here as well, buses scale pixels while they are set
+  const PowerSumOutput output = { !noGamma, correctWB, cctFromRgb ? int16_t(-1) : Bus::getCCT(), _pixelCCT };
+  for (size_t i = 0; i < BusManager::getNumBusses(); i++) {
+    Bus *bus = BusManager::getBus(i);
+    if (!(bus && bus->isDigital() && bus->isOk()) || bus->getMaxCurrent() == 0 || bus->getLEDCurrent() == 0) continue;
+    bus->limitCurrent(busPowerSum(bus, _pixels, gather, useMap, bus->getLEDCurrent() == 255, &output));
+  }
 
   // paint actual pixels
   int oldCCT = Bus::getCCT(); // store original CCT value (since it is global)
   // when cctFromRgb is true we implicitly calculate WW and CW from RGB values (cct==-1)
   if (cctFromRgb) BusManager::setSegmentCCT(-1);
-  for (size_t i = 0; i < totalLen; i++) {
-    // when correctWB is true setSegmentCCT() will convert CCT into K with which we can then
-    // correct/adjust RGB value according to desired CCT value, it will still affect actual WW/CW ratio
-    if (_pixelCCT) { // cctFromRgb already exluded at allocation
-      if (i == 0 || _pixelCCT[i-1] != _pixelCCT[i]) BusManager::setSegmentCCT(_pixelCCT[i], correctWB);
+  if (useMap && !gather) {
+    // not enough RAM for gather table, paint pixel by pixel
+    for (size_t i = 0; i < totalLen; i++) {
+      if (_pixelCCT && (i == 0 || _pixelCCT[i-1] != _pixelCCT[i])) BusManager::setSegmentCCT(_pixelCCT[i], correctWB);
+      BusManager::setPixelColor(getMappedPixelIndex(i), noGamma ? _pixels[i] : gamma32(_pixels[i]));
+    }
+  } else {
+    // hand contiguous runs of physical pixels to the buses, a run ends at a chunk boundary,
+    // an untouched (unmapped) physical pixel or a change of pixel CCT
+    constexpr size_t SHOW_CHUNK = 64;
+    uint32_t chunk[SHOW_CHUNK];
+    int runCCT = -1;
+    size_t p = 0;
+    while (p < totalLen) {
+      if (gather && gather[p] == 0xFFFF) { p++; continue; }
+      const size_t start = p;
+      size_t n = 0;
+      do {
+        const size_t i = gather ? gather[p] : p;
+        // when correctWB is true setSegmentCCT() will convert CCT into K with which we can then
+        // correct/adjust RGB value according to desired CCT value, it will still affect actual WW/CW ratio
+        if (_pixelCCT && _pixelCCT[i] != runCCT) { // cctFromRgb already exluded at allocation
+          if (n) break;
+          runCCT = _pixelCCT[i];
+          BusManager::setSegmentCCT(runCCT, correctWB);
+        }
+        chunk[n++] = noGamma ? _pixels[i] : gamma32(_pixels[i]);
+        p++;
+      } while (n < SHOW_CHUNK && p < totalLen && !(gather && gather[p] == 0xFFFF));
+      BusManager::setPixels(start, n, chunk);
     }
-    BusManager::setPixelColor(getMappedPixelIndex(i), realtimeMode && arlsDisableGammaCorrection ? _pixels[i] : gamma32(_pixels[i]));
   }
+  d_free(gather);
   Bus::setCCT(oldCCT);  // restore old CCT for ABL adjustments
+  perfEnd(PERF_CONVERT, convertStart);
 
   d_free(_pixelCCT);
   _pixelCCT = nullptr;
@@ -1635,7 +1735,9 @@ void WS2812FX::show() {
   // some buses send asynchronously and this method will return before
   // all of the data has been sent.
   // See https://github.com/Makuna/NeoPixelBus/wiki/ESP32-NeoMethods#neoesp32rmt-methods
+  unsigned long busShowStart = micros();
   BusManager::show();
+  _busShowUs = micros() - busShowStart;
 
   // restore brightness for next frame
   if (newBri != _brightness) BusManager::setBrightness(_brightness);
@@ -1681,12 +1783,6 @@ void WS2812FX::waitForIt() {
   #endif
 };
 
-void WS2812FX::setTargetFps(unsigned fps) {
-  if (fps <= 250) _targetFps = fps;
-  if (_targetFps > 0) _frametime = 1000 / _targetFps;
-  else _frametime = MIN_FRAME_DELAY;     // unlimited mode
-}
-
 void WS2812FX::setCCT(uint16_t k) {
   for (Segment &seg : _segments) {
     if (seg.isActive() && seg.isSelected()) {
@@ -0,0 +1,107 @@
+/*
+  FX_life.cpp contains the cellular automaton engine of the Game of Life effect (see mode_2Dgameoflife())
+
+  Cell states are kept in bitboards (32 cells per word, one bit per cell, rows of (cols+31)/32 words) and neighbours
+  are counted for a whole word at once using bit-sliced adders. A separate byte plane holds the palette index of each cell.
+
+  Licensed under the EUPL v. 1.2 or later
+*/
+#include "wled.h"
+
+#ifndef WLED_DISABLE_2D
+
+// parses rule strings like "B3/S23" or "B2/S/C3"
+void parseLifeRule(const char *rule, lifeState *s) {
+  s->birth = s->survive = 0;
+  s->states = 2;
+  uint16_t *mask = nullptr;
+  char c;
+  while ((c = pgm_read_byte(rule++))) {
+    if      (c == 'B' || c == 'b') mask = &s->birth;
+    else if (c == 'S' || c == 's') mask = &s->survive;
+    else if (c == 'C' || c == 'c') { mask = nullptr; s->states = constrain(atoi(rule), 2, 3); }  // only 2 and 3 states supported
+    else if (c >= '0' && c <= '8' && mask) *mask |= 1U << (c - '0');
+  }
+}
+
+// picks a random set bit from a word (used for sparse mutations)
+static uint32_t randomBit(uint32_t v) {
+  for (unsigned n = hw_random8(__builtin_popcount(v)); n; n--) v &= v - 1;
+  return v & -v;
+}
+
+// computes the next generation (nAlive/nDying) from alive/dying, world wraps around at the edges
+// newborn cells take the dominant color of their live neighbours in colorIdx
+void lifeGeneration(const lifeState *s, const uint32_t *alive, const uint32_t *dying, uint32_t *nAlive, uint32_t *nDying, uint8_t *colorIdx, int cols, int rows, bool mutate) {
+  const int wpr = (cols + 31) >> 5;                                   // words per row
+  const uint32_t lastMask = (cols & 31) ? (1U << (cols & 31)) - 1 : 0xFFFFFFFFU; // valid bits in last word of a row
+  const unsigned lastBit = (cols - 1) & 31;
+
+  // horizontal neighbours with wrap-around (bit n of word w is cell w*32+n)
+  const auto west = [&](const uint32_t *row, int w) -> uint32_t { return (row[w] << 1) | (w > 0 ? row[w-1] >> 31 : (row[wpr-1] >> lastBit) & 1); };
+  const auto east = [&](const uint32_t *row, int w) -> uint32_t { return (row[w] >> 1) | (w < wpr-1 ? row[w+1] << 31 : (row[0] & 1) << lastBit); };
+  const auto isAlive = [&](int x, int y) -> bool { return (alive[y*wpr + (x >> 5)] >> (x & 31)) & 1; };
+
+  for (int y = 0; y < rows; y++) {
+    const uint32_t *up  = alive + ((y + rows - 1) % rows) * wpr;
+    const uint32_t *mid = alive + y * wpr;
+    const uint32_t *dn  = alive + ((y + 1) % rows) * wpr;
+    for (int w = 0; w < wpr; w++) {
+      const uint32_t nb[8] = { west(up,w), up[w], east(up,w), west(mid,w), east(mid,w), west(dn,w), dn[w], east(dn,w) };
+      // bit-sliced neighbour count (s3..s0 hold count 0-8 for each of the 32 cells)
+      uint32_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+      for (int i = 0; i < 8; i++) {
+        uint32_t c0 = s0 & nb[i]; s0 ^= nb[i];
+        uint32_t c1 = s1 & c0;    s1 ^= c0;
+        uint32_t c2 = s2 & c1;    s2 ^= c1;
+        s3 |= c2;
+      }
+      uint32_t bornMask = 0, surviveMask = 0;
+      for (unsigned n = 0; n <= 8; n++) {
+        if (!((s->birth | s->survive) & (1U << n))) continue;
+        uint32_t eq = (n & 1 ? s0 : ~s0) & (n & 2 ? s1 : ~s1) & (n & 4 ? s2 : ~s2) & (n & 8 ? s3 : ~s3);
+        if (s->birth   & (1U << n)) bornMask    |= eq;
+        if (s->survive & (1U << n)) surviveMask |= eq;
+      }
+      const unsigned idx = y * wpr + w;
+      const uint32_t cur = mid[w];
+      const uint32_t validMask = (w == wpr-1) ? lastMask : 0xFFFFFFFFU;
+      uint32_t born = bornMask & ~cur & ~dying[idx] & validMask;
+      if (mutate) {
+        // randomly suppress a birth to avoid endless "gliders" and randomly spawn cells with 2 neighbours (avoids stagnation)
+        if (born && hw_random8() < 2 * __builtin_popcount(born)) born &= ~randomBit(born);
+        const uint32_t cand = ~s3 & ~s2 & s1 & ~s0 & ~cur & ~dying[idx] & ~born & validMask;
+        if (cand && hw_random8() < 2 * __builtin_popcount(cand)) {
+          const uint32_t bit = randomBit(cand);
+          born |= bit;
+          colorIdx[y * cols + (w << 5) + __builtin_ctz(bit)] = hw_random8();
+          bornMask &= ~bit; // color already assigned
+        }
+      }
+      nAlive[idx] = (cur & surviveMask) | born;
+      nDying[idx] = s->states > 2 ? cur & ~surviveMask : 0;
+
+      // newborn cells take the dominant color of their live neighbours
+      for (uint32_t b = born & bornMask; b; b &= b - 1) {
+        const int x = (w << 5) + __builtin_ctz(b);
+        uint8_t nColor[8], nCount[8];
+        unsigned found = 0;
+        for (int j = -1; j <= 1; j++) for (int i = -1; i <= 1; i++) {
+          if (i == 0 && j == 0) continue;
+          const int xx = (x + i + cols) % cols, yy = (y + j + rows) % rows;
+          if (!isAlive(xx, yy)) continue;
+          const uint8_t c = colorIdx[yy * cols + xx];
+          unsigned k = 0;
+          while (k < found && nColor[k] != c) k++;
+          if (k == found) { nColor[found] = c; nCount[found++] = 0; }
+          nCount[k]++;
+        }
+        unsigned dominant = 0;
+        for (unsigned k = 1; k < found; k++) if (nCount[k] > nCount[dominant]) dominant = k;
+        if (found) colorIdx[y * cols + x] = nColor[dominant];
+      }
+    }
+  }
+}
+
+#endif // WLED_DISABLE_2D
@@ -0,0 +1,61 @@
+/*
+  FX_pacing.cpp contains frame pacing of WS2812FX: the configured frame time and, with adaptive pacing, the show
+  interval adapted to the measured cost of effects and LED outputs (see updatePacing())
+
+  Licensed under the EUPL v. 1.2 or later
+*/
+#include "wled.h"
+
+unsigned long WS2812FX::timeToNextFrame() const {
+  if (_suspend) return ULONG_MAX;
+  unsigned long elapsed = millis() - _lastServiceShow;
+  unsigned long minDelay = (_triggered || !isFrameRateLimited()) ? MIN_FRAME_DELAY + 1 : max((unsigned)_showtime, MIN_FRAME_DELAY + 1U);
+  return elapsed >= minDelay ? 0 : minDelay - elapsed;
+}
+
+void WS2812FX::setTargetFps(unsigned fps) {
+  if (fps <= 250) _targetFps = fps;
+  if (_targetFps > 0) _frametime = 1000 / _targetFps;
+  else _frametime = MIN_FRAME_DELAY;     // unlimited mode
+  _showtime = _frametime;
+  _paceLowSince = 0;
+}
+
+void WS2812FX::setAdaptiveFps(bool enable) {
+  _adaptiveFps = enable;
+  setTargetFps(_targetFps); // restore configured frame time
+}
+
+// measures frame cost and, when adaptive pacing is enabled, adapts the show interval to what effects and outputs can sustain
+// (FRAMETIME stays at the configured value so that effects timed by it keep their speed)
+// frame time is raised at once when a frame costs more than it allows, but lowered only after cost stayed
+// lower for PACING_HOLD ms (and then only halfway) so that the cadence stays stable instead of oscillating
+void WS2812FX::updatePacing(uint32_t renderUs, uint32_t segUs, uint8_t segId) {
+  _renderUs     = (_renderUs * 7 + renderUs) / 8;
+  _slowestSegUs = min(unsigned(_slowestSegUs * 7U + segUs) / 8U, 65535U);
+  _slowestSeg   = segId;
+
+  unsigned asyncUs, syncUs;
+  BusManager::getPacingTimes(asyncUs, syncUs);
+  const unsigned cpuUs  = (_renderUs + syncUs) * 100U / WLED_PACING_LOAD; // leave time for network stack
+  const unsigned needMs = (max(cpuUs, asyncUs) + 999U) / 1000U;
+  const unsigned baseMs = _targetFps != FPS_UNLIMITED ? 1000U / _targetFps : MIN_FRAME_DELAY;
+  unsigned wantMs = baseMs;
+  if (needMs <= baseMs) _paceLimit = PACE_TARGET;
+  else {
+    _paceLimit = (asyncUs >= cpuUs || syncUs > _renderUs) ? PACE_OUTPUT : PACE_EFFECTS;
+    wantMs = min(needMs + needMs/8, 1000U); // headroom so that cost jitter does not push frame time up again
+  }
+  if (!_adaptiveFps) return;
+
+  if (wantMs > _showtime) {
+    _showtime = wantMs;
+    _paceLowSince = 0;
+  } else if (wantMs + 1 + wantMs/16 < _showtime || (_paceLimit == PACE_TARGET && wantMs < _showtime)) { // dead band unless back at target
+    if (!_paceLowSince) _paceLowSince = millis();
+    else if (millis() - _paceLowSince > PACING_HOLD) {
+      _showtime = wantMs + (_showtime - wantMs) / 2;
+      _paceLowSince = 0;
+    }
+  } else _paceLowSince = 0;
+}
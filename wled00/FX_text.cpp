@@ -0,0 +1,188 @@
+/*
+  FX_text.cpp contains text drawing on 2D segments (raster fonts)
+
+  Copyright (c) 2022  Blaz Kristan (https://blaz.at/home)
+  Licensed under the EUPL v. 1.2 or later
+  Adapted from code originally licensed under the MIT license
+*/
+#include "wled.h"
+
+#ifndef WLED_DISABLE_2D
+
+#include "src/font/console_font_4x6.h"
+#include "src/font/console_font_5x8.h"
+#include "src/font/console_font_5x12.h"
+#include "src/font/console_font_6x8.h"
+#include "src/font/console_font_7x9.h"
+
+// returns font table for given character size
+// only supports: 4x6=24, 5x8=40, 5x12=60, 6x8=48 and 7x9=63 fonts ATM
+static const unsigned char *fontData(uint8_t w, uint8_t h) {
+  switch (w*h) {
+    case 24: return console_font_4x6;  // 4x6 font
+    case 40: return console_font_5x8;  // 5x8 font
+    case 48: return console_font_6x8;  // 6x8 font
+    case 63: return console_font_7x9;  // 7x9 font
+    case 60: return console_font_5x12; // 5x12 font
+    default: return nullptr;
+  }
+}
+
+// draws a raster font character on canvas
+void Segment::drawCharacter(unsigned char chr, int16_t x, int16_t y, uint8_t w, uint8_t h, uint32_t color, uint32_t col2, int8_t rotate) const {
+  if (!isActive()) return; // not active
+  if (chr < 32 || chr > 126) return; // only ASCII 32-126 supported
+  chr -= 32; // align with font table entries
+  const unsigned char *font = fontData(w, h);
+  if (!font) return;
+
+  // if col2 == BLACK then use currently selected palette for gradient otherwise create gradient from color and col2
+  CRGBPalette16 grad = col2 ? CRGBPalette16(CRGB(color), CRGB(col2)) : SEGPALETTE; // selected palette as gradient
+
+  for (int i = 0; i<h; i++) { // character height
+    uint8_t bits = pgm_read_byte_near(&font[(chr * h) + i]);
+    CRGBW c = ColorFromPalette(grad, (i+1)*255/h, 255, LINEARBLEND_NOWRAP); // NOBLEND is faster
+    for (int j = 0; j<w; j++) { // character width
+      int x0, y0;
+      switch (rotate) {
+        case -1: x0 = x + (h-1) - i; y0 = y + (w-1) - j; break; // -90 deg
+        case -2:
+        case  2: x0 = x + j;         y0 = y + (h-1) - i; break; // 180 deg
+        case  1: x0 = x + i;         y0 = y + j;         break; // +90 deg
+        default: x0 = x + (w-1) - j; y0 = y + i;         break; // no rotation
+      }
+      if (x0 < 0 || x0 >= (int)vWidth() || y0 < 0 || y0 >= (int)vHeight()) continue; // drawing off-screen
+      if (((bits>>(j+(8-w))) & 0x01)) { // bit set
+        setPixelColorXYRaw(x0, y0, c.color32);
+      }
+    }
+  }
+}
+
+// fonts only contain ASCII, Latin-1 supplement (U+00A0-U+00FF) is transliterated to the closest ASCII character
+static const char latin1Ascii[] PROGMEM =
+  " !cLoY|S\"ca<--R-"
+  "o+23'uP.,1o>423?"
+  "AAAAAAACEEEEIIII"
+  "DNOOOOOxOUUUUYPs"
+  "aaaaaaaceeeeiiii"
+  "dnooooo/ouuuuypy";
+
+// returns next printable ASCII character of UTF-8 (or Latin-1) string, 0 for characters that are not drawn
+static unsigned char nextGlyph(const char *&p) {
+  unsigned char c = *p++;
+  if (c < 0x80) return (c < 32 || c > 126) ? 0 : c;
+  if (c >= 0xC0 && (*p & 0xC0) == 0x80) { // UTF-8 sequence, otherwise Latin-1 character
+    if (c == 0xC2 || c == 0xC3) c = ((c & 0x03) << 6) | (*p++ & 0x3F); // 2 byte sequence for U+0080-U+00FF
+    else { // other code point, skip continuation bytes
+      while ((*p & 0xC0) == 0x80) p++;
+      return '?';
+    }
+  }
+  return c < 0xA0 ? 0 : pgm_read_byte_near(&latin1Ascii[c - 0xA0]); // C1 controls are not drawn
+}
+
+// bitmap size needed for given number of characters (rotated ±90 deg characters are h pixels wide)
+size_t Segment::textRasterSize(size_t chars, uint8_t w, uint8_t h, int8_t rotate) {
+  const bool sideways = (rotate == 1 || rotate == -1);
+  const size_t rowBytes = (chars * (sideways ? h : w+1) + 7) / 8; // proportional glyphs may be w+1 wide
+  return sizeof(textRaster) + rowBytes * (sideways ? w : h);
+}
+
+// renders text into a 1 bit bitmap (only if text or parameters changed), returns false if it does not fit into size bytes
+// proportional spacing uses glyph bitmaps to trim empty columns (not used if characters are rotated ±90 deg)
+bool Segment::rasterizeText(textRaster *t, size_t size, const char *text, uint8_t w, uint8_t h, int8_t rotate, bool proportional) {
+  const unsigned char *font = fontData(w, h);
+  if (!t || !font || size < sizeof(textRaster)) return false;
+  const bool sideways = (rotate == 1 || rotate == -1);
+  if (sideways) proportional = false;
+  uint32_t hash = 2166136261U; // FNV-1a
+  for (const char *p = text; *p; p++) hash = (hash ^ (uint8_t)*p) * 16777619U;
+  const uint8_t params[4] = {w, h, (uint8_t)rotate, proportional};
+  for (unsigned i = 0; i < sizeof(params); i++) hash = (hash ^ params[i]) * 16777619U;
+  if (t->hash == hash) return true; // already rendered
+
+  size_t chars = 0;
+  for (const char *p = text; *p; ) if (nextGlyph(p)) chars++;
+  if (textRasterSize(chars, w, h, rotate) > size) return false;
+  t->height   = sideways ? w : h;
+  t->rowBytes = (chars * (sideways ? h : w+1) + 7) / 8;
+  t->glyphH   = h;
+  t->rotate   = rotate;
+  memset(t->bits, 0, t->rowBytes * t->height);
+
+  unsigned gx = 0; // left edge of current glyph
+  for (const char *p = text; *p; ) {
+    unsigned char chr = nextGlyph(p);
+    if (!chr) continue;
+    const unsigned char *glyph = &font[(chr - 32) * h];
+    uint8_t rows[12]; // largest font is 12 pixels high
+    uint8_t used = 0; // columns with at least one pixel set
+    for (int i = 0; i < h; i++) used |= rows[i] = pgm_read_byte_near(&glyph[i]);
+    unsigned lo = 0, hi = w-1, advance = sideways ? h : w;
+    if (proportional) {
+      if (used) {
+        lo = __builtin_clz((uint32_t)used) - 24; // leftmost column (MSB)
+        hi = 7 - __builtin_ctz((uint32_t)used);  // rightmost column
+        advance = hi - lo + 2;                   // glyph width + 1 column spacing
+      } else advance = max(w/2, 1);            // space
+    }
+    for (int i = 0; i < h; i++) {
+      if (!rows[i]) continue;
+      for (int c = 0; c < w; c++) {
+        if (!((rows[i] >> (7-c)) & 0x01)) continue;
+        unsigned X, Y;
+        switch (rotate) {
+          case -1: X = gx + (h-1) - i;     Y = c;         break; // -90 deg
+          case -2:
+          case  2: X = gx + hi - c;        Y = (h-1) - i; break; // 180 deg
+          case  1: X = gx + i;             Y = (w-1) - c; break; // +90 deg
+          default: X = gx + c - lo;        Y = i;         break; // no rotation
+        }
+        t->bits[Y*t->rowBytes + (X>>3)] |= 0x80 >> (X&7);
+      }
+    }
+    gx += advance;
+  }
+  t->width = gx;
+  t->hash  = hash;
+  return true;
+}
+
+// draws text rendered by rasterizeText() with its top left corner at x,y
+// gradient follows glyph rows as in drawCharacter(), colors are precomputed per glyph row
+void Segment::drawText(const textRaster *t, int x, int y, uint32_t color, uint32_t col2) const {
+  if (!isActive() || !t || !t->width) return; // not active or nothing to draw
+  const int vW = vWidth();
+  const int vH = vHeight();
+  const int h  = t->glyphH;
+  const bool sideways = (t->rotate == 1 || t->rotate == -1);
+  const bool flipped  = (t->rotate == -1 || t->rotate == 2 || t->rotate == -2); // glyph rows run bottom-up or right-left
+
+  // if col2 == BLACK then use currently selected palette for gradient otherwise create gradient from color and col2
+  CRGBPalette16 grad = col2 ? CRGBPalette16(CRGB(color), CRGB(col2)) : SEGPALETTE; // selected palette as gradient
+  uint32_t lut[12];
+  for (int i = 0; i < h; i++) lut[flipped ? h-1-i : i] = CRGBW(ColorFromPalette(grad, (i+1)*255/h, 255, LINEARBLEND_NOWRAP)).color32;
+
+  // visible window
+  const int x0 = max(0, -x);
+  const int x1 = min((int)t->width, vW - x);
+  const int y0 = max(0, -y);
+  const int y1 = min((int)t->height, vH - y);
+  if (x0 >= x1 || y0 >= y1) return;
+
+  for (int Y = y0; Y < y1; Y++) {
+    const uint8_t *row = &t->bits[Y * t->rowBytes];
+    const uint32_t rowColor = lut[Y % h];
+    for (int b = x0 >> 3; b <= (x1-1) >> 3; b++) {
+      uint8_t bits = row[b];
+      if (!bits) continue; // span of 8 empty pixels
+      for (int X = b << 3; bits; X++, bits <<= 1) {
+        if (!(bits & 0x80) || X < x0 || X >= x1) continue;
+        setPixelColorXYRaw(x + X, y + Y, sideways ? lut[X % h] : rowColor);
+      }
+    }
+  }
+}
+
+#endif // WLED_DISABLE_2D
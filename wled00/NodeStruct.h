@@ -5,7 +5,6 @@
 * NodeStruct from the ESP Easy project (https://github.com/letscontrolit/ESPEasy)
 \*********************************************************************************************/
 
-#include <map>
 #include <IPAddress.h>
 
 #define NODE_TYPE_ID_UNDEFINED        0
@@ -15,13 +14,15 @@
 #define NODE_TYPE_ID_ESP32S3         34
 #define NODE_TYPE_ID_ESP32C3         35
 
+#define NODE_NAME_LEN                32
+#define NODE_MAX_AGE                 10 // node is dropped after this many refreshNodeList() calls without info packet
+
 /*********************************************************************************************\
 * NodeStruct
 \*********************************************************************************************/
 struct NodeStruct
 {
-  String    nodeName;
-  IPAddress ip;
+  char      nodeName[NODE_NAME_LEN+1];
   uint8_t   age;
   union {
     uint8_t nodeType;   // a waste of space as we only have 5 types
@@ -30,13 +31,95 @@ struct NodeStruct
       bool    on   : 1;
     };
   };
+  uint32_t  ip;         // full IPv4 address (as uint32_t(IPAddress)), 0 marks a free slot
   uint32_t  build;
+};
+
+/*********************************************************************************************\
+* Fixed capacity node directory (open addressing with linear probing, keyed by full IPv4 address)
+* Slots are allocated on first insert and released by clear(). When WLED_MAX_NODES nodes are known
+* the one not heard from for the longest time (highest age) is replaced.
+\*********************************************************************************************/
+class NodesTable
+{
+  public:
+    static constexpr unsigned bits(unsigned b = 3) { return (1U << b) >= WLED_MAX_NODES + WLED_MAX_NODES/3 ? b : bits(b + 1); } // load factor <= 75%
+    static constexpr size_t   capacity()           { return 1U << bits(); }
+
+    ~NodesTable() { clear(); }
+
+    inline size_t size() const { return _count; }
+    inline const NodeStruct *slot(size_t i) const { return (_slots && i < capacity() && _slots[i].ip) ? &_slots[i] : nullptr; } // nullptr for free slot
+
+    NodeStruct *find(IPAddress addr) {
+      const uint32_t key = uint32_t(addr);
+      if (!_slots || !key) return nullptr;
+      for (size_t i = home(key); _slots[i].ip; i = next(i)) if (_slots[i].ip == key) return &_slots[i];
+      return nullptr;
+    }
+
+    // returns existing or new (zeroed) node, nullptr if out of memory
+    NodeStruct *insert(IPAddress addr) {
+      const uint32_t key = uint32_t(addr);
+      if (!key) return nullptr;
+      NodeStruct *n = find(addr);
+      if (n) return n;
+      if (!_slots) _slots = static_cast<NodeStruct*>(p_calloc(capacity(), sizeof(NodeStruct)));
+      if (!_slots) return nullptr;
+      if (_count >= WLED_MAX_NODES) evictOldest();
+      size_t i = home(key);
+      while (_slots[i].ip) i = next(i);
+      memset(&_slots[i], 0, sizeof(NodeStruct));
+      _slots[i].ip = key;
+      _count++;
+      return &_slots[i];
+    }
+
+    // increments age of all nodes and drops those that reached maxAge
+    void age(uint8_t maxAge) {
+      if (!_slots) return;
+      for (size_t i = 0; i < capacity(); i++) if (_slots[i].ip && _slots[i].age < 255) _slots[i].age++;
+      for (size_t i = 0; i < capacity(); ) {
+        if (_slots[i].ip && _slots[i].age >= maxAge) removeAt(i); // slot is refilled by backward shift, check again
+        else i++;
+      }
+    }
+
+    void clear() {
+      p_free(_slots);
+      _slots = nullptr;
+      _count = 0;
+    }
+
+  private:
+    NodeStruct *_slots = nullptr;
+    size_t      _count = 0;
+
+    static inline size_t home(uint32_t key) { return uint32_t(key * 2654435761U) >> (32 - bits()); } // Fibonacci hashing (uses all octets)
+    static inline size_t next(size_t i)     { return (i + 1) & (capacity() - 1); }
+
+    // backward shift deletion keeps probe sequences intact without tombstones
+    void removeAt(size_t i) {
+      size_t j = i;
+      while (true) {
+        j = next(j);
+        if (!_slots[j].ip) break;
+        const size_t h = home(_slots[j].ip);
+        // move entry j into hole i unless its home lies cyclically in (i, j]
+        if ((i < j) ? (h <= i || h > j) : (h <= i && h > j)) {
+          _slots[i] = _slots[j];
+          i = j;
+        }
+      }
+      _slots[i].ip = 0;
+      _count--;
+    }
 
-  NodeStruct() : age(0), nodeType(0), build(0)
-  {
-    for (unsigned i = 0; i < 4; ++i) { ip[i] = 0; }
-  }
+    void evictOldest() {
+      size_t oldest = capacity();
+      for (size_t i = 0; i < capacity(); i++) if (_slots[i].ip && (oldest == capacity() || _slots[i].age > _slots[oldest].age)) oldest = i;
+      if (oldest < capacity()) removeAt(oldest);
+    }
 };
-typedef std::map<uint8_t, NodeStruct> NodesMap;
 
 #endif // WLED_NODESTRUCT_H
@@ -21,6 +21,7 @@
 #endif
 #include "const.h"
 #include "pin_manager.h"
+#include "perf.h"
 #include "bus_manager.h"
 #include "bus_wrapper.h"
 #include <bits/unique_ptr.h>
@@ -106,9 +107,7 @@ void Bus::calculateCCT(uint32_t c, uint8_t &ww, uint8_t &cw) {
   cw = (w * cw) / 255;
 }
 
-uint32_t Bus::autoWhiteCalc(uint32_t c) const {
-  unsigned aWM = _autoWhiteMode;
-  if (_gAWM < AW_GLOBAL_DISABLED) aWM = _gAWM;
+uint32_t Bus::autoWhiteCalc(uint32_t c, unsigned aWM) {
   if (aWM == RGBW_MODE_MANUAL_ONLY) return c;
   unsigned w = W(c);
   //ignore auto-white calculation if w>0 and mode DUAL (DUAL behaves as BRIGHTER if w==0)
@@ -122,6 +121,20 @@ uint32_t Bus::autoWhiteCalc(uint32_t c) const {
   return RGBW32(r, g, b, w);
 }
 
+// cct as in _cct (white balance correction is applied for values in K)
+uint32_t Bus::getOutputColor(uint32_t c, int16_t cct) const {
+  if (hasWhite()) c = autoWhiteCalc(c);
+  if (cct >= 1900) c = colorBalanceFromKelvin(cct, c);
+  return c;
+}
+
+// averages over ~8 frames, values are only meant for balancing outputs (see /json/info)
+void Bus::updateTimings(unsigned transmitUs) {
+  _prepareUs  = std::min(unsigned((_prepareUs  * 7U + _prepareAcc) / 8U), 65535U);
+  _transmitUs = std::min(unsigned((_transmitUs * 7U + transmitUs)  / 8U), 65535U);
+  _prepareAcc = 0;
+}
+
 
 BusDigital::BusDigital(const BusConfig &bc, uint8_t nr)
 : Bus(bc.type, bc.start, bc.autoWhite, bc.count, bc.reversed, (bc.refreshReq || bc.type == TYPE_TM1814))
@@ -129,6 +142,8 @@ BusDigital::BusDigital(const BusConfig &bc, uint8_t nr)
 , _colorOrder(bc.colorOrder)
 , _milliAmpsPerLed(bc.milliAmpsPerLed)
 , _milliAmpsMax(bc.milliAmpsMax)
+, _milliAmpsTotal(0)
+, _limitBri(255)
 {
   DEBUGBUS_PRINTLN(F("Bus: Creating digital bus."));
   if (!isDigital(bc.type) || !bc.count) { DEBUGBUS_PRINTLN(F("Not digial or empty bus!")); return; }
@@ -173,17 +188,17 @@ BusDigital::BusDigital(const BusConfig &bc, uint8_t nr)
 //I am NOT to be held liable for burned down garages or houses!
 
 // To disable brightness limiter we either set output max current to 0 or single LED current to 0
-uint8_t BusDigital::estimateCurrentAndLimitBri() const {
-  bool useWackyWS2815PowerModel = false;
-  byte actualMilliampsPerLed = _milliAmpsPerLed;
+// powerSum is the sum of all channel values of this bus' pixels as they are sent (after auto white and white balance, see WS2812FX::show())
+// if the budget is exceeded the lower brightness is set before pixels are handed to the bus so that
+// NeoPixelBus scales them once while converting (no read back and repaint of the whole bus)
+void BusDigital::limitCurrent(uint32_t powerSum) {
+  _milliAmpsTotal = 0;
+  _limitBri = _bri;
+  if (!_valid) return;
+  byte actualMilliampsPerLed = _milliAmpsPerLed == 255 ? 12 : _milliAmpsPerLed; // 255 = WS2815 power model, 12mA from testing an actual strip
 
   if (_milliAmpsMax < MA_FOR_ESP/BusManager::getNumBusses() || actualMilliampsPerLed == 0) { //0 mA per LED and too low numbers turn off calculation
-    return _bri;
-  }
-
-  if (_milliAmpsPerLed == 255) {
-    useWackyWS2815PowerModel = true;
-    actualMilliampsPerLed = 12; // from testing an actual strip
+    return;
   }
 
   unsigned powerBudget = (_milliAmpsMax - MA_FOR_ESP/BusManager::getNumBusses()); //80/120mA for ESP power
@@ -193,59 +208,32 @@ uint8_t BusDigital::estimateCurrentAndLimitBri() const {
     powerBudget = 0;
   }
 
-  uint32_t busPowerSum = 0;
-  for (unsigned i = 0; i < getLength(); i++) {  //sum up the usage of each LED
-    uint32_t c = getPixelColor(i); // always returns original or restored color without brightness scaling
-    byte r = R(c), g = G(c), b = B(c), w = W(c);
-
-    if (useWackyWS2815PowerModel) { //ignore white component on WS2815 power calculation
-      busPowerSum += (max(max(r,g),b)) * 3;
-    } else {
-      busPowerSum += (r + g + b + w);
-    }
-  }
-
   if (hasWhite()) { //RGBW led total output with white LEDs enabled is still 50mA, so each channel uses less
-    busPowerSum *= 3;
-    busPowerSum >>= 2; //same as /= 4
+    powerSum *= 3;
+    powerSum >>= 2; //same as /= 4
   }
 
   // powerSum has all the values of channels summed (max would be getLength()*765 as white is excluded) so convert to milliAmps
-  BusDigital::_milliAmpsTotal = (busPowerSum * actualMilliampsPerLed * _bri) / (765*255);
+  // (64 bit product, the result fits 32 bit: long buses exceed the 16 bit _milliAmpsTotal which is only clamped for reporting)
+  const uint32_t milliAmps = (uint64_t(powerSum) * actualMilliampsPerLed * _bri) / (765*255);
 
-  uint8_t newBri = _bri;
-  if (BusDigital::_milliAmpsTotal > powerBudget) {
+  if (milliAmps > powerBudget) {
     //scale brightness down to stay in current limit
-    unsigned scaleB = powerBudget * 255 / BusDigital::_milliAmpsTotal;
-    newBri = (_bri * scaleB) / 256 + 1;
-    BusDigital::_milliAmpsTotal = powerBudget;
-    //_milliAmpsTotal = (busPowerSum * actualMilliampsPerLed * newBri) / (765*255);
+    unsigned scaleB = powerBudget * 255 / milliAmps;
+    _limitBri = (_bri * scaleB) / 256 + 1;
+    _milliAmpsTotal = powerBudget;
+    PolyBus::setBrightness(_busPtr, _iType, _limitBri); // pixels set from now on are scaled by the limited brightness
+  } else {
+    _milliAmpsTotal = std::min(milliAmps, uint32_t(65535));
   }
-  return newBri;
 }
 
 void BusDigital::show() {
-  BusDigital::_milliAmpsTotal = 0;
   if (!_valid) return;
-
-  uint8_t cctWW = 0, cctCW = 0;
-  unsigned newBri = estimateCurrentAndLimitBri();  // will fill _milliAmpsTotal (TODO: could use PolyBus::CalcTotalMilliAmpere())
-  if (newBri < _bri) PolyBus::setBrightness(_busPtr, _iType, newBri); // limit brightness to stay within current limits
-    if (newBri < _bri) {
-      unsigned hwLen = _len;
-      if (_type == TYPE_WS2812_1CH_X3) hwLen = NUM_ICS_WS2812_1CH_3X(_len); // only needs a third of "RGB" LEDs for NeoPixelBus
-      for (unsigned i = 0; i < hwLen; i++) {
-        // use 0 as color order, actual order does not matter here as we just update the channel values as-is
-        uint32_t c = restoreColorLossy(PolyBus::getPixelColor(_busPtr, _iType, i, 0), _bri);
-        if (hasCCT()) Bus::calculateCCT(c, cctWW, cctCW); // this will unfortunately corrupt (segment) CCT data on every bus
-        PolyBus::setPixelColor(_busPtr, _iType, i, c, 0, (cctCW<<8) | cctWW); // repaint all pixels with new brightness
-      }
-    }
   PolyBus::show(_busPtr, _iType, false); // faster if buffer consistency is not important
-  // restore bus brightness to its original value
-  // this is done right after show, so this is only OK if LED updates are completed before show() returns
-  // or async show has a separate buffer (ESP32 RMT and I2S are ok)
-  if (newBri < _bri) PolyBus::setBrightness(_busPtr, _iType, _bri);
+  // restore bus brightness to its original value (only affects pixels set for the next frame)
+  if (_limitBri < _bri) PolyBus::setBrightness(_busPtr, _iType, _bri);
+  _limitBri = _bri;
 }
 
 bool BusDigital::canShow() const {
@@ -253,9 +241,29 @@ bool BusDigital::canShow() const {
   return PolyBus::canShow(_busPtr, _iType);
 }
 
+// bit-banged (ESP8266) and SPI outputs block until all data is sent
+bool BusDigital::isAsync() const {
+  if (!_valid || is2Pin()) return false;
+  #ifdef ESP8266
+  return (_iType % 4) != 0; // every 4th type (I_8266_BB_*) is bit-bang
+  #else
+  return true; // RMT and I2S
+  #endif
+}
+
+// time the frame occupies the data line, computed from bit count and bit rate (one-wire chips run at 800 kHz
+// (400 kHz for old WS2811) and need ~300us latch/reset)
+unsigned BusDigital::getWireTime() const {
+  if (!_valid) return 0;
+  const unsigned bits = (_len + _skip) * getNumberOfChannels() * (is16bit() ? 16 : 8);
+  if (is2Pin()) return _frequencykHz ? bits * 1000U / _frequencykHz : 0;
+  return bits * (_type == TYPE_WS2811_400KHZ ? 10U : 5U) / 4U + 300U; // 1.25us (2.5us) per bit
+}
+
 void BusDigital::setBrightness(uint8_t b) {
   if (_bri == b) return;
   Bus::setBrightness(b);
+  _limitBri = b; // pixels set from now on are scaled by the new brightness
   PolyBus::setBrightness(_busPtr, _iType, b);
 }
 
@@ -278,7 +286,7 @@ void IRAM_ATTR BusDigital::setPixelColor(unsigned pix, uint32_t c) {
   if (_type == TYPE_WS2812_1CH_X3) { // map to correct IC, each controls 3 LEDs
     unsigned pOld = pix;
     pix = IC_INDEX_WS2812_1CH_3X(pix);
-    uint32_t cOld = restoreColorLossy(PolyBus::getPixelColor(_busPtr, _iType, pix, co),_bri);
+    uint32_t cOld = restoreColorLossy(PolyBus::getPixelColor(_busPtr, _iType, pix, co),_limitBri); // IC channels were scaled with current (possibly ABL limited) brightness
     switch (pOld % 3) { // change only the single channel (TODO: this can cause loss because of get/set)
       case 0: c = RGBW32(R(cOld), W(c)   , B(cOld), 0); break;
       case 1: c = RGBW32(W(c)   , G(cOld), B(cOld), 0); break;
@@ -295,6 +303,34 @@ void IRAM_ATTR BusDigital::setPixelColor(unsigned pix, uint32_t c) {
   PolyBus::setPixelColor(_busPtr, _iType, pix, c, co, wwcw);
 }
 
+// bulk variant of setPixelColor(), per-bus settings are evaluated once for the whole range
+void IRAM_ATTR BusDigital::setPixels(unsigned pix, unsigned count, const uint32_t *c) {
+  if (!_valid) return;
+  if (_type == TYPE_WS2812_1CH_X3) { Bus::setPixels(pix, count, c); return; } // needs read-modify-write of shared ICs
+  if (pix >= _len) return;
+  if (pix + count > _len) count = _len - pix;
+  const unsigned aWM     = hasWhite() ? getEffectiveAWMode() : RGBW_MODE_MANUAL_ONLY;
+  const bool     balance = Bus::_cct >= 1900;
+  const bool     useCOM  = _colorOrderMap.count() > 0;
+  const bool     isWWA   = _type == TYPE_WS2812_WWA;
+  const int      step    = _reversed ? -1 : 1;
+  unsigned       pos     = (_reversed ? _len - pix - 1 : pix) + _skip;
+  unsigned       co      = _colorOrder;
+  for (unsigned i = 0; i < count; i++, pos += step) {
+    uint32_t col = autoWhiteCalc(c[i], aWM);
+    if (balance) col = colorBalanceFromKelvin(Bus::_cct, col); //color correction from CCT
+    if (useCOM) co = _colorOrderMap.getPixelColorOrder(pos+_start, _colorOrder);
+    uint16_t wwcw = 0;
+    if (hasCCT()) {
+      uint8_t cctWW = 0, cctCW = 0;
+      Bus::calculateCCT(col, cctWW, cctCW);
+      wwcw = (cctCW<<8) | cctWW;
+      if (isWWA) col = RGBW32(cctWW, cctCW, 0, W(col));
+    }
+    PolyBus::setPixelColor(_busPtr, _iType, pos, col, co, wwcw);
+  }
+}
+
 // returns original color if global buffering is enabled, else returns lossly restored color from bus
 uint32_t IRAM_ATTR BusDigital::getPixelColor(unsigned pix) const {
   if (!_valid) return 0;
@@ -704,6 +740,22 @@ void BusNetwork::setPixelColor(unsigned pix, uint32_t c) {
   if (_hasWhite) _data[offset+3] = W(c);
 }
 
+void BusNetwork::setPixels(unsigned pix, unsigned count, const uint32_t *c) {
+  if (!_valid || pix >= _len) return;
+  if (pix + count > _len) count = _len - pix;
+  const unsigned aWM     = _hasWhite ? getEffectiveAWMode() : RGBW_MODE_MANUAL_ONLY;
+  const bool     balance = Bus::_cct >= 1900;
+  uint8_t *data = _data + pix * _UDPchannels;
+  for (unsigned i = 0; i < count; i++, data += _UDPchannels) {
+    uint32_t col = autoWhiteCalc(c[i], aWM);
+    if (balance) col = colorBalanceFromKelvin(Bus::_cct, col); //color correction from CCT
+    data[0] = R(col);
+    data[1] = G(col);
+    data[2] = B(col);
+    if (_hasWhite) data[3] = W(col);
+  }
+}
+
 uint32_t BusNetwork::getPixelColor(unsigned pix) const {
   if (!_valid || pix >= _len) return 0;
   unsigned offset = pix * _UDPchannels;
@@ -928,12 +980,21 @@ void BusManager::off() {
   #endif
 }
 
+// buses with background output (RMT/I2S/UART DMA) are started first so they transmit while
+// blocking outputs (SPI, bit-bang, PWM, network) are being sent in the second pass
 void BusManager::show() {
+  uint32_t showStart = perfStart();
   _gMilliAmpsUsed = 0;
-  for (auto &bus : busses) {
-    bus->show();
-    _gMilliAmpsUsed += bus->getUsedCurrent();
+  for (unsigned pass = 0; pass < 2; pass++) {
+    for (auto &bus : busses) {
+      if (bus->isAsync() != (pass == 0)) continue;
+      unsigned long start = micros();
+      bus->show();
+      bus->updateTimings(micros() - start);
+      _gMilliAmpsUsed += bus->getUsedCurrent();
+    }
   }
+  perfEnd(PERF_BUS_SHOW, showStart);
 }
 
 void IRAM_ATTR BusManager::setPixelColor(unsigned pix, uint32_t c) {
@@ -943,6 +1004,21 @@ void IRAM_ATTR BusManager::setPixelColor(unsigned pix, uint32_t c) {
   }
 }
 
+// hands a contiguous range of physical pixels to every bus it overlaps (one call per bus instead of one per pixel)
+void IRAM_ATTR BusManager::setPixels(unsigned start, unsigned count, const uint32_t *c) {
+  const unsigned end = start + count;
+  for (auto &bus : busses) {
+    const unsigned busStart = bus->getStart();
+    const unsigned busEnd   = busStart + bus->getLength();
+    const unsigned from = std::max(start, busStart);
+    const unsigned to   = std::min(end, busEnd);
+    if (from >= to) continue;
+    unsigned long t = micros();
+    bus->setPixels(from - busStart, to - from, c + (from - start));
+    bus->addPrepareTime(micros() - t);
+  }
+}
+
 void BusManager::setSegmentCCT(int16_t cct, bool allowWBCorrection) {
   if (cct > 255) cct = 255;
   if (cct >= 0) {
@@ -965,6 +1041,26 @@ bool BusManager::canAllShow() {
   return true;
 }
 
+// waits until all buses have finished sending previous frame (asynchronous outputs may still be busy after show())
+bool BusManager::waitForAllShown(unsigned timeoutMs) {
+  unsigned long start = millis();
+  while (!canAllShow()) {
+    if (millis() - start > timeoutMs) return false;
+    delay(1);
+  }
+  return true;
+}
+
+// outputs with background transmission only limit the frame period (they transmit while the next frame is rendered),
+// blocking outputs add their show() time to the CPU time of every frame
+void BusManager::getPacingTimes(unsigned &asyncUs, unsigned &syncUs) {
+  asyncUs = syncUs = 0;
+  for (const auto &bus : busses) {
+    if (bus->isAsync()) asyncUs = std::max(asyncUs, std::max((unsigned)bus->getTransmitTime(), bus->getWireTime()));
+    else syncUs += bus->getTransmitTime();
+  }
+}
+
 ColorOrderMap& BusManager::getColorOrderMap() { return _colorOrderMap; }
 
 
@@ -975,7 +1071,6 @@ int16_t Bus::_cct = -1;
 uint8_t Bus::_cctBlend = 0; // 0 - 127
 uint8_t Bus::_gAWM = 255;
 
-uint16_t BusDigital::_milliAmpsTotal = 0;
 
 std::vector<std::unique_ptr<Bus>> BusManager::busses;
 uint16_t BusManager::_gMilliAmpsUsed = 0;
@@ -110,6 +110,9 @@ class Bus {
     , _reversed(reversed)
     , _valid(false)
     , _needsRefresh(refresh)
+    , _prepareAcc(0)
+    , _prepareUs(0)
+    , _transmitUs(0)
     {
       _autoWhiteMode = Bus::hasWhite(type) ? aw : RGBW_MODE_MANUAL_ONLY;
     };
@@ -119,9 +122,13 @@ class Bus {
     virtual void     begin()                                    {};
     virtual void     show()                                     = 0;
     virtual bool     canShow() const                            { return true; }
+    virtual bool     isAsync() const                            { return false; } // show() only starts output which completes in background (RMT/I2S/UART)
+    virtual unsigned getWireTime() const                        { return 0; }     // minimum time (us) a frame needs on the wire, 0 if unknown
     virtual void     setStatusPixel(uint32_t c)                 {}
     virtual void     setPixelColor(unsigned pix, uint32_t c)    = 0;
+    virtual void     setPixels(unsigned pix, unsigned count, const uint32_t *c) { for (unsigned i = 0; i < count; i++) setPixelColor(pix + i, c[i]); }
     virtual void     setBrightness(uint8_t b)                   { _bri = b; };
+    virtual void     limitCurrent(uint32_t powerSum)            {} // per bus ABL, called with the frame's channel sum before pixels are set
     virtual void     setColorOrder(uint8_t co)                  {}
     virtual uint32_t getPixelColor(unsigned pix) const          { return 0; }
     virtual size_t   getPins(uint8_t* pinArray = nullptr) const { return 0; }
@@ -155,6 +162,12 @@ class Bus {
     inline  bool     isReversed() const                         { return _reversed; }
     inline  bool     isOffRefreshRequired() const               { return _needsRefresh; }
     inline  bool     containsPixel(uint16_t pix) const          { return pix >= _start && pix < _start + _len; }
+    inline  uint8_t  getEffectiveAWMode() const                 { return _gAWM < AW_GLOBAL_DISABLED ? _gAWM : _autoWhiteMode; }
+    uint32_t         getOutputColor(uint32_t c, int16_t cct) const; // color as sent to the LEDs (auto white, white balance), used for current estimation
+    inline  void     addPrepareTime(unsigned us)                { _prepareAcc += us; }
+    inline  uint16_t getPrepareTime() const                     { return _prepareUs; }  // averaged time (us) spent converting pixels per frame
+    inline  uint16_t getTransmitTime() const                    { return _transmitUs; } // averaged time (us) spent in show() per frame
+    void             updateTimings(unsigned transmitUs);
 
     static inline std::vector<LEDType> getLEDTypes()            { return {{TYPE_NONE, "", PSTR("None")}}; } // not used. just for reference for derived classes
     static constexpr size_t   getNumberOfPins(uint8_t type)     { return isVirtual(type) ? 4 : isPWM(type) ? numPWMPins(type) : is2Pin(type) + 1; } // credit @PaoloTK
@@ -213,6 +226,9 @@ class Bus {
       bool _hasCCT;//       : 1;
     //} __attribute__ ((packed));
     uint8_t  _autoWhiteMode;
+    uint32_t _prepareAcc;   // conversion time accumulated during current frame
+    uint16_t _prepareUs;
+    uint16_t _transmitUs;
     // global Auto White Calculation override
     static uint8_t _gAWM;
     // _cct has the following menaings (see calculateCCT() & BusManager::setSegmentCCT()):
@@ -226,7 +242,8 @@ class Bus {
     //  127 - additive CCT blending (CCT 127 => 100% warm, 100% cold)
     static uint8_t _cctBlend;
 
-    uint32_t autoWhiteCalc(uint32_t c) const;
+    uint32_t autoWhiteCalc(uint32_t c) const { return autoWhiteCalc(c, getEffectiveAWMode()); }
+    static uint32_t autoWhiteCalc(uint32_t c, unsigned aWM);
 };
 
 
@@ -237,9 +254,13 @@ class BusDigital : public Bus {
 
     void show() override;
     bool canShow() const override;
+    bool isAsync() const override;
+    unsigned getWireTime() const override;
     void setBrightness(uint8_t b) override;
+    void limitCurrent(uint32_t powerSum) override;
     void setStatusPixel(uint32_t c) override;
     [[gnu::hot]] void setPixelColor(unsigned pix, uint32_t c) override;
+    [[gnu::hot]] void setPixels(unsigned pix, unsigned count, const uint32_t *c) override;
     void setColorOrder(uint8_t colorOrder) override;
     [[gnu::hot]] uint32_t getPixelColor(unsigned pix) const override;
     uint8_t  getColorOrder() const override  { return _colorOrder; }
@@ -263,10 +284,10 @@ class BusDigital : public Bus {
     uint16_t _frequencykHz;
     uint8_t  _milliAmpsPerLed;
     uint16_t _milliAmpsMax;
+    uint16_t _milliAmpsTotal; // is recalculated on each limitCurrent()
+    uint8_t  _limitBri;       // brightness used for current frame if limited by ABL
     void    *_busPtr;
 
-    static uint16_t _milliAmpsTotal; // is overwitten/recalculated on each show()
-
     inline uint32_t restoreColorLossy(uint32_t c, uint8_t restoreBri) const {
       if (restoreBri < 255) {
         uint8_t* chan = (uint8_t*) &c;
@@ -277,8 +298,6 @@ class BusDigital : public Bus {
       }
       return c;
     }
-
-    uint8_t  estimateCurrentAndLimitBri() const;
 };
 
 
@@ -337,6 +356,7 @@ class BusNetwork : public Bus {
 
     bool canShow() const override  { return !_broadcastLock; } // this should be a return value from UDP routine if it is still sending data out
     [[gnu::hot]] void setPixelColor(unsigned pix, uint32_t c) override;
+    [[gnu::hot]] void setPixels(unsigned pix, unsigned count, const uint32_t *c) override;
     [[gnu::hot]] uint32_t getPixelColor(unsigned pix) const override;
     size_t getPins(uint8_t* pinArray = nullptr) const override;
     size_t getBusSize() const override  { return sizeof(BusNetwork) + (isOk() ? _len * _UDPchannels : 0); }
@@ -455,9 +475,12 @@ namespace BusManager {
   void off();
 
   [[gnu::hot]] void     setPixelColor(unsigned pix, uint32_t c);
+  [[gnu::hot]] void     setPixels(unsigned start, unsigned count, const uint32_t *c); // contiguous range of physical pixels
   [[gnu::hot]] uint32_t getPixelColor(unsigned pix);
   void        show();
   bool        canAllShow();
+  bool        waitForAllShown(unsigned timeoutMs); // completion barrier, returns false on timeout
+  void        getPacingTimes(unsigned &asyncUs, unsigned &syncUs); // frame period limits imposed by outputs (for adaptive FPS)
   inline void setStatusPixel(uint32_t c) { for (auto &bus : busses) bus->setStatusPixel(c);}
   inline void setBrightness(uint8_t b)   { for (auto &bus : busses) bus->setBrightness(b); }
   // for setSegmentCCT(), cct can only be in [-1,255] range; allowWBCorrection will convert it to K
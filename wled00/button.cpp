@@ -2,6 +2,11 @@
 
 /*
  * Physical IO
+ *
+ * Edges of push buttons, switches and PIR sensors are captured by a pin change interrupt with a timestamp
+ * and queued (single producer ring buffer), the queue is drained once per loop by handleButton().
+ * Press durations are therefore measured from the actual edges even if loop() was busy (e.g. during a file write).
+ * Touch and analog buttons as well as pins without interrupt support are polled.
  */
 
 #define WLED_DEBOUNCE_THRESHOLD      50 // only consider button input of at least 50ms as valid (debouncing)
@@ -12,9 +17,28 @@
 #define WLED_LONG_FACTORY_RESET   10000 // how long button 0 needs to be held to trigger a factory reset
 #define WLED_LONG_BRI_STEPS          16 // how much to increase/decrease the brightness with each long press repetition
 
+#define BTN_QUEUE_SIZE               32 // button edge events (power of 2)
+
 static const char _mqtt_topic_button[] PROGMEM = "%s/button/%d";  // optimize flash usage
 static bool buttonBriDirection = false; // true: increase brightness, false: decrease brightness
 
+typedef struct ButtonEvent {
+  unsigned long time;
+  uint8_t       button;
+  bool          pressed;
+} buttonEvent;
+
+static volatile buttonEvent btnQueue[BTN_QUEUE_SIZE];
+static volatile uint8_t btnQueueHead = 0;               // written by ISR only
+static volatile uint8_t btnQueueTail = 0;               // written by handleButton() only
+static volatile bool    btnQueueOverflow = false;
+static int8_t  btnIrqPin[WLED_MAX_BUTTONS];             // pin with attached interrupt (valid if btnIrqAttached)
+static uint8_t btnIrqType[WLED_MAX_BUTTONS];
+static bool    btnIrqActiveHigh[WLED_MAX_BUTTONS];
+static bool    btnIrqAttached[WLED_MAX_BUTTONS] = {false};
+static bool    btnLevel[WLED_MAX_BUTTONS] = {false};    // last queued state of interrupt driven buttons
+static unsigned long btnLastTime = 0;                   // events are processed in time order
+
 void shortPressAction(uint8_t b)
 {
   if (!macroButton[b]) {
@@ -121,18 +145,69 @@ bool isButtonPressed(uint8_t b)
   return false;
 }
 
-void handleSwitch(uint8_t b)
+static void IRAM_ATTR buttonISR(void *arg)
+{
+  const unsigned b = (uintptr_t)arg;
+  const unsigned head = btnQueueHead;
+  const unsigned next = (head + 1) & (BTN_QUEUE_SIZE - 1);
+  if (next == btnQueueTail) { btnQueueOverflow = true; return; } // full, state is resynchronised by handleButton()
+  btnQueue[head].time    = millis();
+  btnQueue[head].button  = b;
+  btnQueue[head].pressed = digitalRead(btnIrqPin[b]) == (btnIrqActiveHigh[b] ? HIGH : LOW);
+  btnQueueHead = next;
+}
+
+static bool canUseInterrupt(uint8_t b)
+{
+  if (btnPin[b] < 0 || digitalPinToInterrupt(btnPin[b]) == NOT_AN_INTERRUPT) return false; // e.g. GPIO16 on ESP8266
+  switch (buttonType[b]) {
+    case BTN_TYPE_PUSH:
+    case BTN_TYPE_PUSH_ACT_HIGH:
+    case BTN_TYPE_SWITCH:
+    case BTN_TYPE_PIR_SENSOR:
+      return true;
+  }
+  return false;
+}
+
+// must be called before button pin is deallocated
+void detachButtonInterrupt(uint8_t b)
+{
+  if (b >= WLED_MAX_BUTTONS || !btnIrqAttached[b]) return;
+  detachInterrupt(digitalPinToInterrupt(btnIrqPin[b]));
+  btnIrqAttached[b] = false;
+  // discard queued edges of the old pin, the button may be re-attached before the queue is drained
+  for (unsigned i = btnQueueTail; i != btnQueueHead; i = (i + 1) & (BTN_QUEUE_SIZE - 1)) if (btnQueue[i].button == b) btnQueue[i].button = WLED_MAX_BUTTONS;
+}
+
+// (re)attaches pin change interrupts after button configuration changed
+static void syncButtonInterrupts()
+{
+  for (unsigned b = 0; b < WLED_MAX_BUTTONS; b++) {
+    const bool irq = canUseInterrupt(b);
+    if (btnIrqAttached[b] && (!irq || btnIrqPin[b] != btnPin[b] || btnIrqType[b] != buttonType[b])) detachButtonInterrupt(b);
+    if (!irq || btnIrqAttached[b]) continue;
+    btnIrqPin[b]        = btnPin[b];
+    btnIrqType[b]       = buttonType[b];
+    btnIrqActiveHigh[b] = buttonType[b] == BTN_TYPE_PUSH_ACT_HIGH || buttonType[b] == BTN_TYPE_PIR_SENSOR;
+    btnLevel[b]         = isButtonPressed(b);
+    attachInterruptArg(digitalPinToInterrupt(btnPin[b]), buttonISR, (void*)(uintptr_t)b, CHANGE);
+    btnIrqAttached[b]   = true;
+    DEBUG_PRINTF_P(PSTR("Button %u: interrupt on GPIO%d\n"), b, btnPin[b]);
+  }
+}
+
+static void handleSwitch(uint8_t b, bool pressed, unsigned long now)
 {
-  // isButtonPressed() handles inverted/noninverted logic
-  if (buttonPressedBefore[b] != isButtonPressed(b)) {
+  if (buttonPressedBefore[b] != pressed) {
     DEBUG_PRINTF_P(PSTR("Switch: State changed %u\n"), b);
-    buttonPressedTime[b] = millis();
+    buttonPressedTime[b] = now;
     buttonPressedBefore[b] = !buttonPressedBefore[b];
   }
 
   if (buttonLongPressed[b] == buttonPressedBefore[b]) return;
 
-  if (millis() - buttonPressedTime[b] > WLED_DEBOUNCE_THRESHOLD) { //fire edge event only after 50ms without change (debounce)
+  if (now - buttonPressedTime[b] > WLED_DEBOUNCE_THRESHOLD) { //fire edge event only after 50ms without change (debounce)
     DEBUG_PRINTF_P(PSTR("Switch: Activating  %u\n"), b);
     if (!buttonPressedBefore[b]) { // on -> off
       DEBUG_PRINTF_P(PSTR("Switch: On -> Off (%u)\n"), b);
@@ -181,7 +256,6 @@ void handleAnalog(uint8_t b)
   if ((btnPin[b] < 0) /*|| (digitalPinToAnalogChannel(btnPin[b]) < 0)*/) return; // pin must support analog ADC - newer esp32 frameworks throw lots of warnings otherwise
   rawReading = analogRead(btnPin[b]); // collect at full 12bit resolution
   #endif
-  yield();                            // keep WiFi task running - analog read may take several millis on ESP8266
 
   filteredReading[b] += POT_SMOOTHING * ((float(rawReading) / 16.0f) - filteredReading[b]); // filter raw input, and scale to [0..255]
   unsigned aRead = max(min(int(filteredReading[b]), 255), 0);                               // squash into 8bit
@@ -252,6 +326,90 @@ void handleAnalog(uint8_t b)
   colorUpdated(CALL_MODE_BUTTON);
 }
 
+// momentary button logic, pressed state at time now
+static void handleMomentary(uint8_t b, bool pressed, unsigned long now)
+{
+  if (pressed) { // pressed
+
+    // if all macros are the same, fire action immediately on rising edge
+    if (macroButton[b] && macroButton[b] == macroLongPress[b] && macroButton[b] == macroDoublePress[b]) {
+      if (!buttonPressedBefore[b])
+        shortPressAction(b);
+      buttonPressedBefore[b] = true;
+      buttonPressedTime[b] = now; // continually update (for debouncing to work in release handler)
+      return;
+    }
+
+    if (!buttonPressedBefore[b]) buttonPressedTime[b] = now;
+    buttonPressedBefore[b] = true;
+
+    if (now - buttonPressedTime[b] > WLED_LONG_PRESS) { //long press
+      if (!buttonLongPressed[b]) {
+        buttonBriDirection = !buttonBriDirection; //toggle brightness direction on long press
+        longPressAction(b);
+        if (b && macroLongPress[b]) buttonPressedTime[b] = now - WLED_LONG_REPEATED_ACTION; // 1st repetition after 200ms (default action restarts timer itself)
+      } else if (b) { //repeatable action (~5 times per s) on button > 0
+        longPressAction(b);
+        buttonPressedTime[b] = now - WLED_LONG_REPEATED_ACTION; //200ms
+      }
+      buttonLongPressed[b] = true;
+    }
+
+  } else if (buttonPressedBefore[b]) { //released
+    long dur = now - buttonPressedTime[b];
+
+    // released after rising-edge short press action
+    if (macroButton[b] && macroButton[b] == macroLongPress[b] && macroButton[b] == macroDoublePress[b]) {
+      if (dur > WLED_DEBOUNCE_THRESHOLD) buttonPressedBefore[b] = false; // debounce, blocks button for 50 ms once it has been released
+      return;
+    }
+
+    if (dur < WLED_DEBOUNCE_THRESHOLD) {buttonPressedBefore[b] = false; return;} // too short "press", debounce
+    bool doublePress = buttonWaitTime[b]; //did we have a short press before?
+    buttonWaitTime[b] = 0;
+
+    if (b == 0 && dur > WLED_LONG_AP) { // long press on button 0 (when released)
+      if (dur > WLED_LONG_FACTORY_RESET) { // factory reset if pressed > 10 seconds
+        WLED_FS.format();
+        #ifdef WLED_ADD_EEPROM_SUPPORT
+        clearEEPROM();
+        #endif
+        doReboot = true;
+      } else {
+        WLED::instance().initAP(true);
+      }
+    } else if (!buttonLongPressed[b]) { //short press
+      //NOTE: this interferes with double click handling in usermods so usermod needs to implement full button handling
+      if (b != 1 && !macroDoublePress[b]) { //don't wait for double press on buttons without a default action if no double press macro set
+        shortPressAction(b);
+      } else { //double press if less than 350 ms between current press and previous short press release (buttonWaitTime!=0)
+        if (doublePress) {
+          doublePressAction(b);
+        } else {
+          buttonWaitTime[b] = now;
+        }
+      }
+    }
+    buttonPressedBefore[b] = false;
+    buttonLongPressed[b] = false;
+  }
+
+  //if 350ms elapsed since last short press release it is a short press
+  if (buttonWaitTime[b] && now - buttonWaitTime[b] > WLED_DOUBLE_PRESS && !buttonPressedBefore[b]) {
+    buttonWaitTime[b] = 0;
+    shortPressAction(b);
+  }
+}
+
+static void handleDigitalButton(uint8_t b, bool pressed, unsigned long now)
+{
+  if ((long)(now - btnLastTime) < 0) now = btnLastTime; // queued edge older than last poll
+  btnLastTime = now;
+  // button is not momentary, but switch. This is only suitable on pins whose on-boot state does not matter (NOT gpio0)
+  if (buttonType[b] == BTN_TYPE_SWITCH || buttonType[b] == BTN_TYPE_TOUCH_SWITCH || buttonType[b] == BTN_TYPE_PIR_SENSOR) handleSwitch(b, pressed, now);
+  else handleMomentary(b, pressed, now);
+}
+
 void handleButton()
 {
   static unsigned long lastAnalogRead = 0UL;
@@ -261,14 +419,38 @@ void handleButton()
   if (strip.isUpdating() && (now - lastRun < ANALOG_BTN_READ_CYCLE+1)) return; // don't interfere with strip update (unless strip is updating continuously, e.g. very long strips)
   lastRun = now;
 
+  syncButtonInterrupts();
+
+  bool active[WLED_MAX_BUTTONS]; // button is handled here (not by usermod)
   for (unsigned b=0; b<WLED_MAX_BUTTONS; b++) {
     #ifdef ESP8266
-    if ((btnPin[b]<0 && !(buttonType[b] == BTN_TYPE_ANALOG || buttonType[b] == BTN_TYPE_ANALOG_INVERTED)) || buttonType[b] == BTN_TYPE_NONE) continue;
+    active[b] = !((btnPin[b]<0 && !(buttonType[b] == BTN_TYPE_ANALOG || buttonType[b] == BTN_TYPE_ANALOG_INVERTED)) || buttonType[b] == BTN_TYPE_NONE);
     #else
-    if (btnPin[b]<0 || buttonType[b] == BTN_TYPE_NONE) continue;
+    active[b] = !(btnPin[b]<0 || buttonType[b] == BTN_TYPE_NONE);
     #endif
+    if (active[b] && UsermodManager::handleButton(b)) active[b] = false; // did usermod handle buttons
+  }
 
-    if (UsermodManager::handleButton(b)) continue; // did usermod handle buttons
+  // edges captured by interrupt, in order and with their own timestamps
+  while (btnQueueTail != btnQueueHead) {
+    const unsigned t = btnQueueTail;
+    const unsigned b = btnQueue[t].button;
+    const bool pressed = btnQueue[t].pressed;
+    const unsigned long time = btnQueue[t].time;
+    btnQueueTail = (t + 1) & (BTN_QUEUE_SIZE - 1);
+    if (b >= WLED_MAX_BUTTONS || !btnIrqAttached[b]) continue; // stale event
+    btnLevel[b] = pressed;
+    if (active[b]) handleDigitalButton(b, pressed, time);
+  }
+  if (btnQueueOverflow) {
+    btnQueueOverflow = false;
+    for (unsigned b=0; b<WLED_MAX_BUTTONS; b++) if (btnIrqAttached[b]) btnLevel[b] = isButtonPressed(b);
+    DEBUG_PRINTLN(F("Button: event queue overflow."));
+  }
+
+  now = millis();
+  for (unsigned b=0; b<WLED_MAX_BUTTONS; b++) {
+    if (!active[b]) continue;
 
     if (buttonType[b] == BTN_TYPE_ANALOG || buttonType[b] == BTN_TYPE_ANALOG_INVERTED) { // button is not a button but a potentiometer
       if (now - lastAnalogRead > ANALOG_BTN_READ_CYCLE) {
@@ -277,82 +459,8 @@ void handleButton()
       continue;
     }
 
-    // button is not momentary, but switch. This is only suitable on pins whose on-boot state does not matter (NOT gpio0)
-    if (buttonType[b] == BTN_TYPE_SWITCH || buttonType[b] == BTN_TYPE_TOUCH_SWITCH || buttonType[b] == BTN_TYPE_PIR_SENSOR) {
-      handleSwitch(b);
-      continue;
-    }
-
-    // momentary button logic
-    if (isButtonPressed(b)) { // pressed
-
-      // if all macros are the same, fire action immediately on rising edge
-      if (macroButton[b] && macroButton[b] == macroLongPress[b] && macroButton[b] == macroDoublePress[b]) {
-        if (!buttonPressedBefore[b])
-          shortPressAction(b);
-        buttonPressedBefore[b] = true;
-        buttonPressedTime[b] = now; // continually update (for debouncing to work in release handler)
-        continue;
-      }
-
-      if (!buttonPressedBefore[b]) buttonPressedTime[b] = now;
-      buttonPressedBefore[b] = true;
-
-      if (now - buttonPressedTime[b] > WLED_LONG_PRESS) { //long press
-        if (!buttonLongPressed[b]) {
-          buttonBriDirection = !buttonBriDirection; //toggle brightness direction on long press
-          longPressAction(b);
-        } else if (b) { //repeatable action (~5 times per s) on button > 0
-          longPressAction(b);
-          buttonPressedTime[b] = now - WLED_LONG_REPEATED_ACTION; //200ms
-        }
-        buttonLongPressed[b] = true;
-      }
-
-    } else if (buttonPressedBefore[b]) { //released
-      long dur = now - buttonPressedTime[b];
-
-      // released after rising-edge short press action
-      if (macroButton[b] && macroButton[b] == macroLongPress[b] && macroButton[b] == macroDoublePress[b]) {
-        if (dur > WLED_DEBOUNCE_THRESHOLD) buttonPressedBefore[b] = false; // debounce, blocks button for 50 ms once it has been released
-        continue;
-      }
-
-      if (dur < WLED_DEBOUNCE_THRESHOLD) {buttonPressedBefore[b] = false; continue;} // too short "press", debounce
-      bool doublePress = buttonWaitTime[b]; //did we have a short press before?
-      buttonWaitTime[b] = 0;
-
-      if (b == 0 && dur > WLED_LONG_AP) { // long press on button 0 (when released)
-        if (dur > WLED_LONG_FACTORY_RESET) { // factory reset if pressed > 10 seconds
-          WLED_FS.format();
-          #ifdef WLED_ADD_EEPROM_SUPPORT
-          clearEEPROM();
-          #endif
-          doReboot = true;
-        } else {
-          WLED::instance().initAP(true);
-        }
-      } else if (!buttonLongPressed[b]) { //short press
-        //NOTE: this interferes with double click handling in usermods so usermod needs to implement full button handling
-        if (b != 1 && !macroDoublePress[b]) { //don't wait for double press on buttons without a default action if no double press macro set
-          shortPressAction(b);
-        } else { //double press if less than 350 ms between current press and previous short press release (buttonWaitTime!=0)
-          if (doublePress) {
-            doublePressAction(b);
-          } else {
-            buttonWaitTime[b] = now;
-          }
-        }
-      }
-      buttonPressedBefore[b] = false;
-      buttonLongPressed[b] = false;
-    }
-
-    //if 350ms elapsed since last short press release it is a short press
-    if (buttonWaitTime[b] && now - buttonWaitTime[b] > WLED_DOUBLE_PRESS && !buttonPressedBefore[b]) {
-      buttonWaitTime[b] = 0;
-      shortPressAction(b);
-    }
+    // timeouts (long press, double press) and polled buttons (touch, pins without interrupt)
+    handleDigitalButton(b, btnIrqAttached[b] ? btnLevel[b] : isButtonPressed(b), now);
   }
   if (now - lastAnalogRead > ANALOG_BTN_READ_CYCLE) {
     lastAnalogRead = now;
@@ -165,6 +165,7 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   uint8_t cctBlending = hw_led[F("cb")] | Bus::getCCTBlend();
   Bus::setCCTBlend(cctBlending);
   strip.setTargetFps(hw_led["fps"]); //NOP if 0, default 42 FPS
+  strip.setAdaptiveFps(hw_led[F("afps")] | strip.isAdaptiveFps());
   #if defined(ARDUINO_ARCH_ESP32) && !defined(CONFIG_IDF_TARGET_ESP32C3)
   CJSON(useParallelI2S, hw_led[F("prl")]);
   #endif
@@ -353,7 +354,10 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   JsonArray hw_btn_ins = btn_obj["ins"];
   if (!hw_btn_ins.isNull()) {
     // deallocate existing button pins
-    for (unsigned b = 0; b < WLED_MAX_BUTTONS; b++) PinManager::deallocatePin(btnPin[b], PinOwner::Button); // does nothing if trying to deallocate a pin with PinOwner != Button
+    for (unsigned b = 0; b < WLED_MAX_BUTTONS; b++) {
+      detachButtonInterrupt(b);
+      PinManager::deallocatePin(btnPin[b], PinOwner::Button); // does nothing if trying to deallocate a pin with PinOwner != Button
+    }
     unsigned s = 0;
     for (JsonObject btn : hw_btn_ins) {
       CJSON(buttonType[s], btn["type"]);
@@ -563,6 +567,8 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
 
 #ifndef WLED_DISABLE_ESPNOW
   CJSON(useESPNowSync, if_sync[F("espnow")]);
+  CJSON(espNowStreamMode, if_sync[F("espnow_px")]);
+  CJSON(espNowStreamDelta, if_sync[F("espnow_dlt")]);
 #endif
 
   JsonObject if_sync_recv = if_sync[F("recv")];
@@ -584,6 +590,8 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   CJSON(syncGroups, if_sync_send["grp"]);
   if (if_sync_send[F("twice")]) udpNumRetries = 1; // import setting from 0.13 and earlier
   CJSON(udpNumRetries, if_sync_send["ret"]);
+  CJSON(udpCompactSync, if_sync_send[F("cmp")]);
+  CJSON(udpLegacySync, if_sync_send[F("leg")]);
 
   JsonObject if_nodes = interfaces["nodes"];
   CJSON(nodeListEnabled, if_nodes[F("list")]);
@@ -641,6 +649,9 @@ bool deserializeConfig(JsonObject doc, bool fromFS) {
   getStringFromJson(mqttDeviceTopic, if_mqtt[F("topics")][F("device")], MQTT_MAX_TOPIC_LEN+1); // "wled/test"
   getStringFromJson(mqttGroupTopic, if_mqtt[F("topics")][F("group")], MQTT_MAX_TOPIC_LEN+1); // ""
   CJSON(retainMqttMsg, if_mqtt[F("rtn")]);
+  CJSON(mqttJsonState, if_mqtt[F("json")]);
+  CJSON(mqttMinInterval, if_mqtt[F("imin")]);
+  CJSON(mqttMaxInterval, if_mqtt[F("imax")]);
 #endif
 
 #ifndef WLED_DISABLE_HUESYNC
@@ -812,6 +823,7 @@ void serializeConfigToFS() {
   File f = WLED_FS.open(FPSTR(s_cfg_json), "w");
   if (f) serializeJson(root, f);
   f.close();
+  invalidateFsCache();
   releaseJSONBufferLock();
 
   configNeedsWrite = false;
@@ -919,6 +931,7 @@ void serializeConfig(JsonObject root) {
   hw_led[F("ic")] = cctICused;
   hw_led[F("cb")] = Bus::getCCTBlend();
   hw_led["fps"] = strip.getTargetFps();
+  hw_led[F("afps")] = strip.isAdaptiveFps();
   hw_led[F("rgbwm")] = Bus::getGlobalAWMode(); // global auto white mode override
   #if defined(ARDUINO_ARCH_ESP32) && !defined(CONFIG_IDF_TARGET_ESP32C3)
   hw_led[F("prl")] = BusManager::hasParallelOutput();
@@ -1071,6 +1084,8 @@ void serializeConfig(JsonObject root) {
 
 #ifndef WLED_DISABLE_ESPNOW
   if_sync[F("espnow")] = useESPNowSync;
+  if_sync[F("espnow_px")] = espNowStreamMode;
+  if_sync[F("espnow_dlt")] = espNowStreamDelta;
 #endif
 
   JsonObject if_sync_recv = if_sync.createNestedObject(F("recv"));
@@ -1090,6 +1105,8 @@ void serializeConfig(JsonObject root) {
   if_sync_send["hue"] = notifyHue;
   if_sync_send["grp"] = syncGroups;
   if_sync_send["ret"] = udpNumRetries;
+  if_sync_send[F("cmp")] = udpCompactSync;
+  if_sync_send[F("leg")] = udpLegacySync;
 
   JsonObject if_nodes = interfaces.createNestedObject("nodes");
   if_nodes[F("list")] = nodeListEnabled;
@@ -1141,6 +1158,9 @@ void serializeConfig(JsonObject root) {
   if_mqtt[F("pskl")] = strlen(mqttPass);
   if_mqtt[F("cid")] = mqttClientID;
   if_mqtt[F("rtn")] = retainMqttMsg;
+  if_mqtt[F("json")] = mqttJsonState;
+  if_mqtt[F("imin")] = mqttMinInterval;
+  if_mqtt[F("imax")] = mqttMaxInterval;
 
   JsonObject if_mqtt_topics = if_mqtt.createNestedObject(F("topics"));
   if_mqtt_topics[F("device")] = mqttDeviceTopic;
@@ -247,6 +247,11 @@ static_assert(WLED_MAX_BUSSES <= 32, "WLED_MAX_BUSSES exceeds hard limit");
 #define REALTIME_MODE_TPM2NET     7
 #define REALTIME_MODE_DDP         8
 #define REALTIME_MODE_DMX         9
+#define REALTIME_MODE_ESPNOW     10
+
+//notifier port packet types (first byte) besides notifier (0), UDP realtime (1-5), TPM2.NET (0x9C) and node info (255)
+#define UDP_COMPACT_MAGIC        13    //compact sync (v13)
+#define TIMESYNC_MAGIC           14    //timebase sync request/reply
 
 //realtime override modes
 #define REALTIME_OVERRIDE_NONE    0
@@ -341,6 +346,10 @@ static_assert(WLED_MAX_BUSSES <= 32, "WLED_MAX_BUSSES exceeds hard limit");
 #define ESP_NOW_STATE_ON           1
 #define ESP_NOW_STATE_ERROR        2
 
+#define ESPNOW_STREAM_OFF          0
+#define ESPNOW_STREAM_SEND         1  // leader, broadcasts rendered frames
+#define ESPNOW_STREAM_RECEIVE      2  // follower, shows received frames in realtime mode
+
 //Button type
 #define BTN_TYPE_NONE             0
 #define BTN_TYPE_RESERVED         1
@@ -427,6 +436,18 @@ static_assert(WLED_MAX_BUSSES <= 32, "WLED_MAX_BUSSES exceeds hard limit");
 #define ERR_OVERCURRENT 31  // An attached current sensor has measured a current above the threshold (not implemented)
 #define ERR_UNDERVOLT   32  // An attached voltmeter has measured a voltage below the threshold (not implemented)
 
+// Image effect (GIF/FSEQ) render results
+#define IMAGE_ERROR_NONE 0
+#define IMAGE_ERROR_NO_NAME 1
+#define IMAGE_ERROR_SEG_LIMIT 2
+#define IMAGE_ERROR_UNSUPPORTED_FORMAT 3
+#define IMAGE_ERROR_FILE_MISSING 4
+#define IMAGE_ERROR_DECODER_ALLOC 5
+#define IMAGE_ERROR_GIF_DECODE 6
+#define IMAGE_ERROR_FRAME_DECODE 7
+#define IMAGE_ERROR_WAITING 254
+#define IMAGE_ERROR_PREV 255
+
 // Timer mode types
 #define NL_MODE_SET               0            //After nightlight time elapsed, set to target brightness
 #define NL_MODE_FADE              1            //Fade to target brightness gradually
@@ -548,6 +569,39 @@ static_assert(WLED_MAX_BUSSES <= 32, "WLED_MAX_BUSSES exceeds hard limit");
   #endif
 #endif
 
+// Limits of incremental state parser (JsonStateStream): top level members except "seg", single segment object and raw "seg" text kept for presets
+#ifdef ESP8266
+  #define JSON_STREAM_REST_SIZE 1024
+  #define JSON_STREAM_UNIT_SIZE 2048
+  #define JSON_STREAM_SEG_KEEP  4096
+#else
+  #define JSON_STREAM_REST_SIZE 2048
+  #define JSON_STREAM_UNIT_SIZE 6144
+  #define JSON_STREAM_SEG_KEEP  16384
+#endif
+
+// Read-through cache of files served over HTTP (presets.json, palettes, ledmaps...), sizes in bytes
+#define FS_CACHE_ENTRIES 6
+#ifndef FS_CACHE_RAM_SIZE
+  #ifdef ESP8266
+    #define FS_CACHE_RAM_SIZE 0      // not enough heap
+  #else
+    #define FS_CACHE_RAM_SIZE 16384
+  #endif
+#endif
+#ifndef FS_CACHE_PSRAM_SIZE
+  #define FS_CACHE_PSRAM_SIZE 262144
+#endif
+
+// UART receive buffer (Adalight/TPM2 at up to 2 Mbaud)
+#ifndef SERIAL_RX_BUFFER_SIZE
+  #ifdef ESP8266
+    #define SERIAL_RX_BUFFER_SIZE 512
+  #else
+    #define SERIAL_RX_BUFFER_SIZE 2048
+  #endif
+#endif
+
 //#define MIN_HEAP_SIZE
 #define MIN_HEAP_SIZE 2048
 
@@ -574,6 +628,7 @@ static_assert(WLED_MAX_BUSSES <= 32, "WLED_MAX_BUSSES exceeds hard limit");
 #else
   #define WLED_MAX_NODES 150
 #endif
+#define WLED_NODES_PER_PAGE 25 // nodes per /json/nodes?page=n response
 
 // Defaults pins, type and counts to configure LED output
 #if defined(ESP8266) || defined(CONFIG_IDF_TARGET_ESP32C3)
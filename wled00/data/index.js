@@ -1133,9 +1133,9 @@ function populateNodes(i,n)
 	gId('kn').innerHTML = cn;
 }
 
-function loadNodes()
+function loadNodes(p=0, nodes=[])
 {
-	fetch(getURL('/json/nodes'), {
+	fetch(getURL(`/json/nodes?page=${p}`), {
 		method: 'get'
 	})
 	.then((res)=>{
@@ -1144,7 +1144,9 @@ function loadNodes()
 	})
 	.then((json)=>{
 		clearErrorToast(100);
-		populateNodes(lastinfo, json);
+		if (json.nodes) nodes = nodes.concat(json.nodes);
+		if (p < json.m) { loadNodes(p+1, nodes); return; } // large fleets are served in pages
+		populateNodes(lastinfo, {nodes: nodes});
 	})
 	.catch((e)=>{
 		showToast(e, true);
@@ -125,14 +125,7 @@ bool DMXInput::installDriver()
 void DMXInput::init(uint8_t rxPin, uint8_t txPin, uint8_t enPin, uint8_t inputPortNum)
 {
 
-#ifdef WLED_ENABLE_DMX_OUTPUT
-  //TODO add again once dmx output has been merged
-  // if(inputPortNum == dmxOutputPort)
-  // {
-  //   DEBUG_PRINTF("DMXInput: Error: Input port == output port");
-  //   return;
-  // }
-#endif
+  // DMX output (initDMXOutput(), called before) moves to UART 1 if input uses UART 2
 
   if (inputPortNum <= (SOC_UART_NUM - 1) && inputPortNum > 0) {
     this->inputPortNum = inputPortNum;
@@ -12,67 +12,116 @@
 
 #ifdef WLED_ENABLE_DMX
 
-void handleDMXOutput()
-{
-  // don't act, when in DMX Proxy mode
-  if (e131ProxyUniverse != 0) return;
+/*
+ * The universe is filled once per shown frame (frame synchronous, like ESP-NOW streaming) from a fixture map
+ * compiled on configuration change: each fixture channel is either a (brightness scaled) color component or a
+ * fixed value. On ESP32 the frame is handed to the UART driver and sent in the background whenever the previous one
+ * is done (steady ~44 Hz for a full universe). ESPDMX (ESP8266, -C3, -S2) blocks while sending, there only new frames
+ * are sent and an unchanged universe is resent every DMX_REFRESH ms so fixtures do not time out.
+ */
 
-  uint8_t brightness = strip.getBrightness();
+#if defined(ESP8266) || defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32S2)
+  #define DMX_BLOCKING
+#endif
 
-  bool calc_brightness = true;
+#define DMX_CHANNELS   512
+#define DMX_REFRESH    800    // resend unchanged universe at least this often (ms), DMX allows 1s between frames
+#define DMX_FIXED      0xFF   // dmxOp.shift of fixed value channels
 
-   // check if no shutter channel is set
-   for (unsigned i = 0; i < DMXChannels; i++)
-   {
-     if (DMXFixtureMap[i] == 5) calc_brightness = false;
-   }
+typedef struct DMXOp {
+  uint8_t shift;  // of color component in pixel color, DMX_FIXED for fixed value
+  uint8_t value;  // fixed value (0, 255 or brightness for shutter channel)
+} dmxOp;
 
-  uint16_t len = strip.getLengthTotal();
-  for (int i = DMXStartLED; i < len; i++) {        // uses the amount of LEDs as fixture count
+static dmxOp    dmxOps[15];            // compiled DMXFixtureMap
+static uint8_t  dmxScale[256];         // brightness scaling of color components
+static int      dmxScaleBri = -1;     // brightness dmxScale was built for
+static bool     dmxScaled = true;      // false if fixtures have a shutter channel
+static uint32_t dmxConfig = 0;         // hash of fixture configuration dmxOps were compiled from
+static uint8_t  dmxFrame[DMX_CHANNELS];
+static bool     dmxPending = false;    // frame filled but not yet handed to the DMX library
+static unsigned long dmxLastShow = 0;
+static unsigned long dmxLastSent = 0;
 
-    uint32_t in = strip.getPixelColor(i);     // get the colors for the individual fixtures as suggested by Aircoookie in issue #462
-    byte w = W(in);
-    byte r = R(in);
-    byte g = G(in);
-    byte b = B(in);
+static uint32_t dmxConfigHash() {
+  uint32_t h = 2166136261U; // FNV-1a
+  const uint16_t v[] = { DMXChannels, DMXStart, DMXGap, DMXStartLED };
+  for (size_t i = 0; i < sizeof(v); i++) h = (h ^ reinterpret_cast<const uint8_t*>(v)[i]) * 16777619U;
+  for (unsigned i = 0; i < DMXChannels && i < 15; i++) h = (h ^ DMXFixtureMap[i]) * 16777619U;
+  return h;
+}
 
-    int DMXFixtureStart = DMXStart + (DMXGap * (i - DMXStartLED));
-    for (int j = 0; j < DMXChannels; j++) {
-      int DMXAddr = DMXFixtureStart + j;
-      switch (DMXFixtureMap[j]) {
-        case 0:        // Set this channel to 0. Good way to tell strobe- and fade-functions to fuck right off.
-          dmx.write(DMXAddr, 0);
-          break;
-        case 1:        // Red
-          dmx.write(DMXAddr, calc_brightness ? (r * brightness) / 255 : r);
-          break;
-        case 2:        // Green
-          dmx.write(DMXAddr, calc_brightness ? (g * brightness) / 255 : g);
-          break;
-        case 3:        // Blue
-          dmx.write(DMXAddr, calc_brightness ? (b * brightness) / 255 : b);
-          break;
-        case 4:        // White
-          dmx.write(DMXAddr, calc_brightness ? (w * brightness) / 255 : w);
-          break;
-        case 5:        // Shutter channel. Controls the brightness.
-          dmx.write(DMXAddr, brightness);
-          break;
-        case 6:        // Sets this channel to 255. Like 0, but more wholesome.
-          dmx.write(DMXAddr, 255);
-          break;
-      }
+static void compileDMXMap() {
+  dmxScaled = true;
+  for (unsigned j = 0; j < DMXChannels && j < 15; j++) {
+    switch (DMXFixtureMap[j]) {
+      case 1:  dmxOps[j] = { 16, 0 };          break; // Red
+      case 2:  dmxOps[j] = {  8, 0 };          break; // Green
+      case 3:  dmxOps[j] = {  0, 0 };          break; // Blue
+      case 4:  dmxOps[j] = { 24, 0 };          break; // White
+      case 5:  dmxOps[j] = { DMX_FIXED, 0 };   dmxScaled = false; break; // Shutter channel. Controls the brightness (value set per frame).
+      case 6:  dmxOps[j] = { DMX_FIXED, 255 }; break; // Sets this channel to 255. Like 0, but more wholesome.
+      default: dmxOps[j] = { DMX_FIXED, 0 };   break; // Set this channel to 0. Good way to tell strobe- and fade-functions to fuck right off.
     }
   }
+  memset(dmxFrame, 0, sizeof(dmxFrame));
+  dmxScaleBri = -1;
+  if (!dmxScaled) for (unsigned v = 0; v < 256; v++) dmxScale[v] = v; // shutter channel dims instead
+  dmxConfig = dmxConfigHash();
+}
+
+// uses the amount of LEDs as fixture count, colors for the individual fixtures as suggested by Aircoookie in issue #462
+static void fillDMXFrame() {
+  const uint8_t brightness = strip.getBrightness();
+  if (dmxScaled && brightness != dmxScaleBri) {
+    for (unsigned v = 0; v < 256; v++) dmxScale[v] = (v * brightness) / 255;
+    dmxScaleBri = brightness;
+  }
+  const unsigned channels = min((unsigned)DMXChannels, 15U);
+  for (unsigned j = 0; j < channels; j++) if (DMXFixtureMap[j] == 5) dmxOps[j].value = brightness;
+
+  const unsigned len = strip.getLengthTotal();
+  unsigned addr = max((int)DMXStart, 1); // DMX address of first channel of fixture
+  for (unsigned i = DMXStartLED; i < len && addr <= DMX_CHANNELS; i++, addr += DMXGap) {
+    const uint32_t c = strip.getPixelColor(i);
+    uint8_t *fixture = dmxFrame + addr - 1;
+    const unsigned n = min(channels, DMX_CHANNELS + 1 - addr); // last fixture may be cut off at end of universe
+    for (unsigned j = 0; j < n; j++) fixture[j] = dmxOps[j].shift == DMX_FIXED ? dmxOps[j].value : dmxScale[(c >> dmxOps[j].shift) & 0xFF];
+  }
+}
+
+void handleDMXOutput()
+{
+  // don't act, when in DMX Proxy mode
+  if (e131ProxyUniverse != 0) return;
+
+  if (strip.getLastShow() != dmxLastShow) {
+    dmxLastShow = strip.getLastShow();
+    if (dmxConfigHash() != dmxConfig) compileDMXMap();
+    fillDMXFrame();
+    dmxPending = true;
+  }
+#ifdef DMX_BLOCKING
+  else if (millis() - dmxLastSent > DMX_REFRESH) dmxPending = true;
+  if (!dmxPending) return;
+#endif
 
+  if (!dmx.ready()) return; // previous universe still being sent
+  dmx.write(dmxFrame, DMX_CHANNELS);
   dmx.update();        // update the DMX bus
+  dmxPending = false;
+  dmxLastSent = millis();
 }
 
 void initDMXOutput() {
  #if defined(ESP8266) || defined(CONFIG_IDF_TARGET_ESP32C3) || defined(CONFIG_IDF_TARGET_ESP32S2)
   dmx.init(512);        // initialize with bus length
  #else
-  dmx.initWrite(512);  // initialize with bus length
+  int port = 2;
+  #ifdef WLED_ENABLE_DMX_INPUT
+  if (dmxInputPort == port && dmxInputReceivePin > 0) port = 1; // UART 2 is used by DMX input
+  #endif
+  dmx.initWrite(512, port);  // initialize with bus length
  #endif
 }
 #else
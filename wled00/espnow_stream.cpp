@@ -0,0 +1,289 @@
+#include "wled.h"
+
+/*
+ * ESP-NOW realtime pixel streaming (leader broadcasts rendered frames to followers, no WiFi infrastructure needed)
+ *
+ * Frames (whole strip, RGB, scaled by brightness) are split into fragments of ESPNOW_STREAM_PIXELS pixels at fixed
+ * boundaries. With delta encoding only fragments that changed since they were last sent are transmitted, all fragments
+ * are sent at least every ESPNOW_STREAM_KEY_MS (key frame) to heal losses and keep followers in realtime mode.
+ * Fragment data is RLE encoded whenever that is smaller (same spans as binary /px upload).
+ * Followers apply fragments in realtime mode and show the frame on the fragment flagged as push, like DDP.
+ *
+ * Packet layout:
+ *  0    'X'
+ *  1    flags: bit 0 RLE, bit 1 push (last fragment of frame), bit 2 key frame
+ *  2    frame sequence number
+ *  3    number of fragments sent for this frame
+ *  4-5  first pixel (little endian)
+ *  6... RGB pixels or RLE spans (control byte c < 128: c+1 literal pixels, c >= 128: one pixel repeated c-126 times)
+ */
+
+#ifndef WLED_DISABLE_ESPNOW
+
+#define ESPNOW_STREAM_MAGIC  'X'
+#define ESPNOW_STREAM_HDR    6
+#define ESPNOW_STREAM_PIXELS 81     // (250 - header) / 3
+#define ESPNOW_STREAM_RLE    0x01
+#define ESPNOW_STREAM_PUSH   0x02
+#define ESPNOW_STREAM_KEY    0x04
+#define ESPNOW_STREAM_KEY_MS 1000
+#define ESPNOW_STREAM_QUEUE  16     // received packets waiting for loop()
+
+typedef struct EspNowStreamPacket {
+  uint8_t len;
+  uint8_t data[250];
+} espNowStreamPacket;
+
+// leader
+static uint8_t      *txFrame = nullptr;    // RGB snapshot of frame being sent
+static uint32_t     *txHash = nullptr;     // per fragment hash of content last sent
+static uint8_t      *txPending = nullptr;  // per fragment: to be sent in current frame
+static unsigned      txPixels = 0;
+static unsigned      txFrags = 0;
+static unsigned      txNext = 0;           // next fragment to check
+static uint8_t       txCount = 0;          // fragments sent for current frame
+static uint8_t       txLeft = 0;           // fragments still to send
+static uint8_t       txSeq = 0;
+static uint8_t       txFlags = 0;
+static unsigned long txLastShow = 0;
+static unsigned long txLastKey = 0;
+static uint32_t      txFrames = 0;
+static uint32_t      txSkipped = 0;        // rendered frames not sent as previous frame was still being sent
+static uint32_t      txFailed = 0;
+
+// follower
+static espNowStreamPacket *rxQueue = nullptr;
+static volatile uint8_t    rxHead = 0;     // written by receive callback
+static volatile uint8_t    rxTail = 0;     // read by loop
+static int                 rxSeq = -1;
+static uint8_t             rxCount = 0;    // fragments received for current frame
+static uint8_t             rxExpected = 0;
+static bool                rxShown = false;
+static uint32_t            rxFrames = 0;
+static uint32_t            rxLost = 0;     // fragments
+static uint32_t            rxLostFrames = 0;
+static uint32_t            rxOverflow = 0; // packets dropped as queue was full
+static uint32_t            rxInvalid = 0;
+
+// encodes n RGB pixels as RLE spans, returns encoded length or 0 if that would not be smaller than raw data
+static size_t encodeRle(const uint8_t *px, size_t n, uint8_t *out) {
+  const size_t cap = n * 3;
+  size_t i = 0, o = 0;
+  while (i < n) {
+    size_t run = 1;
+    while (i + run < n && run < 129 && !memcmp(px + 3*i, px + 3*(i+run), 3)) run++;
+    if (o + 4 > cap) return 0;
+    if (run > 1) {
+      out[o++] = run + 126;
+      memcpy(out + o, px + 3*i, 3);
+      o += 3;
+      i += run;
+    } else {
+      const size_t ctrl = o++;
+      unsigned lit = 0;
+      // literals until the next run starts
+      while (i < n && lit < 128 && !(lit && i + 1 < n && !memcmp(px + 3*i, px + 3*(i+1), 3))) {
+        if (o + 3 > cap) return 0;
+        memcpy(out + o, px + 3*i, 3);
+        o += 3;
+        i++;
+        lit++;
+      }
+      out[ctrl] = lit - 1;
+    }
+  }
+  return o < cap ? o : 0;
+}
+
+// sets pixels of a fragment, returns false if data is malformed
+static bool decodeFragment(const uint8_t *d, size_t len, unsigned pos, bool rle) {
+  if (!rle) {
+    if (len % 3) return false;
+    for (size_t i = 0; i < len; i += 3) setRealtimePixel(pos++, d[i], d[i+1], d[i+2], 0);
+    return true;
+  }
+  size_t i = 0;
+  while (i < len) {
+    const uint8_t c = d[i++];
+    const bool run = c >= 128;
+    const unsigned n = run ? c - 126 : c + 1;
+    if (i + (run ? 3 : 3*n) > len) return false;
+    for (unsigned k = 0; k < n; k++) {
+      const uint8_t *p = d + i + (run ? 0 : 3*k);
+      setRealtimePixel(pos++, p[0], p[1], p[2], 0);
+    }
+    i += run ? 3 : 3*n;
+  }
+  return true;
+}
+
+static void freeStreamBuffers() {
+  p_free(txFrame);   txFrame = nullptr;
+  p_free(txHash);    txHash = nullptr;
+  p_free(txPending); txPending = nullptr;
+  txPixels = txFrags = 0;
+  txLeft = 0;
+  p_free(rxQueue);   rxQueue = nullptr;
+}
+
+// takes a snapshot of the last shown frame and determines fragments to send
+static bool startStreamFrame() {
+  const unsigned len = min((unsigned)strip.getLengthTotal(), (unsigned)(255 * ESPNOW_STREAM_PIXELS));
+  if (len != txPixels) {
+    freeStreamBuffers();
+    txFrags   = (len + ESPNOW_STREAM_PIXELS - 1) / ESPNOW_STREAM_PIXELS;
+    txFrame   = static_cast<uint8_t*>(p_malloc(len * 3));
+    txHash    = static_cast<uint32_t*>(p_calloc(txFrags, sizeof(uint32_t)));
+    txPending = static_cast<uint8_t*>(p_malloc(txFrags));
+    if (!txFrame || !txHash || !txPending) {
+      freeStreamBuffers();
+      return false;
+    }
+    txPixels = len;
+    txLastKey = 0;
+  }
+  for (unsigned i = 0; i < len; i++) {
+    const uint32_t c = color_fade(strip.getPixelColor(i), bri);
+    txFrame[3*i] = R(c); txFrame[3*i+1] = G(c); txFrame[3*i+2] = B(c);
+  }
+  const bool key = !espNowStreamDelta || millis() - txLastKey >= ESPNOW_STREAM_KEY_MS;
+  if (key) txLastKey = millis();
+  txLeft = 0;
+  for (unsigned f = 0; f < txFrags; f++) {
+    const unsigned n = min((unsigned)ESPNOW_STREAM_PIXELS, len - f*ESPNOW_STREAM_PIXELS);
+    uint32_t h = 2166136261U; // FNV-1a
+    for (const uint8_t *p = txFrame + 3*f*ESPNOW_STREAM_PIXELS, *e = p + 3*n; p < e; p++) h = (h ^ *p) * 16777619U;
+    txPending[f] = key || h != txHash[f];
+    txHash[f] = h;
+    txLeft += txPending[f];
+  }
+  if (!txLeft) return false; // nothing changed
+  txCount = txLeft;
+  txFlags = key ? ESPNOW_STREAM_KEY : 0;
+  txNext  = 0;
+  txSeq++;
+  txFrames++;
+  return true;
+}
+
+// sends next fragment of current frame, returns false if nothing was sent
+static bool sendStreamFragment() {
+  while (txNext < txFrags && !txPending[txNext]) txNext++;
+  if (txNext >= txFrags) { txLeft = 0; return false; }
+  const unsigned first = txNext * ESPNOW_STREAM_PIXELS;
+  const unsigned n = min((unsigned)ESPNOW_STREAM_PIXELS, txPixels - first);
+  uint8_t packet[ESPNOW_STREAM_HDR + 3*ESPNOW_STREAM_PIXELS];
+  size_t len = encodeRle(txFrame + 3*first, n, packet + ESPNOW_STREAM_HDR);
+  packet[1] = txFlags;
+  if (len) packet[1] |= ESPNOW_STREAM_RLE;
+  else {
+    len = 3*n;
+    memcpy(packet + ESPNOW_STREAM_HDR, txFrame + 3*first, len);
+  }
+  if (txLeft == 1) packet[1] |= ESPNOW_STREAM_PUSH;
+  packet[0] = ESPNOW_STREAM_MAGIC;
+  packet[2] = txSeq;
+  packet[3] = txCount;
+  packet[4] = first & 0xFF;
+  packet[5] = first >> 8;
+  if (quickEspNow.send(ESPNOW_BROADCAST_ADDRESS, packet, ESPNOW_STREAM_HDR + len)) txFailed++; // fragment is lost, followers count it
+  txPending[txNext++] = 0;
+  txLeft--;
+  return true;
+}
+
+// ESP-NOW receive callback context: queue packet for loop()
+bool espNowStreamReceive(const uint8_t *data, uint8_t len) {
+  if (len < ESPNOW_STREAM_HDR || data[0] != ESPNOW_STREAM_MAGIC) return false;
+  if (espNowStreamMode != ESPNOW_STREAM_RECEIVE || !rxQueue) return true;
+  const uint8_t next = (rxHead + 1) % ESPNOW_STREAM_QUEUE;
+  if (next == rxTail) { rxOverflow++; return true; }
+  rxQueue[rxHead].len = len;
+  memcpy(rxQueue[rxHead].data, data, len);
+  rxHead = next;
+  return true;
+}
+
+static void processStreamPacket(const uint8_t *data, size_t len) {
+  const uint8_t flags = data[1];
+  const uint8_t seq   = data[2];
+  if (seq != rxSeq) {
+    // after realtime timed out (leader restarted or stream resumed) any sequence number is accepted
+    if (rxSeq >= 0 && realtimeMode == REALTIME_MODE_ESPNOW) {
+      const int8_t gap = seq - rxSeq;
+      if (gap < 0 && !(flags & ESPNOW_STREAM_KEY)) return; // late fragment of an older frame
+      if (gap > 0) { // else: key frame with older sequence number, leader restarted, resync
+        if (rxCount < rxExpected) rxLost += rxExpected - rxCount;
+        rxLostFrames += gap - 1;
+      }
+    }
+    rxSeq = seq;
+    rxCount = 0;
+    rxShown = false;
+  }
+  rxExpected = data[3];
+  rxCount++;
+  realtimeLock(realtimeTimeoutMs, REALTIME_MODE_ESPNOW);
+  if (realtimeOverride) return;
+  if (!decodeFragment(data + ESPNOW_STREAM_HDR, len - ESPNOW_STREAM_HDR, data[4] | (data[5] << 8), flags & ESPNOW_STREAM_RLE)) {
+    rxInvalid++;
+    return;
+  }
+  // show on push, or once all fragments arrived if push got lost
+  if (!rxShown && ((flags & ESPNOW_STREAM_PUSH) || rxCount >= rxExpected)) {
+    strip.show();
+    rxShown = true;
+    rxFrames++;
+  }
+}
+
+void handleEspNowStream() {
+  if (espNowStreamMode == ESPNOW_STREAM_OFF || !enableESPNow || statusESPNow != ESP_NOW_STATE_ON) {
+    if (txFrame || rxQueue) freeStreamBuffers();
+    return;
+  }
+
+  if (espNowStreamMode == ESPNOW_STREAM_RECEIVE) {
+    if (!rxQueue) {
+      rxQueue = static_cast<espNowStreamPacket*>(p_malloc(ESPNOW_STREAM_QUEUE * sizeof(espNowStreamPacket)));
+      rxHead = rxTail = 0;
+      rxSeq = -1;
+    }
+    while (rxQueue && rxTail != rxHead) {
+      processStreamPacket(rxQueue[rxTail].data, rxQueue[rxTail].len);
+      rxTail = (rxTail + 1) % ESPNOW_STREAM_QUEUE;
+    }
+    return;
+  }
+
+  // leader: send last shown frame, QuickEspNow can only queue a few packets so fragments are spread over loops
+  if (txLeft) {
+    if (strip.getLastShow() != txLastShow) {
+      txLastShow = strip.getLastShow();
+      txSkipped++;
+    }
+  } else if (strip.getLastShow() != txLastShow || millis() - txLastKey >= ESPNOW_STREAM_KEY_MS) {
+    txLastShow = strip.getLastShow();
+    if (!startStreamFrame()) return;
+  }
+  while (txLeft && quickEspNow.readyToSendData() && sendStreamFragment());
+}
+
+// statistics for /json/info
+void serializeEspNowStream(JsonObject root) {
+  if (espNowStreamMode == ESPNOW_STREAM_OFF) return;
+  JsonObject s = root.createNestedObject(F("espnow"));
+  if (espNowStreamMode == ESPNOW_STREAM_SEND) {
+    s[F("tx")]    = txFrames;
+    s[F("skip")]  = txSkipped;
+    s[F("fail")]  = txFailed;
+  } else {
+    s[F("rx")]    = rxFrames;
+    s[F("lost")]  = rxLost;
+    s[F("lostf")] = rxLostFrames;
+    s[F("ovf")]   = rxOverflow;
+    s[F("inv")]   = rxInvalid;
+  }
+}
+
+#endif
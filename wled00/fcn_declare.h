@@ -19,6 +19,7 @@ void shortPressAction(uint8_t b=0);
 void longPressAction(uint8_t b=0);
 void doublePressAction(uint8_t b=0);
 bool isButtonPressed(uint8_t b=0);
+void detachButtonInterrupt(uint8_t b);
 void handleButton();
 void handleIO();
 void IRAM_ATTR touchButtonISR();
@@ -210,8 +211,17 @@ void handleArtnetPollReply(IPAddress ipAddress);
 void prepareArtnetPollReply(ArtPollReply* reply);
 void sendArtnetPollReply(ArtPollReply* reply, IPAddress ipAddress, uint16_t portAddress);
 
+//espnow_stream.cpp
+#ifndef WLED_DISABLE_ESPNOW
+bool espNowStreamReceive(const uint8_t *data, uint8_t len);
+void handleEspNowStream();
+void serializeEspNowStream(JsonObject root);
+#endif
+
 //file.cpp
 bool handleFileRead(AsyncWebServerRequest*, String path);
+void invalidateFsCache();
+void serializeFsCache(JsonObject root);
 bool writeObjectToFileUsingId(const char* file, uint16_t id, const JsonDocument* content);
 bool writeObjectToFile(const char* file, const char* key, const JsonDocument* content);
 bool readObjectFromFileUsingId(const char* file, uint16_t id, JsonDocument* dest, const JsonDocument* filter = nullptr);
@@ -243,6 +253,14 @@ byte renderImageToSegment(Segment &seg);
 void endImagePlayback(Segment* seg);
 #endif
 
+//fseq_player.cpp
+#ifdef WLED_ENABLE_FSEQ
+bool isFseqFile(const char *name);
+byte renderFseqToSegment(Segment &seg);
+void handleFseqPrefetch();
+void endFseqPlayback(Segment *seg);
+#endif
+
 //improv.cpp
 enum ImprovRPCType {
   Command_Wifi = 0x01,
@@ -263,6 +281,7 @@ void sendImprovIPRPCResult(ImprovRPCType type);
 void initIR();
 void deInitIR();
 void handleIR();
+void reloadIRTable();
 
 //json.cpp
 #include "ESPAsyncWebServer.h"
@@ -270,6 +289,11 @@ void handleIR();
 #include "src/dependencies/json/AsyncJson-v6.h"
 
 bool deserializeState(JsonObject root, byte callMode = CALL_MODE_DIRECT_CHANGE, byte presetId = 0);
+bool deserializeSegment(JsonObject elem, byte it, byte presetId = 0);
+void deserializeSegmentObject(JsonObject segObj, byte presetId);
+void deserializeStateHead(JsonObject root, byte &callMode, byte presetId);
+bool deserializeStateTail(JsonObject root, byte callMode, byte presetId);
+void purgeDeletedSegments(size_t deleted);
 void serializeSegment(const JsonObject& root, const Segment& seg, byte id, bool forPreset = false, bool segmentBounds = true);
 void serializeState(JsonObject root, bool forPreset = false, bool includeBri = true, bool segmentBounds = true, bool selectedSegmentsOnly = false);
 void serializeInfo(JsonObject root);
@@ -280,6 +304,9 @@ void serveJson(AsyncWebServerRequest* request);
 bool serveLiveLeds(AsyncWebServerRequest* request, uint32_t wsClient = 0);
 #endif
 
+//jsonstream.cpp
+#include "jsonstream.h"
+
 //led.cpp
 void setValuesFromSegment(uint8_t s);
 #define setValuesFromMainSeg()          setValuesFromSegment(strip.getMainSegmentId())
@@ -304,6 +331,8 @@ void parseLxJson(int lxValue, byte segId, bool secondary);
 //mqtt.cpp
 bool initMqtt();
 void publishMqtt();
+void handleMqtt();
+void serializeMqttInfo(JsonObject root);
 
 //ntp.cpp
 void handleTime();
@@ -324,6 +353,9 @@ void handleOverlayDraw();
 void _overlayAnalogCountdown();
 void _overlayAnalogClock();
 
+//perf.cpp
+void serializePerf(JsonObject root);
+
 //playlist.cpp
 void shufflePlaylist();
 void unloadPlaylist();
@@ -349,11 +381,34 @@ bool getPresetName(byte index, String& name);
 void handleWiZdata(uint8_t *incomingData, size_t len);
 void handleRemote();
 
+//scheduler.cpp
+// background task of the main loop: optional readiness predicate, a period (0 = every pass) and a maximum deferral;
+// a task whose expected cost exceeds the time left until the next frame is postponed, but never for longer than
+// maxDefer ms (0 = never postponed)
+typedef struct LoopTask {
+  void        (*fn)();
+  bool        (*ready)();  // nullptr = always ready
+  uint16_t      period;    // ms
+  uint16_t      maxDefer;  // ms
+  uint8_t       perfSpan;  // PERF_* span to record or 255
+  uint16_t      costUs;    // expected cost: peak of recent runs (halves every LOOP_TASK_COST_DECAY ms)
+  unsigned long lastRun;
+} loopTask;
+void runLoopTasks(loopTask *tasks, size_t count);
+
 //set.cpp
 bool isAsterisksOnly(const char* str, byte maxLen);
 void handleSettingsSet(AsyncWebServerRequest *request, byte subPage);
 bool handleSet(AsyncWebServerRequest *request, const String& req, bool apply=true);
 
+//timesync.cpp
+int64_t timeSyncClock();
+void timeSyncReference(IPAddress ip);
+bool timeSyncLocked(IPAddress ip);
+void handleTimeSyncPacket(const uint8_t *data, size_t len, IPAddress ip, int64_t rxUs);
+void handleTimeSync();
+void serializeTimeSync(JsonObject root);
+
 //udp.cpp
 void notify(byte callMode, bool followUp=false);
 uint8_t realtimeBroadcast(uint8_t type, IPAddress client, uint16_t length, const uint8_t* buffer, uint8_t bri=255, bool isRGBW=false);
@@ -368,6 +423,9 @@ void espNowSentCB(uint8_t* address, uint8_t status);
 void espNowReceiveCB(uint8_t* address, uint8_t* data, uint8_t len, signed int rssi, bool broadcast);
 #endif
 
+//udp_compact.cpp
+#include "udp_compact.h"
+
 //network.cpp
 bool initEthernet(); // result is informational
 int  getSignalQuality(int rssi);
@@ -435,6 +493,7 @@ class Usermod {
     virtual void onUpdateBegin(bool) {}                                      // fired prior to and after unsuccessful firmware update
     virtual void onStateChange(uint8_t mode) {}                              // fired upon WLED state change
     virtual uint16_t getId() {return USERMOD_ID_UNSPECIFIED;}
+    virtual uint16_t getLoopPeriod() { return 0; }                           // desired loop() period in ms, 0 = every WLED loop pass (loop may be deferred to stay within budget)
 
   // API shims
   private:
@@ -522,6 +581,8 @@ void enumerateLedmaps();
 [[gnu::hot]] uint8_t get_random_wheel_index(uint8_t pos);
 [[gnu::hot, gnu::pure]] float mapf(float x, float in_min, float in_max, float out_min, float out_max);
 uint32_t hashInt(uint32_t s);
+
+//perlin.cpp
 int32_t perlin1D_raw(uint32_t x, bool is16bit = false);
 int32_t perlin2D_raw(uint32_t x, uint32_t y, bool is16bit = false);
 int32_t perlin3D_raw(uint32_t x, uint32_t y, uint32_t z, bool is16bit = false);
@@ -531,6 +592,11 @@ uint16_t perlin16(uint32_t x, uint32_t y, uint32_t z);
 uint8_t perlin8(uint16_t x);
 uint8_t perlin8(uint16_t x, uint16_t y);
 uint8_t perlin8(uint16_t x, uint16_t y, uint16_t z);
+// batched versions: fill count values along x starting at x, advancing by xstep (same results as single value functions)
+void perlin16_row(uint16_t *out, unsigned count, uint32_t x, uint32_t xstep, uint32_t y);
+void perlin16_row(uint16_t *out, unsigned count, uint32_t x, uint32_t xstep, uint32_t y, uint32_t z);
+void perlin8_row(uint8_t *out, unsigned count, uint16_t x, uint16_t xstep, uint16_t y);
+void perlin8_row(uint8_t *out, unsigned count, uint16_t x, uint16_t xstep, uint16_t y, uint16_t z);
 
 // fast (true) random numbers using hardware RNG, all functions return values in the range lowerlimit to upperlimit-1
 // note: for true random numbers with high entropy, do not call faster than every 200ns (5MHz)
@@ -641,6 +707,11 @@ void serveJsonError(AsyncWebServerRequest* request, uint16_t code, uint16_t erro
 void serveSettings(AsyncWebServerRequest* request, bool post = false);
 void serveSettingsJS(AsyncWebServerRequest* request);
 
+//pixelstream.cpp
+bool pixelStreamBegin(const void *owner);
+bool pixelStreamWrite(const void *owner, const uint8_t *data, size_t len);
+int  pixelStreamEnd(const void *owner);
+
 //ws.cpp
 void handleWs();
 void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len);
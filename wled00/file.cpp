@@ -273,6 +273,7 @@ bool writeObjectToFile(const char* file, const char* key, const JsonDocument* co
 
   size_t pos = 0;
   char fileName[129]; strncpy_P(fileName, file, 128); fileName[128] = 0; //use PROGMEM safe copy as FS.open() does not
+  invalidateFsCache(); // in-place updates may keep size and (without NTP) modification time
   f = WLED_FS.open(fileName, WLED_FS.exists(fileName) ? "r+" : "w+");
   if (!f) {
     DEBUGFS_PRINTLN(F("Failed to open!"));
@@ -377,65 +378,168 @@ void updateFSInfo() {
 }
 
 
-#ifdef ARDUINO_ARCH_ESP32
-// caching presets in PSRAM may prevent occasional flashes seen when HomeAssitant polls WLED
-// original idea by @akaricchi (https://github.com/Akaricchi)
-// returns a pointer to the PSRAM buffer, updates size parameter
-static const uint8_t *getPresetCache(size_t &size) {
-  static unsigned long presetsCachedTime = 0;
-  static uint8_t *presetsCached = nullptr;
-  static size_t presetsCachedSize = 0;
-  static byte presetsCachedValidate = 0;
+/*
+ * Read-through cache for files served over HTTP (presets, palettes, ledmaps, skin...)
+ * Polling clients (e.g. HomeAssistant) and UI reloads no longer read from flash (which may cause occasional LED flashes).
+ * Original preset caching idea by @akaricchi (https://github.com/Akaricchi)
+ * Entries are validated on each request against file size, modification time and WLED's own write generations,
+ * buffers are reference counted so a file changed during a running transfer is never freed underneath it.
+ */
+typedef struct FsCacheEntry {
+  std::shared_ptr<uint8_t> data;
+  uint32_t      pathHash;
+  uint32_t      stamp;    // validator, also used as ETag
+  size_t        size;
+  unsigned long lastUse;
+} fsCacheEntry;
+
+static fsCacheEntry fsCache[FS_CACHE_ENTRIES];
+static uint16_t fsCacheGeneration = 0; // incremented by WLED's own file writes
+static size_t   fsCacheBytes  = 0;
+static uint32_t fsCacheHits   = 0;
+static uint32_t fsCacheMisses = 0;
+
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len) {
+  const uint8_t *p = static_cast<const uint8_t*>(data);
+  while (len--) h = (h ^ *p++) * 16777619U;
+  return h;
+}
+
+void invalidateFsCache() {
+  fsCacheGeneration++;
+}
 
-  //if (presetsModifiedTime != presetsCachedTime) DEBUG_PRINTLN(F("getPresetCache(): presetsModifiedTime changed."));
-  //if (presetsCachedValidate != cacheInvalidate) DEBUG_PRINTLN(F("getPresetCache(): cacheInvalidate changed."));
+// changes whenever the file or anything WLED knows about its writes changes
+static uint32_t fsFileStamp(uint32_t pathHash, size_t size, time_t lastWrite) {
+  uint32_t v[] = { (uint32_t)size, (uint32_t)lastWrite, fsCacheGeneration, cacheInvalidate };
+  return fnv1a(pathHash, v, sizeof(v));
+}
 
-  if ((presetsModifiedTime != presetsCachedTime) || (presetsCachedValidate != cacheInvalidate)) {
-    if (presetsCached) {
-      p_free(presetsCached);
-      presetsCached = nullptr;
+static size_t fsCacheBudget() {
+  #ifdef ARDUINO_ARCH_ESP32
+  if (psramSafe && psramFound()) return FS_CACHE_PSRAM_SIZE;
+  #endif
+  return FS_CACHE_RAM_SIZE;
+}
+
+static void fsCacheDrop(fsCacheEntry &e) {
+  if (!e.data) return;
+  fsCacheBytes -= e.size;
+  e.data.reset(); // buffer is freed once the last response using it is finished
+}
+
+// returns cached content of file (reading it into the cache on a miss), nullptr if file is not cacheable
+static std::shared_ptr<uint8_t> fsCacheGet(uint32_t pathHash, File &file, size_t size, uint32_t stamp) {
+  for (auto &e : fsCache) {
+    if (!e.data || e.pathHash != pathHash) continue;
+    if (e.stamp == stamp) {
+      e.lastUse = millis();
+      fsCacheHits++;
+      return e.data;
     }
+    fsCacheDrop(e); // stale
+    break;
   }
-
-  if (!presetsCached) {
-    File file = WLED_FS.open(FPSTR(getPresetsFileName()), "r");
-    if (file) {
-      presetsCachedTime = presetsModifiedTime;
-      presetsCachedValidate = cacheInvalidate;
-      presetsCachedSize = 0;
-      presetsCached = (uint8_t*)p_malloc(file.size() + 1);
-      if (presetsCached) {
-        presetsCachedSize = file.size();
-        file.read(presetsCached, presetsCachedSize);
-        presetsCached[presetsCachedSize] = 0;
-        file.close();
-      }
+  fsCacheMisses++;
+  const size_t budget = fsCacheBudget();
+  if (!size || size > budget/2) return nullptr;
+
+  // make room, least recently used first
+  fsCacheEntry *slot = nullptr;
+  while (true) {
+    fsCacheEntry *lru = nullptr;
+    slot = nullptr;
+    for (auto &e : fsCache) {
+      if (!e.data) { if (!slot) slot = &e; }
+      else if (!lru || (long)(e.lastUse - lru->lastUse) < 0) lru = &e;
     }
+    if (slot && fsCacheBytes + size <= budget) break;
+    if (!lru) return nullptr;
+    fsCacheDrop(*lru);
   }
 
-  size = presetsCachedSize;
-  return presetsCached;
+  uint8_t *buf = static_cast<uint8_t*>(p_malloc(size));
+  if (!buf) return nullptr;
+  if (file.read(buf, size) != size) {
+    p_free(buf);
+    return nullptr;
+  }
+  slot->data     = std::shared_ptr<uint8_t>(buf, [](uint8_t *p) { p_free(p); });
+  slot->pathHash = pathHash;
+  slot->stamp    = stamp;
+  slot->size     = size;
+  slot->lastUse  = millis();
+  fsCacheBytes  += size;
+  return slot->data;
+}
+
+void serializeFsCache(JsonObject root) {
+  JsonObject fc = root.createNestedObject(F("cache"));
+  unsigned n = 0;
+  for (const auto &e : fsCache) if (e.data) n++;
+  fc["n"]        = n;
+  fc["b"]        = fsCacheBytes;
+  fc[F("hit")]   = fsCacheHits;
+  fc[F("miss")]  = fsCacheMisses;
+}
+
+// returns PROGMEM string
+static const char *fsContentType(const String &path) {
+  if (path.endsWith(F(".htm")) || path.endsWith(F(".html"))) return CONTENT_TYPE_HTML;
+  if (path.endsWith(F(".css")))  return CONTENT_TYPE_CSS;
+  if (path.endsWith(F(".js")))   return CONTENT_TYPE_JAVASCRIPT;
+  if (path.endsWith(F(".json"))) return CONTENT_TYPE_JSON;
+  if (path.endsWith(F(".png")))  return PSTR("image/png");
+  if (path.endsWith(F(".gif")))  return PSTR("image/gif");
+  if (path.endsWith(F(".jpg")))  return PSTR("image/jpeg");
+  if (path.endsWith(F(".ico")))  return PSTR("image/x-icon");
+  if (path.endsWith(F(".svg")))  return PSTR("image/svg+xml");
+  return CONTENT_TYPE_PLAIN;
 }
-#endif
 
 bool handleFileRead(AsyncWebServerRequest* request, String path){
   DEBUGFS_PRINT(F("WS FileRead: ")); DEBUGFS_PRINTLN(path);
   if(path.endsWith("/")) path += "index.htm";
   if(path.indexOf(F("sec")) > -1) return false;
-  #ifdef ARDUINO_ARCH_ESP32
-  if (psramSafe && psramFound() && path.endsWith(FPSTR(getPresetsFileName()))) {
-    size_t psize;
-    const uint8_t *presets = getPresetCache(psize);
-    if (presets) {
-      AsyncWebServerResponse *response = request->beginResponse_P(200, FPSTR(CONTENT_TYPE_JSON), presets, psize);
-      request->send(response);
-      return true;
-    }
+  bool gzip = false;
+  if (!WLED_FS.exists(path)) {
+    if (!WLED_FS.exists(path + ".gz")) return false;
+    gzip = true; // precompressed file, sent as is
   }
-  #endif
-  if(WLED_FS.exists(path) || WLED_FS.exists(path + ".gz")) {
-    request->send(request->beginResponse(WLED_FS, path, {}, request->hasArg(F("download")), {}));
+  if (request->hasArg(F("download"))) {
+    request->send(request->beginResponse(WLED_FS, path, {}, true, {}));
     return true;
   }
-  return false;
+
+  File file = WLED_FS.open(gzip ? path + ".gz" : path, "r");
+  if (!file || file.isDirectory()) return false;
+  const size_t   size     = file.size();
+  const uint32_t pathHash = fnv1a(2166136261U, path.c_str(), path.length());
+  const uint32_t stamp    = fsFileStamp(pathHash, size, file.getLastWrite());
+  char etag[12];
+  sprintf_P(etag, PSTR("%08x"), (unsigned)stamp);
+
+  AsyncWebServerResponse *response;
+  AsyncWebHeader *header = request->getHeader(F("If-None-Match"));
+  if (header && header->value() == etag) {
+    file.close();
+    response = request->beginResponse(304);
+  } else {
+    std::shared_ptr<uint8_t> data = fsCacheGet(pathHash, file, size, stamp);
+    file.close();
+    if (data) {
+      response = request->beginResponse(FPSTR(fsContentType(path)), size, [data, size](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+        size_t len = min(maxLen, size - index);
+        memcpy(buffer, data.get() + index, len);
+        return len;
+      });
+      if (gzip) response->addHeader(F("Content-Encoding"), F("gzip"));
+    } else {
+      response = request->beginResponse(WLED_FS, path, {}, false, {}); // too large for cache (or out of memory), stream from FS
+    }
+  }
+  response->addHeader(F("Cache-Control"), F("no-cache")); // file may change any time, revalidate using ETag
+  response->addHeader(F("ETag"), etag);
+  request->send(response);
+  return true;
 }
@@ -0,0 +1,287 @@
+#include "wled.h"
+
+#ifdef WLED_ENABLE_FSEQ
+
+#if defined(WLED_USE_SD_MMC)
+  #include "SD_MMC.h"
+  #define FSEQ_SD SD_MMC
+#elif defined(WLED_USE_SD_SPI)
+  #include "SD.h"
+  #define FSEQ_SD SD
+#endif
+
+/*
+ * Streaming player for xLights/Falcon .fseq (v2) sequences, used by the "Image" effect
+ *
+ * Segment pixels are mapped to sequence channels by their position on the strip (3 channels per pixel, same as DDP),
+ * so a show sequenced for the whole installation can be split into segments. Reversed and transposed segments (and
+ * 1D offset) are mapped to the pixels they light up. Segments with grouping, spacing or mirroring cannot show every
+ * pixel of a sequence individually and are rejected. Frames are read into a back buffer by
+ * handleFseqPrefetch() (called from the main loop after strip.service()) so the effect only has to copy a buffer.
+ * Frame selection is derived from strip.now (synchronized across nodes via timebase), sequences loop.
+ * Uncompressed files (with or without sparse ranges) are supported, compressed files need to be re-exported
+ * uncompressed in xLights (compressed blocks cannot be decoded in streaming fashion without a large window).
+ */
+
+#ifndef WLED_MAX_FSEQ_PLAYERS
+  #define WLED_MAX_FSEQ_PLAYERS 2
+#endif
+
+#define FSEQ_HEADER_SIZE   32
+#define FSEQ_MAX_RANGES    16  // max. number of sparse ranges supported
+#define FSEQ_RETRY         1000 // ms until opening a sequence that failed to open is retried
+
+typedef struct FseqSpan {
+  uint32_t src;   // offset within stored frame
+  uint32_t dst;   // offset within segment buffer
+  uint32_t len;   // number of channels
+} fseqSpan;
+
+class FseqPlayer {
+  public:
+    const Segment *seg = nullptr;
+    char      filename[34];
+    File      file;
+    uint32_t  dataOffset;   // file offset of first frame
+    uint32_t  frameSize;    // stored channels per frame
+    uint32_t  frameCount;
+    uint8_t   stepTime;     // ms per frame
+    fseqSpan *spans = nullptr;
+    unsigned  numSpans = 0;
+    uint8_t  *buf[2] = {nullptr, nullptr}; // front and back frame buffer (RGB per segment pixel)
+    size_t    bufLen = 0;
+    int32_t   bufFrame[2];  // frame held in buffer, -1 if none
+    uint8_t   front = 0;
+    uint16_t  width, height; // segment dimensions at open (physical, frame buffer is in strip order)
+    uint16_t  start, startY, offset;
+    uint16_t  options;      // reverse/transpose options at open
+    uint32_t  prefetchMisses = 0;
+    unsigned long lastUsed = 0; // millis() of last render call, players of vanished segments are closed after a while
+    unsigned long failedAt = 0; // millis() when file could not be opened/parsed, retried after FSEQ_RETRY
+    bool      failed = false; // file could not be opened/parsed or segment layout is not supported
+
+    bool open(const Segment &s);
+    bool matches(const Segment &s) const;
+    void close();
+    bool readFrame(uint32_t frame, uint8_t *dst);
+    inline uint32_t frameAt(unsigned long t) const { return (t / stepTime) % frameCount; }
+};
+
+static FseqPlayer fseqPlayers[WLED_MAX_FSEQ_PLAYERS];
+
+static inline uint32_t readLE(const uint8_t *p, unsigned n) {
+  uint32_t v = 0;
+  while (n--) v = (v << 8) | p[n];
+  return v;
+}
+
+static inline uint16_t mappingOptions(const Segment &s) {
+  return (s.reverse ? 1 : 0) | (s.reverse_y ? 2 : 0) | (s.transpose ? 4 : 0);
+}
+
+// segment is at the position and has the layout the player was opened for
+bool FseqPlayer::matches(const Segment &s) const {
+  return strncmp(filename + 1, s.name, 32) == 0 && width == s.width() && height == s.height() && start == s.start &&
+         startY == s.startY && offset == s.offset && options == mappingOptions(s) && s.groupLength() == 1 && !s.mirror && !s.mirror_y;
+}
+
+bool FseqPlayer::open(const Segment &s) {
+  width   = s.width();
+  height  = s.height();
+  start   = s.start;
+  startY  = s.startY;
+  offset  = s.offset;
+  options = mappingOptions(s);
+  filename[0] = '/';
+  strlcpy(filename + 1, s.name, sizeof(filename) - 1);
+  file = WLED_FS.open(filename, "r");
+  #ifdef FSEQ_SD
+  if (!file) file = FSEQ_SD.open(filename, "r");
+  #endif
+  if (!file) return false;
+
+  uint8_t hdr[FSEQ_HEADER_SIZE];
+  if (file.read(hdr, FSEQ_HEADER_SIZE) != FSEQ_HEADER_SIZE) return false;
+  if ((hdr[0] != 'P' && hdr[0] != 'F') || hdr[1] != 'S' || hdr[2] != 'E' || hdr[3] != 'Q') return false;
+  if (hdr[7] != 2) { DEBUG_PRINTF_P(PSTR("FSEQ: unsupported version %u\n"), hdr[7]); return false; }
+  if (hdr[20] & 0x0F) { DEBUG_PRINTLN(F("FSEQ: compressed files are not supported")); return false; }
+  dataOffset = readLE(hdr + 4, 2);
+  frameSize  = readLE(hdr + 10, 4);
+  frameCount = readLE(hdr + 14, 4);
+  stepTime   = hdr[18];
+  const unsigned numBlocks = hdr[21] | ((hdr[20] & 0xF0) << 4);
+  const unsigned numRanges = hdr[22];
+  if (!frameCount || !stepTime || numRanges > FSEQ_MAX_RANGES) return false;
+
+  // sparse ranges follow the (unused) compression block table, stored frame is concatenation of the ranges
+  uint32_t rangeStart[FSEQ_MAX_RANGES+1], rangeLen[FSEQ_MAX_RANGES+1];
+  unsigned ranges = 1;
+  rangeStart[0] = 0; rangeLen[0] = frameSize;
+  if (numRanges) {
+    file.seek(FSEQ_HEADER_SIZE + 8 * numBlocks);
+    for (unsigned r = 0; r < numRanges; r++) {
+      uint8_t rng[6];
+      if (file.read(rng, 6) != 6) return false;
+      rangeStart[r] = readLE(rng, 3);
+      rangeLen[r]   = readLE(rng + 3, 3);
+    }
+    ranges = numRanges;
+  }
+
+  // segment rows are contiguous channel ranges (logical strip index * 3), intersect them with the stored ranges
+  // (spans that continue each other, e.g. full matrix rows, are merged so that a frame is read in one go)
+  bufLen = width * height * 3;
+  spans  = static_cast<fseqSpan*>(malloc(sizeof(fseqSpan) * height * ranges));
+  buf[0] = static_cast<uint8_t*>(p_malloc(bufLen)); // prefer PSRAM, frame data is only copied once per frame
+  buf[1] = static_cast<uint8_t*>(p_malloc(bufLen));
+  if (!spans || !buf[0] || !buf[1]) return false;
+  numSpans = 0;
+  for (unsigned y = 0; y < height; y++) {
+    const uint32_t chStart = ((s.startY + y) * Segment::maxWidth + s.start) * 3;
+    const uint32_t chEnd   = chStart + width * 3;
+    uint32_t stored = 0; // offset of range within stored frame
+    for (unsigned r = 0; r < ranges; r++) {
+      const uint32_t lo = max(chStart, rangeStart[r]);
+      const uint32_t hi = min(chEnd, rangeStart[r] + rangeLen[r]);
+      if (lo < hi && stored + (hi - rangeStart[r]) <= frameSize) {
+        const fseqSpan sp = { stored + lo - rangeStart[r], y * width * 3 + lo - chStart, hi - lo };
+        fseqSpan *last = numSpans ? &spans[numSpans - 1] : nullptr;
+        if (last && last->src + last->len == sp.src && last->dst + last->len == sp.dst) last->len += sp.len;
+        else spans[numSpans++] = sp;
+      }
+      stored += rangeLen[r];
+    }
+  }
+  memset(buf[0], 0, bufLen);
+  memset(buf[1], 0, bufLen);
+  bufFrame[0] = bufFrame[1] = -1;
+  front = 0;
+  prefetchMisses = 0;
+  seg = &s;
+  DEBUG_PRINTF_P(PSTR("FSEQ: %s %u frames @%ums, %u channels, %u spans\n"), filename, frameCount, stepTime, frameSize, numSpans);
+  return true;
+}
+
+void FseqPlayer::close() {
+  if (file) file.close();
+  free(spans);
+  p_free(buf[0]);
+  p_free(buf[1]);
+  spans = nullptr;
+  buf[0] = buf[1] = nullptr;
+  numSpans = 0;
+  failed = false;
+  seg = nullptr;
+}
+
+// frame buffer offset of the physical pixel a segment pixel is shown on (see WS2812FX::blendSegment())
+static inline unsigned bufIndex(const FseqPlayer *p, unsigned i) {
+  if (strip.isMatrix) {
+    const unsigned vW = (p->options & 4) ? p->height : p->width, vH = (p->options & 4) ? p->width : p->height;
+    unsigned x = i % vW, y = i / vW;
+    if (p->options & 1) x = vW - x - 1;
+    if (p->options & 2) y = vH - y - 1;
+    if (p->options & 4) std::swap(x, y);
+    return (y * p->width + x) * 3;
+  }
+  const unsigned len = p->width * p->height;
+  unsigned j = (p->options & 1) ? len - i - 1 : i;
+  j += p->offset;
+  if (j >= len) j -= len;
+  return j * 3;
+}
+
+// reads the segment's channels of a frame (one seek + read per span, one span if the segment is contiguous)
+bool FseqPlayer::readFrame(uint32_t frame, uint8_t *dst) {
+  const uint32_t base = dataOffset + frame * frameSize;
+  for (unsigned i = 0; i < numSpans; i++) {
+    if (!file.seek(base + spans[i].src)) return false;
+    if (file.read(dst + spans[i].dst, spans[i].len) != spans[i].len) return false;
+  }
+  return true;
+}
+
+static FseqPlayer *findFseqPlayer(const Segment *seg) {
+  for (auto &p : fseqPlayers) if (p.seg == seg) return &p;
+  return nullptr;
+}
+
+bool isFseqFile(const char *name) {
+  if (!name) return false;
+  size_t len = strlen(name);
+  return len > 5 && strcasecmp(name + len - 5, ".fseq") == 0;
+}
+
+// renders the due frame of the sequence named by the segment name to the segment
+byte renderFseqToSegment(Segment &seg) {
+  if (!seg.name) return IMAGE_ERROR_NO_NAME;
+  FseqPlayer *p = findFseqPlayer(&seg);
+  if (p && (!p->matches(seg) || (p->failed && millis() - p->failedAt > FSEQ_RETRY))) {
+    p->close(); // name, position or layout changed, or time to retry a failed file
+    p = nullptr;
+  }
+  if (!p) {
+    p = findFseqPlayer(nullptr);
+    if (!p) return IMAGE_ERROR_SEG_LIMIT;
+    byte err = IMAGE_ERROR_NONE;
+    if (seg.groupLength() != 1 || seg.mirror || seg.mirror_y) err = IMAGE_ERROR_UNSUPPORTED_FORMAT;
+    else if (!p->open(seg)) err = p->file ? IMAGE_ERROR_UNSUPPORTED_FORMAT : IMAGE_ERROR_FILE_MISSING;
+    if (err != IMAGE_ERROR_NONE) {
+      p->close();
+      p->seg = &seg; // keep slot to remember the failure until it is retried
+      p->failed = true;
+      p->failedAt = millis();
+      p->lastUsed = millis();
+      return err;
+    }
+  }
+  p->lastUsed = millis();
+  if (p->failed) return IMAGE_ERROR_PREV;
+
+  const uint32_t frame = p->frameAt(strip.now);
+  if (p->bufFrame[p->front] == (int32_t)frame) return IMAGE_ERROR_WAITING; // already shown
+  uint8_t back = p->front ^ 1;
+  if (p->bufFrame[back] != (int32_t)frame) {
+    // not prefetched (first frame, seek or I/O too slow), read synchronously
+    if (p->bufFrame[p->front] >= 0) p->prefetchMisses++;
+    if (!p->readFrame(frame, p->buf[back])) return IMAGE_ERROR_FRAME_DECODE;
+    p->bufFrame[back] = frame;
+  }
+  p->front = back;
+
+  const uint8_t *buf = p->buf[p->front];
+  if (!seg.is2D()) {
+    for (unsigned i = 0; i < seg.vLength(); i++) {
+      const uint8_t *src = buf + bufIndex(p, i);
+      seg.setPixelColor(i, RGBW32(src[0], src[1], src[2], 0));
+    }
+  } else {
+    const unsigned cols = seg.vWidth(), rows = seg.vHeight();
+    for (unsigned y = 0; y < rows; y++) for (unsigned x = 0; x < cols; x++) {
+      const uint8_t *src = buf + bufIndex(p, y * cols + x);
+      seg.setPixelColorXY(x, y, RGBW32(src[0], src[1], src[2], 0));
+    }
+  }
+  return IMAGE_ERROR_NONE;
+}
+
+// reads the next frame of each active player into its back buffer, called after strip.service()
+void handleFseqPrefetch() {
+  for (auto &p : fseqPlayers) {
+    if (p.seg && millis() - p.lastUsed > 2000) p.close(); // segment was deleted or changed effect without reset
+    if (!p.seg || p.failed || p.bufFrame[p.front] < 0) continue;
+    const uint32_t next = (p.bufFrame[p.front] + 1) % p.frameCount;
+    const uint8_t back = p.front ^ 1;
+    if (p.bufFrame[back] == (int32_t)next) continue;
+    p.bufFrame[back] = p.readFrame(next, p.buf[back]) ? (int32_t)next : -1;
+  }
+}
+
+void endFseqPlayback(Segment *seg) {
+  FseqPlayer *p = findFseqPlayer(seg);
+  if (!p) return;
+  DEBUG_PRINTF_P(PSTR("FSEQ: playback ended, %u prefetch misses\n"), p->prefetchMisses);
+  p->close();
+}
+
+#endif
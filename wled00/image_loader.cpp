@@ -7,13 +7,67 @@
 
 /*
  * Functions to render images from filesystem to segments, used by the "Image" effect
+ *
+ * GIF frames are decoded into a canvas (RGB565, GIF resolution) and the canvas is blitted row by row to the segment
+ * using precomputed nearest-neighbour scale tables. Decoded frames are kept in a frame cache (in PSRAM if available)
+ * so looping GIFs are only decoded once. The decoder is shared: a segment needs it only until its GIF is fully cached,
+ * afterwards other segments can use it. If a GIF does not fit into the cache it is decoded on every loop (streaming);
+ * a streaming segment keeps its canvas and file position and hands the decoder over after each frame if another
+ * segment is waiting for it. If there is not even RAM for the canvas, pixels are drawn directly to the segment.
+ * Without PSRAM all GIFs share one cache budget and the canvas is limited, larger GIFs are drawn directly.
  */
 
+#ifndef WLED_MAX_GIF_PLAYERS
+  #define WLED_MAX_GIF_PLAYERS 4
+#endif
+#ifndef WLED_GIF_CACHE_PSRAM
+  #define WLED_GIF_CACHE_PSRAM  (512*1024) // max. frame cache size per GIF if PSRAM is available
+#endif
+#ifndef WLED_GIF_CACHE_DRAM
+  #define WLED_GIF_CACHE_DRAM   (16*1024)  // max. frame cache size of all GIFs together without PSRAM
+#endif
+#ifndef WLED_GIF_CANVAS_DRAM
+  #define WLED_GIF_CANVAS_DRAM  (32*1024)  // max. canvas size without PSRAM (e.g. 128x128), larger GIFs are drawn directly
+#endif
+#define GIF_MAX_FRAMES 256
+
 File file;
-char lastFilename[34] = "/";
 GifDecoder<320,320,12,true> decoder;
-bool gifDecodeFailed = false;
-unsigned long lastFrameDisplayTime = 0, currentFrameDelay = 0;
+
+class GifPlayer {
+  public:
+    Segment *seg = nullptr;
+    char     filename[34];
+    bool     failed = false;
+    bool     complete = false;       // all frames are cached, decoder not needed anymore
+    bool     streaming = false;      // GIF does not fit into the cache, decode every frame
+    uint16_t gifWidth = 0, gifHeight = 0;
+    uint16_t segWidth = 0, segHeight = 0;
+    uint16_t *srcX = nullptr;        // source column for each segment column
+    uint16_t *srcY = nullptr;        // source row for each segment row
+    uint16_t *canvas = nullptr;      // decoder output at GIF resolution (while decoding/streaming)
+    uint32_t *line = nullptr;        // converted pixels of current segment row
+    uint32_t resumePos = 0;          // file position of next frame if decoder was handed over while streaming
+    uint32_t firstFramePos = 0;      // file position after decoding first frame (detects looping)
+    uint16_t **frames = nullptr;     // cached frames (RGB565)
+    uint16_t *delays = nullptr;      // cached frame delays (ms)
+    uint16_t frameCount = 0;
+    uint16_t frame = 0;              // current frame when playing from cache
+    size_t   cacheBytes = 0;
+    unsigned long lastFrameDisplayTime = 0, currentFrameDelay = 0;
+    unsigned long lastUsed = 0;      // players of vanished segments are released after a while
+
+    void     reset();
+    void     freeCache();
+    bool     updateScaleTables();
+    void     blit(const uint16_t *src) const;
+};
+
+static GifPlayer gifPlayers[WLED_MAX_GIF_PLAYERS];
+static GifPlayer *decoderOwner = nullptr; // player currently using the decoder
+static bool decoderWanted = false;        // another player is waiting for the decoder
+static uint16_t *directX = nullptr;       // first segment column for each GIF column (direct drawing without canvas)
+static uint16_t *directY = nullptr;       // first segment row for each GIF row
 
 bool fileSeekCallback(unsigned long position) {
   return file.seek(position);
@@ -42,103 +96,282 @@ bool openGif(const char *filename) {
   return true;
 }
 
-Segment* activeSeg;
-uint16_t gifWidth, gifHeight;
+static inline uint16_t toRGB565(uint8_t r, uint8_t g, uint8_t b) {
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+static inline uint32_t fromRGB565(uint16_t c) {
+  uint8_t r = (c >> 8) & 0xF8, g = (c >> 3) & 0xFC, b = (c << 3) & 0xF8;
+  return RGBW32(gamma8(r | (r >> 5)), gamma8(g | (g >> 6)), gamma8(b | (b >> 5)), 0);
+}
 
 void screenClearCallback(void) {
-  activeSeg->fill(0);
+  if (!decoderOwner) return;
+  if (decoderOwner->canvas) memset(decoderOwner->canvas, 0, decoderOwner->gifWidth * decoderOwner->gifHeight * sizeof(uint16_t));
+  else decoderOwner->seg->fill(0);
 }
 
 void updateScreenCallback(void) {}
 
 void drawPixelCallback(int16_t x, int16_t y, uint8_t red, uint8_t green, uint8_t blue) {
-  // simple nearest-neighbor scaling 
-  int16_t outY = y * activeSeg->height() / gifHeight;
-  int16_t outX = x * activeSeg->width()  / gifWidth;
-  // set multiple pixels if upscaling
-  for (int16_t i = 0; i < (activeSeg->width()+(gifWidth-1)) / gifWidth; i++) {
-    for (int16_t j = 0; j < (activeSeg->height()+(gifHeight-1)) / gifHeight; j++) {
-      activeSeg->setPixelColorXY(outX + i, outY + j, gamma8(red), gamma8(green), gamma8(blue));
+  const GifPlayer *p = decoderOwner;
+  if (!p || x < 0 || y < 0 || x >= p->gifWidth || y >= p->gifHeight) return;
+  if (p->canvas) {
+    p->canvas[y * p->gifWidth + x] = toRGB565(red, green, blue);
+    return;
+  }
+  // no canvas: nearest-neighbor scaling directly to segment (sets multiple pixels if upscaling)
+  const uint32_t c = RGBW32(gamma8(red), gamma8(green), gamma8(blue), 0);
+  for (unsigned j = directY[y]; j < directY[y+1]; j++)
+    for (unsigned i = directX[x]; i < directX[x+1]; i++) p->seg->setPixelColorXY(i, j, c);
+}
+
+void GifPlayer::freeCache() {
+  if (frames) for (unsigned i = 0; i < frameCount; i++) p_free(frames[i]);
+  free(frames);
+  free(delays);
+  frames = nullptr;
+  delays = nullptr;
+  frameCount = 0;
+  cacheBytes = 0;
+  complete = false;
+}
+
+static void releaseDecoder() {
+  if (file) file.close();
+  decoder.dealloc();
+  free(directX);
+  free(directY);
+  directX = directY = nullptr;
+  decoderOwner = nullptr;
+}
+
+void GifPlayer::reset() {
+  if (decoderOwner == this) releaseDecoder();
+  freeCache();
+  p_free(canvas);
+  canvas = nullptr;
+  resumePos = 0;
+  free(srcX);
+  free(srcY);
+  free(line);
+  srcX = srcY = nullptr;
+  line = nullptr;
+  segWidth = segHeight = 0;
+  gifWidth = gifHeight = 0;
+  failed = streaming = false;
+  frame = 0;
+  lastFrameDisplayTime = currentFrameDelay = 0;
+  seg = nullptr;
+}
+
+// (re)builds segment->GIF mapping tables if segment or GIF dimensions changed
+bool GifPlayer::updateScaleTables() {
+  const unsigned w = seg->vWidth(), h = seg->vHeight();
+  if (srcX && w == segWidth && h == segHeight) return true;
+  free(srcX);
+  free(srcY);
+  free(line);
+  srcX = static_cast<uint16_t*>(malloc(w * sizeof(uint16_t)));
+  srcY = static_cast<uint16_t*>(malloc(h * sizeof(uint16_t)));
+  line = static_cast<uint32_t*>(malloc(w * sizeof(uint32_t)));
+  if (!srcX || !srcY || !line) return false;
+  for (unsigned x = 0; x < w; x++) srcX[x] = x * gifWidth  / w;
+  for (unsigned y = 0; y < h; y++) srcY[y] = y * gifHeight / h;
+  segWidth  = w;
+  segHeight = h;
+  return true;
+}
+
+// copies a frame (RGB565 at GIF resolution) to the segment, one segment row at a time
+void GifPlayer::blit(const uint16_t *src) const {
+  int lastRow = -1;
+  for (unsigned y = 0; y < segHeight; y++) {
+    if (srcY[y] != lastRow) { // upscaled rows are converted only once
+      lastRow = srcY[y];
+      const uint16_t *row = src + lastRow * gifWidth;
+      for (unsigned x = 0; x < segWidth; x++) line[x] = fromRGB565(row[srcX[x]]);
     }
+    if (seg->is2D()) for (unsigned x = 0; x < segWidth; x++) seg->setPixelColorXY(x, y, line[x]);
+    else             for (unsigned x = 0; x < segWidth; x++) seg->setPixelColor(x, line[x]);
+  }
+}
+
+static GifPlayer *findGifPlayer(const Segment *seg) {
+  for (auto &p : gifPlayers) if (p.seg == seg) return &p;
+  return nullptr;
+}
+
+// releases players whose segments were deleted or switched effect without reset (also frees the decoder)
+static void purgeStaleGifPlayers() {
+  for (auto &p : gifPlayers) if (p.seg && millis() - p.lastUsed > 2000) p.reset();
+}
+
+// opens the GIF of a player and prepares decoder, canvas and tables (continues at resumePos if the decoder was handed over)
+static byte acquireDecoder(GifPlayer *p) {
+  openGif(p->filename);
+  if (!file) return IMAGE_ERROR_FILE_MISSING;
+  decoderOwner = p;
+  decoderWanted = false;
+  decoder.setScreenClearCallback(screenClearCallback);
+  decoder.setUpdateScreenCallback(updateScreenCallback);
+  decoder.setDrawPixelCallback(drawPixelCallback);
+  decoder.setFileSeekCallback(fileSeekCallback);
+  decoder.setFilePositionCallback(filePositionCallback);
+  decoder.setFileReadCallback(fileReadCallback);
+  decoder.setFileReadBlockCallback(fileReadBlockCallback);
+  decoder.setFileSizeCallback(fileSizeCallback);
+  decoder.alloc();
+  DEBUG_PRINTLN(F("Starting decoding"));
+  if (decoder.startDecoding() < 0) return IMAGE_ERROR_GIF_DECODE;
+  DEBUG_PRINTLN(F("Decoding started"));
+  decoder.getSize(&p->gifWidth, &p->gifHeight);
+  if (!p->gifWidth || !p->gifHeight) return IMAGE_ERROR_GIF_DECODE;
+  if (p->resumePos) {
+    if (!file.seek(p->resumePos)) return IMAGE_ERROR_GIF_DECODE;
+    p->resumePos = 0;
+  }
+  const size_t canvasBytes = p->gifWidth * p->gifHeight * sizeof(uint16_t);
+  if (!p->canvas && (canvasBytes <= WLED_GIF_CANVAS_DRAM || (psramSafe && psramFound())))
+    p->canvas = static_cast<uint16_t*>(p_calloc(p->gifWidth * p->gifHeight, sizeof(uint16_t)));
+  if (!p->canvas) {
+    // draw directly to segment, cannot cache
+    p->streaming = true;
+    const unsigned w = p->seg->vWidth(), h = p->seg->vHeight();
+    directX = static_cast<uint16_t*>(malloc((p->gifWidth  + 1) * sizeof(uint16_t)));
+    directY = static_cast<uint16_t*>(malloc((p->gifHeight + 1) * sizeof(uint16_t)));
+    if (!directX || !directY) return IMAGE_ERROR_DECODER_ALLOC;
+    for (unsigned x = 0; x <= p->gifWidth;  x++) directX[x] = (x * w + p->gifWidth  - 1) / p->gifWidth;
+    for (unsigned y = 0; y <= p->gifHeight; y++) directY[y] = (y * h + p->gifHeight - 1) / p->gifHeight;
   }
+  p->firstFramePos = 0;
+  return IMAGE_ERROR_NONE;
 }
 
-#define IMAGE_ERROR_NONE 0
-#define IMAGE_ERROR_NO_NAME 1
-#define IMAGE_ERROR_SEG_LIMIT 2
-#define IMAGE_ERROR_UNSUPPORTED_FORMAT 3
-#define IMAGE_ERROR_FILE_MISSING 4
-#define IMAGE_ERROR_DECODER_ALLOC 5
-#define IMAGE_ERROR_GIF_DECODE 6
-#define IMAGE_ERROR_FRAME_DECODE 7
-#define IMAGE_ERROR_WAITING 254
-#define IMAGE_ERROR_PREV 255
+// decodes next frame into canvas and adds it to the cache, returns frame to display (nullptr if drawn directly)
+static const uint16_t *decodeNextFrame(GifPlayer *p, byte &err) {
+  err = IMAGE_ERROR_NONE;
+  if (decoder.decodeFrame(false) < 0) { err = IMAGE_ERROR_FRAME_DECODE; return nullptr; }
+  const uint16_t delay = decoder.getFrameDelay_ms();
+  p->currentFrameDelay = delay;
+  if (!p->canvas) return nullptr;
+  if (p->streaming) return p->canvas;
+
+  const uint32_t pos = file.position();
+  if (p->frameCount == 0) p->firstFramePos = pos;
+  else if (pos == p->firstFramePos) {
+    // decoder wrapped around to first frame: all frames are cached, decoder is no longer needed
+    p->complete = true;
+    p->frame = 0;
+    p->currentFrameDelay = p->delays[0];
+    releaseDecoder();
+    p_free(p->canvas);
+    p->canvas = nullptr;
+    DEBUG_PRINTF_P(PSTR("GIF cached: %u frames, %u bytes\n"), p->frameCount, p->cacheBytes);
+    return p->frames[0];
+  }
 
-// renders an image (.gif only; .bmp and .fseq to be added soon) from FS to a segment
+  const size_t frameBytes = p->gifWidth * p->gifHeight * sizeof(uint16_t);
+  size_t cached = p->cacheBytes, budget = WLED_GIF_CACHE_PSRAM;
+  if (!(psramSafe && psramFound())) {
+    cached = 0; // DRAM budget is shared by all GIFs
+    for (const auto &g : gifPlayers) cached += g.cacheBytes;
+    budget = WLED_GIF_CACHE_DRAM;
+  }
+  uint16_t *copy = nullptr;
+  if (p->frameCount < GIF_MAX_FRAMES && cached + frameBytes <= budget) {
+    if (!p->frames) {
+      p->frames = static_cast<uint16_t**>(calloc(GIF_MAX_FRAMES, sizeof(uint16_t*)));
+      p->delays = static_cast<uint16_t*>(calloc(GIF_MAX_FRAMES, sizeof(uint16_t)));
+    }
+    if (p->frames && p->delays) copy = static_cast<uint16_t*>(p_malloc(frameBytes));
+  }
+  if (!copy) {
+    // does not fit: give up caching and decode every frame
+    p->freeCache();
+    p->streaming = true;
+    DEBUG_PRINTLN(F("GIF too large for cache, streaming."));
+  } else {
+    memcpy(copy, p->canvas, frameBytes);
+    p->frames[p->frameCount] = copy;
+    p->delays[p->frameCount] = delay;
+    p->frameCount++;
+    p->cacheBytes += frameBytes;
+  }
+  return p->canvas;
+}
+
+// renders an image (.gif only; .fseq is handled by fseq_player.cpp) from FS to a segment
 byte renderImageToSegment(Segment &seg) {
   if (!seg.name) return IMAGE_ERROR_NO_NAME;
   // disable during effect transition, causes flickering, multiple allocations and depending on image, part of old FX remaining
   //if (seg.mode != seg.currentMode()) return IMAGE_ERROR_WAITING;
-  if (activeSeg && activeSeg != &seg) return IMAGE_ERROR_SEG_LIMIT; // only one segment at a time
-  activeSeg = &seg;
-
-  if (strncmp(lastFilename +1, seg.name, 32) != 0) { // segment name changed, load new image
-    strncpy(lastFilename +1, seg.name, 32);
-    gifDecodeFailed = false;
-    if (strcmp(lastFilename + strlen(lastFilename) - 4, ".gif") != 0) {
-      gifDecodeFailed = true;
+
+  purgeStaleGifPlayers();
+  GifPlayer *p = findGifPlayer(&seg);
+  if (p && strncmp(p->filename + 1, seg.name, 32) != 0) p->reset(); // segment name changed, load new image
+  if (!p || !p->seg) {
+    p = findGifPlayer(nullptr);
+    if (!p) return IMAGE_ERROR_SEG_LIMIT;
+    p->seg = &seg;
+    p->lastUsed = millis();
+    p->filename[0] = '/';
+    strlcpy(p->filename + 1, seg.name, sizeof(p->filename) - 1);
+    if (strcmp(p->filename + strlen(p->filename) - 4, ".gif") != 0) {
+      p->failed = true;
       return IMAGE_ERROR_UNSUPPORTED_FORMAT;
     }
-    if (file) file.close();
-    openGif(lastFilename);
-    if (!file) { gifDecodeFailed = true; return IMAGE_ERROR_FILE_MISSING; }
-    decoder.setScreenClearCallback(screenClearCallback);
-    decoder.setUpdateScreenCallback(updateScreenCallback);
-    decoder.setDrawPixelCallback(drawPixelCallback);
-    decoder.setFileSeekCallback(fileSeekCallback);
-    decoder.setFilePositionCallback(filePositionCallback);
-    decoder.setFileReadCallback(fileReadCallback);
-    decoder.setFileReadBlockCallback(fileReadBlockCallback);
-    decoder.setFileSizeCallback(fileSizeCallback);
-    decoder.alloc();
-    DEBUG_PRINTLN(F("Starting decoding"));
-    if(decoder.startDecoding() < 0) { gifDecodeFailed = true; return IMAGE_ERROR_GIF_DECODE; }
-    DEBUG_PRINTLN(F("Decoding started"));
   }
-
-  if (gifDecodeFailed) return IMAGE_ERROR_PREV;
-  if (!file) { gifDecodeFailed = true; return IMAGE_ERROR_FILE_MISSING; }
-  //if (!decoder) { gifDecodeFailed = true; return IMAGE_ERROR_DECODER_ALLOC; }
+  p->lastUsed = millis();
+  if (p->failed) return IMAGE_ERROR_PREV;
 
   // speed 0 = half speed, 128 = normal, 255 = full FX FPS
   // TODO: 0 = 4x slow, 64 = 2x slow, 128 = normal, 192 = 2x fast, 255 = 4x fast
-  uint32_t wait = currentFrameDelay * 2 - seg.speed * currentFrameDelay / 128;
+  uint32_t wait = p->currentFrameDelay * 2 - seg.speed * p->currentFrameDelay / 128;
 
   // TODO consider handling this on FX level with a different frametime, but that would cause slow gifs to speed up during transitions
-  if (millis() - lastFrameDisplayTime < wait) return IMAGE_ERROR_WAITING;
+  if (millis() - p->lastFrameDisplayTime < wait) return IMAGE_ERROR_WAITING;
 
-  decoder.getSize(&gifWidth, &gifHeight);
+  const uint16_t *src;
+  if (p->complete) {
+    p->frame = (p->frame + 1) % p->frameCount;
+    p->currentFrameDelay = p->delays[p->frame];
+    src = p->frames[p->frame];
+  } else {
+    if (decoderOwner != p) {
+      if (decoderOwner) { decoderWanted = true; return IMAGE_ERROR_WAITING; } // another segment is decoding, wait for hand-over
+      byte err = acquireDecoder(p);
+      if (err != IMAGE_ERROR_NONE) { releaseDecoder(); p->failed = true; return err; }
+    }
+    byte err;
+    src = decodeNextFrame(p, err);
+    if (err != IMAGE_ERROR_NONE) { releaseDecoder(); p->failed = true; return err; }
+    if (p->streaming && decoderWanted && decoderOwner == p) {
+      // streaming never completes: hand the decoder to the waiting segment, continue from here when it is free again
+      p->resumePos = file.position();
+      releaseDecoder();
+      decoderWanted = false;
+    }
+  }
 
-  int result = decoder.decodeFrame(false);
-  if (result < 0) { gifDecodeFailed = true; return IMAGE_ERROR_FRAME_DECODE; }
+  if (src) {
+    if (!p->updateScaleTables()) { p->failed = true; return IMAGE_ERROR_DECODER_ALLOC; }
+    p->blit(src);
+  }
 
-  currentFrameDelay = decoder.getFrameDelay_ms();
-  unsigned long tooSlowBy = (millis() - lastFrameDisplayTime) - wait; // if last frame was longer than intended, compensate
-  currentFrameDelay = tooSlowBy > currentFrameDelay ? 0 : currentFrameDelay - tooSlowBy;
-  lastFrameDisplayTime = millis();
+  unsigned long tooSlowBy = (millis() - p->lastFrameDisplayTime) - wait; // if last frame was longer than intended, compensate
+  p->currentFrameDelay = tooSlowBy > p->currentFrameDelay ? 0 : p->currentFrameDelay - tooSlowBy;
+  p->lastFrameDisplayTime = millis();
 
   return IMAGE_ERROR_NONE;
 }
 
 void endImagePlayback(Segment *seg) {
   DEBUG_PRINTLN(F("Image playback end called"));
-  if (!activeSeg || activeSeg != seg) return;
-  if (file) file.close();
-  decoder.dealloc();
-  gifDecodeFailed = false;
-  activeSeg = nullptr;
-  lastFilename[1] = '\0';
+  GifPlayer *p = findGifPlayer(seg);
+  if (!p) return;
+  p->reset();
   DEBUG_PRINTLN(F("Image playback ended"));
 }
 
-#endif
\ No newline at end of file
+#endif
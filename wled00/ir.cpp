@@ -550,84 +550,220 @@ Sample:
   "0xFF22DD": {"cmd": "!presetFallback", "PL": 1, "FX": 16, "FP": 6,  // Custom command
                "label": "Preset 1, fallback to Saw - Party if not found"},
 }
+
+ir.json is compiled into an in-RAM table (open addressing, keyed by IR code) when IR is initialised and whenever
+ir.json is uploaded. Changes made with the /edit page are picked up by checking size and modification time of ir.json
+on a new key press (at most every 5s), so repeated keys never touch the file system.
+HTTP and JSON commands are kept as text in a string pool, custom commands are stored pre-decoded.
 */
+
+#define IR_CMD_NONE      0 // unknown custom command
+#define IR_CMD_INC_BRI   1
+#define IR_CMD_DEC_BRI   2
+#define IR_CMD_PRESET_FB 3 // presetFallback(), FX 255 means random effect
+#define IR_CMD_API       4 // HTTP API command in pool (with "win&" prefix)
+#define IR_CMD_JSON      5 // JSON API command in pool
+#define IR_CMD_PSAVE     6
+
+#define IR_FILE_CHECK    5000 // min. time between checks for a changed ir.json (ms)
+
+typedef struct IRCommand {
+  uint32_t code;       // 0 marks a free slot
+  uint16_t str;        // offset of command text in pool
+  uint8_t  action;     // IR_CMD_*
+  bool     repeatable;
+  uint8_t  param[3];
+} irCommand;
+
+static irCommand *irTable = nullptr;
+static size_t     irTableBits = 0;
+static char      *irPool = nullptr;
+static size_t     irPoolLen = 0;
+static size_t     irCommands = 0;
+static bool       irTableDirty = true;
+static bool       irFileMissing = false;
+static uint32_t   irFileStamp = 0;
+static unsigned long irFileChecked = 0;
+
+static inline uint32_t irStamp(File &f) { return f.size() ^ (uint32_t(f.getLastWrite()) * 2654435761U); }
+
+static inline size_t irTableHome(uint32_t code) { return uint32_t(code * 2654435761U) >> (32 - irTableBits); } // Fibonacci hashing
+
+static const irCommand *findIRCommand(uint32_t code) {
+  if (!irTable || !code) return nullptr;
+  const size_t mask = (1U << irTableBits) - 1;
+  for (size_t i = irTableHome(code); irTable[i].code; i = (i + 1) & mask) if (irTable[i].code == code) return &irTable[i];
+  return nullptr;
+}
+
+// translates one ir.json entry, pool text is only written if irPool is allocated (2nd pass), returns pool bytes used
+static size_t compileIRCommand(uint32_t code, JsonObject fdo) {
+  irCommand c = {code, (uint16_t)irPoolLen, IR_CMD_NONE, false, {0, 0, 0}};
+  size_t len = 0;
+  JsonVariant cmd = fdo["cmd"];
+  if (cmd.is<JsonObject>()) {
+    if (cmd[F("psave")].isNull()) {
+      c.action = IR_CMD_JSON;
+      len = measureJson(cmd) + 1;
+      if (irPool) serializeJson(cmd, irPool + irPoolLen, len);
+    } else {
+      c.action = IR_CMD_PSAVE;
+      c.param[0] = cmd[F("psave")].as<int>();
+    }
+  } else {
+    const char *cmdStr = cmd | "";
+    if (cmdStr[0] == '!') {
+      // limited set of C functions
+      if (!strncmp_P(cmdStr, PSTR("!incBri"), 7))      { c.action = IR_CMD_INC_BRI; c.repeatable = true; }
+      else if (!strncmp_P(cmdStr, PSTR("!decBri"), 7)) { c.action = IR_CMD_DEC_BRI; c.repeatable = true; }
+      else if (!strncmp_P(cmdStr, PSTR("!presetF"), 8)) { //!presetFallback
+        c.action = IR_CMD_PRESET_FB;
+        c.param[0] = fdo["PL"] | 1;
+        c.param[1] = fdo["FX"] | 255;
+        c.param[2] = fdo["FP"] | 0;
+      }
+    } else {
+      // HTTP API command
+      c.action = IR_CMD_API;
+      c.repeatable = (cmdStr[0] && strchr(cmdStr + 1, '~')) || fdo["rpt"]; // repeatable action
+      const bool prefix = strncmp_P(cmdStr, PSTR("win&"), 4);             // if no "win&" prefix
+      len = strlen(cmdStr) + (prefix ? 4 : 0) + 1;
+      if (irPool) {
+        if (prefix) strcpy_P(irPool + irPoolLen, PSTR("win&"));
+        strcpy(irPool + irPoolLen + (prefix ? 4 : 0), cmdStr);
+      }
+    }
+  }
+  if (irTable && irPool) {
+    const size_t mask = (1U << irTableBits) - 1;
+    size_t i = irTableHome(code);
+    while (irTable[i].code && irTable[i].code != code) i = (i + 1) & mask; // duplicate keys: last one wins
+    irTable[i] = c;
+  }
+  return len;
+}
+
+// walks all top level "0x..." entries of ir.json (values are parsed one at a time into the JSON buffer)
+// 1st pass (no table allocated) counts commands and pool size, 2nd pass fills the table
+static bool parseIRFile() {
+  File f = WLED_FS.open(F("/ir.json"), "r");
+  if (!f) return false;
+  irFileStamp = irStamp(f);
+  irCommands = 0;
+  irPoolLen = 0;
+  if (f.find("{")) while (true) {
+    int c;
+    do c = f.read(); while (c == ',' || isspace(c));
+    if (c != '"') break; // end of object (or malformed file)
+    char key[12];
+    size_t n = 0;
+    while ((c = f.read()) >= 0 && c != '"') if (n < sizeof(key)-1) key[n++] = c;
+    key[n] = '\0';
+    if (c < 0 || !f.find(":")) break;
+    if (deserializeJson(*pDoc, f)) break;
+    uint32_t code = (key[0] == '0' && (key[1] == 'x' || key[1] == 'X')) ? strtoul(key + 2, nullptr, 16) : 0;
+    if (!code || !pDoc->is<JsonObject>()) continue; // other keys are ignored
+    irPoolLen += compileIRCommand(code, pDoc->as<JsonObject>());
+    irCommands++;
+  }
+  f.close();
+  return true;
+}
+
+static void freeIRTable() {
+  p_free(irTable);
+  p_free(irPool);
+  irTable = nullptr;
+  irPool = nullptr;
+  irCommands = 0;
+}
+
+// (re)builds command table from ir.json
+static void compileIRTable() {
+  if (!requestJSONBufferLock(13)) return; // try again on next key press
+  freeIRTable();
+  irTableDirty = false;
+  irFileChecked = millis();
+  irFileMissing = !parseIRFile();
+  if (!irFileMissing && irCommands && irPoolLen <= UINT16_MAX) {
+    const size_t poolLen = irPoolLen;
+    irTableBits = 3;
+    while ((1U << irTableBits) < irCommands + irCommands/3) irTableBits++; // load factor <= 75%
+    irTable = static_cast<irCommand*>(p_calloc(1U << irTableBits, sizeof(irCommand)));
+    irPool  = static_cast<char*>(p_malloc(poolLen ? poolLen : 1));
+    if (!irTable || !irPool || !parseIRFile() || irPoolLen != poolLen) {
+      DEBUG_PRINTLN(F("IR: Failed to compile ir.json."));
+      freeIRTable();
+    }
+  }
+  releaseJSONBufferLock();
+  DEBUG_PRINTF_P(PSTR("IR: %u commands, %u bytes.\n"), (unsigned)irCommands, (unsigned)irPoolLen);
+}
+
+// ir.json changed, table is rebuilt on next key press
+void reloadIRTable() {
+  irTableDirty = true;
+}
+
+// ir.json was modified (or created) since it was compiled
+static bool irFileChanged() {
+  if (millis() - irFileChecked < IR_FILE_CHECK) return false;
+  irFileChecked = millis();
+  File f = WLED_FS.open(F("/ir.json"), "r");
+  if (!f) return !irFileMissing;
+  const bool changed = irFileMissing || irStamp(f) != irFileStamp;
+  f.close();
+  return changed;
+}
+
 static void decodeIRJson(uint32_t code)
 {
-  char objKey[10];
-  char fileName[16];
-  String cmdStr;
-  JsonObject fdo;
-  JsonObject jsonCmdObj;
-
-  if (!requestJSONBufferLock(13)) return;
-
-  sprintf_P(objKey, PSTR("\"0x%lX\":"), (unsigned long)code);
-  strcpy_P(fileName, PSTR("/ir.json")); // for FS.exists()
-
-  // attempt to read command from ir.json
-  // this may fail for two reasons: ir.json does not exist or IR code not found
-  // if the IR code is not found readObjectFromFile() will clean() doc JSON document
-  // so we can differentiate between the two
-  readObjectFromFile(fileName, objKey, pDoc);
-  fdo = pDoc->as<JsonObject>();
+  if (irTableDirty || (!irTimesRepeated && irFileChanged())) compileIRTable();
   lastValidCode = 0;
-  if (fdo.isNull()) {
+  const irCommand *cmd = findIRCommand(code);
+  if (!cmd) {
     //the received code does not exist
-    if (!WLED_FS.exists(fileName)) errorFlag = ERR_FS_IRLOAD; //warn if IR file itself doesn't exist
-    releaseJSONBufferLock();
+    if (irFileMissing) errorFlag = ERR_FS_IRLOAD; //warn if IR file itself doesn't exist
     return;
   }
+  if (cmd->repeatable) lastValidCode = code;
 
-  cmdStr = fdo["cmd"].as<String>();
-  jsonCmdObj = fdo["cmd"]; //object
-
-  if (jsonCmdObj.isNull())  // we could also use: fdo["cmd"].is<String>()
-  {
-    if (cmdStr.startsWith("!")) {
-      // call limited set of C functions
-      if (cmdStr.startsWith(F("!incBri"))) {
-        lastValidCode = code;
-        incBrightness();
-      } else if (cmdStr.startsWith(F("!decBri"))) {
-        lastValidCode = code;
-        decBrightness();
-      } else if (cmdStr.startsWith(F("!presetF"))) { //!presetFallback
-        uint8_t p1 = fdo["PL"] | 1;
-        uint8_t p2 = fdo["FX"] | hw_random8(strip.getModeCount() -1);
-        uint8_t p3 = fdo["FP"] | 0;
-        presetFallback(p1, p2, p3);
-      }
-    } else {
-      // HTTP API command
-      String apireq = "win"; apireq += '&';                        // reduce flash string usage
-      if (cmdStr.indexOf("~") > 0 || fdo["rpt"]) lastValidCode = code; // repeatable action
-      if (!cmdStr.startsWith(apireq)) cmdStr = apireq + cmdStr;    // if no "win&" prefix
+  switch (cmd->action) {
+    case IR_CMD_INC_BRI: incBrightness(); break;
+    case IR_CMD_DEC_BRI: decBrightness(); break;
+    case IR_CMD_PRESET_FB:
+      presetFallback(cmd->param[0], cmd->param[1] < 255 ? cmd->param[1] : hw_random8(strip.getModeCount() -1), cmd->param[2]);
+      break;
+    case IR_CMD_API: {
+      String cmdStr = irPool + cmd->str;
       if (!irApplyToAllSelected && cmdStr.indexOf(F("SS="))<0) {
         char tmp[10];
         sprintf_P(tmp, PSTR("&SS=%d"), strip.getMainSegmentId());
         cmdStr += tmp;
       }
-      fdo.clear();                                                 // clear JSON buffer (it is no longer needed)
       handleSet(nullptr, cmdStr, false);                           // no stateUpdated() call here
+      break;
     }
-  } else {
-    // command is JSON object
-    if (jsonCmdObj[F("psave")].isNull()) {
-      if (irApplyToAllSelected && jsonCmdObj["seg"].is<JsonArray>()) {
-        JsonObject seg = jsonCmdObj["seg"][0];                    // take 1st segment from array and use it to apply to all selected segments
-        seg.remove("id");                                         // remove segment ID if it exists
-        jsonCmdObj["seg"] = seg;                                  // replace array with object
+    case IR_CMD_JSON:
+    case IR_CMD_PSAVE:
+      if (!requestJSONBufferLock(13)) return;
+      if (cmd->action == IR_CMD_PSAVE) {
+        char pname[33];
+        sprintf_P(pname, PSTR("IR Preset %d"), cmd->param[0]);
+        JsonObject empty = pDoc->to<JsonObject>();
+        if (cmd->param[0] > 0 && cmd->param[0] < 251) savePreset(cmd->param[0], pname, empty);
+      } else if (!deserializeJson(*pDoc, (const char*)(irPool + cmd->str))) { // const: no zero-copy, pool must stay intact
+        JsonObject jsonCmdObj = pDoc->as<JsonObject>();
+        if (irApplyToAllSelected && jsonCmdObj["seg"].is<JsonArray>()) {
+          JsonObject seg = jsonCmdObj["seg"][0];                    // take 1st segment from array and use it to apply to all selected segments
+          seg.remove("id");                                         // remove segment ID if it exists
+          jsonCmdObj["seg"] = seg;                                  // replace array with object
+        }
+        deserializeState(jsonCmdObj, CALL_MODE_BUTTON_PRESET);      // **will call stateUpdated() with correct CALL_MODE**
       }
-      deserializeState(jsonCmdObj, CALL_MODE_BUTTON_PRESET);      // **will call stateUpdated() with correct CALL_MODE**
-    } else {
-      uint8_t psave = jsonCmdObj[F("psave")].as<int>();
-      char pname[33];
-      sprintf_P(pname, PSTR("IR Preset %d"), psave);
-      fdo.clear();
-      if (psave > 0 && psave < 251) savePreset(psave, pname, fdo);
-    }
+      releaseJSONBufferLock();
+      break;
   }
-  releaseJSONBufferLock();
 }
 
 static void applyRepeatActions()
@@ -698,6 +834,7 @@ static void decodeIR(uint32_t code)
 
 void initIR()
 {
+  irTableDirty = true;
   if (irEnabled > 0) {
     irrecv = new IRrecv(irPin);
     if (irrecv) irrecv->enableIRIn();
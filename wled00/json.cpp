@@ -66,7 +66,7 @@ namespace {
   }
 }
 
-static bool deserializeSegment(JsonObject elem, byte it, byte presetId = 0)
+bool deserializeSegment(JsonObject elem, byte it, byte presetId)
 {
   byte id = elem["id"] | it;
   if (id >= WS2812FX::getMaxSegments()) return false;
@@ -362,10 +362,9 @@ static bool deserializeSegment(JsonObject elem, byte it, byte presetId = 0)
 
 // deserializes WLED state
 // presetId is non-0 if called from handlePreset()
-bool deserializeState(JsonObject root, byte callMode, byte presetId)
+// members that are applied before segments
+void deserializeStateHead(JsonObject root, byte &callMode, byte presetId)
 {
-  bool stateResponse = root[F("v")] | false;
-
   #if defined(WLED_DEBUG) && defined(WLED_DEBUG_HOST)
   netDebugEnabled = root[F("debug")] | netDebugEnabled;
   #endif
@@ -452,37 +451,35 @@ bool deserializeState(JsonObject root, byte callMode, byte presetId)
       exitRealtime();
     }
   }
+}
 
-  int it = 0;
-  JsonVariant segVar = root["seg"];
-  if (!segVar.isNull()) {
-    // we may be called during strip.service() so we must not modify segments while effects are executing
-    strip.suspend();
-    strip.waitForIt();
-    if (segVar.is<JsonObject>()) {
-      int id = segVar["id"] | -1;
-      //if "seg" is not an array and ID not specified, apply to all selected/checked segments
-      if (id < 0) {
-        //apply all selected segments
-        for (size_t s = 0; s < strip.getSegmentsNum(); s++) {
-          const Segment &sg = strip.getSegment(s);
-          if (sg.isActive() && sg.isSelected()) {
-            deserializeSegment(segVar, s, presetId);
-          }
-        }
-      } else {
-        deserializeSegment(segVar, id, presetId); //apply only the segment with the specified ID
-      }
-    } else {
-      size_t deleted = 0;
-      JsonArray segs = segVar.as<JsonArray>();
-      for (JsonObject elem : segs) {
-        if (deserializeSegment(elem, it++, presetId) && !elem["stop"].isNull() && elem["stop"]==0) deleted++;
+// "seg" object without "id" applies to all selected segments
+void deserializeSegmentObject(JsonObject segObj, byte presetId)
+{
+  int id = segObj["id"] | -1;
+  if (id < 0) {
+    //apply all selected segments
+    for (size_t s = 0; s < strip.getSegmentsNum(); s++) {
+      const Segment &sg = strip.getSegment(s);
+      if (sg.isActive() && sg.isSelected()) {
+        deserializeSegment(segObj, s, presetId);
       }
-      if (strip.getSegmentsNum() > 3 && deleted >= strip.getSegmentsNum()/2U) strip.purgeSegments(); // batch deleting more than half segments
     }
-    strip.resume();
+  } else {
+    deserializeSegment(segObj, id, presetId); //apply only the segment with the specified ID
   }
+}
+
+// batch deleting more than half segments
+void purgeDeletedSegments(size_t deleted)
+{
+  if (strip.getSegmentsNum() > 3 && deleted >= strip.getSegmentsNum()/2U) strip.purgeSegments();
+}
+
+// members that are applied after segments, returns true if full state response was requested
+bool deserializeStateTail(JsonObject root, byte callMode, byte presetId)
+{
+  bool stateResponse = root[F("v")] | false;
 
   UsermodManager::readFromJsonState(root);
 
@@ -560,6 +557,32 @@ bool deserializeState(JsonObject root, byte callMode, byte presetId)
   return stateResponse;
 }
 
+bool deserializeState(JsonObject root, byte callMode, byte presetId)
+{
+  deserializeStateHead(root, callMode, presetId);
+
+  JsonVariant segVar = root["seg"];
+  if (!segVar.isNull()) {
+    // we may be called during strip.service() so we must not modify segments while effects are executing
+    strip.suspend();
+    strip.waitForIt();
+    if (segVar.is<JsonObject>()) {
+      deserializeSegmentObject(segVar, presetId);
+    } else {
+      int it = 0;
+      size_t deleted = 0;
+      JsonArray segs = segVar.as<JsonArray>();
+      for (JsonObject elem : segs) {
+        if (deserializeSegment(elem, it++, presetId) && !elem["stop"].isNull() && elem["stop"]==0) deleted++;
+      }
+      purgeDeletedSegments(deleted);
+    }
+    strip.resume();
+  }
+
+  return deserializeStateTail(root, callMode, presetId);
+}
+
 static void serializeSegment(JsonObject& root, const Segment& seg, byte id, bool forPreset, bool segmentBounds)
 {
   root["id"] = id;
@@ -706,6 +729,26 @@ void serializeInfo(JsonObject root)
   //leds[F("seglock")] = false; //might be used in the future to prevent modifications to segment config
   leds[F("bootps")] = bootPreset;
 
+  // per bus conversion (p) and output (t) time in us, averaged over a few frames
+  JsonArray busTimes = leds.createNestedArray(F("bus"));
+  for (size_t b = 0; b < BusManager::getNumBusses(); b++) {
+    const Bus *bus = BusManager::getBus(b);
+    JsonObject bt = busTimes.createNestedObject();
+    bt["n"] = bus->getLength();
+    bt["p"] = bus->getPrepareTime();
+    bt["t"] = bus->getTransmitTime();
+  }
+
+  // frame pacing: effective frame time (ms), limiting factor (0 target FPS, 1 effects, 2 LED output),
+  // averaged frame CPU time (us) and the most expensive segment with its effect time (us)
+  JsonObject pace = leds.createNestedObject(F("pace"));
+  pace[F("on")]  = strip.isAdaptiveFps();
+  pace[F("ft")]  = strip.getShowTime();
+  pace[F("lim")] = strip.getPaceLimit();
+  pace[F("cpu")] = strip.getRenderTime();
+  pace[F("seg")] = strip.getSlowestSegment();
+  pace[F("sus")] = strip.getSlowestSegmentTime();
+
   #ifndef WLED_DISABLE_2D
   if (strip.isMatrix) {
     JsonObject matrix = leds.createNestedObject(F("matrix"));
@@ -758,6 +801,7 @@ void serializeInfo(JsonObject root)
     case REALTIME_MODE_ARTNET:   root["lm"] = F("Art-Net"); break;
     case REALTIME_MODE_TPM2NET:  root["lm"] = F("tpm2.net"); break;
     case REALTIME_MODE_DDP:      root["lm"] = F("DDP"); break;
+    case REALTIME_MODE_ESPNOW:   root["lm"] = F("ESP-NOW"); break;
   }
 
   root[F("lip")] = realtimeIP[0] == 0 ? "" : realtimeIP.toString();
@@ -795,8 +839,16 @@ void serializeInfo(JsonObject root)
   fs_info["u"] = fsBytesUsed / 1000;
   fs_info["t"] = fsBytesTotal / 1000;
   fs_info[F("pmt")] = presetsModifiedTime;
+  serializeFsCache(fs_info);
 
   root[F("ndc")] = nodeListEnabled ? (int)Nodes.size() : -1;
+  serializeTimeSync(root);
+  #ifndef WLED_DISABLE_MQTT
+  serializeMqttInfo(root);
+  #endif
+  #ifndef WLED_DISABLE_ESPNOW
+  serializeEspNowStream(root);
+  #endif
 
 #ifdef ARDUINO_ARCH_ESP32
   #ifdef WLED_DEBUG
@@ -1018,21 +1070,24 @@ void serializeNetworks(JsonObject root)
   }
 }
 
-void serializeNodes(JsonObject root)
+// page < 0 returns all nodes, otherwise WLED_NODES_PER_PAGE nodes of requested page and number of last page ("m")
+void serializeNodes(JsonObject root, int page)
 {
   JsonArray nodes = root.createNestedArray("nodes");
+  if (page >= 0) root[F("m")] = Nodes.size() ? (Nodes.size() - 1) / WLED_NODES_PER_PAGE : 0;
 
-  for (NodesMap::iterator it = Nodes.begin(); it != Nodes.end(); ++it)
+  size_t n = 0;
+  for (size_t i = 0; i < NodesTable::capacity(); i++)
   {
-    if (it->second.ip[0] != 0)
-    {
-      JsonObject node = nodes.createNestedObject();
-      node[F("name")] = it->second.nodeName;
-      node["type"]    = it->second.nodeType;
-      node["ip"]      = it->second.ip.toString();
-      node[F("age")]  = it->second.age;
-      node[F("vid")]  = it->second.build;
-    }
+    const NodeStruct *it = Nodes.slot(i);
+    if (!it) continue;
+    if (page >= 0 && (n++ / WLED_NODES_PER_PAGE) != (size_t)page) continue;
+    JsonObject node = nodes.createNestedObject();
+    node[F("name")] = (char *)it->nodeName; // char* is copied, table may change before response is sent
+    node["type"]    = it->nodeType;
+    node["ip"]      = IPAddress(it->ip).toString();
+    node[F("age")]  = it->age;
+    node[F("vid")]  = it->build;
   }
 }
 
@@ -1094,7 +1149,7 @@ class LockedJsonResponse: public AsyncJsonResponse {
 void serveJson(AsyncWebServerRequest* request)
 {
   enum class json_target {
-    all, state, info, state_info, nodes, effects, palettes, fxdata, networks, config
+    all, state, info, state_info, nodes, effects, palettes, fxdata, networks, config, perf
   };
   json_target subJson = json_target::all;
 
@@ -1108,6 +1163,7 @@ void serveJson(AsyncWebServerRequest* request)
   else if (url.indexOf(F("fxda"))  > 0) subJson = json_target::fxdata;
   else if (url.indexOf(F("net"))   > 0) subJson = json_target::networks;
   else if (url.indexOf(F("cfg"))   > 0) subJson = json_target::config;
+  else if (url.indexOf(F("perf"))  > 0) subJson = json_target::perf;
   #ifdef WLED_ENABLE_JSONLIVE
   else if (url.indexOf("live")     > 0) {
     serveLiveLeds(request);
@@ -1140,7 +1196,7 @@ void serveJson(AsyncWebServerRequest* request)
     case json_target::info:
       serializeInfo(lDoc); break;
     case json_target::nodes:
-      serializeNodes(lDoc); break;
+      serializeNodes(lDoc, request->hasParam(F("page")) ? request->getParam(F("page"))->value().toInt() : -1); break;
     case json_target::palettes:
       serializePalettes(lDoc, request->hasParam(F("page")) ? request->getParam(F("page"))->value().toInt() : 0); break;
     case json_target::effects:
@@ -1151,6 +1207,8 @@ void serveJson(AsyncWebServerRequest* request)
       serializeNetworks(lDoc); break;
     case json_target::config:
       serializeConfig(lDoc); break;
+    case json_target::perf:
+      serializePerf(lDoc); break;
     case json_target::state_info:
     case json_target::all:
       JsonObject state = lDoc.createNestedObject("state");
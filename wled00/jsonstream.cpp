@@ -0,0 +1,282 @@
+#include "wled.h"
+
+/*
+ * JsonStateStream (see jsonstream.h)
+ * Input is scanned byte by byte tracking nesting depth and strings only, no DOM is built for the whole document.
+ */
+#define JSON_STREAM_TIMEOUT 1000 // ms after which an unfinished document of another owner is abandoned
+
+void JsonStateStream::release() {
+  p_free(_rest);
+  p_free(_unit);
+  p_free(_seg);
+  _rest = _unit = _seg = nullptr;
+  _segCap = 0;
+  _owner = nullptr;
+}
+
+// state is only modified while holding the JSON buffer lock so that presets (which hold it while applying) do not interleave
+bool JsonStateStream::lock() {
+  if (requestJSONBufferLock(23)) return true;
+  _failed = true;
+  return false;
+}
+
+bool JsonStateStream::begin(const void *owner, byte callMode, bool acceptPin) {
+  if (_owner && _owner != owner && millis() - _lastData < JSON_STREAM_TIMEOUT) return false;
+  if (!_rest) _rest = static_cast<char*>(p_malloc(JSON_STREAM_REST_SIZE));
+  if (!_unit) _unit = static_cast<char*>(p_malloc(JSON_STREAM_UNIT_SIZE));
+  if (!_rest || !_unit) { release(); return false; }
+  _owner    = owner;
+  _lastData = millis();
+  _callMode = callMode;
+  _acceptPin = acceptPin;
+  _rest[0]  = '{';
+  _restLen  = 1;
+  _unitLen  = 0;
+  _segLen   = 0;
+  _depth    = 0;
+  _mode     = Root;
+  _inStr = _esc = _headDone = _segArray = _unitOverflow = _segLost = _failed = false;
+  return true;
+}
+
+// appends to collected top level members or current segment object
+void JsonStateStream::put(char c) {
+  if (_mode == KeyStr || _mode == Value) {
+    if (_restLen < JSON_STREAM_REST_SIZE-1) _rest[_restLen++] = c; // keep room for closing '}'
+    else _failed = true;
+  } else if (_mode == SegObj || _mode == SegElem) {
+    if (_unitLen < JSON_STREAM_UNIT_SIZE) _unit[_unitLen++] = c;
+    else _unitOverflow = true;
+  }
+}
+
+// appends to raw "seg" text, gives up (frees the copy) if it grows beyond JSON_STREAM_SEG_KEEP
+void JsonStateStream::keepSeg(char c) {
+  if (_segLost) return;
+  if (_segLen == _segCap) {
+    const size_t cap = _segCap ? 2 * _segCap : 256;
+    char *seg = cap <= JSON_STREAM_SEG_KEEP ? static_cast<char*>(p_realloc(_seg, cap)) : nullptr;
+    if (!seg) {
+      p_free(_seg);
+      _seg = nullptr;
+      _segCap = _segLen = 0;
+      _segLost = true;
+      return;
+    }
+    _seg = seg;
+    _segCap = cap;
+  }
+  _seg[_segLen++] = c;
+}
+
+// parses members starting at _rest[from] (from == 1 for all members, else _rest[from] is the separating ',')
+bool JsonStateStream::parseRest(JsonDocument &doc, size_t from) {
+  if (_failed) return false;
+  const size_t start = from > 1 ? from : 0;
+  const char save = _rest[start];
+  _rest[start] = '{';
+  _rest[_restLen] = '}';
+  DeserializationError error = deserializeJson(doc, (const char*)_rest + start, _restLen + 1 - start); // const char* input: strings are copied
+  _rest[start] = save;
+  return !error;
+}
+
+// parses the complete request (collected members and kept "seg" text) like deserializeJson() would
+bool JsonStateStream::parseAll(JsonDocument &doc) {
+  if (_failed || _segLost) return false;
+  if (!_segLen) return parseRest(doc, 1);
+  static const char segKey[] PROGMEM = "{\"seg\":";
+  const size_t keyLen = strlen_P(segKey);
+  const size_t len = keyLen + _segLen + _restLen + 1;
+  char *buf = static_cast<char*>(p_malloc(len));
+  if (!buf) return false;
+  strcpy_P(buf, segKey);
+  memcpy(buf + keyLen, _seg, _segLen);
+  size_t n = keyLen + _segLen;
+  if (_restLen > 1) { buf[n++] = ','; memcpy(buf + n, _rest + 1, _restLen - 1); n += _restLen - 1; } // skip '{' of members
+  buf[n++] = '}';
+  DeserializationError error = deserializeJson(doc, (const char*)buf, n); // const char* input: strings are copied
+  p_free(buf);
+  return !error;
+}
+
+void JsonStateStream::applyHead(size_t from) {
+  if (!lock()) return;
+  if (parseRest(*pDoc, from)) deserializeStateHead(pDoc->as<JsonObject>(), _callMode, 0);
+  else _failed = true;
+  releaseJSONBufferLock();
+}
+
+// applies completed segment object (or segment array element)
+void JsonStateStream::applyUnit() {
+  const byte it = _it;
+  if (_segArray) _it++; // keep indices of following elements even if this one is dropped
+  if (_unitOverflow || _failed || !lock()) { _failed = true; return; }
+  if (deserializeJson(*pDoc, (const char*)_unit, _unitLen)) { _failed = true; releaseJSONBufferLock(); return; }
+  JsonObject elem = pDoc->as<JsonObject>();
+  // we may be called during strip.service() so we must not modify segments while effects are executing
+  strip.suspend();
+  strip.waitForIt();
+  if (!_segArray) deserializeSegmentObject(elem, 0);
+  else if (deserializeSegment(elem, it, 0) && !elem["stop"].isNull() && elem["stop"]==0) _deleted++;
+  strip.resume();
+  releaseJSONBufferLock();
+}
+
+void JsonStateStream::process(char c) {
+  if (_inStr) {
+    put(c);
+    if (_esc) _esc = false;
+    else if (c == '\\') _esc = true;
+    else if (c == '"') {
+      _inStr = false;
+      if (_mode == KeyStr) _mode = Colon;
+    }
+    return;
+  }
+  if (c == ' ' || c == '\t' || c == '\r' || c == '\n') return;
+
+  switch (_mode) {
+    case Root:
+      if (c == '{') { _depth = 1; _mode = Key; }
+      else _mode = Error;
+      break;
+    case Key:
+      if (c == '}') { _depth = 0; _mode = Done; break; } // empty document
+      if (c != '"') { _mode = Error; break; }
+      _keyPos = _restLen;
+      _mode = KeyStr;
+      if (_restLen > 1) put(',');
+      put('"');
+      _inStr = true;
+      break;
+    case Colon: {
+      if (c != ':') { _mode = Error; break; }
+      const char *k = _rest + _keyPos + (_restLen > _keyPos && _rest[_keyPos] == ',');
+      if (_restLen - (k - _rest) == 5 && !strncmp_P(k, PSTR("\"seg\""), 5)) {
+        _restLen = _keyPos; // "seg" is not collected
+        if (!_headDone) applyHead(1);
+        _headDone = true;
+        _segMark  = _restLen;
+        _segLen   = 0;      // only the last "seg" counts (like deserializeJson())
+        _mode     = Seg;
+      } else {
+        _mode = Value;
+        put(':');
+      }
+      break;
+    }
+    case Value:
+    case Skip:
+      if (c == '{' || c == '[') _depth++;
+      else if (c == '}' || c == ']') {
+        if (_depth == 1) { _depth = 0; _mode = Done; break; } // end of document
+        _depth--;
+      } else if (c == ',' && _depth == 1) { _mode = Key; break; }
+      else if (c == '"') _inStr = true;
+      put(c);
+      break;
+    case Seg:
+      _unitLen = 0;
+      _unitOverflow = false;
+      if (c == '{') {
+        _segArray = false;
+        _depth = 2;
+        _mode = SegObj;
+        put(c);
+      } else if (c == '[') {
+        _segArray = true;
+        _it = _deleted = 0;
+        _depth = 2;
+        _mode = SegArr;
+      } else {
+        _segLen = 0;
+        _mode = Skip; // not an object or array, ignored
+        process(c);
+      }
+      break;
+    case SegObj:
+      put(c);
+      if (c == '{' || c == '[') _depth++;
+      else if (c == '}' || c == ']') {
+        if (--_depth == 1) { applyUnit(); _mode = Next; }
+      } else if (c == '"') _inStr = true;
+      break;
+    case SegArr:
+      if (c == ']') {
+        _depth = 1;
+        _mode = Next;
+        if (_deleted && lock()) {
+          strip.suspend();
+          strip.waitForIt();
+          purgeDeletedSegments(_deleted);
+          strip.resume();
+          releaseJSONBufferLock();
+        }
+      } else if (c == '}') _mode = Error; // mismatched bracket (would be handed back and forth with SegElem)
+      else if (c != ',') {
+        _unitLen = 0;
+        _unitOverflow = false;
+        _mode = SegElem;
+        process(c);
+      }
+      break;
+    case SegElem:
+      if (c == '{' || c == '[') _depth++;
+      else if ((c == '}' || c == ']') && _depth == 2) { applyUnit(); _mode = SegArr; process(c); break; } // end of scalar element
+      else if (c == '}' || c == ']') {
+        put(c);
+        if (--_depth == 2) { applyUnit(); _mode = SegArr; }
+        break;
+      } else if (c == ',' && _depth == 2) { applyUnit(); _mode = SegArr; break; }
+      else if (c == '"') _inStr = true;
+      put(c);
+      break;
+    case Next:
+      if (c == ',') _mode = Key;
+      else if (c == '}') { _depth = 0; _mode = Done; }
+      else _mode = Error;
+      break;
+    default: // Done, Error: ignore trailing data
+      break;
+  }
+}
+
+bool JsonStateStream::write(const void *owner, const uint8_t *data, size_t len) {
+  if (owner != _owner || _mode == Error) return false;
+  _lastData = millis();
+  for (size_t i = 0; i < len && _mode != Done; i++) {
+    if (_mode >= Seg && _mode <= SegElem) keepSeg(data[i]); // raw "seg" value
+    process(data[i]);
+  }
+  return _mode != Error;
+}
+
+bool JsonStateStream::end(const void *owner, bool &verbose) {
+  verbose = false;
+  if (owner != _owner) return false;
+  bool ok = _mode == Done && !_failed;
+  if (ok) {
+    if (!_headDone) applyHead(1);
+    else if (_restLen > _segMark) applyHead(_segMark); // members following "seg"
+    ok = !_failed && lock();
+  }
+  if (ok) {
+    ok = parseRest(*pDoc, 1);
+    // saving a preset stores the request from pDoc, it has to include "seg" (applied already)
+    if (ok && !(*pDoc)[F("psave")].isNull() && _headDone) {
+      ok = parseAll(*pDoc);
+      if (!ok) DEBUG_PRINTLN(F("JSON stream: \"seg\" too large to save preset."));
+    }
+    if (ok) {
+      if (_acceptPin && pDoc->containsKey("pin")) checkSettingsPIN((*pDoc)["pin"].as<const char*>());
+      verbose = deserializeStateTail(pDoc->as<JsonObject>(), _callMode, 0);
+    }
+    releaseJSONBufferLock();
+  }
+  release(); // do not keep buffers while idle
+  DEBUG_PRINTF_P(PSTR("JSON stream %s.\n"), ok ? "applied" : "failed");
+  return ok;
+}
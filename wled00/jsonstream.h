@@ -0,0 +1,54 @@
+#ifndef WLED_JSONSTREAM_H
+#define WLED_JSONSTREAM_H
+
+// Incremental (SAX style) state parser for chunked input (WS frames, HTTP body, serial) that does not buffer the whole document.
+// Segment objects are applied one at a time as soon as they are complete, other top level members are collected
+// (bounded by JSON_STREAM_REST_SIZE) and applied before the first segment and at the end of the document.
+// Each part is parsed into pDoc and applied while holding the JSON buffer lock (like presets), the lock is not held in between.
+// The raw "seg" text is kept (bounded by JSON_STREAM_SEG_KEEP) so that "psave" (with "o") can store the complete request.
+// Results equal deserializeState() except that usermods do not see "seg" and members following "seg" are applied after segments.
+class JsonStateStream {
+  public:
+    ~JsonStateStream() { release(); }
+    bool begin(const void *owner, byte callMode = CALL_MODE_DIRECT_CHANGE, bool acceptPin = false); // false if another owner is still active
+    bool write(const void *owner, const uint8_t *data, size_t len);         // false once input is invalid
+    bool end(const void *owner, bool &verbose);                             // false if input was invalid, truncated or too large
+    inline bool isComplete() const { return _mode == Done; }
+  private:
+    enum Mode : uint8_t { Root, Key, KeyStr, Colon, Value, Skip, Seg, SegObj, SegArr, SegElem, Next, Done, Error };
+    const void   *_owner = nullptr;
+    unsigned long _lastData = 0;
+    char   *_rest = nullptr;  // '{' followed by top level members other than "seg"
+    char   *_unit = nullptr;  // current segment object
+    char   *_seg  = nullptr;  // raw text of "seg" value (for saving presets)
+    size_t  _restLen = 0;
+    size_t  _unitLen = 0;
+    size_t  _segLen = 0;
+    size_t  _segCap = 0;
+    size_t  _keyPos = 0;      // start of current key in _rest
+    size_t  _segMark = 0;     // end of members preceding "seg" in _rest
+    uint8_t _depth = 0;
+    uint8_t _it = 0;          // segment array index
+    uint8_t _deleted = 0;
+    byte    _callMode = CALL_MODE_DIRECT_CHANGE;
+    Mode    _mode = Done;
+    bool    _inStr = false;
+    bool    _esc = false;
+    bool    _headDone = false;
+    bool    _segArray = false;
+    bool    _unitOverflow = false;
+    bool    _segLost = false;   // "seg" text exceeded JSON_STREAM_SEG_KEEP
+    bool    _acceptPin = false; // "pin" unlocks settings (HTTP API)
+    bool    _failed = false;
+    void release();
+    bool lock();
+    void put(char c);
+    void keepSeg(char c);
+    void process(char c);
+    bool parseRest(JsonDocument &doc, size_t from);
+    bool parseAll(JsonDocument &doc);
+    void applyHead(size_t from);
+    void applyUnit();
+};
+
+#endif // WLED_JSONSTREAM_H
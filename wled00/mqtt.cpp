@@ -11,6 +11,8 @@
 #warning "MQTT topics length > 32 is not recommended for compatibility with usermods!"
 #endif
 
+static void resetMqttPublished();
+
 static void parseMQTTBriPayload(char* payload)
 {
   if      (strstr(payload, "ON") || strstr(payload, "on") || strstr(payload, "true")) {bri = briLast; stateUpdated(CALL_MODE_DIRECT_CHANGE);}
@@ -59,7 +61,7 @@ static void onMqttConnect(bool sessionPresent)
   mqtt->publish(subuf, 0, true, "online"); // retain message for a LWT
 #endif
 
-  publishMqtt();
+  resetMqttPublished();
 }
 
 
@@ -162,35 +164,137 @@ class bufferPrint : public Print {
 }; // anonymous namespace
 
 
+/*
+ * State publishing
+ * publishMqtt() only marks state as changed, handleMqtt() publishes at most every mqttMinInterval ms
+ * so rapid changes (slider drags, playlists) are coalesced into one update.
+ * Only topics whose payload differs from the last published one are sent (all after (re)connect).
+ * Each topic occupies one slot of the outbound queue: if the client's TCP buffer is full the publish
+ * is dropped (counted) and retried with then current values on the next cycle.
+ */
+#define MQTT_PUB_BRI  0x01  // <device>/g
+#define MQTT_PUB_COL  0x02  // <device>/c
+#define MQTT_PUB_XML  0x04  // <device>/v
+#define MQTT_PUB_JSON 0x08  // <device>/state (optional)
+
+static bool          mqttChanged = false;
+static uint8_t       mqttPending = 0;       // topics that must be published regardless of their value (failed or not yet published)
+static unsigned long mqttLastPublish = 0;
+static unsigned long mqttLastJson = 0;
+static uint8_t       mqttLastBri = 0;
+static uint32_t      mqttLastCol = 0;
+static uint32_t      mqttLastXml = 0;       // payload hashes
+static uint32_t      mqttLastJsonHash = 0;
+static uint32_t      mqttPublished = 0;
+static uint32_t      mqttCoalesced = 0;
+static uint32_t      mqttDropped = 0;
+
+static char          mqttTopicBuf[MQTT_MAX_TOPIC_LEN + 8];
+static size_t        mqttTopicLen = 0;    // length of device topic prefix in mqttTopicBuf
+
+static uint32_t payloadHash(const char *payload, size_t len) {
+  uint32_t h = 2166136261U; // FNV-1a
+  while (len--) h = (h ^ (uint8_t)*payload++) * 16777619U;
+  return h;
+}
+
+// appends suffix (PROGMEM) to device topic
+static const char *mqttTopic(const char *suffix) {
+  strcpy_P(mqttTopicBuf + mqttTopicLen, suffix);
+  return mqttTopicBuf;
+}
+
+// publishes a topic, returns false if the client could not take it (topic stays pending)
+static bool mqttPublish(uint8_t topic, const char *suffix, const char *payload, size_t len, bool retain) {
+  if (!mqtt->publish(mqttTopic(suffix), 0, retain, payload, len)) {
+    mqttPending |= topic;
+    mqttDropped++;
+    return false;
+  }
+  mqttPending &= ~topic;
+  mqttPublished++;
+  return true;
+}
+
+// marks state as changed, actual publishing is done by handleMqtt()
 void publishMqtt()
+{
+  if (mqttChanged) mqttCoalesced++;
+  mqttChanged = true;
+}
+
+// forget published values so everything is sent again (after (re)connect)
+static void resetMqttPublished()
+{
+  #ifndef USERMOD_SMARTNEST
+  mqttPending = MQTT_PUB_BRI | MQTT_PUB_COL | MQTT_PUB_XML | (mqttJsonState ? MQTT_PUB_JSON : 0);
+  #endif
+  mqttLastJson = 0;
+}
+
+void handleMqtt()
 {
   if (!WLED_MQTT_CONNECTED) return;
+  const unsigned long now = millis();
+  const bool jsonDue = mqttJsonState && mqttMaxInterval && now - mqttLastJson >= mqttMaxInterval * 1000UL;
+  if (!(mqttChanged || mqttPending || jsonDue) || now - mqttLastPublish < mqttMinInterval) return;
   DEBUG_PRINTLN(F("Publish MQTT"));
+  mqttLastPublish = now;
+  mqttChanged = false;
 
   #ifndef USERMOD_SMARTNEST
-  char s[10];
-  char subuf[MQTT_MAX_TOPIC_LEN + 16];
+  mqttTopicLen = strlcpy(mqttTopicBuf, mqttDeviceTopic, MQTT_MAX_TOPIC_LEN + 1);
+  char s[12];
 
-  sprintf_P(s, PSTR("%u"), bri);
-  strlcpy(subuf, mqttDeviceTopic, MQTT_MAX_TOPIC_LEN + 1);
-  strcat_P(subuf, PSTR("/g"));
-  mqtt->publish(subuf, 0, retainMqttMsg, s);         // optionally retain message (#2263)
+  if (mqttLastBri != bri || (mqttPending & MQTT_PUB_BRI)) {
+    size_t l = sprintf_P(s, PSTR("%u"), bri);
+    if (mqttPublish(MQTT_PUB_BRI, PSTR("/g"), s, l, retainMqttMsg)) mqttLastBri = bri; // optionally retain message (#2263)
+  }
 
-  sprintf_P(s, PSTR("#%06X"), (colPri[3] << 24) | (colPri[0] << 16) | (colPri[1] << 8) | (colPri[2]));
-  strlcpy(subuf, mqttDeviceTopic, MQTT_MAX_TOPIC_LEN + 1);
-  strcat_P(subuf, PSTR("/c"));
-  mqtt->publish(subuf, 0, retainMqttMsg, s);         // optionally retain message (#2263)
+  const uint32_t col = (colPri[3] << 24) | (colPri[0] << 16) | (colPri[1] << 8) | (colPri[2]);
+  if (mqttLastCol != col || (mqttPending & MQTT_PUB_COL)) {
+    size_t l = sprintf_P(s, PSTR("#%06X"), (unsigned)col);
+    if (mqttPublish(MQTT_PUB_COL, PSTR("/c"), s, l, retainMqttMsg)) mqttLastCol = col; // optionally retain message (#2263)
+  }
 
   // TODO: use a DynamicBufferList.  Requires a list-read-capable MQTT client API.
   DynamicBuffer buf(1024);
   bufferPrint pbuf(buf.data(), buf.size());
   XML_response(pbuf);
-  strlcpy(subuf, mqttDeviceTopic, MQTT_MAX_TOPIC_LEN + 1);
-  strcat_P(subuf, PSTR("/v"));
-  mqtt->publish(subuf, 0, retainMqttMsg, buf.data(), pbuf.size());   // optionally retain message (#2263)
+  uint32_t h = payloadHash(buf.data(), pbuf.size());
+  if (h != mqttLastXml || (mqttPending & MQTT_PUB_XML)) {
+    if (mqttPublish(MQTT_PUB_XML, PSTR("/v"), buf.data(), pbuf.size(), retainMqttMsg)) mqttLastXml = h; // optionally retain message (#2263)
+  }
+
+  if (!mqttJsonState) mqttPending &= ~MQTT_PUB_JSON; // disabled meanwhile
+  else {
+    const Segment &seg = strip.getMainSegment();
+    char json[128];
+    size_t l = snprintf_P(json, sizeof(json), PSTR("{\"on\":%s,\"bri\":%u,\"ps\":%d,\"pl\":%d,\"col\":\"#%06X\",\"fx\":%u,\"sx\":%u,\"ix\":%u,\"pal\":%u}"),
+                          bri ? "true" : "false", bri, currentPreset ? (int)currentPreset : -1, currentPlaylist, (unsigned)col,
+                          seg.mode, seg.speed, seg.intensity, seg.palette);
+    h = payloadHash(json, l);
+    if (h != mqttLastJsonHash || (mqttPending & MQTT_PUB_JSON) || jsonDue) {
+      if (mqttPublish(MQTT_PUB_JSON, PSTR("/state"), json, l, retainMqttMsg)) {
+        mqttLastJsonHash = h;
+        mqttLastJson = now;
+      }
+    }
+  }
   #endif
 }
 
+// publishing statistics for /json/info
+void serializeMqttInfo(JsonObject root)
+{
+  JsonObject m = root.createNestedObject(F("mqtt"));
+  m[F("con")]  = WLED_MQTT_CONNECTED;
+  m[F("pub")]  = mqttPublished;
+  m[F("coal")] = mqttCoalesced;
+  m[F("drop")] = mqttDropped;
+  m["q"]       = __builtin_popcount(mqttPending);
+}
+
 
 //HA autodiscovery was removed in favor of the native integration in HA v0.102.0
 
@@ -0,0 +1,122 @@
+#include "wled.h"
+
+/*
+ * Frame/loop timing statistics, see perf.h
+ */
+
+#ifndef WLED_DISABLE_PERF_STATS
+
+typedef struct PerfHistogram {
+  uint16_t counts[PERF_BUCKETS];
+  uint32_t count;     // samples in histogram (decays with counts)
+  uint32_t sumUs;     // for average (decays with counts)
+  uint32_t maxUs;     // max. in current window
+  uint32_t lastMaxUs; // max. in previous window
+} perfHistogram;
+
+static perfHistogram perfStats[PERF_SPAN_COUNT];
+static uint32_t perfCyclesPerUs = 0;
+static uint32_t perfSlowestEffectUs = 0;  // slowest effect call in current window
+static uint8_t  perfSlowestEffect = 0;
+static unsigned long perfLastDecay = 0;
+
+static const char perfSpanNames[] PROGMEM = "loop\0service\0effect\0blend\0convert\0show\0network\0usermods\0";
+
+// 0,1 map to themselves, then 2 buckets per octave: [2^o, 1.5*2^o) and [1.5*2^o, 2^(o+1))
+static inline unsigned perfBucket(uint32_t us) {
+  if (us < 2) return us;
+  unsigned o = 31 - __builtin_clz(us);
+  unsigned b = 2*o + ((us >> (o-1)) & 1);
+  return b < PERF_BUCKETS ? b : PERF_BUCKETS-1;
+}
+
+// representative value (middle) of bucket
+static uint32_t perfBucketValue(unsigned b) {
+  if (b < 2) return b;
+  unsigned o = b >> 1;
+  uint32_t lo = (2 + (b & 1)) << (o-1);
+  return lo + (1U << (o-1)) / 2;
+}
+
+static void perfHalve(perfHistogram &h) {
+  for (unsigned i = 0; i < PERF_BUCKETS; i++) h.counts[i] >>= 1;
+  h.count >>= 1;
+  h.sumUs >>= 1;
+}
+
+void perfRecord(uint8_t span, uint32_t cycles) {
+  if (span >= PERF_SPAN_COUNT) return;
+  if (!perfCyclesPerUs) perfCyclesPerUs = ESP.getCpuFreqMHz();
+  uint32_t us = cycles / perfCyclesPerUs;
+  perfHistogram &h = perfStats[span];
+  unsigned b = perfBucket(us);
+  if (h.counts[b] == UINT16_MAX) perfHalve(h); // keep ratios when a bucket saturates
+  h.counts[b]++;
+  h.count++;
+  h.sumUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+}
+
+void perfRecordEffect(uint8_t mode, uint32_t cycles) {
+  perfRecord(PERF_EFFECT, cycles);
+  uint32_t us = cycles / perfCyclesPerUs;
+  if (us > perfSlowestEffectUs) {
+    perfSlowestEffectUs = us;
+    perfSlowestEffect = mode;
+  }
+}
+
+// called once per loop, ages histograms so that percentiles follow current behaviour
+void perfDecay() {
+  if (millis() - perfLastDecay < PERF_WINDOW) return;
+  perfLastDecay = millis();
+  for (auto &h : perfStats) {
+    perfHalve(h);
+    h.lastMaxUs = h.maxUs;
+    h.maxUs = 0;
+  }
+  if (perfSlowestEffectUs) perfSlowestEffectUs >>= 1; // let a new effect take over after a while
+}
+
+static uint32_t perfPercentile(const perfHistogram &h, unsigned pct) {
+  uint32_t total = 0;
+  for (unsigned i = 0; i < PERF_BUCKETS; i++) total += h.counts[i];
+  if (!total) return 0;
+  uint32_t target = (total * pct + 99) / 100;
+  uint32_t acc = 0;
+  for (unsigned i = 0; i < PERF_BUCKETS; i++) {
+    acc += h.counts[i];
+    if (acc >= target) return perfBucketValue(i);
+  }
+  return perfBucketValue(PERF_BUCKETS-1);
+}
+
+// all values in microseconds
+void serializePerf(JsonObject root) {
+  root[F("mhz")] = ESP.getCpuFreqMHz();
+  root["fps"]    = strip.getFps();
+  root[F("win")] = PERF_WINDOW;
+  root[F("missed")] = strip.getMissedDeadlines(); // frames started more than half a frame late
+  JsonObject spans = root.createNestedObject(F("spans"));
+  const char *name = perfSpanNames;
+  for (unsigned s = 0; s < PERF_SPAN_COUNT; s++) {
+    const perfHistogram &h = perfStats[s];
+    char key[12];
+    strncpy_P(key, name, sizeof(key)-1);
+    key[sizeof(key)-1] = 0;
+    name += strlen_P(name) + 1;
+    JsonObject span = spans.createNestedObject(key); // copies key
+    span["n"]     = h.count;
+    span[F("avg")] = h.count ? h.sumUs / h.count : 0;
+    span[F("p50")] = perfPercentile(h, 50);
+    span[F("p99")] = perfPercentile(h, 99);
+    span[F("max")] = max(h.maxUs, h.lastMaxUs);
+  }
+  JsonObject slow = root.createNestedObject(F("slowfx"));
+  slow["fx"] = perfSlowestEffect;
+  slow["us"] = perfSlowestEffectUs;
+}
+
+#else
+void serializePerf(JsonObject root) {}
+#endif
@@ -0,0 +1,45 @@
+#ifndef WLED_PERF_H
+#define WLED_PERF_H
+/*
+ * Always-on frame/loop timing statistics (served at /json/perf)
+ *
+ * Spans are measured with the CPU cycle counter and collected into log2 histograms
+ * (2 buckets per octave of microseconds) from which p50/p99 are derived.
+ * Recording a span costs two cycle counter reads and one bucket increment.
+ * Histograms decay (halve) every PERF_WINDOW ms so they represent recent behaviour.
+ * Define WLED_DISABLE_PERF_STATS to compile out.
+ */
+
+#include <Arduino.h>
+
+enum PerfSpan : uint8_t {
+  PERF_LOOP = 0,  // complete WLED::loop()
+  PERF_SERVICE,   // strip.service() when a frame is rendered (effects + show)
+  PERF_EFFECT,    // single effect function call
+  PERF_BLEND,     // blending one segment into the frame buffer
+  PERF_CONVERT,   // handing frame to buses (gamma, CCT, color order, ABL)
+  PERF_BUS_SHOW,  // BusManager::show()
+  PERF_NETWORK,   // UDP notifier/realtime receive
+  PERF_USERMODS,  // userLoop() + UsermodManager::loop()
+  PERF_SPAN_COUNT
+};
+
+#define PERF_BUCKETS 48      // 2 buckets per octave covers 0us to ~16s
+#define PERF_WINDOW  10000   // decay period in ms
+
+#ifndef WLED_DISABLE_PERF_STATS
+void perfRecord(uint8_t span, uint32_t cycles);
+void perfRecordEffect(uint8_t mode, uint32_t cycles);
+void perfDecay();
+
+inline uint32_t perfStart() { return ESP.getCycleCount(); }
+inline void perfEnd(uint8_t span, uint32_t start) { perfRecord(span, ESP.getCycleCount() - start); }
+inline void perfEndEffect(uint8_t mode, uint32_t start) { perfRecordEffect(mode, ESP.getCycleCount() - start); }
+#else
+inline uint32_t perfStart() { return 0; }
+inline void perfEnd(uint8_t span, uint32_t start) {}
+inline void perfEndEffect(uint8_t mode, uint32_t start) {}
+inline void perfDecay() {}
+#endif
+
+#endif
@@ -0,0 +1,156 @@
+#include "wled.h"
+
+/*
+ * Binary per-LED upload (alternative to JSON {"seg":{"i":[...]}} without using the JSON buffer)
+ *
+ * Accepted as HTTP POST body on /px (Content-Type: application/octet-stream) and as (possibly fragmented) binary WebSocket message.
+ * Data is decoded while it arrives and written directly into segment pixels (like "i", segment is frozen).
+ *
+ * Message layout (multi-byte values little endian):
+ *  0    'P'
+ *  1    format: bits 0-2 pixel format (PX_FMT_*), bit 3 RLE
+ *  2    segment id (255 = main segment)
+ *  3    reserved (0)
+ *  4-7  offset of first pixel (raw segment index)
+ *  8... pixel data, 3 (RGB), 4 (RGBW), 2 (RGB565) or 1 (palette index) bytes per pixel
+ * With RLE, data is a sequence of spans (PackBits): control byte c < 128 is followed by c+1 literal pixels,
+ * c >= 128 by a single pixel repeated c-126 times.
+ * A message may be split at any byte (HTTP chunks, WS frames/fragments).
+ */
+
+#define PX_MAGIC     'P'
+#define PX_HDR_SIZE  8
+#define PX_FMT_RGB   0
+#define PX_FMT_RGBW  1
+#define PX_FMT_565   2
+#define PX_FMT_PAL   3
+#define PX_FMT_RLE   0x08
+#define PX_TIMEOUT   1000   // ms after which an unfinished upload of another client is abandoned
+
+static const void    *pxOwner = nullptr;  // client/request currently uploading
+static unsigned long  pxLastData = 0;
+static uint8_t        pxHeader[PX_HDR_SIZE];
+static uint8_t        pxHdrLen = 0;
+static uint8_t        pxPixel[4];         // partially received pixel
+static uint8_t        pxPixLen = 0;
+static uint8_t        pxStride = 3;
+static uint8_t        pxFormat = 0;
+static uint8_t        pxSegId = 0;
+static uint8_t        pxSpan = 0;         // pixels left in current RLE span
+static bool           pxRun = false;      // current span is a run (repeated pixel)
+static bool           pxStarted = false;  // header was valid and segment prepared
+static bool           pxError = false;
+static uint32_t       pxPos = 0;          // next pixel index
+static uint32_t       pxCount = 0;        // pixels written
+static CRGBPalette16  pxPalette;          // for PX_FMT_PAL
+
+static uint32_t decodePixel(const uint8_t *p) {
+  switch (pxFormat & 0x07) {
+    case PX_FMT_RGBW: return RGBW32(p[0], p[1], p[2], p[3]);
+    case PX_FMT_565: {
+      const unsigned v = p[0] | (p[1] << 8);
+      const unsigned r = (v >> 11) & 0x1F, g = (v >> 5) & 0x3F, b = v & 0x1F;
+      return RGBW32((r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2), 0);
+    }
+    case PX_FMT_PAL:  return ColorFromPalette(pxPalette, p[0], 255, NOBLEND);
+    default:          return RGBW32(p[0], p[1], p[2], 0);
+  }
+}
+
+// validates header and prepares segment the same way as "i" does
+static bool startPixels() {
+  if (pxHeader[0] != PX_MAGIC) return false;
+  pxFormat = pxHeader[1];
+  switch (pxFormat & 0x07) {
+    case PX_FMT_RGB:  pxStride = 3; break;
+    case PX_FMT_RGBW: pxStride = 4; break;
+    case PX_FMT_565:  pxStride = 2; break;
+    case PX_FMT_PAL:  pxStride = 1; break;
+    default: return false;
+  }
+  pxSegId = pxHeader[2] == 255 ? strip.getMainSegmentId() : pxHeader[2];
+  if (pxSegId >= strip.getSegmentsNum()) return false;
+  Segment &seg = strip.getSegment(pxSegId);
+  if (!seg.isActive()) return false;
+  pxPos = pxHeader[4] | (pxHeader[5] << 8) | (pxHeader[6] << 16) | ((uint32_t)pxHeader[7] << 24);
+  if ((pxFormat & 0x07) == PX_FMT_PAL) seg.loadPalette(pxPalette, seg.palette);
+
+  // set brightness immediately and disable transition
+  jsonTransitionOnce = true;
+  if (seg.isInTransition()) seg.startTransition(0);
+  strip.setTransition(0);
+  strip.setBrightness(scaledBri(bri), true);
+  // freeze and init to black
+  if (!seg.freeze) {
+    seg.freeze = true;
+    seg.clear();
+  }
+  return true;
+}
+
+// starts a new upload, returns false if another client is still uploading
+bool pixelStreamBegin(const void *owner) {
+  if (pxOwner && pxOwner != owner && millis() - pxLastData < PX_TIMEOUT) return false;
+  pxOwner    = owner;
+  pxLastData = millis();
+  pxHdrLen   = 0;
+  pxPixLen   = 0;
+  pxSpan     = 0;
+  pxRun      = false;
+  pxStarted  = false;
+  pxError    = false;
+  pxCount    = 0;
+  return true;
+}
+
+static inline void putPixels(Segment &seg, uint32_t c) {
+  unsigned n = 1;
+  if (pxFormat & PX_FMT_RLE) {
+    if (pxRun) n = pxSpan;
+    pxSpan -= n;
+  }
+  pxCount += n;
+  while (n--) seg.setRawPixelColor(pxPos++, c); // sets pixel color without 1D->2D expansion, grouping or spacing
+}
+
+// decodes next part of a message, returns false once data is invalid
+bool pixelStreamWrite(const void *owner, const uint8_t *data, size_t len) {
+  if (owner != pxOwner || pxError) return false;
+  pxLastData = millis();
+  size_t i = 0;
+  while (pxHdrLen < PX_HDR_SIZE && i < len) pxHeader[pxHdrLen++] = data[i++];
+  if (pxHdrLen < PX_HDR_SIZE) return true;
+  if (!pxStarted) {
+    if (!startPixels()) { pxError = true; return false; }
+    pxStarted = true;
+  }
+
+  Segment &seg = strip.getSegment(pxSegId);
+  while (i < len) {
+    if ((pxFormat & PX_FMT_RLE) && !pxSpan) {
+      const uint8_t c = data[i++];
+      pxRun  = c >= 128;
+      pxSpan = pxRun ? c - 126 : c + 1;
+    } else if (!pxPixLen && len - i >= pxStride) {
+      putPixels(seg, decodePixel(data + i)); // whole pixel in this chunk
+      i += pxStride;
+    } else {
+      pxPixel[pxPixLen++] = data[i++];      // pixel split across chunks
+      if (pxPixLen == pxStride) {
+        putPixels(seg, decodePixel(pxPixel));
+        pxPixLen = 0;
+      }
+    }
+  }
+  return true;
+}
+
+// ends upload, returns number of pixels set or -1 if message was invalid or incomplete
+int pixelStreamEnd(const void *owner) {
+  if (owner != pxOwner) return -1;
+  pxOwner = nullptr;
+  if (pxError || !pxStarted || pxPixLen || pxSpan) return -1;
+  strip.trigger(); // force segment update
+  DEBUG_PRINTF_P(PSTR("Pixel upload: %u px to seg %u\n"), (unsigned)pxCount, (unsigned)pxSegId);
+  return pxCount;
+}
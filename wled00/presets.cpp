@@ -29,8 +29,7 @@ bool presetNeedsSaving() {
 static void doSaveState() {
   bool persist = (presetToSave < 251);
 
-  unsigned long maxWait = millis() + strip.getFrameTime();
-  while (strip.isUpdating() && millis() < maxWait) delay(1); // wait for strip to finish updating, accessing FS during sendout causes glitches
+  BusManager::waitForAllShown(strip.getFrameTime()); // wait for strip to finish updating, accessing FS during sendout causes glitches
 
   if (!requestJSONBufferLock(10)) return;
 
@@ -166,8 +165,7 @@ void handlePresets()
   DEBUG_PRINTF_P(PSTR("Applying preset: %u\n"), (unsigned)tmpPreset);
 
   #if defined(ARDUINO_ARCH_ESP32S2) || defined(ARDUINO_ARCH_ESP32C3)
-  unsigned long maxWait = millis() + strip.getFrameTime();
-  while (strip.isUpdating() && millis() < maxWait) delay(1); // wait for strip to finish updating, accessing FS during sendout causes glitches
+  BusManager::waitForAllShown(strip.getFrameTime()); // wait for strip to finish updating, accessing FS during sendout causes glitches
   #endif
 
   #ifdef ARDUINO_ARCH_ESP32
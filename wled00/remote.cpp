@@ -124,8 +124,7 @@ static bool remoteJson(int button)
 
   sprintf_P(objKey, PSTR("\"%d\":"), button);
 
-  unsigned long start = millis();
-  while (strip.isUpdating() && millis()-start < ESPNOW_BUSWAIT_TIMEOUT) yield(); // wait for strip to finish updating, accessing FS during sendout causes glitches
+  BusManager::waitForAllShown(ESPNOW_BUSWAIT_TIMEOUT); // wait for strip to finish updating, accessing FS during sendout causes glitches
 
   // attempt to read command from remote.json
   readObjectFromFile(PSTR("/remote.json"), objKey, pDoc);
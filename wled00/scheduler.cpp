@@ -0,0 +1,37 @@
+#include "wled.h"
+
+/*
+ * Background tasks of the main loop (see LoopTask in fcn_declare.h and WLED::loop())
+ */
+
+// A handler that is cheap on most passes but now and then does real work (a display redraw, a blocking HTTP poll)
+// is judged by its peak cost, an average over thousands of cheap passes would never postpone it.
+#define LOOP_TASK_COST_DECAY 10000 // ms
+
+// runs due background tasks, postponing expensive ones if they would delay the next frame
+void runLoopTasks(loopTask *tasks, size_t count) {
+  static unsigned long lastDecay = 0;
+  if (millis() - lastDecay >= LOOP_TASK_COST_DECAY) {
+    lastDecay = millis();
+    for (size_t i = 0; i < count; i++) tasks[i].costUs >>= 1;
+  }
+  for (size_t i = 0; i < count; i++) {
+    loopTask &t = tasks[i];
+    if (t.ready && !t.ready()) continue;
+    const unsigned long now = millis();
+    const unsigned long since = now - t.lastRun;
+    if (t.period && since < t.period) continue;
+    if (t.maxDefer && since < t.maxDefer && t.costUs > 0) {
+      const unsigned long slack = strip.timeToNextFrame();
+      if (slack < 1000UL && t.costUs > slack * 1000UL) continue; // would make next frame late
+    }
+    const uint32_t cycles = perfStart();
+    const unsigned long start = micros();
+    t.fn();
+    const unsigned us = std::min(micros() - start, 65535UL);
+    if (us > t.costUs) t.costUs = us;
+    t.lastRun = now;
+    if (t.perfSpan != 255) perfEnd(t.perfSpan, cycles);
+    yield();
+  }
+}
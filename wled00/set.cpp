@@ -130,6 +130,7 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     #endif
     for (unsigned s=0; s<WLED_MAX_BUTTONS; s++) {
       if (btnPin[s]>=0 && PinManager::isPinAllocated(btnPin[s], PinOwner::Button)) {
+        detachButtonInterrupt(s);
         PinManager::deallocatePin(btnPin[s], PinOwner::Button);
         #ifdef SOC_TOUCH_VERSION_2 // ESP32 S2 and S3 have a function to check touch state, detach interrupt
         if (digitalPinToTouchChannel(btnPin[s]) >= 0) // if touch capable pin
@@ -154,6 +155,7 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     Bus::setCCTBlend(cctBlending);
     Bus::setGlobalAWMode(request->arg(F("AW")).toInt());
     strip.setTargetFps(request->arg(F("FR")).toInt());
+    strip.setAdaptiveFps(request->hasArg(F("AF")));
     #if defined(ARDUINO_ARCH_ESP32) && !defined(CONFIG_IDF_TARGET_ESP32C3)
     useParallelI2S = request->hasArg(F("PR"));
     #endif
@@ -386,6 +388,9 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
 
     #ifndef WLED_DISABLE_ESPNOW
     useESPNowSync = request->hasArg(F("EN"));
+    t = request->arg(F("ES")).toInt();
+    if (t >= ESPNOW_STREAM_OFF && t <= ESPNOW_STREAM_RECEIVE) espNowStreamMode = t;
+    espNowStreamDelta = request->hasArg(F("ED"));
     #endif
 
     syncGroups = request->arg(F("GS")).toInt();
@@ -405,6 +410,8 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
 
     t = request->arg(F("UR")).toInt();
     if ((t>=0) && (t<30)) udpNumRetries = t;
+    udpCompactSync = request->hasArg(F("UC"));
+    udpLegacySync = request->hasArg(F("UL"));
 
 
     nodeListEnabled = request->hasArg(F("NL"));
@@ -462,6 +469,11 @@ void handleSettingsSet(AsyncWebServerRequest *request, byte subPage)
     strlcpy(mqttGroupTopic, request->arg(F("MG")).c_str(), MQTT_MAX_TOPIC_LEN+1);
     buttonPublishMqtt = request->hasArg(F("BM"));
     retainMqttMsg = request->hasArg(F("RT"));
+    mqttJsonState = request->hasArg(F("MJ"));
+    t = request->arg(F("MI")).toInt();
+    if (t >= 0 && t <= 10000) mqttMinInterval = t;
+    t = request->arg(F("MX")).toInt();
+    if (t >= 0 && t <= 3600) mqttMaxInterval = t;
     #endif
 
     #ifndef WLED_DISABLE_HUESYNC
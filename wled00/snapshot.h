@@ -0,0 +1,95 @@
+#ifndef WLED_SNAPSHOT_H
+#define WLED_SNAPSHOT_H
+
+#include <memory>
+
+/*
+ * Responses rendered in one go (settings scripts)
+ * Content is generated once into a chain of fixed size blocks (PSRAM if available) and sent from memory with a
+ * Content-Length, so it cannot change while it is transferred and nothing has to be generated again per chunk.
+ * Blocks are never reallocated: heap needed is the content plus at most one partly filled block, nothing is copied.
+ */
+
+#ifndef WLED_SNAPSHOT_BLOCK
+  #define WLED_SNAPSHOT_BLOCK 1024 // allocation size of a block (including link)
+#endif
+
+struct SnapshotBlock {
+  SnapshotBlock *next;
+  uint8_t        data[WLED_SNAPSHOT_BLOCK - sizeof(SnapshotBlock*)];
+};
+
+static inline void freeSnapshotChain(SnapshotBlock *b) {
+  while (b) {
+    SnapshotBlock *next = b->next;
+    p_free(b);
+    b = next;
+  }
+}
+
+// Print adapter collecting generated content in a chain of blocks
+class SnapshotPrint : public Print {
+  SnapshotBlock *_head = nullptr, *_tail = nullptr;
+  size_t _len = 0;
+  bool   _failed = false;
+  public:
+  ~SnapshotPrint() { freeSnapshotChain(_head); }
+
+  size_t write(const uint8_t *buffer, size_t size) override {
+    if (_failed) return 0;
+    size_t done = 0;
+    while (done < size) {
+      size_t used = _len % sizeof(SnapshotBlock::data);
+      if (!_tail || (used == 0 && _len)) { // first or full block: append a new one
+        SnapshotBlock *b = static_cast<SnapshotBlock*>(p_malloc(sizeof(SnapshotBlock)));
+        if (!b) { _failed = true; return done; }
+        b->next = nullptr;
+        if (_tail) _tail->next = b; else _head = b;
+        _tail = b;
+        used = 0;
+      }
+      const size_t n = std::min(size - done, sizeof(SnapshotBlock::data) - used);
+      memcpy(_tail->data + used, buffer + done, n);
+      done += n;
+      _len += n;
+    }
+    return done;
+  }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+
+  bool   failed() const { return _failed; }
+  size_t length() const { return _len; }
+  // caller takes ownership of the chain
+  SnapshotBlock *release() {
+    SnapshotBlock *b = _head;
+    _head = _tail = nullptr;
+    _len = 0;
+    return b;
+  }
+};
+
+// sends the content of a snapshot (takes ownership of its blocks), blocks are freed when the response is destroyed
+// (also if the client disconnects early)
+inline AsyncWebServerResponse *beginSnapshotResponse(AsyncWebServerRequest* request, const String& contentType, SnapshotPrint &snap)
+{
+  const size_t len = snap.length();
+  std::shared_ptr<SnapshotBlock> chain(snap.release(), freeSnapshotChain);
+  const SnapshotBlock *block = chain.get(); // block holding 'blockStart' (content is requested in order)
+  size_t blockStart = 0;
+  return request->beginResponse(contentType, len, [chain, len, block, blockStart](uint8_t *buffer, size_t maxLen, size_t index) mutable -> size_t {
+    constexpr size_t blockLen = sizeof(SnapshotBlock::data);
+    if (index < blockStart) { block = chain.get(); blockStart = 0; } // resent from an earlier position
+    size_t n = 0;
+    maxLen = std::min(maxLen, len - index);
+    while (n < maxLen && block) {
+      if (index >= blockStart + blockLen) { block = block->next; blockStart += blockLen; continue; }
+      const size_t off = index - blockStart, cnt = std::min(maxLen - n, blockLen - off);
+      memcpy(buffer + n, block->data + off, cnt);
+      n += cnt;
+      index += cnt;
+    }
+    return n;
+  });
+}
+
+#endif // WLED_SNAPSHOT_H
@@ -78,6 +78,14 @@ void DMXESPSerial::write(int Channel, uint8_t value) {
   dmxDataStore[Channel] = value;
 }
 
+// Function to send channels 1 to channels at once
+void DMXESPSerial::write(const uint8_t *values, int channels) {
+  if (dmxStarted == false) init();
+
+  if (channels > dmxMaxChannel) channels = dmxMaxChannel;
+  if (channels > 0) memcpy(dmxDataStore + 1, values, channels);
+}
+
 void DMXESPSerial::end() {
   channelSize = 0;
   Serial1.end();
@@ -24,6 +24,8 @@ public:
   void init(int MaxChan);
   uint8_t read(int Channel);
   void write(int channel, uint8_t value);
+  void write(const uint8_t *values, int channels);
+  bool ready() { return true; } // update() blocks until frame is sent
   void update();
   void end();
 };
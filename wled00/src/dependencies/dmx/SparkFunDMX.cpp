@@ -21,6 +21,7 @@ Distributed as-is; no warranty is given.
 
 #include "SparkFunDMX.h"
 #include <HardwareSerial.h>
+#include <driver/uart.h>
 
 #define dmxMaxChannel  512
 #define defaultMax 32
@@ -30,6 +31,14 @@ Distributed as-is; no warranty is given.
 #define BREAKSPEED     83333
 #define BREAKFORMAT    SERIAL_8N1
 
+// output uses the IDF UART driver: frames are copied into its TX ring buffer and sent by interrupt,
+// each frame is followed by a break (and mark after break) generated by the UART itself
+#define DMX_TX_BUFFER  1024     // must be larger than one frame
+#define BREAK_BITS     25       // 100us break at 250kbaud (min. 88us)
+#define MAB_BITS       3        // 12us mark after break (min. 8us)
+
+static uart_port_t dmxUart = UART_NUM_2; // set by initWrite(), must not be the UART used by DMX input
+
 static const int enablePin = -1;		// disable the enable pin because it is not needed
 static const int rxPin = -1;       // disable the receiving pin because it is not needed - softhack007: Pin=-1 means "use default" not "disable"
 static const int txPin = 2;        // transmit DMX data over this pin (default is pin 2)
@@ -102,7 +111,7 @@ void SparkFunDMX::initRead(int chanQuant) {
 #endif
 
 // Set up the DMX-Protocol
-void SparkFunDMX::initWrite (int chanQuant) {
+void SparkFunDMX::initWrite (int chanQuant, int uartNum) {
 
   _READWRITE = _WRITE;
   if (chanQuant > dmxMaxChannel || chanQuant <= 0) {
@@ -110,8 +119,19 @@ void SparkFunDMX::initWrite (int chanQuant) {
   }
 
   chanSize = chanQuant + 1; //Add 1 for start code
-
-  DMXSerial.begin(DMXSPEED, DMXFORMAT, rxPin, txPin);
+  if (uartNum > 0 && uartNum < SOC_UART_NUM) dmxUart = (uart_port_t)uartNum; // UART 0 is the console
+
+  uart_config_t config = {};
+  config.baud_rate = DMXSPEED;
+  config.data_bits = UART_DATA_8_BITS;
+  config.parity    = UART_PARITY_DISABLE;
+  config.stop_bits = UART_STOP_BITS_2;
+  config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+  if (!uart_is_driver_installed(dmxUart)) uart_driver_install(dmxUart, 256, DMX_TX_BUFFER, 0, NULL, 0);
+  uart_param_config(dmxUart, &config);
+  uart_set_pin(dmxUart, txPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  uart_set_tx_idle_num(dmxUart, MAB_BITS);
+  uart_write_bytes_with_break(dmxUart, (const char *)dmxData, 1, BREAK_BITS); // break before first frame (lone byte is ignored by receivers)
   if (enablePin >= 0) {
     pinMode(enablePin, OUTPUT);
     digitalWrite(enablePin, HIGH);
@@ -134,24 +154,28 @@ void SparkFunDMX::write(int Channel, uint8_t value) {
   dmxData[Channel] = value; //add one to account for start byte
 }
 
+// sets channels 1 to channels at once
+void SparkFunDMX::write(const uint8_t *values, int channels) {
+  if (channels > dmxMaxChannel) channels = dmxMaxChannel;
+  if (channels <= 0) return;
+  if (channels + 1 > chanSize) chanSize = channels + 1;
+  dmxData[0] = 0;
+  memcpy(dmxData + 1, values, channels);
+}
+
+// previous frame has been sent completely
+bool SparkFunDMX::ready() {
+  return _READWRITE != _WRITE || uart_wait_tx_done(dmxUart, 0) == ESP_OK;
+}
+
 
 
 void SparkFunDMX::update() {
   if (_READWRITE == _WRITE)
   {
-    //Send DMX break
-    digitalWrite(txPin, HIGH);
-    DMXSerial.begin(BREAKSPEED, BREAKFORMAT, rxPin, txPin);//Begin the Serial port
-    DMXSerial.write(0);
-    DMXSerial.flush();
-    delay(1);
-    DMXSerial.end();
-    
-    //Send DMX data
-    DMXSerial.begin(DMXSPEED, DMXFORMAT, rxPin, txPin);//Begin the Serial port
-    DMXSerial.write(dmxData, chanSize);
-    DMXSerial.flush();
-    DMXSerial.end();//clear our DMX array, end the Hardware Serial port
+    //Send DMX data followed by break (does not wait for transmission), frame is dropped if previous one is still being sent
+    if (uart_wait_tx_done(dmxUart, 0) != ESP_OK) return;
+    uart_write_bytes_with_break(dmxUart, (const char *)dmxData, chanSize, BREAK_BITS);
   }
 #if !defined(DMX_SEND_ONLY)
   else if (_READWRITE == _READ)//In a perfect world, this function ends serial communication upon packet completion and attaches RX to a CHANGE interrupt so the start code can be read again
@@ -25,12 +25,14 @@ Distributed as-is; no warranty is given.
 
 class SparkFunDMX {
 public:
-  void initWrite(int maxChan);
+  void initWrite(int maxChan, int uartNum = 2);
 #if !defined(DMX_SEND_ONLY)
   void initRead(int maxChan);
   uint8_t read(int Channel);
 #endif
   void write(int channel, uint8_t value);
+  void write(const uint8_t *values, int channels);
+  bool ready();
   void update();
 private:
   const uint8_t _startCodeValue = 0xFF;
@@ -0,0 +1,181 @@
+#include "wled.h"
+
+/*
+ * Timebase synchronization between nodes (NTP style offset and skew estimation over the notifier port)
+ *
+ * A node applying effect sync from another node (reference) polls it with its local time t1. The reference answers
+ * with its effect clock (strip time) at reception (t2) and at transmission (t3), the answer arrives at local time t4.
+ * offset = ((t2-t1) + (t3-t4)) / 2, round trip delay = (t4-t1) - (t3-t2)
+ * Only samples with near minimal round trip are used as WiFi queueing mostly delays one direction.
+ * Offset and clock skew are tracked by a PI loop and strip.timebase is slewed towards the estimate
+ * (at most 5% rate change) so effects do not jump. While locked, notifications no longer set the timebase directly.
+ */
+
+#define TIMESYNC_SIZE       28
+#define TIMESYNC_REQUEST    0
+#define TIMESYNC_REPLY      1
+#define TIMESYNC_POLL_FAST  1000    // poll interval (ms) until locked
+#define TIMESYNC_POLL       4000    // poll interval (ms) when locked
+#define TIMESYNC_TIMEOUT    30000   // lock is lost if reference does not answer for this long (ms)
+#define TIMESYNC_LOCK       4       // accepted samples needed for lock
+#define TIMESYNC_STEP_US    50000   // offset error that causes reacquisition (timebase jump)
+#define TIMESYNC_MAX_SKEW   500.0f  // ppm
+
+static IPAddress     tsRef;             // reference node (sender of applied effect notifications)
+static int64_t       tsOffsetUs = 0;    // estimated reference strip time - local time at tsEstAt
+static int64_t       tsEstAt = 0;       // local time (us) of last estimate
+static float         tsSkewPpm = 0;     // reference clock rate relative to local clock
+static int64_t       tsReqT1 = 0;       // local time of pending request
+static uint32_t      tsMinDelayUs = UINT32_MAX;
+static uint32_t      tsDelayUs = 0;     // round trip of last sample
+static int32_t       tsErrUs = 0;       // offset error of last accepted sample
+static uint16_t      tsSamples = 0;
+static uint16_t      tsRejected = 0;
+static uint8_t       tsSeq = 0;
+static bool          tsLocked = false;
+static unsigned long tsLastPoll = 0;
+static unsigned long tsLastReply = 0;
+static unsigned long tsLastSlew = 0;
+
+// local monotonic clock
+int64_t timeSyncClock() {
+  #ifdef ESP8266
+  return micros64();
+  #else
+  return esp_timer_get_time();
+  #endif
+}
+
+// effect clock (strip.now) in us, strip.timebase is a ms offset modulo 2^32
+static inline int64_t stripTimeUs(int64_t localUs) {
+  return localUs + (int64_t)strip.timebase * 1000;
+}
+
+static inline void putInt64(uint8_t *p, int64_t v) { for (unsigned i = 0; i < 8; i++) p[i] = (uint64_t)v >> (8*i); }
+static inline int64_t getInt64(const uint8_t *p) { uint64_t v = 0; for (unsigned i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8*i); return v; }
+
+static void resetTimeSync() {
+  tsLocked = false;
+  tsSamples = 0;
+  tsRejected = 0;
+  tsSkewPpm = 0;
+  tsMinDelayUs = UINT32_MAX;
+  tsReqT1 = 0;
+}
+
+// called for every applied notification, the sender becomes the reference
+void timeSyncReference(IPAddress ip) {
+  if (ip == IPAddress(0,0,0,0) || ip == tsRef) return;
+  tsRef = ip;
+  resetTimeSync();
+  tsLastReply = millis();
+  tsLastPoll = 0;
+}
+
+bool timeSyncLocked(IPAddress ip) {
+  return tsLocked && ip == tsRef;
+}
+
+static int64_t estimatedOffset(int64_t localUs) {
+  return tsOffsetUs + (int64_t)(tsSkewPpm * (float)(localUs - tsEstAt) / 1e6f);
+}
+
+static void processSample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+  int64_t delay = (t4 - t1) - (t3 - t2);
+  if (delay < 0) delay = 0;
+  const int64_t offset = ((t2 - t1) + (t3 - t4)) / 2;
+  tsDelayUs = delay;
+  tsLastReply = millis();
+
+  // minimum round trip follows slowly upwards so that a changed network path is accepted eventually
+  tsMinDelayUs = tsMinDelayUs == UINT32_MAX ? (uint32_t)delay : min((uint32_t)delay, tsMinDelayUs + tsMinDelayUs/32 + 50);
+  if (tsSamples && delay > tsMinDelayUs + tsMinDelayUs/2 + 1000) { tsRejected++; return; }
+
+  const int64_t err = offset - estimatedOffset(t4);
+  if (!tsSamples || llabs(err) > TIMESYNC_STEP_US) {
+    // (re)acquire
+    tsOffsetUs = offset;
+    tsSkewPpm  = 0;
+    tsEstAt    = t4;
+    tsErrUs    = 0;
+    tsSamples  = 1;
+    tsLastSlew = 0; // jump
+    return;
+  }
+  const float dt = (float)(t4 - tsEstAt);
+  tsOffsetUs = estimatedOffset(t4) + err / 4;
+  if (dt > 0) tsSkewPpm = constrain(tsSkewPpm + (float)err * 1e6f / dt / 8.0f, -TIMESYNC_MAX_SKEW, TIMESYNC_MAX_SKEW);
+  tsEstAt = t4;
+  tsErrUs = err;
+  if (tsSamples < UINT16_MAX) tsSamples++;
+  if (tsSamples >= TIMESYNC_LOCK) tsLocked = true;
+}
+
+// time sync request or reply received on notifier port, rxUs is local time of reception
+void handleTimeSyncPacket(const uint8_t *data, size_t len, IPAddress ip, int64_t rxUs) {
+  if (len < TIMESYNC_SIZE || data[0] != TIMESYNC_MAGIC) return;
+  if (data[1] == TIMESYNC_REQUEST) {
+    uint8_t reply[TIMESYNC_SIZE];
+    memcpy(reply, data, 12); // magic, type, seq, reserved, t1
+    reply[1] = TIMESYNC_REPLY;
+    putInt64(reply + 12, stripTimeUs(rxUs));
+    putInt64(reply + 20, stripTimeUs(timeSyncClock()));
+    notifierUdp.beginPacket(ip, udpPort);
+    notifierUdp.write(reply, sizeof(reply));
+    notifierUdp.endPacket();
+  } else if (data[1] == TIMESYNC_REPLY) {
+    if (!(ip == tsRef) || data[2] != tsSeq || !tsReqT1 || getInt64(data + 4) != tsReqT1) return; // stale or foreign reply
+    processSample(tsReqT1, getInt64(data + 12), getInt64(data + 20), rxUs);
+    tsReqT1 = 0;
+  }
+}
+
+// polls reference and slews strip.timebase towards estimate
+void handleTimeSync() {
+  if (!udpConnected || tsRef == IPAddress(0,0,0,0)) return;
+  const unsigned long now = millis();
+  if (now - tsLastReply > TIMESYNC_TIMEOUT) {
+    if (tsLocked) DEBUG_PRINTLN(F("Time sync: reference lost."));
+    tsRef = IPAddress(0,0,0,0);
+    resetTimeSync();
+    return;
+  }
+  if (now - tsLastPoll > (tsLocked ? TIMESYNC_POLL : TIMESYNC_POLL_FAST)) {
+    tsLastPoll = now;
+    uint8_t req[TIMESYNC_SIZE] = {TIMESYNC_MAGIC, TIMESYNC_REQUEST, ++tsSeq, 0};
+    tsReqT1 = timeSyncClock();
+    putInt64(req + 4, tsReqT1);
+    notifierUdp.beginPacket(tsRef, udpPort);
+    notifierUdp.write(req, sizeof(req));
+    notifierUdp.endPacket();
+  }
+
+  if (!tsLocked || (tsLastSlew && now - tsLastSlew < 20)) return;
+  const int64_t localUs = timeSyncClock();
+  const unsigned long target = (unsigned long)((localUs + estimatedOffset(localUs)) / 1000) - millis();
+  const int32_t diff = (int32_t)(target - strip.timebase);
+  if (!tsLastSlew || abs(diff) > 500) strip.timebase = target; // acquisition or large step
+  else {
+    const int32_t maxStep = (now - tsLastSlew) / 20; // 5% clock rate change
+    strip.timebase += constrain(diff, -maxStep, maxStep);
+  }
+  tsLastSlew = now;
+}
+
+// statistics for /json/info: offset error and round trip (us), skew (ppm), pending slew (ms)
+void serializeTimeSync(JsonObject root) {
+  JsonObject ts = root.createNestedObject(F("tsync"));
+  ts[F("lock")] = tsLocked;
+  if (tsRef == IPAddress(0,0,0,0)) return;
+  ts[F("ref")]  = tsRef.toString();
+  ts[F("err")]  = tsErrUs;
+  ts[F("rtt")]  = tsDelayUs;
+  ts[F("skew")] = tsSkewPpm;
+  ts["n"]       = tsSamples;
+  ts[F("rej")]  = tsRejected;
+  if (tsLocked) {
+    const int64_t localUs = timeSyncClock();
+    const unsigned long target = (unsigned long)((localUs + estimatedOffset(localUs)) / 1000) - millis();
+    ts[F("slew")] = (int32_t)(target - strip.timebase);
+  }
+}
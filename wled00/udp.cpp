@@ -4,11 +4,9 @@
  * UDP sync notifier / Realtime / Hyperion / TPM2.NET
  */
 
-#define UDP_SEG_SIZE 36
-#define SEG_OFFSET (41)
-#define WLEDPACKETSIZE (41+(WS2812FX::getMaxSegments()*UDP_SEG_SIZE)+0)
 #define UDP_IN_MAXSIZE 1472
 #define PRESUMED_NETWORK_DELAY 3 //how many ms could it take on avg to reach the receiver? This will be added to transmitted times
+#define UDP_LEGACY_HOLD 600000 // keep sending v12 packets for 10 min after a v12 only node was heard
 
 typedef struct PartialEspNowPacket {
   uint8_t magic;
@@ -17,6 +15,23 @@ typedef struct PartialEspNowPacket {
   uint8_t data[247];
 } partial_packet_t;
 
+// compact sync (v13) state, see udp_compact.h
+static CompactSyncEncoder syncTx;
+static CompactSyncDecoder syncRx;
+static unsigned long syncLegacySeen = 0; // millis() when a v12 only notification was last received, 0 if never
+static unsigned long syncRxNackTime = 0;
+
+// sends state as compact (v13) packet, returns false if packet could not be built (out of memory)
+static bool sendCompactNotify(const uint8_t *udpOut, size_t len, bool followUp, IPAddress ip) {
+  size_t pktLen;
+  const uint8_t *pkt = syncTx.encode(udpOut, len, followUp, syncGroups, pktLen);
+  if (!pkt) return false;
+  notifierUdp.beginPacket(ip, udpPort);
+  notifierUdp.write(pkt, pktLen);
+  notifierUdp.endPacket();
+  return true;
+}
+
 void notify(byte callMode, bool followUp)
 {
 #ifndef WLED_DISABLE_ESPNOW
@@ -56,8 +71,8 @@ void notify(byte callMode, bool followUp)
   //3: supports FX intensity, 24 byte packet 4: supports transitionDelay 5: sup palette
   //6: supports timebase syncing, 29 byte packet 7: supports tertiary color 8: supports sys time sync, 36 byte packet
   //9: supports sync groups, 37 byte packet 10: supports CCT, 39 byte packet 11: per segment options, variable packet length (40+WS2812FX::getMaxSegments()*3)
-  //12: enhanced effect sliders, 2D & mapping options
-  udpOut[11] = 12;
+  //12: enhanced effect sliders, 2D & mapping options 13: understands compact delta packets (UDP_COMPACT_MAGIC)
+  udpOut[11] = 13;
   col = mainseg.colors[1];
   udpOut[12] = R(col);
   udpOut[13] = G(col);
@@ -145,6 +160,7 @@ void notify(byte callMode, bool followUp)
     udpOut[35+ofs] = selseg.stopY & 0xFF;
     ++s;
   }
+  const size_t udpLen = SEG_OFFSET + s*UDP_SEG_SIZE; // used part of the packet, receivers only read active segments
 
   //uint16_t offs = SEG_OFFSET;
   //next value to be added has index: udpOut[offs + 0]
@@ -197,16 +213,22 @@ void notify(byte callMode, bool followUp)
   {
     DEBUG_PRINTLN(F("UDP sending packet."));
     IPAddress broadcastIp = ~uint32_t(Network.subnetMask()) | uint32_t(Network.gatewayIP());
-    notifierUdp.beginPacket(broadcastIp, udpPort);
-    notifierUdp.write(udpOut, WLEDPACKETSIZE); // TODO: add actual used buffer size
-    notifierUdp.endPacket();
+    bool sendLegacy = !udpCompactSync || !sendCompactNotify(udpOut, udpLen, followUp, broadcastIp);
+    // receive-only older nodes are never heard: plain packets are sent until the user disables them
+    // nodes that only understand v12 have been heard recently, keep them in sync regardless
+    if (udpLegacySync || (syncLegacySeen && millis() - syncLegacySeen < UDP_LEGACY_HOLD)) sendLegacy = true;
+    if (sendLegacy) {
+      notifierUdp.beginPacket(broadcastIp, udpPort);
+      notifierUdp.write(udpOut, udpLen);
+      notifierUdp.endPacket();
+    }
   }
   notificationSentCallMode = callMode;
   notificationSentTime = millis();
   notificationCount = followUp ? notificationCount + 1 : 0;
 }
 
-static void parseNotifyPacket(const uint8_t *udpIn) {
+static void parseNotifyPacket(const uint8_t *udpIn, IPAddress from = IPAddress(0,0,0,0)) {
   //ignore notification if received within a second after sending a notification ourselves
   if (millis() - notificationSentTime < 1000) return;
   if (udpIn[1] > 199) return; //do not receive custom versions
@@ -214,6 +236,7 @@ static void parseNotifyPacket(const uint8_t *udpIn) {
   //compatibilityVersionByte:
   byte version = udpIn[11];
   DEBUG_PRINTF_P(PSTR("UDP packet version: %d\n"), (int)version);
+  if (version < 13) syncLegacySeen = max(millis(), 1UL);
 
   // if we are not part of any sync group ignore message
   if (version < 9) {
@@ -368,7 +391,8 @@ static void parseNotifyPacket(const uint8_t *udpIn) {
     stateChanged = true;
   }
 
-  if (applyEffects && version > 5) {
+  if (applyEffects && version > 5) timeSyncReference(from); // poll sender for precise offset
+  if (applyEffects && version > 5 && !timeSyncLocked(from)) { // slewed by handleTimeSync() when locked
     uint32_t t = (udpIn[25] << 24) | (udpIn[26] << 16) | (udpIn[27] << 8) | (udpIn[28]);
     t += PRESUMED_NETWORK_DELAY; //adjust trivially for network delay
     t -= millis();
@@ -406,6 +430,31 @@ static void parseNotifyPacket(const uint8_t *udpIn) {
   stateUpdated(CALL_MODE_NOTIFICATION);
 }
 
+// asks sender of compact sync packets for a keyframe (at most once per second)
+static void requestSyncKeyframe(IPAddress ip) {
+  if (millis() - syncRxNackTime < 1000) return;
+  syncRxNackTime = millis();
+  const uint8_t nack[UDP_COMPACT_HDR] = {UDP_COMPACT_MAGIC, UDP_COMPACT_NACK, syncRx.getSeq(), receiveGroups};
+  notifierUdp.beginPacket(ip, udpPort);
+  notifierUdp.write(nack, sizeof(nack));
+  notifierUdp.endPacket();
+}
+
+// applies compact (v13) packet like a v12 notification or answers a keyframe request
+static void parseCompactPacket(const uint8_t *udpIn, size_t len, IPAddress ip) {
+  if (len < UDP_COMPACT_HDR) return;
+  if (udpIn[1] & UDP_COMPACT_NACK) {
+    if (udpCompactSync && (syncGroups & udpIn[3])) syncTx.requestKeyframe();
+    return;
+  }
+  if (!(receiveGroups & udpIn[3]) || realtimeMode) return;
+  switch (syncRx.decode(udpIn, len, ip)) {
+    case CompactSyncDecoder::Applied: parseNotifyPacket(syncRx.image(), ip); break;
+    case CompactSyncDecoder::Lost:    requestSyncKeyframe(ip); break;
+    default: break;
+  }
+}
+
 // realtimeLock() is called from UDP notifications, JSON API or serial Ada
 void realtimeLock(uint32_t timeoutMs, byte md)
 {
@@ -473,6 +522,11 @@ void handleNotifications()
   if(udpConnected && (notificationCount < udpNumRetries) && ((millis()-notificationSentTime) > 250)){
     notify(notificationSentCallMode,true);
   }
+  //a receiver of compact sync lost a packet, send current state as keyframe
+  if (syncTx.isKeyframeRequested() && udpConnected && millis()-notificationSentTime > 100) {
+    if (notificationSentCallMode != CALL_MODE_INIT) notify(notificationSentCallMode);
+    syncTx.clearKeyRequest();
+  }
 
   if (e131NewData && millis() - strip.getLastShow() > 15)
   {
@@ -489,6 +543,7 @@ void handleNotifications()
 
   bool isSupp = false;
   size_t packetSize = notifierUdp.parsePacket();
+  const int64_t rxUs = timeSyncClock(); // reception time for time sync
   if (!packetSize && udp2Connected) {
     packetSize = notifier2Udp.parsePacket();
     isSupp = true;
@@ -530,38 +585,45 @@ void handleNotifications()
   if (isSupp && udpIn[0] == 255 && udpIn[1] == 1 && len >= 40) {
     if (!nodeListEnabled || notifier2Udp.remoteIP() == localIP) return;
 
-    unsigned unit = udpIn[39];
-    NodesMap::iterator it = Nodes.find(unit);
-    if (it == Nodes.end() && Nodes.size() < WLED_MAX_NODES) { // Create a new element when not present
-      Nodes[unit].age = 0;
-      it = Nodes.find(unit);
-    }
-
-    if (it != Nodes.end()) {
-      for (size_t x = 0; x < 4; x++) {
-        it->second.ip[x] = udpIn[x + 2];
-      }
-      it->second.age = 0; // reset 'age counter'
-      char tmpNodeName[33] = { 0 };
-      memcpy(&tmpNodeName[0], reinterpret_cast<byte *>(&udpIn[6]), 32);
-      tmpNodeName[32]     = 0;
-      it->second.nodeName = tmpNodeName;
-      it->second.nodeName.trim();
-      it->second.nodeType = udpIn[38];
+    // nodes are keyed by their full IP (last octet alone collides across subnets), oldest node is replaced when full
+    NodeStruct *node = Nodes.insert(IPAddress(udpIn[2], udpIn[3], udpIn[4], udpIn[5]));
+    if (node) {
+      node->age = 0; // reset 'age counter'
+      memcpy(node->nodeName, &udpIn[6], NODE_NAME_LEN);
+      node->nodeName[NODE_NAME_LEN] = 0;
+      for (int i = strlen(node->nodeName) - 1; i >= 0 && isspace(node->nodeName[i]); i--) node->nodeName[i] = 0; // trim
+      unsigned lead = 0;
+      while (isspace(node->nodeName[lead])) lead++;
+      if (lead) memmove(node->nodeName, node->nodeName + lead, strlen(node->nodeName + lead) + 1);
+      node->nodeType = udpIn[38];
       uint32_t build = 0;
       if (len >= 44)
         for (size_t i=0; i<sizeof(uint32_t); i++)
           build |= udpIn[40+i]<<(8*i);
-      it->second.build = build;
+      node->build = build;
     }
     return;
   }
 
+  //timebase sync request/reply
+  if (udpIn[0] == TIMESYNC_MAGIC && !isSupp) {
+    handleTimeSyncPacket(udpIn, len, notifierUdp.remoteIP(), rxUs);
+    return;
+  }
+
+  //compact wled notifier (v13) or keyframe request
+  if (udpIn[0] == UDP_COMPACT_MAGIC && !isSupp) {
+    parseCompactPacket(udpIn, len, notifierUdp.remoteIP());
+    return;
+  }
+
   //wled notifier, ignore if realtime packets active
   if (udpIn[0] == 0 && !realtimeMode && receiveGroups)
   {
+    // a v13 sender also sends compact packets, its plain copy has already been applied from those
+    if (udpIn[11] >= 13 && syncRx.isFollowing(notifierUdp.remoteIP())) return;
     DEBUG_PRINTF_P(PSTR("UDP notification from: %d.%d.%d.%d\n"), notifierUdp.remoteIP()[0], notifierUdp.remoteIP()[1], notifierUdp.remoteIP()[2], notifierUdp.remoteIP()[3]);
-    parseNotifyPacket(udpIn);
+    parseNotifyPacket(udpIn, notifierUdp.remoteIP());
     return;
   }
 
@@ -683,21 +745,7 @@ void setRealtimePixel(uint16_t i, byte r, byte g, byte b, byte w)
 \*********************************************************************************************/
 void refreshNodeList()
 {
-  for (NodesMap::iterator it = Nodes.begin(); it != Nodes.end();) {
-    bool mustRemove = true;
-
-    if (it->second.ip[0] != 0) {
-      if (it->second.age < 10) {
-        it->second.age++;
-        mustRemove = false;
-        ++it;
-      }
-    }
-
-    if (mustRemove) {
-      it = Nodes.erase(it);
-    }
-  }
+  Nodes.age(NODE_MAX_AGE + 1);
 }
 
 /*********************************************************************************************\
@@ -955,6 +1003,9 @@ void espNowReceiveCB(uint8_t* address, uint8_t* data, uint8_t len, signed int rs
     return;
   }
 
+  // realtime pixel stream, processed in loop()
+  if (espNowStreamReceive(data, len)) return;
+
   // handle WiZ Mote data
   if (data[0] == 0x91 || data[0] == 0x81 || data[0] == 0x80) {
     handleWiZdata(data, len);
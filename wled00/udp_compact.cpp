@@ -0,0 +1,122 @@
+#include "wled.h"
+
+/*
+ * Compact sync (v13) encoder and decoder (see udp_compact.h), sending and receiving is done in udp.cpp
+ */
+
+// appends bitmap of bytes of cur differing from prev (1 bit per byte) followed by these bytes, updates prev
+// returns number of bytes written, 0 if nothing changed
+static size_t encodeDelta(uint8_t *out, const uint8_t *cur, uint8_t *prev, size_t len) {
+  const size_t mapLen = (len + 7) / 8;
+  memset(out, 0, mapLen);
+  size_t n = mapLen;
+  for (size_t i = 0; i < len; i++) {
+    if (cur[i] == prev[i]) continue;
+    out[i >> 3] |= 1 << (i & 7);
+    out[n++] = prev[i] = cur[i];
+  }
+  return n > mapLen ? n : 0;
+}
+
+// applies delta written by encodeDelta(), returns number of bytes consumed or 0 if input is truncated
+static size_t decodeDelta(const uint8_t *in, size_t avail, uint8_t *img, size_t len) {
+  const size_t mapLen = (len + 7) / 8;
+  if (avail < mapLen) return 0;
+  size_t n = mapLen;
+  for (size_t i = 0; i < len; i++) {
+    if (!(in[i >> 3] & (1 << (i & 7)))) continue;
+    if (n >= avail) return 0;
+    img[i] = in[n++];
+  }
+  return n;
+}
+
+const uint8_t *CompactSyncEncoder::encode(const uint8_t *udpOut, size_t len, bool followUp, uint8_t groups, size_t &pktLen) {
+  if (!_img) _img = static_cast<uint8_t*>(malloc(WLEDPACKETSIZE));
+  if (!_pkt) _pkt = static_cast<uint8_t*>(malloc(UDP_COMPACT_MAXSIZE));
+  if (!_img || !_pkt) return nullptr;
+
+  if (!followUp || !_len) {
+    const size_t nsegs = (len - SEG_OFFSET) / UDP_SEG_SIZE;
+    bool key = !_len || _keyRequested || _deltas >= UDP_KEYFRAME_DELTAS || millis() - _keyTime > UDP_KEYFRAME_MS;
+    size_t n = UDP_COMPACT_HDR;
+    if (!key) {
+      size_t d = encodeDelta(_pkt + n, udpOut, _img, SEG_OFFSET);
+      n += d ? d : (SEG_OFFSET + 7) / 8; // empty bitmap if header did not change
+      for (size_t i = 0; i < nsegs; i++) {
+        const size_t ofs = SEG_OFFSET + i*UDP_SEG_SIZE;
+        _pkt[n] = i;
+        d = encodeDelta(_pkt + n + 1, udpOut + ofs, _img + ofs, UDP_SEG_SIZE);
+        if (d) n += 1 + d;
+      }
+      key = n >= UDP_COMPACT_HDR + len; // delta does not pay off
+      _deltas++;
+    }
+    if (key) {
+      memcpy(_pkt + UDP_COMPACT_HDR, udpOut, len);
+      memcpy(_img, udpOut, len);
+      memset(_img + len, 0, WLEDPACKETSIZE - len); // receivers clear unused segments as well
+      n = UDP_COMPACT_HDR + len;
+      _deltas = 0;
+      _keyTime = millis();
+      _keyRequested = false;
+    }
+    _pkt[0] = UDP_COMPACT_MAGIC;
+    _pkt[1] = key ? UDP_COMPACT_KEY : 0;
+    _pkt[2] = ++_seq;
+    _pkt[3] = groups;
+    _len = n;
+  } else {
+    _pkt[1] |= UDP_COMPACT_FOLLOWUP;
+  }
+  pktLen = _len;
+  return _pkt;
+}
+
+// a missing sequence number, a different sender or a malformed delta invalidate the image until next keyframe
+CompactSyncDecoder::Result CompactSyncDecoder::decode(const uint8_t *udpIn, size_t len, IPAddress ip) {
+  if (len < UDP_COMPACT_HDR) return Ignored;
+  const uint8_t flags = udpIn[1];
+  const uint8_t seq   = udpIn[2];
+  if (!_img) _img = static_cast<uint8_t*>(malloc(WLEDPACKETSIZE));
+  if (!_img) return Ignored;
+  if (!(ip == _ip)) {
+    _ip = ip;
+    _valid = false;
+  }
+  const uint8_t *in = udpIn + UDP_COMPACT_HDR;
+  size_t avail = len - UDP_COMPACT_HDR;
+  if (_valid && seq == _seq) return Ignored; // retransmission
+
+  if (flags & UDP_COMPACT_KEY) {
+    if (avail < SEG_OFFSET || in[40] != UDP_SEG_SIZE) return Ignored;
+    const size_t nsegs = min((size_t)in[39], (size_t)WS2812FX::getMaxSegments());
+    const size_t imgLen = SEG_OFFSET + nsegs * UDP_SEG_SIZE;
+    if (avail < imgLen) return Ignored;
+    memcpy(_img, in, imgLen);
+    memset(_img + imgLen, 0, WLEDPACKETSIZE - imgLen);
+  } else {
+    if (!_valid || seq != uint8_t(_seq + 1)) {
+      if (_valid) _gaps++;
+      DEBUG_PRINTF_P(PSTR("UDP sync gap: %u -> %u (%u)\n"), (unsigned)_seq, (unsigned)seq, (unsigned)_gaps);
+      _valid = false;
+      return Lost;
+    }
+    size_t n = decodeDelta(in, avail, _img, SEG_OFFSET);
+    while (n && n < avail) {
+      const unsigned id = in[n];
+      if (id >= WS2812FX::getMaxSegments()) { n = 0; break; }
+      const size_t d = decodeDelta(in + n + 1, avail - n - 1, _img + SEG_OFFSET + id*UDP_SEG_SIZE, UDP_SEG_SIZE);
+      n = d ? n + 1 + d : 0;
+    }
+    if (!n || _img[40] != UDP_SEG_SIZE || _img[39] > WS2812FX::getMaxSegments()) {
+      DEBUG_PRINTLN(F("UDP sync malformed delta."));
+      _valid = false;
+      return Lost;
+    }
+  }
+  _seq = seq;
+  _valid = true;
+  _time = millis();
+  return Applied;
+}
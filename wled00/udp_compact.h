@@ -0,0 +1,64 @@
+#ifndef WLED_UDP_COMPACT_H
+#define WLED_UDP_COMPACT_H
+
+/*
+ * Compact sync (v13): only changed bytes of the v12 notifier packet image are sent
+ * Keyframes carry the used part of the v12 image, delta packets only the bytes changed since the previous packet
+ * (header bitmap + bytes, then index, bitmap and bytes of changed segments). Packets start with a 4 byte header:
+ * magic, flags, sequence number, sync groups. Receivers keep the sender's image and rebuild the v12 packet from it.
+ */
+
+#define UDP_SEG_SIZE 36
+#define SEG_OFFSET (41)
+#define WLEDPACKETSIZE (41+(WS2812FX::getMaxSegments()*UDP_SEG_SIZE)+0)
+
+#define UDP_COMPACT_HDR      4      // magic, flags, sequence number, sync groups
+#define UDP_COMPACT_MAXSIZE  (UDP_COMPACT_HDR+6+SEG_OFFSET+(WS2812FX::getMaxSegments()*(1+5+UDP_SEG_SIZE)))
+#define UDP_COMPACT_KEY      0x01   // packet holds full image (keyframe)
+#define UDP_COMPACT_FOLLOWUP 0x02   // retransmission of previous packet
+#define UDP_COMPACT_NACK     0x80   // receiver lost a packet and requests a keyframe
+#define UDP_KEYFRAME_MS      10000  // max. time between keyframes
+#define UDP_KEYFRAME_DELTAS  16     // max. delta packets between keyframes
+
+// sender side: turns v12 images into compact packets
+class CompactSyncEncoder {
+  public:
+    ~CompactSyncEncoder() { free(_img); free(_pkt); }
+    // builds packet for v12 image udpOut (len bytes used), a follow-up resends the previous packet
+    // returns packet or nullptr if out of memory
+    const uint8_t *encode(const uint8_t *udpOut, size_t len, bool followUp, uint8_t groups, size_t &pktLen);
+    inline void requestKeyframe()              { _keyRequested = true; }
+    inline void clearKeyRequest()              { _keyRequested = false; }
+    inline bool isKeyframeRequested() const    { return _keyRequested; }
+  private:
+    uint8_t *_img = nullptr;  // v12 image of last sent state (identical to receivers' image)
+    uint8_t *_pkt = nullptr;  // last sent packet (for retransmissions)
+    size_t   _len = 0;
+    uint8_t  _seq = 0;
+    uint8_t  _deltas = 0;     // delta packets since last keyframe
+    bool     _keyRequested = false;
+    unsigned long _keyTime = 0;
+};
+
+// receiver side: rebuilds the v12 image of a single sender, another sender needs a keyframe first
+class CompactSyncDecoder {
+  public:
+    enum Result : uint8_t { Ignored, Applied, Lost }; // Lost: image is invalid until next keyframe, request one
+    ~CompactSyncDecoder() { free(_img); }
+    // applies packet (without NACK flag) from ip, image() holds the rebuilt v12 packet if Applied
+    Result decode(const uint8_t *udpIn, size_t len, IPAddress ip);
+    inline const uint8_t *image() const        { return _img; }
+    inline uint8_t  getSeq() const             { return _seq; }
+    inline uint16_t getGaps() const            { return _gaps; }
+    // image of ip is valid and was updated within the last two keyframe periods
+    inline bool isFollowing(IPAddress ip) const { return _valid && millis() - _time < 2*UDP_KEYFRAME_MS && ip == _ip; }
+  private:
+    uint8_t  *_img = nullptr;
+    IPAddress _ip;
+    uint8_t   _seq = 0;
+    bool      _valid = false;
+    uint16_t  _gaps = 0;
+    unsigned long _time = 0;   // millis() of last compact packet from _ip
+};
+
+#endif
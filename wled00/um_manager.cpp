@@ -18,10 +18,90 @@ static size_t getCount() {
 }
 
 
+// Loop accounting and scheduling
+// Usermods returning 0 from getLoopPeriod() are due on every pass, periodic usermods when their period has elapsed.
+// Due usermods take turns in a rotating order. A usermod runs if its expected cost (the peak of this and the last
+// window, work done only now and then is not averaged away) fits into the remaining per-pass budget. One usermod per
+// pass may run without fitting (unknown cost counts as not fitting), the others wait for a later pass. A pass thereby
+// stays within the budget plus the cost of one usermod and slow usermods never run back to back.
+#ifndef WLED_USERMOD_LOOP_BUDGET
+  #define WLED_USERMOD_LOOP_BUDGET 3000 // us per WLED loop pass for all usermods
+#endif
+#define UM_STATS_WINDOW 10000           // ms, CPU share is computed over this window
+
+typedef struct UsermodStats {
+  unsigned long lastRun;  // millis() of last loop() call
+  uint32_t windowUs;      // time spent in current window
+  uint16_t avgUs;         // moving average of loop() cost (saturates at 65ms)
+  uint16_t maxUs;         // max. loop() cost in last window
+  uint16_t peakUs;        // max. loop() cost in this and the last window (expected cost)
+  uint16_t share;         // CPU share in last window (per mille)
+  uint16_t deferred;      // number of deferred runs in last window
+  bool     measured;      // loop() has run at least once
+} usermodStats;
+
+static usermodStats *_umStats = nullptr;
+static unsigned long _umWindowStart = 0;
+
+static inline void runUsermodLoop(Usermod *mod, usermodStats &st, unsigned long now) {
+  unsigned long start = micros();
+  mod->loop();
+  unsigned us = std::min(micros() - start, 65535UL);
+  st.lastRun = now;
+  st.windowUs += us;
+  st.avgUs = (st.avgUs * 7U + us) / 8U;
+  if (us > st.maxUs) st.maxUs = us;
+  if (us > st.peakUs) st.peakUs = us;
+  st.measured = true;
+}
+
+void UsermodManager::loop() {
+  if (!_umStats) { // no accounting possible
+    for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) (*mod)->loop();
+    return;
+  }
+  const unsigned long now = millis();
+  if (now - _umWindowStart >= UM_STATS_WINDOW) {
+    const unsigned long window = now - _umWindowStart;
+    for (size_t i = 0; i < getCount(); i++) {
+      _umStats[i].share = std::min(_umStats[i].windowUs / window, 1000UL); // us/ms = per mille
+      _umStats[i].windowUs = 0;
+      _umStats[i].peakUs = _umStats[i].maxUs;
+      _umStats[i].maxUs = 0;
+      _umStats[i].deferred = 0;
+    }
+    _umWindowStart = now;
+  }
+
+  const unsigned long passStart = micros();
+  const size_t count = getCount();
+  bool overrun = false; // a usermod that did not fit has run in this pass
+  // starting point rotates so that every due usermod gets its turn to run without fitting
+  static size_t first = 0;
+  for (size_t n = 0; n < count; n++) {
+    const size_t i = (first + n) % count;
+    Usermod *mod = _usermod_table_begin[i];
+    usermodStats &st = _umStats[i];
+    const unsigned period = mod->getLoopPeriod();
+    if (period && now - st.lastRun < period) continue; // not due
+    const bool fits = st.measured && micros() - passStart + st.peakUs <= WLED_USERMOD_LOOP_BUDGET;
+    if (!fits && overrun) {
+      st.deferred++;
+      continue; // try again on next pass
+    }
+    runUsermodLoop(mod, st, now);
+    if (!fits) overrun = true;
+  }
+  if (count) first = (first + 1) % count;
+}
+
 //Usermod Manager internals
-void UsermodManager::setup()             { for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) (*mod)->setup(); }
+void UsermodManager::setup()             {
+  if (!_umStats && getCount()) _umStats = static_cast<usermodStats*>(calloc(getCount(), sizeof(usermodStats)));
+  _umWindowStart = millis();
+  for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) (*mod)->setup();
+}
 void UsermodManager::connected()         { for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) (*mod)->connected(); }
-void UsermodManager::loop()              { for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) (*mod)->loop();  }
 void UsermodManager::handleOverlayDraw() { for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) (*mod)->handleOverlayDraw(); }
 void UsermodManager::appendConfigData(Print& dest)  { for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) (*mod)->appendConfigData(dest); }
 bool UsermodManager::handleButton(uint8_t b) {
@@ -41,8 +121,18 @@ bool UsermodManager::getUMData(um_data_t **data, uint8_t mod_id) {
 void UsermodManager::addToJsonState(JsonObject& obj)    { for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) (*mod)->addToJsonState(obj); }
 void UsermodManager::addToJsonInfo(JsonObject& obj)     {
   auto um_id_list = obj.createNestedArray("um");  
+  // loop statistics in same order as "um": [avg us, max us, CPU share in per mille, deferred runs] (last window)
+  auto um_load = obj.createNestedArray(F("umload"));
   for (auto mod = _usermod_table_begin; mod < _usermod_table_end; ++mod) {
     um_id_list.add((*mod)->getId());
+    if (_umStats) {
+      const usermodStats &st = _umStats[mod - _usermod_table_begin];
+      JsonArray load = um_load.createNestedArray();
+      load.add(st.avgUs);
+      load.add(st.maxUs);
+      load.add(st.share);
+      load.add(st.deferred);
+    }
     (*mod)->addToJsonInfo(obj);
   }
 }
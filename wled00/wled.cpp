@@ -34,43 +34,18 @@ void WLED::reset()
   ESP.restart();
 }
 
-void WLED::loop()
-{
-  static uint32_t      lastHeap = UINT32_MAX;
-  static unsigned long heapTime = 0;
+// Main loop scheduling
+// Strip rendering is serviced first whenever its frame is due so frame start does not depend on network or usermod load.
+// The remaining handlers are background tasks (see runLoopTasks()) that fill the slack until the next frame.
+
+static bool stripNotRealtime() { return !realtimeMode || realtimeOverride || (realtimeMode && useMainSegmentOnly); } // block stuff if WARLS/Adalight is enabled
+
 #ifdef WLED_DEBUG
-  static unsigned long lastRun = 0;
-  unsigned long        loopMillis = millis();
-  size_t               loopDelay = loopMillis - lastRun;
-  if (lastRun == 0) loopDelay=0; // startup - don't have valid data from last run.
-  if (loopDelay > 2) DEBUG_PRINTF_P(PSTR("Loop delayed more than %ums.\n"), loopDelay);
-  static unsigned long maxLoopMillis = 0;
-  static size_t        avgLoopMillis = 0;
-  static unsigned long maxUsermodMillis = 0;
-  static size_t        avgUsermodMillis = 0;
-  static unsigned long maxStripMillis = 0;
-  static size_t        avgStripMillis = 0;
-  unsigned long        stripMillis;
+static unsigned long maxUsermodMillis = 0;
+static size_t        avgUsermodMillis = 0;
 #endif
 
-  handleTime();
-  #ifndef WLED_DISABLE_INFRARED
-  handleIR();        // 2nd call to function needed for ESP32 to return valid results -- should be good for ESP8266, too
-  #endif
-  handleConnection();
-  #ifdef WLED_ENABLE_ADALIGHT
-  handleSerial();
-  #endif
-  handleImprovWifiScan();
-  handleNotifications();
-  handleTransitions();
-  #ifdef WLED_ENABLE_DMX
-  handleDMXOutput();
-  #endif
-  #ifdef WLED_ENABLE_DMX_INPUT
-  dmxInput.update();
-  #endif
-
+static void loopUsermods() {
   #ifdef WLED_DEBUG
   unsigned long usermodMillis = millis();
   #endif
@@ -81,60 +56,105 @@ void WLED::loop()
   avgUsermodMillis += usermodMillis;
   if (usermodMillis > maxUsermodMillis) maxUsermodMillis = usermodMillis;
   #endif
+}
 
-  yield();
-  handleIO();
+static loopTask loopTasks[] = {
+  //  function                                       ready predicate                                       period defer perf
+  { handleTime,                                      nullptr,                                                  0,  0, 255 },
+  #ifndef WLED_DISABLE_INFRARED
+  { handleIR,                                        nullptr,                                                  0,  0, 255 }, // 2nd call to function needed for ESP32 to return valid results -- should be good for ESP8266, too
+  #endif
+  { []{ WLED::instance().handleConnection(); },      nullptr,                                                  0,  0, 255 },
+  #ifdef WLED_ENABLE_ADALIGHT
+  { handleSerial,                                    nullptr,                                                  0,  0, 255 },
+  #endif
+  { handleImprovWifiScan,                            nullptr,                                                  0,  0, 255 },
+  { handleNotifications,                             nullptr,                                                  0,  0, PERF_NETWORK },
+  #ifndef WLED_DISABLE_ESPNOW
+  { handleEspNowStream,                              nullptr,                                                  0,  0, PERF_NETWORK },
+  #endif
+  { handleTimeSync,                                  nullptr,                                                  0,  0, 255 },
+  #ifndef WLED_DISABLE_MQTT
+  { handleMqtt,                                      nullptr,                                                  0,  0, 255 },
+  #endif
+  { handleTransitions,                               nullptr,                                                  0,  0, 255 },
+  #ifdef WLED_ENABLE_DMX
+  { handleDMXOutput,                                 nullptr,                                                  0,  0, 255 },
+  #endif
+  #ifdef WLED_ENABLE_DMX_INPUT
+  { []{ dmxInput.update(); },                        nullptr,                                                  0,  0, 255 },
+  #endif
+  { loopUsermods,                                    nullptr,                                                  0, 10, PERF_USERMODS },
+  { handleIO,                                        nullptr,                                                  0,  0, 255 },
   #ifndef WLED_DISABLE_INFRARED
-  handleIR();
+  { handleIR,                                        nullptr,                                                  0,  0, 255 },
   #endif
   #ifndef WLED_DISABLE_ESPNOW
-  handleRemote();
+  { handleRemote,                                    nullptr,                                                  0,  0, 255 },
   #endif
   #ifndef WLED_DISABLE_ALEXA
-  handleAlexa();
+  { handleAlexa,                                     nullptr,                                                  0, 20, 255 },
   #endif
-
-  if (doCloseFile) {
-    closeFile();
-    yield();
+  { closeFile,                                       []{ return doCloseFile; },                                0,  0, 255 },
+  { []{ dnsServer.processNextRequest(); },           []{ return apActive && stripNotRealtime(); },             0, 20, 255 },
+  #ifndef WLED_DISABLE_OTA
+  { []{ ArduinoOTA.handle(); },                      []{ return WLED_CONNECTED && aOtaEnabled && !otaLock && correctPIN && stripNotRealtime(); }, 0, 20, 255 },
+  #endif
+  { handleNightlight,                                stripNotRealtime,                                         0, 20, 255 },
+  #ifndef WLED_DISABLE_HUESYNC
+  { handleHue,                                       stripNotRealtime,                                         0, 50, 255 },
+  #endif
+  { handlePlaylist,                                  []{ return stripNotRealtime() && !presetNeedsSaving(); }, 0,  0, 255 },
+  { handlePresets,                                   stripNotRealtime,                                         0,  0, 255 },
+};
+
+// renders next frame of the strip if it is due
+static void serviceStrip() {
+  if (!stripNotRealtime()) return;
+  if (!offMode || strip.isOffRefreshRequired() || strip.needsUpdate()) {
+    strip.service();
+    #ifdef WLED_ENABLE_FSEQ
+    handleFseqPrefetch(); // read next sequence frames while there is time until next frame is due
+    #endif
   }
+  #ifdef ESP8266
+  else if (!noWifiSleep)
+    delay(1); //required to make sure ESP enters modem sleep (see #1184)
+  #endif
+}
 
+void WLED::loop()
+{
+  static uint32_t      lastHeap = UINT32_MAX;
+  static unsigned long heapTime = 0;
+#ifdef WLED_DEBUG
+  static unsigned long lastRun = 0;
+  unsigned long        loopMillis = millis();
+  size_t               loopDelay = loopMillis - lastRun;
+  if (lastRun == 0) loopDelay=0; // startup - don't have valid data from last run.
+  if (loopDelay > 2) DEBUG_PRINTF_P(PSTR("Loop delayed more than %ums.\n"), loopDelay);
+  static unsigned long maxLoopMillis = 0;
+  static size_t        avgLoopMillis = 0;
+  static unsigned long maxStripMillis = 0;
+  static size_t        avgStripMillis = 0;
+  unsigned long        stripMillis;
+#endif
+  uint32_t loopStart = perfStart();
+
+  // frame deadline first
   #ifdef WLED_DEBUG
   stripMillis = millis();
   #endif
-  if (!realtimeMode || realtimeOverride || (realtimeMode && useMainSegmentOnly))  // block stuff if WARLS/Adalight is enabled
-  {
-    if (apActive) dnsServer.processNextRequest();
-    #ifndef WLED_DISABLE_OTA
-    if (WLED_CONNECTED && aOtaEnabled && !otaLock && correctPIN) ArduinoOTA.handle();
-    #endif
-    handleNightlight();
-    yield();
-
-    #ifndef WLED_DISABLE_HUESYNC
-    handleHue();
-    yield();
-    #endif
-
-    if (!presetNeedsSaving()) {
-      handlePlaylist();
-      yield();
-    }
-    handlePresets();
-    yield();
-
-    if (!offMode || strip.isOffRefreshRequired() || strip.needsUpdate())
-      strip.service();
-    #ifdef ESP8266
-    else if (!noWifiSleep)
-      delay(1); //required to make sure ESP enters modem sleep (see #1184)
-    #endif
-  }
+  serviceStrip();
   #ifdef WLED_DEBUG
   stripMillis = millis() - stripMillis;
   avgStripMillis += stripMillis;
   if (stripMillis > maxStripMillis) maxStripMillis = stripMillis;
   #endif
+  yield();
+
+  // background work fills the slack
+  runLoopTasks(loopTasks, sizeof(loopTasks) / sizeof(loopTasks[0]));
 
   yield();
 #ifdef ESP8266
@@ -226,12 +246,14 @@ void WLED::loop()
   if (doReboot && (!doInitBusses || !configNeedsWrite)) // if busses have to be inited & saved, wait until next iteration
     reset();
 
+  perfEnd(PERF_LOOP, loopStart);
+  perfDecay();
+
 // DEBUG serial logging (every 30s)
 #ifdef WLED_DEBUG
   loopMillis = millis() - loopMillis;
   if (loopMillis > 30) {
     DEBUG_PRINTF_P(PSTR("Loop took %lums.\n"), loopMillis);
-    DEBUG_PRINTF_P(PSTR("Usermods took %lums.\n"), usermodMillis);
     DEBUG_PRINTF_P(PSTR("Strip took %lums.\n"), stripMillis);
   }
   avgLoopMillis += loopMillis;
@@ -265,6 +287,7 @@ void WLED::loop()
       DEBUG_PRINTF_P(PSTR("Loop time[ms]: %u/%lu\n"), avgLoopMillis/loops,    maxLoopMillis);
       DEBUG_PRINTF_P(PSTR("UM time[ms]: %u/%lu\n"),   avgUsermodMillis/loops, maxUsermodMillis);
       DEBUG_PRINTF_P(PSTR("Strip time[ms]:%u/%lu\n"), avgStripMillis/loops,   maxStripMillis);
+      DEBUG_PRINTF_P(PSTR("Missed frames: %u\n"),     strip.getMissedDeadlines());
     }
     strip.printSize();
     server.printStatus(DEBUGOUT);
@@ -321,6 +344,9 @@ void WLED::setup()
   #ifdef WLED_BOOTUPDELAY
   delay(WLED_BOOTUPDELAY); // delay to let voltage stabilize, helps with boot issues on some setups
   #endif
+  #if !ARDUINO_USB_CDC_ON_BOOT
+  Serial.setRxBufferSize(SERIAL_RX_BUFFER_SIZE); // room for a complete block of Adalight/TPM2 data at high baud rates
+  #endif
   Serial.begin(115200);
   #if !ARDUINO_USB_CDC_ON_BOOT
   Serial.setTimeout(50);  // this causes troubles on new MCUs that have a "virtual" USB Serial (HWCDC)
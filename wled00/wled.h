@@ -191,7 +191,9 @@ using PSRAMDynamicJsonDocument = BasicJsonDocument<PSRAM_Allocator>;
 #include "const.h"
 #include "fcn_declare.h"
 #include "NodeStruct.h"
+#include "snapshot.h"
 #include "pin_manager.h"
+#include "perf.h"
 #include "bus_manager.h"
 #include "FX.h"
 
@@ -441,7 +443,7 @@ WLED_GLOBAL bool simplifiedUI          _INIT(false);   // enable simplified UI
 WLED_GLOBAL byte cacheInvalidate       _INIT(0);       // used to invalidate browser cache
 
 // Sync CONFIG
-WLED_GLOBAL NodesMap Nodes;
+WLED_GLOBAL NodesTable Nodes;
 WLED_GLOBAL bool nodeListEnabled _INIT(true);
 WLED_GLOBAL bool nodeBroadcastEnabled _INIT(true);
 
@@ -517,6 +519,9 @@ WLED_GLOBAL char mqttPass[65] _INIT("");                   // optional: password
 WLED_GLOBAL char mqttClientID[41] _INIT("");               // override the client ID
 WLED_GLOBAL uint16_t mqttPort _INIT(1883);
 WLED_GLOBAL bool retainMqttMsg _INIT(false);               // retain brightness and color
+WLED_GLOBAL bool mqttJsonState _INIT(false);               // also publish compact JSON state to <device>/state
+WLED_GLOBAL uint16_t mqttMinInterval _INIT(250);           // ms, state changes within this time are published together
+WLED_GLOBAL uint16_t mqttMaxInterval _INIT(0);             // s, JSON state is republished at least this often (0 = only on change)
 #define WLED_MQTT_CONNECTED (mqtt != nullptr && mqtt->connected())
 #else
 #define WLED_MQTT_CONNECTED false
@@ -541,6 +546,8 @@ WLED_GLOBAL bool     serialCanTX _INIT(false);
 WLED_GLOBAL bool enableESPNow        _INIT(false);  // global on/off for ESP-NOW
 WLED_GLOBAL byte statusESPNow        _INIT(ESP_NOW_STATE_UNINIT); // state of ESP-NOW stack (0 uninitialised, 1 initialised, 2 error)
 WLED_GLOBAL bool useESPNowSync       _INIT(false);  // use ESP-NOW wireless technology for sync
+WLED_GLOBAL byte espNowStreamMode    _INIT(ESPNOW_STREAM_OFF); // realtime pixel streaming over ESP-NOW (send as leader or receive as follower)
+WLED_GLOBAL bool espNowStreamDelta   _INIT(true);   // only send changed fragments (with periodic key frames)
 //WLED_GLOBAL char linked_remote[13]   _INIT("");     // MAC of ESP-NOW remote (Wiz Mote)
 WLED_GLOBAL std::vector<std::array<char, 13>> linked_remotes; // MAC of ESP-NOW remotes (Wiz Mote)
 WLED_GLOBAL char last_signal_src[13] _INIT("");     // last seen ESP-NOW sender
@@ -786,6 +793,8 @@ WLED_GLOBAL bool     udpConnected _INIT(false);
 WLED_GLOBAL bool     udp2Connected _INIT(false);
 WLED_GLOBAL bool     udpRgbConnected _INIT(false);
 #endif
+WLED_GLOBAL bool     udpCompactSync _INIT(false); // send compact (v13) sync packets with only changed fields
+WLED_GLOBAL bool     udpLegacySync _INIT(true);   // also send plain (v12) sync packets when compact sync is enabled (for older nodes)
 
 // ui style
 WLED_GLOBAL bool showWelcomePage _INIT(false);
@@ -974,6 +983,7 @@ WLED_GLOBAL StaticJsonDocument<JSON_BUFFER_SIZE> gDoc;
 WLED_GLOBAL JsonDocument *pDoc _INIT(&gDoc);
 #endif
 WLED_GLOBAL volatile uint8_t jsonBufferLock _INIT(0);
+WLED_GLOBAL JsonStateStream jsonStateStream;  // incremental state parser for WebSocket and HTTP (does not use pDoc)
 
 // enable additional debug output
 #if defined(WLED_DEBUG_HOST)
@@ -2,6 +2,11 @@
 
 /*
  * Adalight and TPM2 handler
+ *
+ * Headers and commands are parsed byte by byte, pixel data is read from the UART buffer in blocks.
+ * Besides Adalight ("Ada", RGB) an RGBW variant "AdW" is accepted: same header and checksum
+ * followed by a frame counter byte and RGBW data (4 bytes per LED), gaps in the counter are reported as lost frames.
+ * ("Awa" is taken by HyperHDR's AWA protocol, RGB with Fletcher checksum.)
  */
 
 enum class AdaState {
@@ -11,17 +16,56 @@ enum class AdaState {
   Header_CountHi,
   Header_CountLo,
   Header_CountCheck,
-  Data_Red,
-  Data_Green,
-  Data_Blue,
+  Header_Seq,
+  Data,
   TPM2_Header_Type,
   TPM2_Header_CountHi,
   TPM2_Header_CountLo,
+  Json,
 };
 
 uint16_t currentBaud = 1152; //default baudrate 115200 (divided by 100)
 bool continuousSendLED = false;
 uint32_t lastUpdate = 0;
+static JsonStateStream serialJson; // JSON API commands are applied while they arrive
+
+#define SERIAL_BLOCK_SIZE 128 // pixel data bytes read from UART buffer at once
+
+static uint32_t serialRemaining = 0;  // pixel data bytes left in current frame
+static uint16_t serialPixel = 0;      // next pixel index
+static uint8_t  serialStride = 3;     // bytes per pixel (3 RGB, 4 RGBW)
+static uint8_t  serialPart[4];        // pixel split across blocks
+static uint8_t  serialPartLen = 0;
+static uint8_t  serialSeq = 0;        // expected "AdW" frame counter
+static uint32_t serialLost = 0;       // "AdW" frames lost
+
+static inline void putSerialPixel(const uint8_t *p) {
+  setRealtimePixel(serialPixel++, p[0], p[1], p[2], serialStride == 4 ? p[3] : 0);
+}
+
+// decodes a block of pixel data (any length, pixels may be split across blocks)
+static void decodeSerialPixels(const uint8_t *data, size_t len) {
+  if (realtimeOverride) return;
+  while (serialPartLen && len) {
+    serialPart[serialPartLen++] = *data++;
+    len--;
+    if (serialPartLen == serialStride) { putSerialPixel(serialPart); serialPartLen = 0; }
+  }
+  for (; len >= serialStride; len -= serialStride, data += serialStride) putSerialPixel(data);
+  while (len--) serialPart[serialPartLen++] = *data++;
+}
+
+static void startSerialFrame(uint32_t bytes, uint8_t stride) {
+  serialRemaining = bytes;
+  serialStride    = stride;
+  serialPixel     = 0;
+  serialPartLen   = 0;
+}
+
+static void endSerialFrame() {
+  realtimeLock(realtimeTimeoutMs, REALTIME_MODE_ADALIGHT);
+  if (!realtimeOverride) strip.show();
+}
 
 void updateBaudRate(uint32_t rate){
   unsigned rate100 = rate/100;
@@ -67,20 +111,53 @@ void sendBytes(){
   }
 }
 
+static void endSerialJson()
+{
+  bool verboseResponse = false;
+  if (!serialJson.end(&Serial, verboseResponse)) {
+    if (serialCanTX) Serial.printf_P(PSTR("{\"error\":%d}\n"), ERR_JSON);
+    return;
+  }
+  //only send response if TX pin is unused for other purposes
+  if (verboseResponse && serialCanTX && requestJSONBufferLock(16)) {
+    JsonObject stateDoc = pDoc->createNestedObject("state");
+    serializeState(stateDoc);
+    JsonObject info  = pDoc->createNestedObject("info");
+    serializeInfo(info);
+
+    serializeJson(*pDoc, Serial);
+    Serial.println();
+    releaseJSONBufferLock();
+  }
+}
+
 void handleSerial()
 {
   if (!(serialCanRX && Serial)) return; // arduino docs: `if (Serial)` indicates whether or not the USB CDC serial connection is open. For all non-USB CDC ports, this will always return true
 
   static auto state = AdaState::Header_A;
-  static uint16_t count = 0;
-  static uint16_t pixel = 0;
+  static uint32_t count = 0;
   static byte check = 0x00;
-  static byte red   = 0x00;
-  static byte green = 0x00;
+  static bool rgbw = false;
+  static unsigned long serialJsonLast = 0;
 
   while (Serial.available() > 0)
   {
-    yield();
+    if (state == AdaState::Data) {
+      // bulk read of pixel data, no per byte state handling
+      uint8_t block[SERIAL_BLOCK_SIZE];
+      size_t len = min(min((size_t)Serial.available(), sizeof(block)), (size_t)serialRemaining);
+      len = Serial.readBytes(block, len);
+      decodeSerialPixels(block, len);
+      serialRemaining -= len;
+      if (serialRemaining == 0) {
+        endSerialFrame();
+        state = AdaState::Header_A;
+        break; // let main loop run between frames
+      }
+      continue;
+    }
+
     byte next = Serial.peek();
     switch (state) {
       case AdaState::Header_A:
@@ -101,28 +178,18 @@ void handleSerial()
         else if (next == 'o')  { continuousSendLED = false; } // Disable Continuous Serial Streaming
         else if (next == 'O')  { continuousSendLED = true; } // Enable Continuous Serial Streaming
         else if (next == '{')  { //JSON API
-          bool verboseResponse = false;
-          if (!requestJSONBufferLock(16)) {
-            Serial.printf_P(PSTR("{\"error\":%d}\n"), ERR_NOBUF);
-            return;
-          }
-          Serial.setTimeout(100);
-          DeserializationError error = deserializeJson(*pDoc, Serial);
-          if (!error) {
-            verboseResponse = deserializeState(pDoc->as<JsonObject>());
-            //only send response if TX pin is unused for other purposes
-            if (verboseResponse && serialCanTX) {
-              pDoc->clear();
-              JsonObject stateDoc = pDoc->createNestedObject("state");
-              serializeState(stateDoc);
-              JsonObject info  = pDoc->createNestedObject("info");
-              serializeInfo(info);
-
-              serializeJson(*pDoc, Serial);
-              Serial.println();
-            }
-          }
-          releaseJSONBufferLock();
+          if (serialJson.begin(&Serial)) {
+            serialJson.write(&Serial, &next, 1);
+            serialJsonLast = millis();
+            state = AdaState::Json;
+          } else if (serialCanTX) Serial.printf_P(PSTR("{\"error\":%d}\n"), ERR_NORAM);
+        }
+        break;
+      case AdaState::Json:
+        serialJsonLast = millis();
+        if (!serialJson.write(&Serial, &next, 1) || serialJson.isComplete()) { // done or invalid
+          endSerialJson();
+          state = AdaState::Header_A;
         }
         break;
       case AdaState::Header_d:
@@ -130,12 +197,12 @@ void handleSerial()
         else             state = AdaState::Header_A;
         break;
       case AdaState::Header_a:
-        if (next == 'a') state = AdaState::Header_CountHi;
-        else             state = AdaState::Header_A;
+        rgbw = next == 'W'; // "AdW": RGBW with frame counter
+        if (next == 'a' || rgbw) state = AdaState::Header_CountHi;
+        else                     state = AdaState::Header_A;
         break;
       case AdaState::Header_CountHi:
-        pixel = 0;
-        count = next * 0x100;
+        count = next << 8;
         check = next;
         state = AdaState::Header_CountLo;
         break;
@@ -145,8 +212,18 @@ void handleSerial()
         state = AdaState::Header_CountCheck;
         break;
       case AdaState::Header_CountCheck:
-        if (check == next) state = AdaState::Data_Red;
-        else               state = AdaState::Header_A;
+        state = AdaState::Header_A;
+        if (check != next) break;
+        startSerialFrame(count * (rgbw ? 4 : 3), rgbw ? 4 : 3);
+        state = rgbw ? AdaState::Header_Seq : AdaState::Data;
+        break;
+      case AdaState::Header_Seq:
+        if (next != serialSeq) {
+          serialLost += (uint8_t)(next - serialSeq);
+          DEBUG_PRINTF_P(PSTR("Serial: %u frame(s) lost (%u total).\n"), (unsigned)(uint8_t)(next - serialSeq), (unsigned)serialLost);
+        }
+        serialSeq = next + 1;
+        state = AdaState::Data;
         break;
       case AdaState::TPM2_Header_Type:
         state = AdaState::Header_A; //(unsupported) TPM2 command or invalid type
@@ -154,32 +231,15 @@ void handleSerial()
         else if (next == 0xAA) Serial.write(0xAC); //TPM2 ping
         break;
       case AdaState::TPM2_Header_CountHi:
-        pixel = 0;
-        count = (next * 0x100) /3;
+        count = next << 8;
         state = AdaState::TPM2_Header_CountLo;
         break;
       case AdaState::TPM2_Header_CountLo:
-        count += next /3;
-        state = AdaState::Data_Red;
+        startSerialFrame(count + next, 3); // frame size in bytes, end byte 0x36 is ignored in Header_A
+        state = AdaState::Data;
         break;
-      case AdaState::Data_Red:
-        red   = next;
-        state = AdaState::Data_Green;
-        break;
-      case AdaState::Data_Green:
-        green = next;
-        state = AdaState::Data_Blue;
-        break;
-      case AdaState::Data_Blue:
-        byte blue  = next;
-        if (!realtimeOverride) setRealtimePixel(pixel++, red, green, blue, 0);
-        if (--count > 0) state = AdaState::Data_Red;
-        else {
-          realtimeLock(realtimeTimeoutMs, REALTIME_MODE_ADALIGHT);
-
-          if (!realtimeOverride) strip.show();
-          state = AdaState::Header_A;
-        }
+      default:
+        state = AdaState::Header_A;
         break;
     }
 
@@ -189,6 +249,16 @@ void handleSerial()
     }
 
     Serial.read(); //discard the byte
+
+    if (state == AdaState::Data && serialRemaining == 0) { // empty frame
+      endSerialFrame();
+      state = AdaState::Header_A;
+    }
+  }
+
+  if (state == AdaState::Json && millis() - serialJsonLast > 100) { // incomplete JSON
+    endSerialJson();
+    state = AdaState::Header_A;
   }
 
   // If Continuous Serial Streaming is enabled, send new LED data as bytes
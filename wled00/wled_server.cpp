@@ -57,37 +57,49 @@ static bool inLocalSubnet(const IPAddress &client) {
  * Integrated HTTP web server page declarations
  */
 
-static void generateEtag(char *etag, uint16_t eTagSuffix) {
-  sprintf_P(etag, PSTR("%7d-%02x-%04x"), VERSION, cacheInvalidate, eTagSuffix);
+// content hash (generated by tools/cdata.js) if known, otherwise build version
+static void generateEtag(char *etag, uint32_t hash) {
+  if (hash) sprintf_P(etag, PSTR("%08x"), (unsigned)hash);
+  else      sprintf_P(etag, PSTR("%7d-%02x-%04x"), VERSION, cacheInvalidate, 0);
 }
 
-static void setStaticContentCacheHeaders(AsyncWebServerResponse *response, int code, uint16_t eTagSuffix = 0) {
+// sub-resources are referenced with their content hash ("common.js?v=1a2b3c4d"), such URLs never change content
+static bool isVersionedRequest(AsyncWebServerRequest *request, const char *etag) {
+  return request->hasArg(F("v")) && request->arg(F("v")) == etag;
+}
+
+static void setStaticContentCacheHeaders(AsyncWebServerRequest *request, AsyncWebServerResponse *response, int code, uint32_t hash = 0) {
   // Only send ETag for 200 (OK) responses
   if (code != 200) return;
 
+  char etag[32];
+  generateEtag(etag, hash);
   // https://medium.com/@codebyamir/a-web-developers-guide-to-browser-caching-cc41f3b73e7c
   #ifndef WLED_DEBUG
-  // this header name is misleading, "no-cache" will not disable cache,
-  // it just revalidates on every load using the "If-None-Match" header with the last ETag value
-  response->addHeader(F("Cache-Control"), F("no-cache"));
+  if (hash && isVersionedRequest(request, etag)) {
+    // no revalidation needed at all, a new build references a different URL
+    response->addHeader(F("Cache-Control"), F("public, max-age=31536000, immutable"));
+  } else {
+    // this header name is misleading, "no-cache" will not disable cache,
+    // it just revalidates on every load using the "If-None-Match" header with the last ETag value
+    response->addHeader(F("Cache-Control"), F("no-cache"));
+  }
   #else
   response->addHeader(F("Cache-Control"), F("no-store,max-age=0"));  // prevent caching if debug build
   #endif
-  char etag[32];
-  generateEtag(etag, eTagSuffix);
   response->addHeader(F("ETag"), etag);
 }
 
-static bool handleIfNoneMatchCacheHeader(AsyncWebServerRequest *request, int code, uint16_t eTagSuffix = 0) {
+static bool handleIfNoneMatchCacheHeader(AsyncWebServerRequest *request, int code, uint32_t hash = 0) {
   // Only send 304 (Not Modified) if response code is 200 (OK)
   if (code != 200) return false;
 
   AsyncWebHeader *header = request->getHeader(F("If-None-Match"));
   char etag[32];
-  generateEtag(etag, eTagSuffix);
+  generateEtag(etag, hash);
   if (header && header->value() == etag) {
     AsyncWebServerResponse *response = request->beginResponse(304);
-    setStaticContentCacheHeaders(response, code, eTagSuffix);
+    setStaticContentCacheHeaders(request, response, code, hash);
     request->send(response);
     return true;
   }
@@ -107,14 +119,14 @@ static bool handleIfNoneMatchCacheHeader(AsyncWebServerRequest *request, int cod
  * @param content Content of the web page
  * @param len Length of the content
  * @param gzip Optional. Defaults to true. If false, the gzip header will not be added.
- * @param eTagSuffix Optional. Defaults to 0. A suffix that will be added to the ETag header. This can be used to invalidate the cache for a specific page.
+ * @param hash Optional. Content hash of the page (generated by tools/cdata.js), used as ETag. If 0, the ETag is derived from the build version.
  */
-static void handleStaticContent(AsyncWebServerRequest *request, const String &path, int code, const String &contentType, const uint8_t *content, size_t len, bool gzip = true, uint16_t eTagSuffix = 0) {
+static void handleStaticContent(AsyncWebServerRequest *request, const String &path, int code, const String &contentType, const uint8_t *content, size_t len, bool gzip = true, uint32_t hash = 0) {
   if (path != "" && handleFileRead(request, path)) return;
-  if (handleIfNoneMatchCacheHeader(request, code, eTagSuffix)) return;
+  if (handleIfNoneMatchCacheHeader(request, code, hash)) return;
   AsyncWebServerResponse *response = request->beginResponse_P(code, contentType, content, len);
   if (gzip) response->addHeader(FPSTR(s_content_enc), F("gzip"));
-  setStaticContentCacheHeaders(response, code, eTagSuffix);
+  setStaticContentCacheHeaders(request, response, code, hash);
   request->send(response);
 }
 
@@ -199,6 +211,9 @@ static void handleUpload(AsyncWebServerRequest *request, const String& filename,
       request->send(200, FPSTR(CONTENT_TYPE_PLAIN), F("Configuration restore successful.\nRebooting..."));
     } else {
       if (filename.indexOf(F("palette")) >= 0 && filename.indexOf(F(".json")) >= 0) loadCustomPalettes();
+      #ifndef WLED_DISABLE_INFRARED
+      if (filename.indexOf(F("ir.json")) >= 0) reloadIRTable();
+      #endif
       request->send(200, FPSTR(CONTENT_TYPE_PLAIN), F("File Uploaded!"));
     }
     cacheInvalidate++;
@@ -252,16 +267,16 @@ void initServer()
 #ifdef WLED_ENABLE_WEBSOCKETS
   #ifndef WLED_DISABLE_2D 
   server.on(F("/liveview2D"), HTTP_GET, [](AsyncWebServerRequest *request) {
-    handleStaticContent(request, "", 200, FPSTR(CONTENT_TYPE_HTML), PAGE_liveviewws2D, PAGE_liveviewws2D_length);
+    handleStaticContent(request, "", 200, FPSTR(CONTENT_TYPE_HTML), PAGE_liveviewws2D, PAGE_liveviewws2D_length, true, PAGE_liveviewws2D_hash);
   });
   #endif
 #endif
   server.on(F("/liveview"), HTTP_GET, [](AsyncWebServerRequest *request) {
-    handleStaticContent(request, "", 200, FPSTR(CONTENT_TYPE_HTML), PAGE_liveview, PAGE_liveview_length);
+    handleStaticContent(request, "", 200, FPSTR(CONTENT_TYPE_HTML), PAGE_liveview, PAGE_liveview_length, true, PAGE_liveview_hash);
   });
 
   server.on(_common_js, HTTP_GET, [](AsyncWebServerRequest *request) {
-    handleStaticContent(request, FPSTR(_common_js), 200, FPSTR(CONTENT_TYPE_JAVASCRIPT), JS_common, JS_common_length);
+    handleStaticContent(request, FPSTR(_common_js), 200, FPSTR(CONTENT_TYPE_JAVASCRIPT), JS_common, JS_common_length, true, JS_common_hash);
   });
 
   //settings page
@@ -272,12 +287,12 @@ void initServer()
   // "/settings/settings.js&p=x" request also handled by serveSettings()
   static const char _style_css[] PROGMEM = "/style.css";
   server.on(_style_css, HTTP_GET, [](AsyncWebServerRequest *request) {
-    handleStaticContent(request, FPSTR(_style_css), 200, FPSTR(CONTENT_TYPE_CSS), PAGE_settingsCss, PAGE_settingsCss_length);
+    handleStaticContent(request, FPSTR(_style_css), 200, FPSTR(CONTENT_TYPE_CSS), PAGE_settingsCss, PAGE_settingsCss_length, true, PAGE_settingsCss_hash);
   });
 
   static const char _favicon_ico[] PROGMEM = "/favicon.ico";
   server.on(_favicon_ico, HTTP_GET, [](AsyncWebServerRequest *request) {
-    handleStaticContent(request, FPSTR(_favicon_ico), 200, F("image/x-icon"), favicon, favicon_length, false);
+    handleStaticContent(request, FPSTR(_favicon_ico), 200, F("image/x-icon"), favicon, favicon_length, false, favicon_hash);
   });
 
   static const char _skin_css[] PROGMEM = "/skin.css";
@@ -305,6 +320,24 @@ void initServer()
     serveJson(request);
   });
 
+  // state is applied while the body arrives without using the JSON buffer (must be registered before /json handler)
+  server.on(F("/json/state"), HTTP_POST, [](AsyncWebServerRequest *request) {
+    bool verboseResponse = false;
+    if (!jsonStateStream.end(request, verboseResponse)) {
+      serveJsonError(request, 400, ERR_JSON);
+      return;
+    }
+    if (verboseResponse) {
+      lastInterfaceUpdate = millis(); // prevent WS update until cooldown
+      interfaceUpdateCallMode = CALL_MODE_WS_SEND; // schedule WS update
+      serveJson(request); return; //if JSON contains "v"
+    }
+    request->send(200, CONTENT_TYPE_JSON, F("{\"success\":true}"));
+  }, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    if (!index) jsonStateStream.begin(request, CALL_MODE_DIRECT_CHANGE, true); // "pin" is accepted like in /json
+    jsonStateStream.write(request, data, len);
+  });
+
   AsyncCallbackJsonWebHandler* handler = new AsyncCallbackJsonWebHandler(FPSTR(_json), [](AsyncWebServerRequest *request) {
     bool verboseResponse = false;
     bool isConfig = false;
@@ -357,6 +390,15 @@ void initServer()
   }, JSON_BUFFER_SIZE);
   server.addHandler(handler);
 
+  // binary pixel upload, see pixelstream.cpp
+  server.on(F("/px"), HTTP_POST, [](AsyncWebServerRequest *request) {
+    if (pixelStreamEnd(request) < 0) serveJsonError(request, 400, ERR_JSON);
+    else request->send(200, CONTENT_TYPE_JSON, F("{\"success\":true}"));
+  }, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+    if (!index && !pixelStreamBegin(request)) return; // another upload in progress, reported by pixelStreamEnd()
+    pixelStreamWrite(request, data, len);
+  });
+
   server.on(F("/version"), HTTP_GET, [](AsyncWebServerRequest *request){
     request->send(200, FPSTR(CONTENT_TYPE_PLAIN), (String)VERSION);
   });
@@ -371,7 +413,7 @@ void initServer()
 
 #ifdef WLED_ENABLE_USERMOD_PAGE
   server.on("/u", HTTP_GET, [](AsyncWebServerRequest *request) {
-    handleStaticContent(request, "", 200, FPSTR(CONTENT_TYPE_HTML), PAGE_usermod, PAGE_usermod_length);
+    handleStaticContent(request, "", 200, FPSTR(CONTENT_TYPE_HTML), PAGE_usermod, PAGE_usermod_length, true, PAGE_usermod_hash);
   });
 #endif
 
@@ -460,7 +502,7 @@ void initServer()
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
     if (captivePortal(request)) return;
     if (!showWelcomePage || request->hasArg(F("sliders"))) {
-      handleStaticContent(request, F("/index.htm"), 200, FPSTR(CONTENT_TYPE_HTML), PAGE_index, PAGE_index_L);
+      handleStaticContent(request, F("/index.htm"), 200, FPSTR(CONTENT_TYPE_HTML), PAGE_index, PAGE_index_L, true, PAGE_index_H);
     } else {
       serveSettings(request);
     }
@@ -469,20 +511,20 @@ void initServer()
 #ifdef WLED_ENABLE_PIXART
   static const char _pixart_htm[] PROGMEM = "/pixart.htm";
   server.on(_pixart_htm, HTTP_GET, [](AsyncWebServerRequest *request) {
-    handleStaticContent(request, FPSTR(_pixart_htm), 200, FPSTR(CONTENT_TYPE_HTML), PAGE_pixart, PAGE_pixart_L);
+    handleStaticContent(request, FPSTR(_pixart_htm), 200, FPSTR(CONTENT_TYPE_HTML), PAGE_pixart, PAGE_pixart_L, true, PAGE_pixart_H);
   });
 #endif
 
 #ifndef WLED_DISABLE_PXMAGIC
   static const char _pxmagic_htm[] PROGMEM = "/pxmagic.htm";
   server.on(_pxmagic_htm, HTTP_GET, [](AsyncWebServerRequest *request) {
-    handleStaticContent(request, FPSTR(_pxmagic_htm), 200, FPSTR(CONTENT_TYPE_HTML), PAGE_pxmagic, PAGE_pxmagic_L);
+    handleStaticContent(request, FPSTR(_pxmagic_htm), 200, FPSTR(CONTENT_TYPE_HTML), PAGE_pxmagic, PAGE_pxmagic_L, true, PAGE_pxmagic_H);
   });
 #endif
 
   static const char _cpal_htm[] PROGMEM = "/cpal.htm";
   server.on(_cpal_htm, HTTP_GET, [](AsyncWebServerRequest *request) {
-    handleStaticContent(request, FPSTR(_cpal_htm), 200, FPSTR(CONTENT_TYPE_HTML), PAGE_cpal, PAGE_cpal_L);
+    handleStaticContent(request, FPSTR(_cpal_htm), 200, FPSTR(CONTENT_TYPE_HTML), PAGE_cpal, PAGE_cpal_L, true, PAGE_cpal_H);
   });
 
 #ifdef WLED_ENABLE_WEBSOCKETS
@@ -507,7 +549,7 @@ void initServer()
     #ifndef WLED_DISABLE_ALEXA
     if(espalexa.handleAlexaApiCall(request)) return;
     #endif
-    handleStaticContent(request, request->url(), 404, FPSTR(CONTENT_TYPE_HTML), PAGE_404, PAGE_404_length);
+    handleStaticContent(request, request->url(), 404, FPSTR(CONTENT_TYPE_HTML), PAGE_404, PAGE_404_length, true, PAGE_404_hash);
   });
 }
 
@@ -538,7 +580,7 @@ void serveJsonError(AsyncWebServerRequest* request, uint16_t code, uint16_t erro
 void serveSettingsJS(AsyncWebServerRequest* request)
 {
   if (request->url().indexOf(FPSTR(_common_js)) > 0) {
-    handleStaticContent(request, FPSTR(_common_js), 200, FPSTR(CONTENT_TYPE_JAVASCRIPT), JS_common, JS_common_length);
+    handleStaticContent(request, FPSTR(_common_js), 200, FPSTR(CONTENT_TYPE_JAVASCRIPT), JS_common, JS_common_length, true, JS_common_hash);
     return;
   }
   byte subPage = request->arg(F("p")).toInt();
@@ -551,13 +593,18 @@ void serveSettingsJS(AsyncWebServerRequest* request)
     return;
   }
   
-  AsyncResponseStream *response = request->beginResponseStream(FPSTR(CONTENT_TYPE_JAVASCRIPT));
+  // script is generated once and sent from memory: changes (GPIO, network...) during the transfer cannot corrupt it
+  SnapshotPrint snap;
+  snap.print(F("function GetV(){var d=document;"));
+  getSettingsJS(subPage, snap);
+  snap.print(F("}"));
+  if (snap.failed()) {
+    request->send_P(503, FPSTR(CONTENT_TYPE_JAVASCRIPT), PSTR("alert('Not enough memory.');"));
+    return;
+  }
+  AsyncWebServerResponse *response = beginSnapshotResponse(request, FPSTR(CONTENT_TYPE_JAVASCRIPT), snap);
   response->addHeader(F("Cache-Control"), F("no-store"));
   response->addHeader(F("Expires"), F("0"));
-
-  response->print(F("function GetV(){var d=document;"));
-  getSettingsJS(subPage, *response);
-  response->print(F("}"));
   request->send(response);
 }
 
@@ -645,19 +692,20 @@ void serveSettings(AsyncWebServerRequest* request, bool post) {
   String contentType = FPSTR(CONTENT_TYPE_HTML);
   const uint8_t* content;
   size_t len;
+  uint32_t hash;
 
   switch (subPage) {
-    case SUBPAGE_WIFI    :  content = PAGE_settings_wifi; len = PAGE_settings_wifi_length; break;
-    case SUBPAGE_LEDS    :  content = PAGE_settings_leds; len = PAGE_settings_leds_length; break;
-    case SUBPAGE_UI      :  content = PAGE_settings_ui;   len = PAGE_settings_ui_length;   break;
-    case SUBPAGE_SYNC    :  content = PAGE_settings_sync; len = PAGE_settings_sync_length; break;
-    case SUBPAGE_TIME    :  content = PAGE_settings_time; len = PAGE_settings_time_length; break;
-    case SUBPAGE_SEC     :  content = PAGE_settings_sec;  len = PAGE_settings_sec_length;  break;
+    case SUBPAGE_WIFI    :  content = PAGE_settings_wifi; len = PAGE_settings_wifi_length; hash = PAGE_settings_wifi_hash; break;
+    case SUBPAGE_LEDS    :  content = PAGE_settings_leds; len = PAGE_settings_leds_length; hash = PAGE_settings_leds_hash; break;
+    case SUBPAGE_UI      :  content = PAGE_settings_ui;   len = PAGE_settings_ui_length;   hash = PAGE_settings_ui_hash;   break;
+    case SUBPAGE_SYNC    :  content = PAGE_settings_sync; len = PAGE_settings_sync_length; hash = PAGE_settings_sync_hash; break;
+    case SUBPAGE_TIME    :  content = PAGE_settings_time; len = PAGE_settings_time_length; hash = PAGE_settings_time_hash; break;
+    case SUBPAGE_SEC     :  content = PAGE_settings_sec;  len = PAGE_settings_sec_length;  hash = PAGE_settings_sec_hash;  break;
 #ifdef WLED_ENABLE_DMX
-    case SUBPAGE_DMX     :  content = PAGE_settings_dmx;  len = PAGE_settings_dmx_length;  break;
+    case SUBPAGE_DMX     :  content = PAGE_settings_dmx;  len = PAGE_settings_dmx_length;  hash = PAGE_settings_dmx_hash;  break;
 #endif
-    case SUBPAGE_UM      :  content = PAGE_settings_um;   len = PAGE_settings_um_length;   break;
-    case SUBPAGE_UPDATE  :  content = PAGE_update;        len = PAGE_update_length;
+    case SUBPAGE_UM      :  content = PAGE_settings_um;   len = PAGE_settings_um_length;   hash = PAGE_settings_um_hash;   break;
+    case SUBPAGE_UPDATE  :  content = PAGE_update;        len = PAGE_update_length;        hash = PAGE_update_hash;
       #ifdef ARDUINO_ARCH_ESP32
       if (request->hasArg(F("revert")) && inLocalSubnet(request->client()->remoteIP()) && Update.canRollBack()) {
         doReboot = Update.rollBack();
@@ -671,7 +719,7 @@ void serveSettings(AsyncWebServerRequest* request, bool post) {
       #endif
       break;
 #ifndef WLED_DISABLE_2D
-    case SUBPAGE_2D      :  content = PAGE_settings_2D;   len = PAGE_settings_2D_length;   break;
+    case SUBPAGE_2D      :  content = PAGE_settings_2D;   len = PAGE_settings_2D_length;   hash = PAGE_settings_2D_hash;   break;
 #endif
     case SUBPAGE_LOCK    : {
       correctPIN = !strlen(settingsPIN); // lock if a pin is set
@@ -679,11 +727,11 @@ void serveSettings(AsyncWebServerRequest* request, bool post) {
       serveMessage(request, 200, strlen(settingsPIN) > 0 ? PSTR("Settings locked") : PSTR("No PIN set"), FPSTR(s_redirecting), 1);
       return;
     }
-    case SUBPAGE_PINREQ  :  content = PAGE_settings_pin;  len = PAGE_settings_pin_length; code = 401;                 break;
-    case SUBPAGE_CSS     :  content = PAGE_settingsCss;   len = PAGE_settingsCss_length;  contentType = FPSTR(CONTENT_TYPE_CSS); break;
+    case SUBPAGE_PINREQ  :  content = PAGE_settings_pin;  len = PAGE_settings_pin_length; hash = PAGE_settings_pin_hash; code = 401; break;
+    case SUBPAGE_CSS     :  content = PAGE_settingsCss;   len = PAGE_settingsCss_length;  hash = PAGE_settingsCss_hash;  contentType = FPSTR(CONTENT_TYPE_CSS); break;
     case SUBPAGE_JS      :  serveSettingsJS(request); return;
-    case SUBPAGE_WELCOME :  content = PAGE_welcome;       len = PAGE_welcome_length;       break;
-    default:                content = PAGE_settings;      len = PAGE_settings_length;      break;
+    case SUBPAGE_WELCOME :  content = PAGE_welcome;       len = PAGE_welcome_length;       hash = PAGE_welcome_hash;       break;
+    default:                content = PAGE_settings;      len = PAGE_settings_length;      hash = PAGE_settings_hash;      break;
   }
-  handleStaticContent(request, "", code, contentType, content, len);
+  handleStaticContent(request, "", code, contentType, content, len, true, hash);
 }
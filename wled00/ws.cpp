@@ -7,9 +7,11 @@
 
 uint16_t wsLiveClientId = 0;
 unsigned long wsLastLiveTime = 0;
-//uint8_t* wsFrameBuffer = nullptr;
+uint16_t wsPerfClientId = 0;
+unsigned long wsLastPerfTime = 0;
 
 #define WS_LIVE_INTERVAL 40
+#define WS_PERF_INTERVAL 1000
 
 void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventType type, void * arg, uint8_t *data, size_t len)
 {
@@ -20,10 +22,24 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
   } else if(type == WS_EVT_DISCONNECT){
     //client disconnected
     if (client->id() == wsLiveClientId) wsLiveClientId = 0;
+    if (client->id() == wsPerfClientId) wsPerfClientId = 0;
     DEBUG_PRINTLN(F("WS client disconnected."));
   } else if(type == WS_EVT_DATA){
     // data packet
     AwsFrameInfo * info = (AwsFrameInfo*)arg;
+    if(info->message_opcode == WS_BINARY){
+      // binary pixel upload, decoded as it arrives (may span multiple frames)
+      if (info->num == 0 && info->index == 0 && !pixelStreamBegin(client)) {
+        client->text(F("{\"error\":2}")); // ERR_CONCURRENCY
+        return;
+      }
+      pixelStreamWrite(client, data, len);
+      if (info->final && (info->index + len) == info->len) {
+        if (pixelStreamEnd(client) < 0) client->text(F("{\"error\":9}")); // ERR_JSON
+        else                            client->text(F("{\"success\":true}"));
+      }
+      return;
+    }
     if(info->final && info->index == 0 && info->len == len){
       // the whole message is in a single frame and we got all of its data (max. 1450 bytes)
       if(info->opcode == WS_TEXT)
@@ -52,6 +68,8 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
           verboseResponse = true;
         } else if (root.containsKey("lv")) {
           wsLiveClientId = root["lv"] ? client->id() : 0;
+        } else if (root.containsKey(F("perf"))) {
+          wsPerfClientId = root[F("perf")] ? client->id() : 0; // stream /json/perf content every second
         } else {
           verboseResponse = deserializeState(root);
         }
@@ -70,19 +88,16 @@ void wsEvent(AsyncWebSocket * server, AsyncWebSocketClient * client, AwsEventTyp
       }
     } else {
       //message is comprised of multiple frames or the frame is split into multiple packets
-      //if(info->index == 0){
-        //if (!wsFrameBuffer && len < 4096) wsFrameBuffer = new uint8_t[4096];
-      //}
-
-      //if (wsFrameBuffer && len < 4096 && info->index + info->)
-      //{
-
-      //}
-
-      if((info->index + len) == info->len){
-        if(info->final){
-          if(info->message_opcode == WS_TEXT) {
-            client->text(F("{\"error\":9}")); // ERR_JSON we do not handle split packets right now
+      //JSON state is applied while it arrives (segment by segment) without using the JSON buffer
+      if (info->message_opcode == WS_TEXT) {
+        if (info->num == 0 && info->index == 0) jsonStateStream.begin(client);
+        jsonStateStream.write(client, data, len);
+        if (info->final && (info->index + len) == info->len) {
+          bool verboseResponse = false;
+          if (!jsonStateStream.end(client, verboseResponse)) client->text(F("{\"error\":9}")); // ERR_JSON
+          else if (!interfaceUpdateCallMode) {
+            if (verboseResponse) sendDataWs(client);
+            else                 client->text(F("{\"success\":true}"));
           }
         }
       }
@@ -219,6 +234,24 @@ bool sendLiveLedsWs(uint32_t wsClient)
   return true;
 }
 
+// sends timing statistics (same as /json/perf) to the subscribed client
+static bool sendPerfWs(uint32_t wsClient)
+{
+  AsyncWebSocketClient * wsc = ws.client(wsClient);
+  if (!wsc) { wsPerfClientId = 0; return true; }
+  if (wsc->queueLength() > 0 || !requestJSONBufferLock(12)) return false;
+  JsonObject perf = pDoc->createNestedObject(F("perf"));
+  serializePerf(perf);
+  size_t len = measureJson(*pDoc);
+  AsyncWebSocketBuffer buffer(len);
+  if (buffer) {
+    serializeJson(*pDoc, (char *)buffer.data(), len);
+    wsc->text(std::move(buffer));
+  }
+  releaseJSONBufferLock();
+  return true;
+}
+
 void handleWs()
 {
   if (millis() - wsLastLiveTime > WS_LIVE_INTERVAL)
@@ -233,6 +266,9 @@ void handleWs()
     wsLastLiveTime = millis();
     if (!success) wsLastLiveTime -= 20; //try again in 20ms if failed due to non-empty WS queue
   }
+  if (wsPerfClientId && millis() - wsLastPerfTime > WS_PERF_INTERVAL) {
+    if (sendPerfWs(wsPerfClientId)) wsLastPerfTime = millis();
+  }
 }
 
 #else
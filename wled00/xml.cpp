@@ -290,6 +290,7 @@ void getSettingsJS(byte subPage, Print& settingsScript)
     printSetFormCheckbox(settingsScript,PSTR("CR"),strip.cctFromRgb);
     printSetFormValue(settingsScript,PSTR("CB"),Bus::getCCTBlend());
     printSetFormValue(settingsScript,PSTR("FR"),strip.getTargetFps());
+    printSetFormCheckbox(settingsScript,PSTR("AF"),strip.isAdaptiveFps());
     printSetFormValue(settingsScript,PSTR("AW"),Bus::getGlobalAWMode());
     printSetFormCheckbox(settingsScript,PSTR("PR"),BusManager::hasParallelOutput());  // get it from bus manager not global variable
 
@@ -407,8 +408,11 @@ void getSettingsJS(byte subPage, Print& settingsScript)
     printSetFormValue(settingsScript,PSTR("UP"),udpPort);
     printSetFormValue(settingsScript,PSTR("U2"),udpPort2);
   #ifndef WLED_DISABLE_ESPNOW
-    if (enableESPNow) printSetFormCheckbox(settingsScript,PSTR("EN"),useESPNowSync);
-    else              settingsScript.print(F("toggle('ESPNOW');"));  // hide ESP-NOW setting
+    if (enableESPNow) {
+      printSetFormCheckbox(settingsScript,PSTR("EN"),useESPNowSync);
+      printSetFormValue(settingsScript,PSTR("ES"),espNowStreamMode);
+      printSetFormCheckbox(settingsScript,PSTR("ED"),espNowStreamDelta);
+    } else settingsScript.print(F("toggle('ESPNOW');"));  // hide ESP-NOW setting
   #else
     settingsScript.print(F("toggle('ESPNOW');"));  // hide ESP-NOW setting
   #endif
@@ -426,6 +430,8 @@ void getSettingsJS(byte subPage, Print& settingsScript)
     printSetFormCheckbox(settingsScript,PSTR("SB"),notifyButton);
     printSetFormCheckbox(settingsScript,PSTR("SH"),notifyHue);
     printSetFormValue(settingsScript,PSTR("UR"),udpNumRetries);
+    printSetFormCheckbox(settingsScript,PSTR("UC"),udpCompactSync);
+    printSetFormCheckbox(settingsScript,PSTR("UL"),udpLegacySync);
 
     printSetFormCheckbox(settingsScript,PSTR("NL"),nodeListEnabled);
     printSetFormCheckbox(settingsScript,PSTR("NB"),nodeBroadcastEnabled);
@@ -481,6 +487,9 @@ void getSettingsJS(byte subPage, Print& settingsScript)
     printSetFormValue(settingsScript,PSTR("MG"),mqttGroupTopic);
     printSetFormCheckbox(settingsScript,PSTR("BM"),buttonPublishMqtt);
     printSetFormCheckbox(settingsScript,PSTR("RT"),retainMqttMsg);
+    printSetFormCheckbox(settingsScript,PSTR("MJ"),mqttJsonState);
+    printSetFormValue(settingsScript,PSTR("MI"),mqttMinInterval);
+    printSetFormValue(settingsScript,PSTR("MX"),mqttMaxInterval);
     settingsScript.printf_P(PSTR("d.Sf.MD.maxLength=%d;d.Sf.MG.maxLength=%d;d.Sf.MS.maxLength=%d;"),
                   MQTT_MAX_TOPIC_LEN, MQTT_MAX_TOPIC_LEN, MQTT_MAX_SERVER_LEN);
     #else